@@ -0,0 +1,71 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*
+ * Converts a text file with one point per line, as "x y z" or
+ * "x y z r g b", to the octree file format used by the SoPointCloud
+ * node. The conversion streams the points through temporary files,
+ * so input files larger than the available memory can be converted.
+ *
+ * Build the example using this command:
+ *
+ *   coin-config --build ivpcconv ivpcconv.cpp
+ *
+ */
+
+#include <cstdio>
+
+#include <Inventor/SoDB.h>
+#include <Inventor/SbTime.h>
+#include <Inventor/nodes/SoPointCloud.h>
+
+int
+main(int argc, char ** argv)
+{
+  fprintf(stderr, "ivpcconv v0.1\n");
+
+  SoDB::init();
+
+  if (argc != 3) {
+    fprintf(stdout, "Usage: %s infile outfile\n", argv[0]);
+    return 0;
+  }
+
+  const SbTime start = SbTime::getTimeOfDay();
+  if (!SoPointCloud::convert(argv[1], argv[2])) {
+    fprintf(stderr, "error: could not convert '%s' to '%s'\n", argv[1], argv[2]);
+    return -1;
+  }
+  fprintf(stderr, "converted '%s' in %.1f seconds\n", argv[1],
+          (SbTime::getTimeOfDay() - start).getValue());
+  return 0;
+}
@@ -86,6 +86,8 @@ public:
   virtual const char * getCurFileName(void) const;
   virtual void setBuffer(const void * bufpointer, size_t bufsize);
           void setStringArray(const char * strings[]);
+  void setDeferredFieldDecoding(const SbBool flag);
+  SbBool isDeferredFieldDecoding(void) const;
   virtual size_t getNumBytesRead(void) const;
   virtual SbString getHeader(void);
   virtual float getIVVersion(void);
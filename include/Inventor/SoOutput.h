@@ -94,6 +94,7 @@ public:
   virtual void write(const unsigned short s);
   virtual void write(const float f);
   virtual void write(const double d);
+  void writeIdentifier(const char * s);
 #ifdef __CYGWIN__
   //These function are not virtual as they are meant to be only wrappers to the real function calls, due to limitations in Cygwin g++ type demangling.
   void write(long int i);
@@ -110,6 +111,8 @@ public:
   SbBool isCompact(void) const;
   void setAnnotation(uint32_t bits);
   uint32_t getAnnotation(void);
+  void setBinaryNameTable(const SbBool flag);
+  SbBool isBinaryNameTable(void) const;
 
   static SbString getDefaultASCIIHeader(void);
   static SbString getDefaultBinaryHeader(void);
@@ -76,6 +76,16 @@ typedef void SoLineSegmentCB(void * userdata, SoCallbackAction * action,
 typedef void SoPointCB(void * userdata, SoCallbackAction * action,
                        const SoPrimitiveVertex * v);
 
+typedef void SoTriangleBatchCB(void * userdata, SoCallbackAction * action,
+                               const SoShape * shape,
+                               const int numvertices,
+                               const SbVec3f * points,
+                               const SbVec3f * normals,
+                               const SbVec4f * texcoords,
+                               const int32_t * materialindices,
+                               const int numtriangles,
+                               const int32_t * indices);
+
 
 class COIN_DLL_API SoCallbackAction : public SoAction {
   typedef SoAction inherited;
@@ -107,6 +117,12 @@ public:
   void addLineSegmentCallback(const SoType type, SoLineSegmentCB * cb, void * userdata);
   void addPointCallback(const SoType type, SoPointCB * cb, void * userdata);
 
+  enum TriangleBatchSpace { OBJECT_SPACE, WORLD_SPACE };
+
+  void addTriangleBatchCallback(const SoType type, SoTriangleBatchCB * cb, void * userdata);
+  void setTriangleBatchSpace(const TriangleBatchSpace space);
+  TriangleBatchSpace getTriangleBatchSpace(void) const;
+
   SoDecimationTypeElement::Type getDecimationType(void) const;
   float getDecimationPercentage(void) const;
   float getComplexity(void) const;
@@ -173,8 +189,18 @@ public:
                                   const SoPrimitiveVertex * const v2);
   void invokePointCallbacks(const SoShape * const shape,
                             const SoPrimitiveVertex * const v);
+  void invokeTriangleBatchCallbacks(const SoShape * const shape);
+  void invokeTriangleBatchCallbacks(const SoShape * const shape,
+                                    const int numvertices,
+                                    const SbVec3f * points,
+                                    const SbVec3f * normals,
+                                    const SbVec4f * texcoords,
+                                    const int32_t * materialindices,
+                                    const int numtriangles,
+                                    const int32_t * indices);
 
   SbBool shouldGeneratePrimitives(const SoShape * shape) const;
+  SbBool shouldGenerateTriangleBatch(const SoShape * shape) const;
 
   virtual SoNode * getCurPathTail(void);
   void setCurrentNode(SoNode * const node);
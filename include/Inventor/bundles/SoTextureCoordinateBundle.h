@@ -57,6 +57,8 @@ public:
 
   const SbVec4f &get(const int index);
   const SbVec4f &get(const SbVec3f &point, const SbVec3f &normal);
+  void get(const int num, const SbVec3f * points, const SbVec3f * normals,
+           SbVec4f * result);
 
   void send(const int index) const {
     glElt->send(index);
@@ -80,6 +82,11 @@ private:
   static const SbVec4f & defaultCBMulti(void * userdata,
                                         const SbVec3f & point,
                                         const SbVec3f & normal);
+  static void defaultBatchCB(void * userdata,
+                             const int num,
+                             const SbVec3f * points,
+                             const SbVec3f * normals,
+                             SbVec4f * result);
   SoShape * shapenode;
   SbVec3f defaultorigo;
   SbVec3f defaultsize;
@@ -53,6 +53,15 @@ public:
 
   void invalidateAll(void);
 
+  int getNumCacheCalls(void) const;
+  int getNumCachesBuilt(void) const;
+  int getNumCachesDiscarded(void) const;
+  int getNumInvalidations(void) const;
+  double getAverageRenderTime(void) const;
+  double getAverageBuildTime(void) const;
+  double getAverageCallTime(void) const;
+  double getAverageLifetime(void) const;
+
 private:
   SoGLCacheListP * pimpl;
 };
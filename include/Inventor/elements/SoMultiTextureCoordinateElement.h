@@ -43,6 +43,12 @@ typedef const SbVec4f & SoTextureCoordinateFunctionCB(void * userdata,
                                                       const SbVec3f & point,
                                                       const SbVec3f & normal);
 
+typedef void SoTextureCoordinateFunctionBatchCB(void * userdata,
+                                                const int num,
+                                                const SbVec3f * points,
+                                                const SbVec3f * normals,
+                                                SbVec4f * result);
+
 class SoMultiTextureCoordinateElementP;
 
 class COIN_DLL_API SoMultiTextureCoordinateElement : public SoElement {
@@ -71,6 +77,11 @@ public:
                           const int unit,
                           SoTextureCoordinateFunctionCB * const func,
                           void * const userdata);
+  static void setFunction(SoState * const state, SoNode * const node,
+                          const int unit,
+                          SoTextureCoordinateFunctionCB * const func,
+                          SoTextureCoordinateFunctionBatchCB * const batchfunc,
+                          void * const userdata);
 
   static void set2(SoState * const state, SoNode * const node,
                    const int unit,
@@ -90,10 +101,15 @@ public:
   const SbVec4f & get(const int unit,
                       const SbVec3f & point,
                       const SbVec3f & normal) const;
+  void get(const int unit, const int num,
+           const SbVec3f * points,
+           const SbVec3f * normals,
+           SbVec4f * result) const;
 
   int32_t getNum(const int unit = 0) const;
   SbBool is2D(const int unit = 0) const;
   int32_t getDimension(const int unit = 0) const;
+  SbUniqueId getNodeId(const int unit = 0) const;
 
   const SbVec2f & get2(const int unit, const int index) const;
   const SbVec3f & get3(const int unit, const int index) const;
@@ -50,6 +50,8 @@ public:
   static void initClass(void);
   SoElapsedTime(void);
 
+  virtual void notify(SoNotList * list);
+
   SoSFTime timeIn;
   SoSFFloat speed;
   SoSFBool on;
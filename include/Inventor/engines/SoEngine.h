@@ -60,6 +60,11 @@ public:
   SbBool isNotifying(void) const;
   virtual void notify(SoNotList * nl);
 
+  static void enableEvaluationScheduling(const SbBool onoff);
+  static SbBool isEvaluationSchedulingEnabled(void);
+  static int evaluateScheduledEngines(void);
+  static uint32_t getEvaluationCount(void);
+
   SoEngine * copy(void) const;
   virtual SoFieldContainer * copyThroughConnection(void) const;
   SbBool shouldCopy(void) const;
@@ -87,7 +92,8 @@ private:
 
   enum InternalEngineFlags {
     FLAG_ISNOTIFYING = (1 << 0),
-    FLAG_ISDIRTY = (1 << 1)
+    FLAG_ISDIRTY = (1 << 1),
+    FLAG_ISSCHEDULED = (1 << 2)
   };
 
   unsigned int flags;
@@ -95,6 +101,7 @@ private:
   // needed for handling connections from SoEngineOutput
   friend class SoEngineOutput;
   void setDirty(void);
+  void schedule(void);
 };
 
 #if !defined(COIN_INTERNAL)
@@ -50,6 +50,8 @@ public:
   static void initClass(void);
   SoOneShot(void);
 
+  virtual void notify(SoNotList * list);
+
   enum Flags {RETRIGGERABLE=1, HOLD_FINAL=2};
 
   SoSFTime timeIn;
@@ -63,6 +63,8 @@ public:
   SoTimeCounter();
   static void initClass();
 
+  virtual void notify(SoNotList * list);
+
 protected:
   virtual ~SoTimeCounter(void);
 
@@ -169,11 +169,17 @@ private:
     FLAG_DONOTIFY = 0x0200,
     FLAG_ISDESTRUCTING = 0x0400,
     FLAG_ISEVALUATING = 0x0800,
-    FLAG_ISNOTIFIED = 0x1000
+    FLAG_ISNOTIFIED = 0x1000,
+    FLAG_DEFERRED = 0x2000,
+    FLAG_COPYONWRITE = 0x4000
   };
 
+  friend class SoMField;
+
   void evaluateField(void) const;
   void extendStorageIfNecessary(void);
+  void setDeferredValues(const char * data, const int num);
+  const char * takeDeferredValues(int & num);
   SoFieldConverter * createConverter(SoType from) const;
   SoFieldContainer * resolveWriteConnection(SbName & mastername) const;
 
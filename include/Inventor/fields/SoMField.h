@@ -70,6 +70,13 @@ protected:
   virtual void * valuesPtr(void) = 0;
   virtual void setValuesPtr(void * ptr) = 0;
   virtual void allocValues(int num);
+
+  // must be called before the values are changed, to decode deferred
+  // values and to copy values shared with other fields
+  void evaluateDeferredValues(void) {
+    if (this->statusbits & (FLAG_DEFERRED | FLAG_COPYONWRITE)) this->detachValues(TRUE);
+  }
+  SbBool shareValues(const SoMField & field);
 #endif // DOXYGEN_SKIP_THIS
 
   virtual SoNotRec createNotRec(SoBase * container);
@@ -82,6 +89,11 @@ protected:
   SbBool userDataIsUsed;
 
 private:
+  friend class SoField;
+
+  void detachValues(const SbBool keep);
+  void decodeDeferredValues(const SbBool decode);
+  void unshareValues(const SbBool keep);
   virtual void deleteAllValues(void) = 0;
   virtual void copyValue(int to, int from) = 0;
   virtual SbBool readValue(SoInput * in);
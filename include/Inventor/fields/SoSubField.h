@@ -263,7 +263,7 @@ public: \
   _valref_ operator=(_valref_ val) { this->setValue(val); return val; } \
   SbBool operator==(const _class_ & field) const; \
   SbBool operator!=(const _class_ & field) const { return !operator==(field); } \
-  _valtype_ * startEditing(void) { this->evaluate(); return this->values; } \
+  _valtype_ * startEditing(void) { this->evaluate(); this->evaluateDeferredValues(); return this->values; } \
   void finishEditing(void) { this->valueChanged(); }
 
 #define SO_MFIELD_DERIVED_VALUE_HEADER(_class_, _valtype_, _valref_) \
@@ -329,6 +329,10 @@ PRIVATE_EQUALITY_SOURCE(_class_); \
 const _class_ & \
 _class_::operator=(const _class_ & field) \
 { \
+  /* Large arrays of plain values are shared until either field */ \
+  /* is changed. */ \
+  if (this->shareValues(field)) return *this; \
+ \
   /* The allocValues() call is needed, as setValues() doesn't */ \
   /* necessarily make the field's getNum() size become the same */ \
   /* as the second argument (only if it expands on the old size). */ \
@@ -372,6 +376,7 @@ _class_::find(_valref_ value, SbBool addifnotfound) \
 void \
 _class_::setValues(const int start, const int numarg, const _valtype_ * newvals) \
 { \
+  this->evaluateDeferredValues(); \
   if (start+numarg > this->maxNum) this->allocValues(start+numarg); \
   else if (start+numarg > this->num) this->num = start+numarg; \
  \
@@ -385,6 +390,7 @@ _class_::setValues(const int start, const int numarg, const _valtype_ * newvals)
 void \
 _class_::set1Value(const int idx, _valref_ value) \
 { \
+  this->evaluateDeferredValues(); \
   if (idx+1 > this->maxNum) this->allocValues(idx+1); \
   else if (idx+1 > this->num) this->num = idx+1; \
   this->values[idx] = value; \
@@ -445,6 +451,7 @@ _class_::allocValues(int newnum) \
   _valtype_ * newblock; \
   assert(newnum >= 0); \
  \
+  this->evaluateDeferredValues(); \
   this->setChangedIndices(); \
   if (newnum == 0) { \
     if (!this->userDataIsUsed) delete[] this->values; /* don't fetch pointer through valuesPtr() (avoids void* cast) */ \
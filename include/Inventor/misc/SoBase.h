@@ -86,6 +86,10 @@ public:
   static void setTraceRefs(SbBool trace);
   static SbBool getTraceRefs(void);
 
+  static void enableDeferredDestruction(const SbBool on);
+  static SbBool isDeferredDestructionEnabled(void);
+  static int flushDeferredDestruction(void);
+
   static SbBool connectRoute(SoInput * input,
                              const SbName & fromnodename, const SbName & fromfieldname,
                              const SbName & tonodename, const SbName & tofieldname);
@@ -121,7 +125,8 @@ private:
   static SoType classTypeId;
 
   struct {
-    mutable signed int referencecount : 28;
+    mutable signed int referencecount : 27;
+    mutable unsigned int deferred : 1;
     mutable unsigned int alive : 4;
   } objdata;
 
@@ -52,6 +52,7 @@ public:
   void replace(SoNode * parent, int n, SoNode * newnode);
   void modify(SoNode * node);
   void prepareToSend(void);
+  void reset(void);
 
 private:
   // Placeholder for any data for the instance. Just added for the
@@ -53,6 +53,7 @@ public:
   virtual void GLRender(SoGLRenderAction * action);
   virtual SbBool generateDefaultNormals(SoState * state, SoNormalBundle * nb);
   virtual void getPrimitiveCount(SoGetPrimitiveCountAction * action);
+  virtual void callback(SoCallbackAction * action);
 
 protected:
   virtual ~SoFaceSet();
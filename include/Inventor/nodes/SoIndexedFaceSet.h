@@ -53,6 +53,7 @@ public:
 
   virtual void GLRender(SoGLRenderAction * action);
   virtual void getPrimitiveCount(SoGetPrimitiveCountAction * action);
+  virtual void callback(SoCallbackAction * action);
 
   virtual SbBool generateDefaultNormals(SoState * state,
                                         SoNormalBundle * bundle);
@@ -84,7 +84,8 @@ public:
     COIN_2_5     = 0x4000,
     COIN_3_0     = 0x8000,
     INVENTOR_6_0 = 0x10000,
-    COIN_4_0     = 0x20000
+    COIN_4_0     = 0x20000,
+    COIN_4_1     = 0x40000
   };
 
   static uint32_t getCompatibilityTypes(const SoType & nodetype);
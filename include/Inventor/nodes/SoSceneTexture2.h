@@ -38,6 +38,8 @@
 #include <Inventor/fields/SoSFColor.h>
 #include <Inventor/fields/SoSFNode.h>
 #include <Inventor/fields/SoSFVec4f.h>
+#include <Inventor/fields/SoSFFloat.h>
+#include <Inventor/fields/SoSFBool.h>
 #include <Inventor/nodes/SoNode.h>
 #include <Inventor/nodes/SoSubNode.h>
 #include <Inventor/elements/SoMultiTextureImageElement.h>
@@ -111,6 +113,9 @@ public:
 
   SoSFEnum type;
 
+  SoSFFloat maxUpdateRate;
+  SoSFBool shareTexture;
+
   virtual void notify(SoNotList * list);
   virtual void write(SoWriteAction * action);
 
@@ -39,6 +39,8 @@
 #include <Inventor/fields/SoSFNode.h>
 #include <Inventor/fields/SoMFNode.h>
 #include <Inventor/fields/SoSFColor.h>
+#include <Inventor/fields/SoSFFloat.h>
+#include <Inventor/fields/SoSFBool.h>
 #include <Inventor/elements/SoMultiTextureImageElement.h>
 
 class SoSensor;
@@ -71,6 +73,11 @@ public:
     ALPHA_TEST
   };
 
+  enum FaceUpdate {
+    ALL_FACES,
+    ONE_FACE_PER_FRAME
+  };
+
   SoSFVec2s size;
   SoSFNode scene;
 
@@ -83,6 +90,10 @@ public:
   SoSFEnum transparencyFunction;
   SoSFColor blendColor;
 
+  SoSFFloat maxUpdateRate;
+  SoSFEnum faceUpdate;
+  SoSFBool shareTexture;
+
   virtual void doAction(SoAction * action);
   virtual void GLRender(SoGLRenderAction * action);
   virtual void callback(SoCallbackAction * action);
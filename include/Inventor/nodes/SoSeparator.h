@@ -40,6 +40,7 @@
 
 class SoState;
 class SoSeparatorP;
+class SoGLCacheList;
 
 class COIN_DLL_API SoSeparator : public SoGroup {
   typedef SoGroup inherited;
@@ -78,8 +79,12 @@ public:
 
   static void setNumRenderCaches(const int howmany);
   static int getNumRenderCaches(void);
+  static void setBoundingBoxRefit(const SbBool onoff);
+  static SbBool getBoundingBoxRefit(void);
   virtual SbBool affectsState(void) const;
 
+  const SoGLCacheList * getGLCacheList(void) const;
+
 protected:
   virtual ~SoSeparator();
 
@@ -66,6 +66,10 @@ private:
   static const SbVec4f &generate(void *userdata,
                                  const SbVec3f &p,
                                  const SbVec3f &n);
+  static void generateBatch(void * userdata, const int num,
+                            const SbVec3f * points,
+                            const SbVec3f * normals,
+                            SbVec4f * result);
   static void handleTexgen(void *data);
 
   SoTextureCoordinatePlaneP * pimpl;
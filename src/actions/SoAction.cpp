@@ -419,6 +419,7 @@ SoAction::initClasses(void)
   SoPickAction::initClass();
   SoRayPickAction::initClass();
   SoSearchAction::initClass();
+  SoShareNodesAction::initClass();
   SoWriteAction::initClass();
   SoAudioRenderAction::initClass();
   SoIntersectionDetectionAction::initClass();
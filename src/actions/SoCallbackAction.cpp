@@ -135,6 +135,12 @@
      return 0;
    }
   \endcode
+
+  Applications which extract large amounts of geometry, like
+  exporters or collision detection libraries, can use
+  addTriangleBatchCallback() instead of addTriangleCallback(). The
+  triangles of each shape are then delivered in a single call, as
+  indexed vertex arrays.
 */
 
 /*!
@@ -176,10 +182,42 @@
   \sa setPassCallback()
 */
 
+/*!
+  \typedef void SoTriangleBatchCB(void * userdata, SoCallbackAction * action, const SoShape * shape, const int numvertices, const SbVec3f * points, const SbVec3f * normals, const SbVec4f * texcoords, const int32_t * materialindices, const int numtriangles, const int32_t * indices)
+
+  \param userdata is a void pointer to any data the application need to
+  know of in the callback function (like for instance a \e this
+  pointer).
+  \param action the action which invoked the callback
+  \param shape the shape which generated the triangles
+  \param numvertices the number of vertices in the arrays
+  \param points the vertex coordinates
+  \param normals the vertex normals
+  \param texcoords the vertex texture coordinates
+  \param materialindices the material index of each vertex
+  \param numtriangles the number of triangles
+  \param indices three indices into the vertex arrays per triangle
+
+  Vertices shared between triangles of the same shape are only stored
+  once. SoFaceSet, SoIndexedFaceSet, SoTriangleStripSet and
+  SoIndexedTriangleStripSet build the arrays directly from their
+  fields, and share the vertices which use the same coordinate,
+  normal, texture coordinate and material indices. Other shapes share
+  vertices with equal values. The arrays are only valid during the
+  callback.
+
+  \sa SoCallbackAction::addTriangleBatchCallback(), SoTriangleCB
+  \since Coin 4.1
+*/
+
 
 #include <Inventor/actions/SoCallbackAction.h>
 
+#include <cstring>
+
 #include <Inventor/SoPath.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/SbMatrix.h>
 #include <Inventor/elements/SoComplexityElement.h>
 #include <Inventor/elements/SoCoordinateElement.h>
 #include <Inventor/elements/SoCreaseAngleElement.h>
@@ -258,6 +296,16 @@ public:
   void doPointCallbacks(SoCallbackAction * action,
                         const SoPrimitiveVertex * v);
 
+  void doTriangleBatchCallbacks(SoCallbackAction * action,
+                                const SoShape * shape,
+                                const int numvertices,
+                                const SbVec3f * points,
+                                const SbVec3f * normals,
+                                const SbVec4f * texcoords,
+                                const int32_t * materialindices,
+                                const int numtriangles,
+                                const int32_t * indices);
+
 public:
   void * func;
   void * data;
@@ -325,9 +373,46 @@ SoCallbackData::doPointCallbacks(SoCallbackAction * action,
   }
 }
 
+void
+SoCallbackData::doTriangleBatchCallbacks(SoCallbackAction * action,
+                                         const SoShape * shape,
+                                         const int numvertices,
+                                         const SbVec3f * points,
+                                         const SbVec3f * normals,
+                                         const SbVec4f * texcoords,
+                                         const int32_t * materialindices,
+                                         const int numtriangles,
+                                         const int32_t * indices)
+{
+  SoCallbackData * cbdata = this;
+  while (cbdata) {
+    assert(cbdata->func != NULL);
+    SoTriangleBatchCB * batchcb = object_to_function_cast<SoTriangleBatchCB *>(cbdata->func);
+    batchcb(cbdata->data, action, shape, numvertices, points, normals,
+            texcoords, materialindices, numtriangles, indices);
+    cbdata = cbdata->next;
+  }
+}
+
 // class to hold private, hidden data
 class SoCallbackActionP {
 public:
+  SoCallbackActionP(void)
+    : batchshape(NULL), batchsent(NULL),
+      batchspace(SoCallbackAction::OBJECT_SPACE) { }
+
+  void addBatchTriangle(const SoPrimitiveVertex * const v1,
+                        const SoPrimitiveVertex * const v2,
+                        const SoPrimitiveVertex * const v3);
+  void flushBatch(SoCallbackAction * action);
+  void sendBatch(SoCallbackAction * action, const SoShape * shape,
+                 const int numvertices, const SbVec3f * points,
+                 const SbVec3f * normals, const SbVec4f * texcoords,
+                 const int32_t * materialindices, const int numtriangles,
+                 const int32_t * indices);
+  int32_t findBatchVertex(const SoPrimitiveVertex * v) const;
+  void insertBatchVertex(const int32_t idx);
+
   SbBool viewportset;
   SbViewportRegion viewport;
   SoCallbackAction::Response response;
@@ -342,10 +427,172 @@ public:
   SbList <SoCallbackData *> trianglecallback;
   SbList <SoCallbackData *> linecallback;
   SbList <SoCallbackData *> pointcallback;
+  SbList <SoCallbackData *> trianglebatchcallback;
+
+  // the triangles collected for the batch callbacks
+  const SoShape * batchshape;
+  // set when the shape has sent its batch arrays itself
+  const SoShape * batchsent;
+  SoCallbackAction::TriangleBatchSpace batchspace;
+  // open addressing table with vertex indices, used for merging
+  // equal vertices. The table is at most half full.
+  SbList <int32_t> batchtable;
+  SbList <SbVec3f> batchpoints;
+  SbList <SbVec3f> batchnormals;
+  SbList <SbVec4f> batchtexcoords;
+  SbList <int32_t> batchmaterials;
+  SbList <int32_t> batchindices;
 
   SbBool callbackall;
 };
 
+// FNV-1a on the words of the vertex attributes, with a final mix
+static uint32_t
+socbaction_hash_vertex(const SbVec3f & point, const SbVec3f & normal,
+                       const SbVec4f & texcoord, const int32_t materialindex)
+{
+  uint32_t words[11];
+  memcpy(words, point.getValue(), sizeof(float) * 3);
+  memcpy(words + 3, normal.getValue(), sizeof(float) * 3);
+  memcpy(words + 6, texcoord.getValue(), sizeof(float) * 4);
+  words[10] = static_cast<uint32_t>(materialindex);
+  uint32_t key = 2166136261u;
+  for (int i = 0; i < 11; i++) key = (key ^ words[i]) * 16777619u;
+  // mix the high bits down, as the low bits of floats with integer
+  // values are all zero
+  key ^= key >> 16;
+  key *= 0x85ebca6bu;
+  key ^= key >> 13;
+  return key;
+}
+
+// returns the index of the vertex equal to \a v, or the table slot
+// where it should be inserted as -(slot + 2)
+int32_t
+SoCallbackActionP::findBatchVertex(const SoPrimitiveVertex * v) const
+{
+  const SbVec3f & point = v->getPoint();
+  const SbVec3f & normal = v->getNormal();
+  const SbVec4f & texcoord = v->getTextureCoords();
+  const int32_t materialindex = v->getMaterialIndex();
+
+  const int mask = this->batchtable.getLength() - 1;
+  int slot = static_cast<int>(socbaction_hash_vertex(point, normal, texcoord, materialindex)) & mask;
+  for (;;) {
+    const int32_t idx = this->batchtable[slot];
+    if (idx < 0) return -(slot + 2);
+    if (this->batchpoints[idx] == point &&
+        this->batchnormals[idx] == normal &&
+        this->batchtexcoords[idx] == texcoord &&
+        this->batchmaterials[idx] == materialindex) return idx;
+    slot = (slot + 1) & mask;
+  }
+}
+
+void
+SoCallbackActionP::insertBatchVertex(const int32_t idx)
+{
+  const int mask = this->batchtable.getLength() - 1;
+  int slot = static_cast<int>(socbaction_hash_vertex(this->batchpoints[idx],
+                                                     this->batchnormals[idx],
+                                                     this->batchtexcoords[idx],
+                                                     this->batchmaterials[idx])) & mask;
+  while (this->batchtable[slot] >= 0) slot = (slot + 1) & mask;
+  this->batchtable[slot] = idx;
+}
+
+void
+SoCallbackActionP::addBatchTriangle(const SoPrimitiveVertex * const v1,
+                                    const SoPrimitiveVertex * const v2,
+                                    const SoPrimitiveVertex * const v3)
+{
+  const SoPrimitiveVertex * vp[3] = { v1, v2, v3 };
+  for (int i = 0; i < 3; i++) {
+    if ((this->batchpoints.getLength() + 1) * 2 > this->batchtable.getLength()) {
+      // grow and rehash
+      int size = this->batchtable.getLength() ? this->batchtable.getLength() * 2 : 256;
+      this->batchtable.truncate(0);
+      for (int j = 0; j < size; j++) this->batchtable.append(-1);
+      for (int j = 0; j < this->batchpoints.getLength(); j++) this->insertBatchVertex(j);
+    }
+    int32_t idx = this->findBatchVertex(vp[i]);
+    if (idx < 0) {
+      const int slot = -idx - 2;
+      idx = this->batchpoints.getLength();
+      this->batchtable[slot] = idx;
+      this->batchpoints.append(vp[i]->getPoint());
+      this->batchnormals.append(vp[i]->getNormal());
+      this->batchtexcoords.append(vp[i]->getTextureCoords());
+      this->batchmaterials.append(vp[i]->getMaterialIndex());
+    }
+    this->batchindices.append(idx);
+  }
+}
+
+void
+SoCallbackActionP::sendBatch(SoCallbackAction * action,
+                             const SoShape * shape,
+                             const int numvertices,
+                             const SbVec3f * points,
+                             const SbVec3f * normals,
+                             const SbVec4f * texcoords,
+                             const int32_t * materialindices,
+                             const int numtriangles,
+                             const int32_t * indices)
+{
+  if (this->batchspace == SoCallbackAction::WORLD_SPACE && numvertices) {
+    if (points != this->batchpoints.getArrayPtr()) {
+      // arrays from the shape, transform a copy
+      this->batchpoints.truncate(0);
+      this->batchnormals.truncate(0);
+      for (int i = 0; i < numvertices; i++) {
+        this->batchpoints.append(points[i]);
+        this->batchnormals.append(normals[i]);
+      }
+    }
+    const SbMatrix & mm = SoModelMatrixElement::get(action->getState());
+    const SbMatrix nm = mm.inverse().transpose();
+    SbVec3f * wpoints = const_cast<SbVec3f *>(this->batchpoints.getArrayPtr());
+    SbVec3f * wnormals = const_cast<SbVec3f *>(this->batchnormals.getArrayPtr());
+    for (int i = 0; i < numvertices; i++) {
+      mm.multVecMatrix(wpoints[i], wpoints[i]);
+      nm.multDirMatrix(wnormals[i], wnormals[i]);
+      (void)wnormals[i].normalize();
+    }
+    points = wpoints;
+    normals = wnormals;
+  }
+
+  const int idx = static_cast<int>(shape->getTypeId().getData());
+  SoCallbackData * cbdata = this->trianglebatchcallback[idx];
+  cbdata->doTriangleBatchCallbacks(action, shape, numvertices,
+                                   points, normals, texcoords,
+                                   materialindices, numtriangles, indices);
+}
+
+void
+SoCallbackActionP::flushBatch(SoCallbackAction * action)
+{
+  const SoShape * shape = this->batchshape;
+  this->batchshape = NULL;
+  if (shape == NULL) return;
+
+  this->sendBatch(action, shape, this->batchpoints.getLength(),
+                  this->batchpoints.getArrayPtr(),
+                  this->batchnormals.getArrayPtr(),
+                  this->batchtexcoords.getArrayPtr(),
+                  this->batchmaterials.getArrayPtr(),
+                  this->batchindices.getLength() / 3,
+                  this->batchindices.getArrayPtr());
+
+  this->batchtable.truncate(0);
+  this->batchpoints.truncate(0);
+  this->batchnormals.truncate(0);
+  this->batchtexcoords.truncate(0);
+  this->batchmaterials.truncate(0);
+  this->batchindices.truncate(0);
+}
+
 #endif // !DOXYGEN_SKIP_THIS
 
 
@@ -475,6 +722,7 @@ SoCallbackAction::~SoCallbackAction()
   delete_list_elements(PRIVATE(this)->trianglecallback);
   delete_list_elements(PRIVATE(this)->linecallback);
   delete_list_elements(PRIVATE(this)->pointcallback);
+  delete_list_elements(PRIVATE(this)->trianglebatchcallback);
 
   if (PRIVATE(this)->pretailcallback) {
     PRIVATE(this)->pretailcallback->deleteAll();
@@ -596,6 +844,54 @@ SoCallbackAction::addPointCallback(const SoType type, SoPointCB * cb,
   set_callback_data(PRIVATE(this)->pointcallback, type, function_to_object_cast<void *>(cb), userdata);
 }
 
+/*!
+  Set a function \a cb to call when traversing a node of \a type which
+  generates triangle primitives. Instead of being called once per
+  triangle, like the callbacks set with addTriangleCallback(), \a cb
+  is called once per shape with all its triangles as indexed vertex
+  arrays. \a cb will be called with \a userdata.
+
+  Use this method when extracting large amounts of geometry, as it
+  avoids the cost of one function call per triangle, and vertices
+  shared between triangles are only passed once.
+
+  \sa setTriangleBatchSpace()
+  \since Coin 4.1
+*/
+void
+SoCallbackAction::addTriangleBatchCallback(const SoType type, SoTriangleBatchCB * cb,
+                                           void * userdata)
+{
+  set_callback_data(PRIVATE(this)->trianglebatchcallback, type, function_to_object_cast<void *>(cb), userdata);
+}
+
+/*!
+  Sets whether the vertices passed to the triangle batch callbacks
+  should be in object space, which is the default, or be transformed
+  to world space with the current model matrix.
+
+  \sa addTriangleBatchCallback()
+  \since Coin 4.1
+*/
+void
+SoCallbackAction::setTriangleBatchSpace(const TriangleBatchSpace space)
+{
+  PRIVATE(this)->batchspace = space;
+}
+
+/*!
+  Returns the coordinate space of the vertices passed to the triangle
+  batch callbacks.
+
+  \sa setTriangleBatchSpace()
+  \since Coin 4.1
+*/
+SoCallbackAction::TriangleBatchSpace
+SoCallbackAction::getTriangleBatchSpace(void) const
+{
+  return PRIVATE(this)->batchspace;
+}
+
 /************************************************************************************/
 
 /*!
@@ -1198,6 +1494,15 @@ SoCallbackAction::invokeTriangleCallbacks(const SoShape * const shape,
   int idx = static_cast<int>(shape->getTypeId().getData());
   if (idx < PRIVATE(this)->trianglecallback.getLength() && PRIVATE(this)->trianglecallback[idx] != NULL)
     PRIVATE(this)->trianglecallback[idx]->doTriangleCallbacks(this, v1, v2, v3);
+
+  if (idx < PRIVATE(this)->trianglebatchcallback.getLength() && PRIVATE(this)->trianglebatchcallback[idx] != NULL &&
+      PRIVATE(this)->batchsent != shape) {
+    if (PRIVATE(this)->batchshape != shape) {
+      PRIVATE(this)->flushBatch(this);
+      PRIVATE(this)->batchshape = shape;
+    }
+    PRIVATE(this)->addBatchTriangle(v1, v2, v3);
+  }
 }
 
 /*!
@@ -1229,6 +1534,51 @@ SoCallbackAction::invokePointCallbacks(const SoShape * const shape,
     PRIVATE(this)->pointcallback[idx]->doPointCallbacks(this, v);
 }
 
+/*!
+  \COININTERNAL
+
+  Invoke all "triangle batch" callbacks with the triangles collected
+  for \a shape. Called by the shape when it is done generating
+  primitives.
+
+  \since Coin 4.1
+ */
+void
+SoCallbackAction::invokeTriangleBatchCallbacks(const SoShape * const shape)
+{
+  if (PRIVATE(this)->batchshape == shape) PRIVATE(this)->flushBatch(this);
+  if (PRIVATE(this)->batchsent == shape) PRIVATE(this)->batchsent = NULL;
+}
+
+/*!
+  \COININTERNAL
+
+  Invoke all "triangle batch" callbacks with arrays built by \a shape
+  itself. The triangles \a shape generates afterwards, for the other
+  callbacks, are then not collected for the batch callbacks.
+
+  \sa shouldGenerateTriangleBatch()
+  \since Coin 4.1
+ */
+void
+SoCallbackAction::invokeTriangleBatchCallbacks(const SoShape * const shape,
+                                               const int numvertices,
+                                               const SbVec3f * points,
+                                               const SbVec3f * normals,
+                                               const SbVec4f * texcoords,
+                                               const int32_t * materialindices,
+                                               const int numtriangles,
+                                               const int32_t * indices)
+{
+  if (!this->shouldGenerateTriangleBatch(shape)) return;
+  PRIVATE(this)->flushBatch(this);
+  PRIVATE(this)->sendBatch(this, shape, numvertices, points, normals,
+                           texcoords, materialindices, numtriangles, indices);
+  PRIVATE(this)->batchpoints.truncate(0);
+  PRIVATE(this)->batchnormals.truncate(0);
+  PRIVATE(this)->batchsent = shape;
+}
+
 /*!
   \COININTERNAL
 
@@ -1246,9 +1596,30 @@ SoCallbackAction::shouldGeneratePrimitives(const SoShape * shape) const
     return TRUE;
   if (idx < PRIVATE(this)->pointcallback.getLength() && PRIVATE(this)->pointcallback[idx])
     return TRUE;
+  if (idx < PRIVATE(this)->trianglebatchcallback.getLength() && PRIVATE(this)->trianglebatchcallback[idx] &&
+      PRIVATE(this)->batchsent != shape)
+    return TRUE;
   return FALSE;
 }
 
+/*!
+  \COININTERNAL
+
+  Returns whether there are triangle batch callbacks for \a shape.
+  Shapes which can build the batch arrays directly from their fields
+  use this to decide whether to do so.
+
+  \since Coin 4.1
+ */
+SbBool
+SoCallbackAction::shouldGenerateTriangleBatch(const SoShape * shape) const
+{
+  int idx = static_cast<int>(shape->getTypeId().getData());
+  return
+    idx < PRIVATE(this)->trianglebatchcallback.getLength() &&
+    PRIVATE(this)->trianglebatchcallback[idx] != NULL;
+}
+
 /*!
   Returns the current tail of the traversal path for the callback
   action.
@@ -1283,6 +1654,8 @@ SoCallbackAction::beginTraversal(SoNode * node)
     SoViewportRegionElement::set(this->getState(), PRIVATE(this)->viewport);
   }
   this->traverse(node);
+  // in case a shape generated triangles outside SoShape::callback()
+  PRIVATE(this)->flushBatch(this);
 }
 
 void SoCallbackAction::setCallbackAll(SbBool callbackall)
@@ -1301,6 +1674,12 @@ SbBool SoCallbackAction::isCallbackAll(void) const
 
 #include <Inventor/nodes/SoSwitch.h>
 #include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoPrimitiveVertex.h>
 
 static SoCallbackAction::Response
 preCB(void * userdata, SoCallbackAction *, const SoNode * node)
@@ -1333,4 +1712,251 @@ BOOST_AUTO_TEST_CASE(callbackall)
   sw->unref();
 }
 
+struct test_batch_data {
+  int numcalls;
+  int numvertices;
+  int numtriangles;
+  SbBox3f box;
+};
+
+static void
+test_batch_cb(void * userdata, SoCallbackAction *, const SoShape *,
+              const int numvertices, const SbVec3f * points,
+              const SbVec3f *, const SbVec4f *, const int32_t *,
+              const int numtriangles, const int32_t * indices)
+{
+  test_batch_data * data = static_cast<test_batch_data *>(userdata);
+  data->numcalls++;
+  data->numvertices += numvertices;
+  data->numtriangles += numtriangles;
+  for (int i = 0; i < numtriangles * 3; i++) {
+    data->box.extendBy(points[indices[i]]);
+  }
+}
+
+static void
+test_triangle_cb(void * userdata, SoCallbackAction *,
+                 const SoPrimitiveVertex *, const SoPrimitiveVertex *,
+                 const SoPrimitiveVertex *)
+{
+  (*static_cast<int *>(userdata))++;
+}
+
+BOOST_AUTO_TEST_CASE(triangleBatch)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoTranslation * trans = new SoTranslation;
+  trans->translation.setValue(10.0f, 0.0f, 0.0f);
+  root->addChild(trans);
+  root->addChild(new SoCube);
+
+  int numtriangles = 0;
+  test_batch_data data;
+  data.numcalls = data.numvertices = data.numtriangles = 0;
+
+  SoCallbackAction cba;
+  cba.addTriangleCallback(SoShape::getClassTypeId(), test_triangle_cb, &numtriangles);
+  cba.addTriangleBatchCallback(SoShape::getClassTypeId(), test_batch_cb, &data);
+  cba.apply(root);
+
+  // one call for the cube, with four vertices per side
+  BOOST_CHECK_EQUAL(data.numcalls, 1);
+  BOOST_CHECK_EQUAL(data.numtriangles, numtriangles);
+  BOOST_CHECK_EQUAL(data.numtriangles, 12);
+  BOOST_CHECK_EQUAL(data.numvertices, 24);
+  BOOST_CHECK(data.box.getMin() == SbVec3f(-1.0f, -1.0f, -1.0f));
+
+  data.numcalls = 0;
+  data.box.makeEmpty();
+  cba.setTriangleBatchSpace(SoCallbackAction::WORLD_SPACE);
+  cba.apply(root);
+  BOOST_CHECK_EQUAL(data.numcalls, 1);
+  BOOST_CHECK(data.box.getMin() == SbVec3f(9.0f, -1.0f, -1.0f));
+
+  root->unref();
+}
+
+struct test_batch_vertex {
+  SbVec3f point;
+  SbVec3f normal;
+  SbVec4f texcoord;
+  int32_t material;
+};
+
+struct test_batch_compare {
+  SbList <test_batch_vertex> fromtriangles;
+  SbList <test_batch_vertex> frombatch;
+  int numbatchvertices;
+};
+
+static void
+test_compare_triangle_cb(void * userdata, SoCallbackAction *,
+                         const SoPrimitiveVertex * v1,
+                         const SoPrimitiveVertex * v2,
+                         const SoPrimitiveVertex * v3)
+{
+  test_batch_compare * data = static_cast<test_batch_compare *>(userdata);
+  const SoPrimitiveVertex * v[3] = { v1, v2, v3 };
+  for (int i = 0; i < 3; i++) {
+    test_batch_vertex tv;
+    tv.point = v[i]->getPoint();
+    tv.normal = v[i]->getNormal();
+    tv.texcoord = v[i]->getTextureCoords();
+    tv.material = v[i]->getMaterialIndex();
+    data->fromtriangles.append(tv);
+  }
+}
+
+static void
+test_compare_batch_cb(void * userdata, SoCallbackAction *, const SoShape *,
+                      const int numvertices, const SbVec3f * points,
+                      const SbVec3f * normals, const SbVec4f * texcoords,
+                      const int32_t * materialindices,
+                      const int numtriangles, const int32_t * indices)
+{
+  test_batch_compare * data = static_cast<test_batch_compare *>(userdata);
+  data->numbatchvertices += numvertices;
+  for (int i = 0; i < numtriangles * 3; i++) {
+    test_batch_vertex tv;
+    tv.point = points[indices[i]];
+    tv.normal = normals[indices[i]];
+    tv.texcoord = texcoords[indices[i]];
+    tv.material = materialindices[indices[i]];
+    data->frombatch.append(tv);
+  }
+}
+
+static SoSeparator *
+test_read_scene(const char * scene)
+{
+  SoInput in;
+  in.setBuffer(scene, strlen(scene));
+  return SoDB::readAll(&in);
+}
+
+// The vertex shapes build the batch arrays from their fields. The
+// triangles must be the same as the ones generatePrimitives() gives
+// the per triangle callbacks, for all the bindings.
+BOOST_AUTO_TEST_CASE(triangleBatchFromFields)
+{
+  const char * scenes[] = {
+    // convex polygons and per face materials, generated normals
+    "#Inventor V2.1 ascii\n"
+    "Separator {\n"
+    "  ShapeHints { faceType CONVEX }\n"
+    "  Material { diffuseColor [ 1 0 0, 0 1 0, 0 0 1, 1 1 0 ] }\n"
+    "  MaterialBinding { value PER_FACE }\n"
+    "  Coordinate3 { point [ 0 0 0, 1 0 0, 1 1 0, 0 1 0, -1 0.5 0, 2 0.5 0 ] }\n"
+    "  IndexedFaceSet { coordIndex [ 0 1 2 -1, 0 2 3 -1, 0 1 2 3 -1, 0 1 5 2 3 4 -1 ] }\n"
+    "}\n",
+    // texture coordinate and normal indices
+    "#Inventor V2.1 ascii\n"
+    "Separator {\n"
+    "  Texture2 { image 1 1 3 0xff0000 }\n"
+    "  TextureCoordinate2 { point [ 0 0, 1 0, 1 1, 0 1 ] }\n"
+    "  Normal { vector [ 0 0 1, 0 1 0, 1 0 0 ] }\n"
+    "  NormalBinding { value PER_VERTEX_INDEXED }\n"
+    "  Coordinate3 { point [ 0 0 0, 1 0 0, 1 1 0, 0 1 0 ] }\n"
+    "  IndexedFaceSet {\n"
+    "    coordIndex [ 0 1 2 3 -1, 0 2 3 -1 ]\n"
+    "    normalIndex [ 0 1 2 0 -1, 1 1 2 -1 ]\n"
+    "    textureCoordIndex [ 3 2 1 0 -1, 0 1 2 -1 ]\n"
+    "  }\n"
+    "}\n",
+    // default texture coordinate function
+    "#Inventor V2.1 ascii\n"
+    "Separator {\n"
+    "  Texture2 { image 1 1 3 0xff0000 }\n"
+    "  Coordinate3 { point [ 0 0 0, 1 0 0, 1 1 0, 0 1 2 ] }\n"
+    "  IndexedFaceSet { coordIndex [ 0 1 2 -1, 0 2 3 -1 ] }\n"
+    "}\n",
+    // a concave polygon, which is left to generatePrimitives()
+    "#Inventor V2.1 ascii\n"
+    "Separator {\n"
+    "  Coordinate3 { point [ 0 0 0, 2 0 0, 2 2 0, 1 0.5 0, 0 2 0 ] }\n"
+    "  IndexedFaceSet { coordIndex [ 0 1 2 3 4 -1 ] }\n"
+    "}\n",
+    // per vertex materials
+    "#Inventor V2.1 ascii\n"
+    "Separator {\n"
+    "  Material { diffuseColor [ 1 0 0, 0 1 0, 0 0 1, 1 1 0, 1 0 1, 0 1 1, 1 1 1 ] }\n"
+    "  MaterialBinding { value PER_VERTEX }\n"
+    "  Coordinate3 { point [ 0 0 0, 1 0 0, 1 1 0, 0 0 1, 1 0 1, 1 1 1, 0 1 1 ] }\n"
+    "  FaceSet { numVertices [ 3, 4 ] }\n"
+    "}\n",
+    // per triangle materials in indexed strips
+    "#Inventor V2.1 ascii\n"
+    "Separator {\n"
+    "  Material { diffuseColor [ 1 0 0, 0 1 0, 0 0 1, 1 1 0 ] }\n"
+    "  MaterialBinding { value PER_FACE }\n"
+    "  Coordinate3 { point [ 0 0 0, 1 0 0, 0 1 0, 1 1 0, 0 2 0 ] }\n"
+    "  IndexedTriangleStripSet { coordIndex [ 0 1 2 3 4 -1, 1 3 2 -1 ] }\n"
+    "}\n",
+    // per strip materials and per vertex normals in strips
+    "#Inventor V2.1 ascii\n"
+    "Separator {\n"
+    "  Material { diffuseColor [ 1 0 0, 0 1 0 ] }\n"
+    "  MaterialBinding { value PER_PART }\n"
+    "  Normal { vector [ 0 0 1, 0 1 0, 1 0 0, 0 0 1, 0 1 0, 1 0 0, 0 0 1, 0 1 0 ] }\n"
+    "  NormalBinding { value PER_VERTEX }\n"
+    "  Coordinate3 { point [ 0 0 0, 1 0 0, 0 1 0, 1 1 0, 0 2 0, 0 0 1, 1 0 1, 0 1 1 ] }\n"
+    "  TriangleStripSet { numVertices [ 5, 3 ] }\n"
+    "}\n"
+  };
+
+  for (int s = 0; s < int(sizeof(scenes) / sizeof(scenes[0])); s++) {
+    SoSeparator * root = test_read_scene(scenes[s]);
+    BOOST_REQUIRE(root != NULL);
+    root->ref();
+
+    test_batch_compare data;
+    data.numbatchvertices = 0;
+    SoCallbackAction cba;
+    cba.addTriangleCallback(SoShape::getClassTypeId(), test_compare_triangle_cb, &data);
+    cba.addTriangleBatchCallback(SoShape::getClassTypeId(), test_compare_batch_cb, &data);
+    cba.apply(root);
+
+    BOOST_CHECK_MESSAGE(data.fromtriangles.getLength() > 0, "scene " << s);
+    BOOST_CHECK_EQUAL(data.frombatch.getLength(), data.fromtriangles.getLength());
+    const int n = SbMin(data.frombatch.getLength(), data.fromtriangles.getLength());
+    int mismatch = -1;
+    for (int i = 0; i < n && mismatch < 0; i++) {
+      const test_batch_vertex & a = data.fromtriangles[i];
+      const test_batch_vertex & b = data.frombatch[i];
+      if (a.point != b.point || a.normal != b.normal ||
+          !a.texcoord.equals(b.texcoord, 1e-6f) || a.material != b.material) {
+        mismatch = i;
+      }
+    }
+    BOOST_CHECK_MESSAGE(mismatch < 0, "scene " << s << ": vertex " << mismatch << " differs");
+    root->unref();
+  }
+}
+
+// Vertices are shared on their indices, so two coordinates with the
+// same value are kept apart.
+BOOST_AUTO_TEST_CASE(triangleBatchIndexSharing)
+{
+  SoSeparator * root = test_read_scene(
+    "#Inventor V2.1 ascii\n"
+    "Separator {\n"
+    "  Normal { vector 0 0 1 }\n"
+    "  NormalBinding { value OVERALL }\n"
+    "  Coordinate3 { point [ 0 0 0, 1 0 0, 1 1 0, 0 1 0, 0 0 0 ] }\n"
+    "  IndexedFaceSet { coordIndex [ 0 1 2 -1, 4 2 3 -1 ] }\n"
+    "}\n");
+  BOOST_REQUIRE(root != NULL);
+  root->ref();
+
+  test_batch_compare data;
+  data.numbatchvertices = 0;
+  SoCallbackAction cba;
+  cba.addTriangleBatchCallback(SoShape::getClassTypeId(), test_compare_batch_cb, &data);
+  cba.apply(root);
+  BOOST_CHECK_EQUAL(data.frombatch.getLength(), 6);
+  BOOST_CHECK_EQUAL(data.numbatchvertices, 5);
+  root->unref();
+}
+
 #endif // COIN_TEST_SUITE
@@ -0,0 +1,495 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+
+/*!
+  \class SoShareNodesAction SoShareNodesAction.h Inventor/actions/SoShareNodesAction.h
+  \ingroup coin_actions
+  \brief The SoShareNodesAction class replaces duplicate nodes with shared instances.
+
+  Models converted from other formats often contain the same
+  coordinates, normals, materials or even complete shapes many times
+  over, written out as separate nodes instead of as references to a
+  single node. Apply this action to such a scene graph, typically
+  right after reading it with SoDB::readAll(), to have all nodes with
+  identical field values replaced with references to one of
+  them. This reduces the memory used by the scene graph, and since
+  the replaced nodes are shared afterwards, it also lets the render
+  caches of the remaining nodes be reused.
+
+  \code
+  SoSeparator * root = SoDB::readAll(&in);
+  if (root) {
+    root->ref();
+    SoShareNodesAction share;
+    share.apply(root);
+    printf("%d nodes shared, %lu bytes saved\n",
+           share.getNumSharedNodes(),
+           (unsigned long)share.getMemorySaved());
+  }
+  \endcode
+
+  By default, the action considers coordinate, normal, texture
+  coordinate, material and binding nodes, vertex properties, shape
+  hints and the vertex based shapes. More node types can be added
+  with addNodeType().
+
+  Two nodes are only considered equal if they are of the same type,
+  have the same name and all their field values are equal. Nodes
+  with connected fields are never replaced. The action does not
+  descend into node kits.
+
+  Note that the scene graph is changed in place. Any references the
+  application holds to the replaced nodes will no longer point into
+  the scene graph.
+
+  \since Coin 4.1
+*/
+
+#include <Inventor/actions/SoShareNodesAction.h>
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <Inventor/SbName.h>
+#include <Inventor/SbString.h>
+#include <Inventor/lists/SoFieldList.h>
+#include <Inventor/lists/SoNodeList.h>
+#include <Inventor/lists/SoTypeList.h>
+#include <Inventor/lists/SbPList.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/fields/SoSFNode.h>
+#include <Inventor/fields/SoMFNode.h>
+#include <Inventor/fields/SoSFImage.h>
+#include <Inventor/fields/SoSFImage3.h>
+#include <Inventor/nodes/SoGroup.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoCoordinate4.h>
+#include <Inventor/nodes/SoNormal.h>
+#include <Inventor/nodes/SoNormalBinding.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoMaterialBinding.h>
+#include <Inventor/nodes/SoBaseColor.h>
+#include <Inventor/nodes/SoPackedColor.h>
+#include <Inventor/nodes/SoTextureCoordinate2.h>
+#include <Inventor/nodes/SoTextureCoordinate3.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+#include <Inventor/nodes/SoShapeHints.h>
+#include <Inventor/nodes/SoVertexShape.h>
+#include <Inventor/nodekits/SoBaseKit.h>
+
+#ifdef HAVE_VRML97
+#include <Inventor/VRMLnodes/SoVRMLCoordinate.h>
+#include <Inventor/VRMLnodes/SoVRMLNormal.h>
+#include <Inventor/VRMLnodes/SoVRMLColor.h>
+#include <Inventor/VRMLnodes/SoVRMLTextureCoordinate.h>
+#include <Inventor/VRMLnodes/SoVRMLMaterial.h>
+#include <Inventor/VRMLnodes/SoVRMLVertexShape.h>
+#endif // HAVE_VRML97
+
+#include "misc/SbHash.h"
+#include "actions/SoSubActionP.h"
+
+// *************************************************************************
+
+class SoShareNodesActionP {
+public:
+  SoShareNodesActionP(void)
+    : numshared(0), memsaved(0)
+  {
+    this->types.append(SoCoordinate3::getClassTypeId());
+    this->types.append(SoCoordinate4::getClassTypeId());
+    this->types.append(SoNormal::getClassTypeId());
+    this->types.append(SoNormalBinding::getClassTypeId());
+    this->types.append(SoMaterial::getClassTypeId());
+    this->types.append(SoMaterialBinding::getClassTypeId());
+    this->types.append(SoBaseColor::getClassTypeId());
+    this->types.append(SoPackedColor::getClassTypeId());
+    this->types.append(SoTextureCoordinate2::getClassTypeId());
+    this->types.append(SoTextureCoordinate3::getClassTypeId());
+    this->types.append(SoVertexProperty::getClassTypeId());
+    this->types.append(SoShapeHints::getClassTypeId());
+    this->types.append(SoVertexShape::getClassTypeId());
+#ifdef HAVE_VRML97
+    this->types.append(SoVRMLCoordinate::getClassTypeId());
+    this->types.append(SoVRMLNormal::getClassTypeId());
+    this->types.append(SoVRMLColor::getClassTypeId());
+    this->types.append(SoVRMLTextureCoordinate::getClassTypeId());
+    this->types.append(SoVRMLMaterial::getClassTypeId());
+    this->types.append(SoVRMLVertexShape::getClassTypeId());
+#endif // HAVE_VRML97
+  }
+
+  SoNode * share(SoNode * node);
+  SbBool isCandidate(SoNode * node) const;
+  void clear(void);
+
+  static uint32_t hashNode(SoNode * node);
+  static SbBool isSameNode(SoNode * node, SoNode * other);
+
+  SoTypeList types;
+  // canonical nodes, keyed on a hash of their contents
+  SbHash<uint32_t, SbPList *> canonical;
+  // the node to use in place of each node already traversed
+  SbHash<const SoNode *, SoNode *> visited;
+  // replaced nodes are kept alive until the traversal is done, so
+  // their addresses are not reused while still in the visited dict
+  SoNodeList dropped;
+  int numshared;
+  size_t memsaved;
+};
+
+// Returns the node which should be used instead of \a node. The
+// nodes below \a node are shared first, so that equal shapes also
+// refer to equal property nodes when they are compared.
+SoNode *
+SoShareNodesActionP::share(SoNode * node)
+{
+  SoNode * result;
+  if (this->visited.get(node, result)) return result;
+  this->visited.put(node, node);
+
+  if (node->isOfType(SoBaseKit::getClassTypeId())) return node;
+
+  if (node->isOfType(SoGroup::getClassTypeId())) {
+    SoGroup * group = static_cast<SoGroup *>(node);
+    const int numchildren = group->getNumChildren();
+    for (int i = 0; i < numchildren; i++) {
+      SoNode * child = group->getChild(i);
+      SoNode * newchild = this->share(child);
+      if (newchild != child) group->replaceChild(i, newchild);
+    }
+  }
+  else {
+    SoFieldList fields;
+    const int numfields = node->getFields(fields);
+    for (int i = 0; i < numfields; i++) {
+      SoField * field = fields[i];
+      if (field->isConnected()) continue;
+      if (field->isOfType(SoSFNode::getClassTypeId())) {
+        SoSFNode * sfnode = static_cast<SoSFNode *>(field);
+        SoNode * value = sfnode->getValue();
+        if (value) {
+          SoNode * newvalue = this->share(value);
+          if (newvalue != value) sfnode->setValue(newvalue);
+        }
+      }
+      else if (field->isOfType(SoMFNode::getClassTypeId())) {
+        SoMFNode * mfnode = static_cast<SoMFNode *>(field);
+        for (int j = 0; j < mfnode->getNum(); j++) {
+          SoNode * value = (*mfnode)[j];
+          if (value) {
+            SoNode * newvalue = this->share(value);
+            if (newvalue != value) mfnode->set1Value(j, newvalue);
+          }
+        }
+      }
+    }
+  }
+
+  if (!this->isCandidate(node)) return node;
+
+  const uint32_t key = SoShareNodesActionP::hashNode(node);
+  SbPList * bucket;
+  if (!this->canonical.get(key, bucket)) {
+    bucket = new SbPList;
+    this->canonical.put(key, bucket);
+  }
+  for (int i = 0; i < bucket->getLength(); i++) {
+    SoNode * other = static_cast<SoNode *>((*bucket)[i]);
+    if (SoShareNodesActionP::isSameNode(node, other)) {
+      size_t managed, unmanaged;
+      node->getFieldsMemorySize(managed, unmanaged);
+      this->memsaved += managed + unmanaged;
+      this->numshared++;
+      this->dropped.append(node);
+      this->visited.put(node, other);
+      return other;
+    }
+  }
+  bucket->append(node);
+  return node;
+}
+
+SbBool
+SoShareNodesActionP::isCandidate(SoNode * node) const
+{
+  const SoType type = node->getTypeId();
+  int i;
+  for (i = 0; i < this->types.getLength(); i++) {
+    if (type.isDerivedFrom(this->types[i])) break;
+  }
+  if (i == this->types.getLength()) return FALSE;
+
+  // replacing nodes which are part of a field network would change
+  // what the network is connected to
+  SoFieldList fields;
+  const int numfields = node->getFields(fields);
+  for (i = 0; i < numfields; i++) {
+    SoFieldList slaves;
+    if (fields[i]->isConnected() ||
+        fields[i]->getForwardConnections(slaves) > 0) return FALSE;
+  }
+  return TRUE;
+}
+
+void
+SoShareNodesActionP::clear(void)
+{
+  SbList<uint32_t> keys;
+  this->canonical.makeKeyList(keys);
+  for (int i = 0; i < keys.getLength(); i++) {
+    SbPList * bucket = NULL;
+    this->canonical.get(keys[i], bucket);
+    delete bucket;
+  }
+  this->canonical.clear();
+  this->visited.clear();
+  this->dropped.truncate(0);
+}
+
+// Hashes the node type, name and a sample of the field values. For
+// large multi-value fields only a few values are used, as equal
+// hashes are always checked with isSameNode() anyway.
+uint32_t
+SoShareNodesActionP::hashNode(SoNode * node)
+{
+  SbString str(node->getTypeId().getName().getString());
+  str += ":";
+  str += node->getName().getString();
+  if (node->isOverride()) str += "!";
+
+  SbString value;
+  SoFieldList fields;
+  const int numfields = node->getFields(fields);
+  for (int i = 0; i < numfields; i++) {
+    SoField * field = fields[i];
+    str += field->isIgnored() ? "|~" : "|";
+    if (field->isOfType(SoSFNode::getClassTypeId())) {
+      value.sprintf("%p", static_cast<void *>(static_cast<SoSFNode *>(field)->getValue()));
+      str += value;
+    }
+    else if (field->isOfType(SoMFNode::getClassTypeId())) {
+      str.addIntString(static_cast<SoMFNode *>(field)->getNum());
+    }
+    else if (field->isOfType(SoMField::getClassTypeId())) {
+      SoMField * mfield = static_cast<SoMField *>(field);
+      const int num = mfield->getNum();
+      str.addIntString(num);
+      const int step = num > 4 ? num / 4 : 1;
+      for (int j = 0; j < num; j += step) {
+        mfield->get1(j, value);
+        str += value;
+      }
+    }
+    else if (!field->isOfType(SoSFImage::getClassTypeId()) &&
+             !field->isOfType(SoSFImage3::getClassTypeId())) {
+      field->get(value);
+      str += value;
+    }
+  }
+  return str.hash();
+}
+
+SbBool
+SoShareNodesActionP::isSameNode(SoNode * node, SoNode * other)
+{
+  if (node->getTypeId() != other->getTypeId()) return FALSE;
+  if (node->getName() != other->getName()) return FALSE;
+  if (node->isOverride() != other->isOverride()) return FALSE;
+
+  SoFieldList fields, otherfields;
+  const int numfields = node->getFields(fields);
+  if (other->getFields(otherfields) != numfields) return FALSE;
+  for (int i = 0; i < numfields; i++) {
+    if (fields[i]->isIgnored() != otherfields[i]->isIgnored()) return FALSE;
+    if (!fields[i]->isSame(*otherfields[i])) return FALSE;
+  }
+  return TRUE;
+}
+
+// *************************************************************************
+
+#define PRIVATE(obj) obj->pimpl
+
+SO_ACTION_SOURCE(SoShareNodesAction);
+
+/*!
+  \copydetails SoAction::initClass(void)
+*/
+void
+SoShareNodesAction::initClass(void)
+{
+  SO_ACTION_INTERNAL_INIT_CLASS(SoShareNodesAction, SoAction);
+}
+
+/*!
+  A constructor.
+*/
+SoShareNodesAction::SoShareNodesAction(void)
+{
+  SO_ACTION_CONSTRUCTOR(SoShareNodesAction);
+}
+
+/*!
+  The destructor.
+*/
+SoShareNodesAction::~SoShareNodesAction(void)
+{
+}
+
+/*!
+  Makes the action share nodes of \a type, and of types derived from
+  it, in addition to the default node types.
+*/
+void
+SoShareNodesAction::addNodeType(const SoType type)
+{
+  if (PRIVATE(this)->types.find(type) < 0) {
+    PRIVATE(this)->types.append(type);
+  }
+}
+
+/*!
+  Stops the action from sharing nodes of \a type. Only types which
+  are in the list of node types, either by default or through
+  addNodeType(), can be removed.
+*/
+void
+SoShareNodesAction::removeNodeType(const SoType type)
+{
+  const int idx = PRIVATE(this)->types.find(type);
+  if (idx >= 0) PRIVATE(this)->types.remove(idx);
+}
+
+/*!
+  Returns the number of nodes which were replaced with a shared
+  instance during the last traversal.
+*/
+int
+SoShareNodesAction::getNumSharedNodes(void) const
+{
+  return PRIVATE(this)->numshared;
+}
+
+/*!
+  Returns the number of bytes of field data held by the nodes which
+  were replaced during the last traversal. The memory is freed when
+  the replaced nodes are no longer referenced by the application.
+
+  \sa SoFieldContainer::getFieldsMemorySize()
+*/
+size_t
+SoShareNodesAction::getMemorySaved(void) const
+{
+  return PRIVATE(this)->memsaved;
+}
+
+// Documented in superclass.
+void
+SoShareNodesAction::beginTraversal(SoNode * node)
+{
+  PRIVATE(this)->numshared = 0;
+  PRIVATE(this)->memsaved = 0;
+  (void)PRIVATE(this)->share(node);
+  PRIVATE(this)->clear();
+}
+
+#undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+
+static SoSeparator *
+test_share_shape(float offset)
+{
+  SoSeparator * sep = new SoSeparator;
+  SoMaterial * mat = new SoMaterial;
+  mat->diffuseColor.setValue(1.0f, 0.0f, 0.0f);
+  sep->addChild(mat);
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->point.set1Value(0, SbVec3f(0.0f, 0.0f, 0.0f));
+  coords->point.set1Value(1, SbVec3f(1.0f, 0.0f, 0.0f));
+  coords->point.set1Value(2, SbVec3f(0.0f, 1.0f, offset));
+  sep->addChild(coords);
+  SoIndexedFaceSet * ifs = new SoIndexedFaceSet;
+  const int32_t idx[] = { 0, 1, 2, -1 };
+  ifs->coordIndex.setValues(0, 4, idx);
+  sep->addChild(ifs);
+  return sep;
+}
+
+BOOST_AUTO_TEST_CASE(shareDuplicates)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  root->addChild(test_share_shape(0.0f));
+  root->addChild(test_share_shape(0.0f));
+  root->addChild(test_share_shape(1.0f));
+
+  SoShareNodesAction share;
+  share.apply(root);
+
+  SoGroup * a = static_cast<SoGroup *>(root->getChild(0));
+  SoGroup * b = static_cast<SoGroup *>(root->getChild(1));
+  SoGroup * c = static_cast<SoGroup *>(root->getChild(2));
+
+  // the separators are not shared, everything below them is, except
+  // the coordinates which differ
+  BOOST_CHECK(a != b);
+  BOOST_CHECK(a->getChild(0) == b->getChild(0));
+  BOOST_CHECK(a->getChild(1) == b->getChild(1));
+  BOOST_CHECK(a->getChild(2) == b->getChild(2));
+  BOOST_CHECK(a->getChild(0) == c->getChild(0));
+  BOOST_CHECK(a->getChild(1) != c->getChild(1));
+  BOOST_CHECK(a->getChild(2) == c->getChild(2));
+  BOOST_CHECK_EQUAL(share.getNumSharedNodes(), 5);
+  BOOST_CHECK(share.getMemorySaved() > 0);
+
+  // nodes with different names are kept apart
+  a->getChild(1)->setName("named");
+  root->addChild(test_share_shape(0.0f));
+  share.apply(root);
+  SoGroup * d = static_cast<SoGroup *>(root->getChild(3));
+  BOOST_CHECK(d->getChild(0) == a->getChild(0));
+  BOOST_CHECK(d->getChild(1) != a->getChild(1));
+  BOOST_CHECK_EQUAL(share.getNumSharedNodes(), 2);
+
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
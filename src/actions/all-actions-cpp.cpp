@@ -51,6 +51,7 @@
 #include "SoRayPickAction.cpp"
 #include "SoReorganizeAction.cpp"
 #include "SoSearchAction.cpp"
+#include "SoShareNodesAction.cpp"
 #include "SoSimplifyAction.cpp"
 #include "SoToVRMLAction.cpp"
 #include "SoWriteAction.cpp"
@@ -234,6 +234,27 @@ SoTextureCoordinateBundle::get(const SbVec3f &point, const SbVec3f &normal)
   }
 }
 
+/*!
+  Generates texture coordinates for \a num points and normals into
+  \a result. \a normals can be NULL, in which case (0, 0, 1) is used.
+  This is the batch version of get(point, normal), and should only be
+  used if SoTextureCoordinateBundle::isFunction() is \a TRUE.
+
+  \since Coin 4.1
+*/
+void
+SoTextureCoordinateBundle::get(const int num, const SbVec3f * points,
+                               const SbVec3f * normals, SbVec4f * result)
+{
+  assert(this->coordElt != NULL && (this->flags & FLAG_FUNCTION));
+  if (this->flags & FLAG_DEFAULT) {
+    SoTextureCoordinateBundle::defaultBatchCB(this, num, points, normals, result);
+  }
+  else {
+    this->coordElt->get(0, num, points, normals, result);
+  }
+}
+
 /*!
   Returns the texture coordinates at index \a index.
   Should only be used if SoTextureCoordinateBundle::isFunction() is \a FALSE.
@@ -276,6 +297,7 @@ SoTextureCoordinateBundle::initDefault(SoAction * action, const int unit)
   }
   SoMultiTextureCoordinateElement::setFunction(this->state, this->shapenode, unit,
                                                SoTextureCoordinateBundle::defaultCBMulti,
+                                               SoTextureCoordinateBundle::defaultBatchCB,
                                                this);
   if (!(this->flags & FLAG_DIDINITDEFAULT)) {
     this->initDefaultCallback(action);
@@ -318,6 +340,42 @@ SoTextureCoordinateBundle:: defaultCBMulti(void * userdata,
   return thisp->dummyInstance;
 }
 
+//
+// batch version of the default texture coordinate callback, with
+// the dimension selection hoisted out of the loop
+//
+void
+SoTextureCoordinateBundle::defaultBatchCB(void * userdata,
+                                          const int num,
+                                          const SbVec3f * points,
+                                          const SbVec3f * COIN_UNUSED_ARG(normals),
+                                          SbVec4f * result)
+{
+  SoTextureCoordinateBundle * thisp = static_cast<SoTextureCoordinateBundle *>(userdata);
+
+  const int d0 = thisp->defaultdim0;
+  const int d1 = thisp->defaultdim1;
+  const float o0 = thisp->defaultorigo[0];
+  const float o1 = thisp->defaultorigo[1];
+  const float o2 = thisp->defaultorigo[2];
+  const float s0 = thisp->defaultsize[0];
+  const float s1 = thisp->defaultsize[1];
+  const float s2 = thisp->defaultsize[2];
+
+  if (thisp->flags & FLAG_3DTEXTURES) {
+    for (int i = 0; i < num; i++) {
+      const float * p = points[i].getValue();
+      result[i].setValue((p[0] - o0) / s0, (p[1] - o1) / s1, (p[2] - o2) / s2, 1.0f);
+    }
+  }
+  else {
+    for (int i = 0; i < num; i++) {
+      const float * p = points[i].getValue();
+      result[i].setValue((p[d0] - o0) / s0, (p[d1] - o1) / s1, 0.0f, 1.0f);
+    }
+  }
+}
+
 //
 // Set up stuff needed for default texture coordinate mapping callback
 //
@@ -35,6 +35,30 @@
   \brief The SoGLCacheList class is used to store and manage OpenGL caches.
 
   \ingroup coin_caches
+
+  By default, auto caching (SoSeparator::renderCaching set to AUTO)
+  is decided from a few fixed heuristics: the number of frames the
+  separator has been valid, the number of primitives rendered below
+  it, and how many caches have been thrown away earlier.
+
+  If the environment variable COIN_ADAPTIVE_CACHING is set to 1, an
+  adaptive cost model is used instead. For each cache list the time
+  spent rendering without a cache, the time spent building a cache,
+  the time spent calling a cache and the number of frames between
+  invalidations are measured. A cache is then only created when the
+  expected savings over the expected lifetime of the cache exceed the
+  extra cost of building it. Separators that are invalidated every
+  frame (e.g. because of animated children) will then stop building
+  caches that are thrown away immediately, while static parts of the
+  scene graph will still be cached. The variable is read when each
+  cache list is constructed.
+
+  The counters returned by getNumCacheCalls(), getNumCachesBuilt(),
+  getNumCachesDiscarded(), getNumInvalidations() and
+  getAverageLifetime() are also kept when the adaptive policy is not
+  enabled. The times returned by getAverageRenderTime(),
+  getAverageBuildTime() and getAverageCallTime() are only measured
+  with the adaptive policy.
 */
 
 #include <Inventor/caches/SoGLCacheList.h>
@@ -44,6 +68,7 @@
 #endif // HAVE_CONFIG_H
 
 #include <Inventor/C/tidbits.h>
+#include <Inventor/SbTime.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/caches/SoGLRenderCache.h>
 #include <Inventor/elements/SoCacheElement.h>
@@ -89,6 +114,28 @@ public:
   int numframesok;
   int numshapes;
 
+  // use the adaptive caching policy
+  SbBool adaptive;
+  // statistics used by the adaptive caching policy. Times are in
+  // seconds and are exponentially weighted moving averages. A
+  // negative value means that no measurement has been done yet.
+  SbTime starttime;
+  SbBool timed;
+  double rendertime;
+  double buildtime;
+  double calltime;
+  double lifetime;
+  int numbuilt;
+  int numinvalidations;
+  int framessinceinvalidation;
+
+  static double average(const double avg, const double sample) {
+    if (avg < 0.0) return sample;
+    return avg * 0.75 + sample * 0.25;
+  }
+
+  SbBool adaptiveShouldCreate(void) const;
+
   //
   // Callback from SoContextHandler
   //
@@ -108,6 +155,48 @@ public:
   }
 };
 
+// Decides whether a cache should be created, based on the measured
+// cost of building and calling caches versus rendering without one.
+// Times and lifetime are negative until they have been measured.
+extern "C" SbBool
+soglcachelist_adaptive_should_create(const double rendertime,
+                                     const double buildtime,
+                                     const double calltime,
+                                     const double lifetime,
+                                     const int framessinceinvalidation,
+                                     const int autocachebits)
+{
+  // we need to know the cost of an uncached traversal
+  if (rendertime < 0.0) return FALSE;
+  // until a cache has been built, we trust the primitive count
+  // heuristics in sogl_autocache_update()
+  if (buildtime < 0.0 &&
+      autocachebits != SoGLCacheContextElement::DO_AUTO_CACHE) return FALSE;
+
+  const double render = rendertime;
+  // use conservative estimates until we have real measurements
+  const double build = (buildtime >= 0.0) ? buildtime : 2.0 * render;
+  const double call = (calltime >= 0.0) ? calltime : 0.5 * render;
+  if (call >= render) return FALSE;
+
+  // the cache is expected to survive as long as the average time
+  // between invalidations, or at least as long as the separator has
+  // been valid so far
+  double frames = static_cast<double>(framessinceinvalidation);
+  if (lifetime > frames) frames = lifetime;
+
+  return (frames * (render - call)) > (build - render);
+}
+
+SbBool
+SoGLCacheListP::adaptiveShouldCreate(void) const
+{
+  return soglcachelist_adaptive_should_create(this->rendertime, this->buildtime,
+                                              this->calltime, this->lifetime,
+                                              this->framessinceinvalidation,
+                                              this->autocachebits);
+}
+
 #define PRIVATE(obj) ((obj)->pimpl)
 
 // *************************************************************************
@@ -127,6 +216,14 @@ SoGLCacheList::SoGLCacheList(int numcaches)
   PRIVATE(this)->invalidelement = NULL;
   PRIVATE(this)->numframesok = 0;
   PRIVATE(this)->numshapes = 0;
+  PRIVATE(this)->timed = FALSE;
+  PRIVATE(this)->rendertime = -1.0;
+  PRIVATE(this)->buildtime = -1.0;
+  PRIVATE(this)->calltime = -1.0;
+  PRIVATE(this)->lifetime = -1.0;
+  PRIVATE(this)->numbuilt = 0;
+  PRIVATE(this)->numinvalidations = 0;
+  PRIVATE(this)->framessinceinvalidation = 0;
 
   // auto caching must be enabled using an environment variable
   if (COIN_AUTO_CACHING < 0) {
@@ -139,6 +236,10 @@ SoGLCacheList::SoGLCacheList(int numcaches)
     if (env) COIN_SMART_CACHING = atoi(env);
     else COIN_SMART_CACHING = 0;
   }
+  // not cached like the settings above, so the policy can be
+  // changed for new cache lists
+  const char * env = coin_getenv("COIN_ADAPTIVE_CACHING");
+  PRIVATE(this)->adaptive = env ? (atoi(env) != 0) : FALSE;
 
   SoContextHandler::addContextDestructionCallback(SoGLCacheListP::contextCleanup, PRIVATE(this));
 
@@ -200,10 +301,20 @@ SoGLCacheList::call(SoGLRenderAction * action)
         PRIVATE(this)->itemlist.append(cache);
         // update lazy GL state before calling cache
         SoGLLazyElement::getInstance(state)->send(state, SoLazyElement::ALL_MASK);
-        cache->call(state);
+        if (PRIVATE(this)->adaptive) {
+          const SbTime start = SbTime::getTimeOfDay();
+          cache->call(state);
+          PRIVATE(this)->calltime =
+            SoGLCacheListP::average(PRIVATE(this)->calltime,
+                                    (SbTime::getTimeOfDay() - start).getValue());
+        }
+        else {
+          cache->call(state);
+        }
         SoGLLazyElement::postCacheCall(state, cache->getPostLazyState());
         cache->unref(state);
         PRIVATE(this)->numused++;
+        PRIVATE(this)->framessinceinvalidation++;
 
 #if COIN_DEBUG
         // The GL error test is default disabled for this optimized
@@ -473,12 +584,35 @@ SoGLCacheList::open(SoGLRenderAction * action, SbBool autocache)
   // will be restored in close()
   PRIVATE(this)->savedinvalid = SoCacheElement::setInvalid(FALSE);
 
+  // traversals below another open cache are not timed, as they are
+  // included in the time measured for the outer cache list
+  PRIVATE(this)->timed = FALSE;
   if (SoCacheElement::anyOpen(state)) return;
 
+  if (PRIVATE(this)->adaptive) {
+    PRIVATE(this)->starttime = SbTime::getTimeOfDay();
+    PRIVATE(this)->timed = TRUE;
+  }
+
   SbBool shouldcreate = FALSE;
   if (!autocache) {
     if (PRIVATE(this)->numframesok >= 1) shouldcreate = TRUE;
   }
+  else if (PRIVATE(this)->adaptive) {
+    if (PRIVATE(this)->numframesok >= 1) {
+      shouldcreate = PRIVATE(this)->adaptiveShouldCreate();
+    }
+#if COIN_DEBUG
+    if (coin_debug_caching_level() > 0 && PRIVATE(this)->numframesok >= 1) {
+      SoDebugError::postInfo("SoGLCacheList::open",
+                             "adaptive cache create: %p: %s. render: %g, build: %g, "
+                             "call: %g, lifetime: %g",
+                             this, shouldcreate ? "yes" : "no",
+                             PRIVATE(this)->rendertime, PRIVATE(this)->buildtime,
+                             PRIVATE(this)->calltime, PRIVATE(this)->lifetime);
+    }
+#endif // debug
+  }
   else {
     if (PRIVATE(this)->numframesok >= 2 &&
         (PRIVATE(this)->autocachebits == SoGLCacheContextElement::DO_AUTO_CACHE)) {
@@ -517,7 +651,7 @@ SoGLCacheList::open(SoGLRenderAction * action, SbBool autocache)
     }
   }
 
-  if (shouldcreate && autocache) {
+  if (shouldcreate && autocache && !PRIVATE(this)->adaptive) {
     // determine if we really should create a new cache, based on numused and numdiscarded
     double docreate = static_cast<double>(PRIVATE(this)->numframesok + PRIVATE(this)->numused);
     double dontcreate = (PRIVATE(this)->numdiscarded);
@@ -577,6 +711,16 @@ SoGLCacheList::close(SoGLRenderAction * action)
     PRIVATE(this)->opencache->close();
     SoGLLazyElement::endCaching(state);
   }
+  if (PRIVATE(this)->timed) {
+    PRIVATE(this)->timed = FALSE;
+    const double elapsed = (SbTime::getTimeOfDay() - PRIVATE(this)->starttime).getValue();
+    if (PRIVATE(this)->opencache) {
+      PRIVATE(this)->buildtime = SoGLCacheListP::average(PRIVATE(this)->buildtime, elapsed);
+    }
+    else {
+      PRIVATE(this)->rendertime = SoGLCacheListP::average(PRIVATE(this)->rendertime, elapsed);
+    }
+  }
   if (SoCacheElement::setInvalid(PRIVATE(this)->savedinvalid)) {
     // notify parent caches
     SoCacheElement::setInvalid(TRUE);
@@ -597,6 +741,7 @@ SoGLCacheList::close(SoGLRenderAction * action)
   }
   else {
     PRIVATE(this)->numframesok++;
+    PRIVATE(this)->framessinceinvalidation++;
   }
 
   // open cache is ok, add it to the cache list
@@ -609,6 +754,7 @@ SoGLCacheList::close(SoGLRenderAction * action)
 #endif // debug
     PRIVATE(this)->itemlist.append(PRIVATE(this)->opencache);
     PRIVATE(this)->opencache = NULL;
+    PRIVATE(this)->numbuilt++;
   }
 
   PRIVATE(this)->numshapes = SoGLCacheContextElement::getNumShapes(state);
@@ -638,6 +784,256 @@ SoGLCacheList::invalidateAll(void)
   PRIVATE(this)->itemlist.truncate(0);
   PRIVATE(this)->numdiscarded += n;
   PRIVATE(this)->numframesok = 0;
+
+  // several notifications might arrive between two frames, only
+  // count them as one invalidation
+  if (PRIVATE(this)->framessinceinvalidation > 0) {
+    PRIVATE(this)->lifetime =
+      SoGLCacheListP::average(PRIVATE(this)->lifetime,
+                              static_cast<double>(PRIVATE(this)->framessinceinvalidation));
+    PRIVATE(this)->framessinceinvalidation = 0;
+    PRIVATE(this)->numinvalidations++;
+  }
+}
+
+/*!
+  Returns the number of times a valid cache has been called.
+
+  \since Coin 4.1
+*/
+int
+SoGLCacheList::getNumCacheCalls(void) const
+{
+  return PRIVATE(this)->numused;
+}
+
+/*!
+  Returns the number of caches that have been successfully built.
+
+  \since Coin 4.1
+*/
+int
+SoGLCacheList::getNumCachesBuilt(void) const
+{
+  return PRIVATE(this)->numbuilt;
+}
+
+/*!
+  Returns the number of caches that have been thrown away, either
+  because they were invalidated or because they failed to build.
+
+  \since Coin 4.1
+*/
+int
+SoGLCacheList::getNumCachesDiscarded(void) const
+{
+  return PRIVATE(this)->numdiscarded;
+}
+
+/*!
+  Returns the number of times the caches have been invalidated
+  between two render traversals.
+
+  \since Coin 4.1
+*/
+int
+SoGLCacheList::getNumInvalidations(void) const
+{
+  return PRIVATE(this)->numinvalidations;
+}
+
+/*!
+  Returns the average time, in seconds, spent rendering without a
+  cache. Returns a negative value if no measurement is available.
+
+  Times are only measured when the adaptive caching policy is enabled
+  (see COIN_ADAPTIVE_CACHING in the class documentation).
+
+  \since Coin 4.1
+*/
+double
+SoGLCacheList::getAverageRenderTime(void) const
+{
+  return PRIVATE(this)->rendertime;
+}
+
+/*!
+  Returns the average time, in seconds, spent rendering while
+  building a cache. Returns a negative value if no measurement is
+  available.
+
+  Times are only measured when the adaptive caching policy is enabled.
+
+  \since Coin 4.1
+*/
+double
+SoGLCacheList::getAverageBuildTime(void) const
+{
+  return PRIVATE(this)->buildtime;
+}
+
+/*!
+  Returns the average time, in seconds, spent calling a valid
+  cache. Returns a negative value if no measurement is available.
+
+  Times are only measured when the adaptive caching policy is enabled.
+
+  \since Coin 4.1
+*/
+double
+SoGLCacheList::getAverageCallTime(void) const
+{
+  return PRIVATE(this)->calltime;
+}
+
+/*!
+  Returns the average number of frames rendered between two
+  invalidations. Returns a negative value if the caches have never
+  been invalidated.
+
+  \since Coin 4.1
+*/
+double
+SoGLCacheList::getAverageLifetime(void) const
+{
+  return PRIVATE(this)->lifetime;
 }
 
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/SbString.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/caches/SoBoundingBoxCache.h>
+#include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/elements/SoGLCacheContextElement.h>
+#include <Inventor/misc/SoState.h>
+
+// A cache list below another open cache must not update its timing
+// statistics, since it never starts the timer.
+BOOST_AUTO_TEST_CASE(nestedAdaptiveTiming)
+{
+  // read when each cache list is constructed
+  const char * env = coin_getenv("COIN_ADAPTIVE_CACHING");
+  const SbString prevenv(env ? env : "");
+  coin_setenv("COIN_ADAPTIVE_CACHING", "1", TRUE);
+  SoGLCacheList outer(2);
+  SoGLCacheList inner(2);
+  if (env) coin_setenv("COIN_ADAPTIVE_CACHING", prevenv.getString(), TRUE);
+  else coin_unsetenv("COIN_ADAPTIVE_CACHING");
+
+  SbViewportRegion vp(100, 100);
+  SoGLRenderAction action(vp);
+  SoState * state = action.getState();
+  state->push();
+  // avoid querying the (nonexistent) GL context for direct rendering
+  SoGLCacheContextElement::set(state, 0, FALSE, FALSE);
+
+  outer.open(&action, TRUE);
+  outer.close(&action);
+  BOOST_CHECK_MESSAGE(outer.getAverageRenderTime() >= 0.0 &&
+                      outer.getAverageRenderTime() < 1.0,
+                      "render time not measured");
+
+  // simulate the cache of a parent separator being recorded
+  SoBoundingBoxCache * parentcache = new SoBoundingBoxCache(state);
+  parentcache->ref();
+  state->push();
+  SoCacheElement::set(state, parentcache);
+  inner.open(&action, TRUE);
+  inner.close(&action);
+  state->pop();
+  parentcache->unref();
+
+  BOOST_CHECK_MESSAGE(inner.getAverageRenderTime() < 0.0,
+                      "render time measured below an open cache");
+
+  state->pop();
+}
+
+// soglcachelist_adaptive_should_create() is internal, so it is declared
+// here.
+extern "C" {
+SbBool soglcachelist_adaptive_should_create(const double rendertime,
+                                            const double buildtime,
+                                            const double calltime,
+                                            const double lifetime,
+                                            const int framessinceinvalidation,
+                                            const int autocachebits);
+}
+
+// A cache must pay for its build cost over its expected lifetime.
+BOOST_AUTO_TEST_CASE(adaptiveBuildCost)
+{
+  const int autocache = SoGLCacheContextElement::DO_AUTO_CACHE;
+  // no cache without knowing the cost of an uncached traversal
+  BOOST_CHECK(!soglcachelist_adaptive_should_create(-1.0, 1.0, 0.1, 100.0, 100, autocache));
+  // before the first build, only when the primitive count asks for it
+  BOOST_CHECK(!soglcachelist_adaptive_should_create(1.0, -1.0, -1.0, 100.0, 100, 0));
+  BOOST_CHECK(soglcachelist_adaptive_should_create(1.0, -1.0, -1.0, 100.0, 100, autocache));
+  // a cache which is not faster to call than rendering is useless
+  BOOST_CHECK(!soglcachelist_adaptive_should_create(1.0, 1.0, 1.0, 100.0, 100, 0));
+  BOOST_CHECK(!soglcachelist_adaptive_should_create(1.0, 1.0, 2.0, 100.0, 100, 0));
+  // saves 0.5 per frame for 10 frames, and costs 3 extra to build
+  BOOST_CHECK(soglcachelist_adaptive_should_create(1.0, 4.0, 0.5, 10.0, 0, 0));
+  // costs 6 extra to build
+  BOOST_CHECK(!soglcachelist_adaptive_should_create(1.0, 7.0, 0.5, 10.0, 0, 0));
+  // a cheap cache pays off even if it only lives a couple of frames
+  BOOST_CHECK(soglcachelist_adaptive_should_create(1.0, 1.1, 0.1, 1.0, 0, 0));
+}
+
+// Caches which are invalidated every frame are not rebuilt, while the
+// same caches are built for separators which stay valid.
+BOOST_AUTO_TEST_CASE(adaptiveInvalidationFrequency)
+{
+  // render 1.0, build 3.0, call 0.1: pays off after 3 frames
+  BOOST_CHECK(!soglcachelist_adaptive_should_create(1.0, 3.0, 0.1, 1.0, 0, 0));
+  BOOST_CHECK(!soglcachelist_adaptive_should_create(1.0, 3.0, 0.1, 2.0, 0, 0));
+  BOOST_CHECK(soglcachelist_adaptive_should_create(1.0, 3.0, 0.1, 3.0, 0, 0));
+  // a separator which has been valid for a long time is cached even
+  // if it used to be invalidated often
+  BOOST_CHECK(soglcachelist_adaptive_should_create(1.0, 3.0, 0.1, 1.0, 10, 0));
+  // and never having been invalidated counts as valid so far
+  BOOST_CHECK(!soglcachelist_adaptive_should_create(1.0, 3.0, 0.1, -1.0, 1, 0));
+  BOOST_CHECK(soglcachelist_adaptive_should_create(1.0, 3.0, 0.1, -1.0, 5, 0));
+}
+
+// The frames between invalidations are counted, also without the
+// adaptive policy, and several invalidations between two frames
+// count as one.
+BOOST_AUTO_TEST_CASE(averageLifetime)
+{
+  SoGLCacheList list(2);
+  SbViewportRegion vp(100, 100);
+  SoGLRenderAction action(vp);
+  SoState * state = action.getState();
+  state->push();
+  SoGLCacheContextElement::set(state, 0, FALSE, FALSE);
+
+  BOOST_CHECK(list.getAverageLifetime() < 0.0);
+  for (int frame = 0; frame < 8; frame++) {
+    list.open(&action, TRUE);
+    list.close(&action);
+    list.invalidateAll();
+    list.invalidateAll();
+  }
+  BOOST_CHECK_EQUAL(list.getNumInvalidations(), 8);
+  BOOST_CHECK_CLOSE(list.getAverageLifetime(), 1.0, 0.001);
+  for (int frame = 0; frame < 32; frame++) {
+    list.open(&action, TRUE);
+    list.close(&action);
+    if (frame % 4 == 3) list.invalidateAll();
+  }
+  BOOST_CHECK_EQUAL(list.getNumInvalidations(), 16);
+  // a moving average, which gets close to 4 after 8 invalidations
+  BOOST_CHECK(list.getAverageLifetime() > 3.5 && list.getAverageLifetime() <= 4.0);
+  // no render times are measured
+  BOOST_CHECK(list.getAverageRenderTime() < 0.0);
+
+  state->pop();
+}
+
+#endif // COIN_TEST_SUITE
@@ -96,6 +96,10 @@ public:
       tangentlist(256),
       vhash(1024),
       deptharray(NULL),
+      vertexdepth(NULL),
+      depthkeys(NULL),
+      depthorder(NULL),
+      depthindices(NULL),
       triangleindexer(NULL),
       lineindexer(NULL),
       pointindexer(NULL),
@@ -123,6 +127,10 @@ public:
       delete[] multitexcoords;
     }
     delete[] deptharray;
+    delete[] vertexdepth;
+    delete[] depthkeys;
+    delete[] depthorder;
+    delete[] depthindices;
   }
 
   class Vertex {
@@ -173,6 +181,10 @@ public:
   SoState * state;
   SbPlane prevsortplane;
   float * deptharray;
+  float * vertexdepth;
+  uint32_t * depthkeys;
+  int * depthorder;
+  GLint * depthindices;
 
   SoVertexArrayIndexer * triangleindexer;
   SoVertexArrayIndexer * lineindexer;
@@ -188,6 +200,7 @@ public:
   SoGLLazyElement::GLState poststate;
 
   void addVertex(const Vertex & v);
+  void addMultiTexCoords(const int num, const int * texcoordidx);
 
   void renderImmediate(const cc_glglue * glue,
                        const GLint * indices,
@@ -499,6 +512,8 @@ SoPrimitiveVertexCache::addTriangle(const SoPrimitiveVertex * v0,
   const SoPrimitiveVertex *vp[3] = { v0, v1, v2 };
 
   int32_t triangleindices[3];
+  int newtexcoordidx[3];
+  int numnew = 0;
 
   for (int i = 0; i < 3; i++) {
     SoPrimitiveVertexCacheP::Vertex v;
@@ -547,25 +562,14 @@ SoPrimitiveVertexCache::addTriangle(const SoPrimitiveVertex * v0,
       PRIVATE(this)->vhash.put(v, idx);
       PRIVATE(this)->addVertex(v);
       triangleindices[i] = idx;
-
-      // update texture coordinates for unit 1-n
-      for (int j = 1; j <= PRIVATE(this)->lastenabled; j++) {
-        if (v.texcoordidx >= 0 &&
-            (PRIVATE(this)->multielem->getType(j) == SoMultiTextureCoordinateElement::EXPLICIT)) {
-          PRIVATE(this)->multitexcoords[j].append(PRIVATE(this)->multielem->get4(j, v.texcoordidx));
-        }
-        else if (PRIVATE(this)->multielem->getType(j) == SoMultiTextureCoordinateElement::FUNCTION) {
-          PRIVATE(this)->multitexcoords[j].append(PRIVATE(this)->multielem->get(j, v.vertex, v.normal));
-        }
-        else {
-          PRIVATE(this)->multitexcoords[j].append(v.texcoord0);
-        }
-      }
+      newtexcoordidx[numnew++] = v.texcoordidx;
     }
     else {
       triangleindices[i] = idx;
     }
   }
+  // update texture coordinates for unit 1-n
+  if (numnew) PRIVATE(this)->addMultiTexCoords(numnew, newtexcoordidx);
   if (PRIVATE(this)->triangleindexer == NULL) {
     PRIVATE(this)->triangleindexer = new SoVertexArrayIndexer;
   }
@@ -585,6 +589,8 @@ SoPrimitiveVertexCache::addLine(const SoPrimitiveVertex * v0,
   const SoPrimitiveVertex *vp[2] = { v0,v1 };
 
   int32_t lineindices[2];
+  int newtexcoordidx[2];
+  int numnew = 0;
 
   for (int i = 0; i < 2; i++) {
     SoPrimitiveVertexCacheP::Vertex v;
@@ -631,25 +637,14 @@ SoPrimitiveVertexCache::addLine(const SoPrimitiveVertex * v0,
       PRIVATE(this)->vhash.put(v, idx);
       PRIVATE(this)->addVertex(v);
       lineindices[i] = idx;
-
-      // update texture coordinates for unit 1-n
-      for (int j = 1; j <= PRIVATE(this)->lastenabled; j++) {
-        if (v.texcoordidx >= 0 &&
-            (PRIVATE(this)->multielem->getType(j) == SoMultiTextureCoordinateElement::EXPLICIT)) {
-          PRIVATE(this)->multitexcoords[j].append(PRIVATE(this)->multielem->get4(j, v.texcoordidx));
-        }
-        else if (PRIVATE(this)->multielem->getType(j) == SoMultiTextureCoordinateElement::FUNCTION) {
-          PRIVATE(this)->multitexcoords[j].append(PRIVATE(this)->multielem->get(j, v.vertex, v.normal));
-        }
-        else {
-          PRIVATE(this)->multitexcoords[j].append(v.texcoord0);
-        }
-      }
+      newtexcoordidx[numnew++] = v.texcoordidx;
     }
     else {
       lineindices[i] = idx;
     }
   }
+  // update texture coordinates for unit 1-n
+  if (numnew) PRIVATE(this)->addMultiTexCoords(numnew, newtexcoordidx);
   if (PRIVATE(this)->lineindexer == NULL) {
     PRIVATE(this)->lineindexer = new SoVertexArrayIndexer;
   }
@@ -710,18 +705,7 @@ SoPrimitiveVertexCache::addPoint(const SoPrimitiveVertex * v0)
     PRIVATE(this)->pointindexer->addPoint(idx);
 
     // update texture coordinates for unit 1-n
-    for (int j = 1; j <= PRIVATE(this)->lastenabled; j++) {
-      if (v.texcoordidx >= 0 &&
-          (PRIVATE(this)->multielem->getType(j) == SoMultiTextureCoordinateElement::EXPLICIT)) {
-        PRIVATE(this)->multitexcoords[j].append(PRIVATE(this)->multielem->get4(j, v.texcoordidx));
-      }
-      else if (PRIVATE(this)->multielem->getType(j) == SoMultiTextureCoordinateElement::FUNCTION) {
-        PRIVATE(this)->multitexcoords[j].append(PRIVATE(this)->multielem->get(j, v.vertex, v.normal));
-      }
-      else {
-        PRIVATE(this)->multitexcoords[j].append(v.texcoord0);
-      }
-    }
+    PRIVATE(this)->addMultiTexCoords(1, &v.texcoordidx);
   }
   else {
     PRIVATE(this)->pointindexer->addPoint(idx);
@@ -844,7 +828,8 @@ SoPrimitiveVertexCache::depthSortTriangles(SoState * state)
 {
   int numv = PRIVATE(this)->vertexlist.getLength();
   int numtri = this->getNumTriangleIndices() / 3;
-  if (numv == 0 || numtri == 0) return;
+  if (numv <= 0 || numtri <= 0) return;
+  const size_t indexbytes = static_cast<size_t>(numtri) * 3 * sizeof(GLint);
 
   SbPlane sortplane = SoViewVolumeElement::get(state).getPlane(0.0);
   // move plane into object space
@@ -854,43 +839,48 @@ SoPrimitiveVertexCache::depthSortTriangles(SoState * state)
       (sortplane != PRIVATE(this)->prevsortplane)) {
     if (!PRIVATE(this)->deptharray) {
       PRIVATE(this)->deptharray = new float[numtri];
+      PRIVATE(this)->vertexdepth = new float[numv];
+      PRIVATE(this)->depthkeys = new uint32_t[numtri];
+      // the second half is scratch space for the sort
+      PRIVATE(this)->depthorder = new int[numtri * 2];
+      // copy of the triangle indices, used when applying a new order
+      PRIVATE(this)->depthindices = new GLint[numtri * 3];
     }
     PRIVATE(this)->prevsortplane = sortplane;
     float * darray = PRIVATE(this)->deptharray;
+    float * vdepth = PRIVATE(this)->vertexdepth;
+    uint32_t * keys = PRIVATE(this)->depthkeys;
+    int * order = PRIVATE(this)->depthorder;
     const SbVec3f * vptr = PRIVATE(this)->vertexlist.getArrayPtr();
     GLint * iptr = PRIVATE(this)->triangleindexer->getWriteableIndices();
-    int i,j;
+    int i;
+
+    // calculate the distance for each vertex once, instead of three
+    // times for each triangle using it
+    const SbVec3f & n = sortplane.getNormal();
+    const float nx = n[0], ny = n[1], nz = n[2];
+    const float d = sortplane.getDistanceFromOrigin();
+    for (i = 0; i < numv; i++) {
+      const float * v = vptr[i].getValue();
+      vdepth[i] = nx * v[0] + ny * v[1] + nz * v[2] - d;
+    }
+    // the sum is sufficient for sorting, no need to divide by 3
     for (i = 0; i < numtri; i++) {
-      float acc = 0.0;
-      for (j = 0; j < 3; j++) {
-        acc += sortplane.getDistance(vptr[iptr[i*3+j]]);
-      }
-      darray[i] = acc / 3.0f;
+      darray[i] = vdepth[iptr[i*3]] + vdepth[iptr[i*3+1]] + vdepth[iptr[i*3+2]];
     }
-    int distance;
-    float dtmp;
-    int itmp[3];
-
-    // shell sort algorithm (O(nlog(n))
-    for (distance = 1; distance <= numtri/9; distance = 3*distance + 1) ;
-    for (; distance > 0; distance /= 3) {
-      for (i = distance; i < numtri; i++) {
-        dtmp = darray[i];
-        itmp[0] = iptr[i*3];
-        itmp[1] = iptr[i*3+1];
-        itmp[2] = iptr[i*3+2];
-        j = i;
-        while (j >= distance && darray[j-distance] > dtmp) {
-          darray[j] = darray[j-distance];
-          iptr[j*3] = iptr[(j-distance)*3];
-          iptr[j*3+1] = iptr[(j-distance)*3+1];
-          iptr[j*3+2] = iptr[(j-distance)*3+2];
-          j -= distance;
-        }
-        darray[j] = dtmp;
-        iptr[j*3] = itmp[0];
-        iptr[j*3+1] = itmp[1];
-        iptr[j*3+2] = itmp[2];
+
+    // the triangles are stored in the order from the previous sort,
+    // which makes the radix sort a no-op if the order is still valid
+    coin_quantize_floats(darray, keys, numtri, 16);
+    for (i = 0; i < numtri; i++) order[i] = i;
+    if (coin_radix_sort(keys, order, order + numtri, numtri, 16)) {
+      GLint * tmp = PRIVATE(this)->depthindices;
+      (void) memcpy(tmp, iptr, indexbytes);
+      for (i = 0; i < numtri; i++) {
+        const GLint * src = tmp + order[i] * 3;
+        iptr[i*3] = src[0];
+        iptr[i*3+1] = src[1];
+        iptr[i*3+2] = src[2];
       }
     }
   }
@@ -940,6 +930,40 @@ SoPrimitiveVertexCacheP::addVertex(const Vertex & v)
   }
 }
 
+//
+// add texture coordinates for unit 1-n for the last num (at most 3)
+// vertices added. Texture coordinate functions are evaluated for all
+// the vertices in one call, using batch generation if supported.
+//
+void
+SoPrimitiveVertexCacheP::addMultiTexCoords(const int num, const int * texcoordidx)
+{
+  assert(num <= 3);
+  const int first = this->vertexlist.getLength() - num;
+  for (int j = 1; j <= this->lastenabled; j++) {
+    const SoMultiTextureCoordinateElement::CoordType type = this->multielem->getType(j);
+    if (type == SoMultiTextureCoordinateElement::FUNCTION) {
+      SbVec4f tc[3];
+      this->multielem->get(j, num,
+                           this->vertexlist.getArrayPtr(first),
+                           this->normallist.getArrayPtr(first), tc);
+      for (int i = 0; i < num; i++) {
+        this->multitexcoords[j].append(tc[i]);
+      }
+    }
+    else {
+      for (int i = 0; i < num; i++) {
+        if (texcoordidx[i] >= 0 && type == SoMultiTextureCoordinateElement::EXPLICIT) {
+          this->multitexcoords[j].append(this->multielem->get4(j, texcoordidx[i]));
+        }
+        else {
+          this->multitexcoords[j].append(this->texcoordlist[first + i]);
+        }
+      }
+    }
+  }
+}
+
 void
 SoPrimitiveVertexCacheP::enableArrays(const cc_glglue * glue,
                                       const SbBool color, const SbBool normal,
@@ -1134,3 +1158,116 @@ SoPrimitiveVertexCacheP::renderImmediate(const cc_glglue * glue,
 }
 
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/caches/SoPrimitiveVertexCache.h>
+#include <Inventor/nodes/SoCallback.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+typedef struct {
+  const float * depths; // one z value per triangle, NaN is allowed
+  int numtri;
+  int numsorted; // triangles in back to front order after the sort
+  SbBool intact; // all triangles kept their three vertices
+} sopvcache_test_sort;
+
+// Builds a cache with one flat triangle for each depth, and sorts it
+// from the view of the camera, which looks down the negative z axis.
+static void
+sopvcache_test_sort_cb(void * closure, SoAction * action)
+{
+  if (!action->isOfType(SoCallbackAction::getClassTypeId())) return;
+  sopvcache_test_sort * data = static_cast<sopvcache_test_sort *>(closure);
+  SoState * state = action->getState();
+
+  SoPrimitiveVertexCache * cache = new SoPrimitiveVertexCache(state);
+  cache->ref();
+  SoPrimitiveVertex v[3];
+  for (int i = 0; i < data->numtri; i++) {
+    // the x offset keeps the vertices of the triangles apart
+    const float x = float(i) * 3.0f, z = data->depths[i];
+    v[0].setPoint(SbVec3f(x, 0.0f, z));
+    v[1].setPoint(SbVec3f(x + 1.0f, 0.0f, z));
+    v[2].setPoint(SbVec3f(x, 1.0f, z));
+    cache->addTriangle(&v[0], &v[1], &v[2]);
+  }
+  cache->close(state);
+  cache->depthSortTriangles(state);
+
+  const SbVec3f * coords = cache->getVertexArray();
+  const GLint * indices = cache->getTriangleIndices();
+  data->intact = cache->getNumTriangleIndices() == data->numtri * 3;
+  data->numsorted = 0;
+  float prev = -FLT_MAX;
+  for (int i = 0; i < cache->getNumTriangleIndices() / 3; i++) {
+    const SbVec3f & p0 = coords[indices[i * 3]];
+    const SbVec3f & p1 = coords[indices[i * 3 + 1]];
+    const SbVec3f & p2 = coords[indices[i * 3 + 2]];
+    // only x and y, which are never NaN, tell the triangles apart
+    if (p1[0] != p0[0] + 1.0f || p1[1] != p0[1] ||
+        p2[0] != p0[0] || p2[1] != p0[1] + 1.0f) data->intact = FALSE;
+    if (p0[2] != p0[2]) continue; // NaN triangles can go anywhere
+    if (p0[2] >= prev) data->numsorted++;
+    prev = p0[2];
+  }
+  cache->unref(state);
+}
+
+static sopvcache_test_sort
+sopvcache_test_depth_sort(const float * depths, const int numtri)
+{
+  sopvcache_test_sort data;
+  data.depths = depths;
+  data.numtri = numtri;
+  data.numsorted = 0;
+  data.intact = FALSE;
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  camera->position = SbVec3f(0.0f, 0.0f, 1000.0f);
+  camera->nearDistance = 1.0f;
+  camera->farDistance = 2000.0f;
+  root->addChild(camera);
+  SoCallback * cb = new SoCallback;
+  cb->setCallback(sopvcache_test_sort_cb, &data);
+  root->addChild(cb);
+  SoCallbackAction cba;
+  cba.apply(root);
+  root->unref();
+  return data;
+}
+
+// Transparent triangles must come back to front after the sort,
+// within the resolution of the 16 bit depth keys.
+BOOST_AUTO_TEST_CASE(depthSortTriangles)
+{
+  const int n = 5000;
+  float * depths = new float[n];
+  srand(42);
+  for (int i = 0; i < n; i++) depths[i] = float(rand() % 2000) * 0.25f;
+  sopvcache_test_sort data = sopvcache_test_depth_sort(depths, n);
+  BOOST_CHECK(data.intact);
+  BOOST_CHECK_EQUAL(data.numsorted, n);
+  delete[] depths;
+}
+
+// NaN coordinates must not break the sort of the other triangles.
+BOOST_AUTO_TEST_CASE(depthSortTrianglesNaN)
+{
+  const float nan = float(std::sqrt(-1.0));
+  const float depths[] = { 3.0f, nan, -2.0f, 10.0f, nan, 0.0f, 7.5f };
+  const int n = int(sizeof(depths) / sizeof(depths[0]));
+  sopvcache_test_sort data = sopvcache_test_depth_sort(depths, n);
+  BOOST_CHECK(data.intact);
+  BOOST_CHECK_EQUAL(data.numsorted, n - 2);
+}
+
+#endif // COIN_TEST_SUITE
@@ -82,12 +82,34 @@ SoMultiTextureCoordinateElement::UnitData::UnitData(const UnitData & org)
 
 class SoMultiTextureCoordinateElementP {
 public:
+  // the batch function is only valid as long as the unit still uses
+  // the per-point function and data it was set together with, since
+  // subclasses may change UnitData directly
+  struct BatchFunc {
+    SoTextureCoordinateFunctionBatchCB * func;
+    SoTextureCoordinateFunctionCB * pointfunc;
+    void * userdata;
+  };
+
   mutable SbList<SoMultiTextureCoordinateElement::UnitData> unitdata;
+  mutable SbList<BatchFunc> batchfuncs;
 
   void ensureCapacity(int units) const {
     for (int i = this->unitdata.getLength(); i <= units; i++) {
       this->unitdata.append(SoMultiTextureCoordinateElement::UnitData());
     }
+    const BatchFunc nofunc = { NULL, NULL, NULL };
+    for (int i = this->batchfuncs.getLength(); i <= units; i++) {
+      this->batchfuncs.append(nofunc);
+    }
+  }
+
+  SoTextureCoordinateFunctionBatchCB *
+  getBatchFunc(const int unit) const {
+    const SoMultiTextureCoordinateElement::UnitData & ud = this->unitdata[unit];
+    const BatchFunc & bf = this->batchfuncs[unit];
+    if (bf.pointfunc == ud.funcCB && bf.userdata == ud.funcCBData) return bf.func;
+    return NULL;
   }
 };
 
@@ -153,6 +175,26 @@ SoMultiTextureCoordinateElement::setFunction(SoState * const state,
                                              const int unit,
                                              SoTextureCoordinateFunctionCB * const func,
                                              void * const userdata)
+{
+  SoMultiTextureCoordinateElement::setFunction(state, node, unit, func, NULL, userdata);
+}
+
+/*!
+  Sets a texture coordinate function for \a unit, with \a batchfunc
+  being an optional function which generates texture coordinates for
+  an array of points in one call. \a batchfunc will be called with
+  the same \a userdata as \a func, and must generate the same
+  coordinates as \a func would for each point.
+
+  \since Coin 4.1
+*/
+void
+SoMultiTextureCoordinateElement::setFunction(SoState * const state,
+                                             SoNode * const node,
+                                             const int unit,
+                                             SoTextureCoordinateFunctionCB * const func,
+                                             SoTextureCoordinateFunctionBatchCB * const batchfunc,
+                                             void * const userdata)
 {
   if (state->isElementEnabled(SoGLVBOElement::getClassStackIndex())) {
     SoGLVBOElement::setTexCoordVBO(state, unit, NULL);
@@ -168,6 +210,10 @@ SoMultiTextureCoordinateElement::setFunction(SoState * const state,
   ud.nodeid = node->getNodeId();
   ud.funcCB = func;
   ud.funcCBData = userdata;
+  SoMultiTextureCoordinateElementP::BatchFunc & bf = PRIVATE(element)->batchfuncs[unit];
+  bf.func = batchfunc;
+  bf.pointfunc = func;
+  bf.userdata = userdata;
   ud.whatKind = FUNCTION;
   ud.coords2 = NULL;
   ud.coords3 = NULL;
@@ -296,6 +342,40 @@ SoMultiTextureCoordinateElement::get(const int unit,
   return (*(ud.funcCB))(ud.funcCBData, point, normal);
 }
 
+/*!
+  Generates texture coordinates for \a num points and normals, and
+  stores them in \a result. \a normals can be NULL, in which case
+  (0, 0, 1) is used for all points. This is much faster than calling
+  get() for each point when the function supports batch generation,
+  and falls back to calling the per-point function otherwise.
+
+  This method should only be used if the CoordType is FUNCTION.
+
+  \since Coin 4.1
+*/
+void
+SoMultiTextureCoordinateElement::get(const int unit, const int num,
+                                     const SbVec3f * points,
+                                     const SbVec3f * normals,
+                                     SbVec4f * result) const
+{
+  assert(unit < PRIVATE(this)->unitdata.getLength());
+  const UnitData & ud = PRIVATE(this)->unitdata[unit];
+
+  assert((ud.whatKind == FUNCTION ||
+          ud.whatKind == TEXGEN) && ud.funcCB);
+  SoTextureCoordinateFunctionBatchCB * batchfunc = PRIVATE(this)->getBatchFunc(unit);
+  if (batchfunc) {
+    (*batchfunc)(ud.funcCBData, num, points, normals, result);
+    return;
+  }
+  const SbVec3f defaultnormal(0.0f, 0.0f, 1.0f);
+  for (int i = 0; i < num; i++) {
+    result[i] = (*(ud.funcCB))(ud.funcCBData, points[i],
+                               normals ? normals[i] : defaultnormal);
+  }
+}
+
 //! FIXME: write doc.
 
 const SbVec2f &
@@ -432,6 +512,7 @@ SoMultiTextureCoordinateElement::init(SoState * state)
 {
   inherited::init(state);
   PRIVATE(this)->unitdata.truncate(0);
+  PRIVATE(this)->batchfuncs.truncate(0);
 }
 
 //! FIXME: write doc.
@@ -467,6 +548,21 @@ SoMultiTextureCoordinateElement::getDimension(const int unit) const
   return ud.coordsDimension;
 }
 
+/*!
+  Returns the id of the node which set the texture coordinates or the
+  texture coordinate function for \a unit, or 0 if the unit uses
+  default texture coordinates.
+
+  \since Coin 4.1
+*/
+SbUniqueId
+SoMultiTextureCoordinateElement::getNodeId(const int unit) const
+{
+  PRIVATE(this)->ensureCapacity(unit);
+  const UnitData & ud = PRIVATE(this)->unitdata[unit];
+  return ud.nodeid;
+}
+
 /*!
   Returns a pointer to the 2D texture coordinate array. This method is not
   part of the OIV API.
@@ -511,6 +607,7 @@ SoMultiTextureCoordinateElement::push(SoState * COIN_UNUSED_ARG(state))
     (this->getNextInStack());
   
   PRIVATE(this)->unitdata = PRIVATE(prev)->unitdata;
+  PRIVATE(this)->batchfuncs = PRIVATE(prev)->batchfuncs;
 }
 
 SbBool
@@ -534,6 +631,7 @@ SoMultiTextureCoordinateElement::copyMatchInfo(void) const
   SoMultiTextureCoordinateElement * elem =
     static_cast<SoMultiTextureCoordinateElement *>(getTypeId().createInstance());
   PRIVATE(elem)->unitdata = PRIVATE(this)->unitdata;
+  PRIVATE(elem)->batchfuncs = PRIVATE(this)->batchfuncs;
   return elem;
 }
 
@@ -561,3 +659,94 @@ SoMultiTextureCoordinateElement::getMaxUnits() const
 }
 
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoTextureCoordinatePlane.h>
+#include <Inventor/nodes/SoTextureCoordinateSphere.h>
+#include <Inventor/nodes/SoTextureCoordinateCylinder.h>
+#include <Inventor/nodes/SoTextureCoordinateCube.h>
+
+static SoCallbackAction::Response
+batchCompareCB(void * userdata, SoCallbackAction * action, const SoNode *)
+{
+  SbBool * ok = (SbBool *) userdata;
+  const SoMultiTextureCoordinateElement * elem =
+    SoMultiTextureCoordinateElement::getInstance(action->getState());
+  if (elem->getType(0) != SoMultiTextureCoordinateElement::FUNCTION) {
+    *ok = FALSE;
+    return SoCallbackAction::CONTINUE;
+  }
+
+  const int num = 6;
+  const SbVec3f points[num] = {
+    SbVec3f(1, 0, 0), SbVec3f(-1, 0.5f, 0), SbVec3f(0, 1, 0.25f),
+    SbVec3f(0, -1, 0), SbVec3f(0.5f, 0, 1), SbVec3f(0, 0.5f, -1)
+  };
+  const SbVec3f normals[num] = {
+    SbVec3f(1, 0, 0), SbVec3f(-1, 0, 0), SbVec3f(0, 1, 0),
+    SbVec3f(0, -1, 0), SbVec3f(0, 0, 1), SbVec3f(0, 0, -1)
+  };
+  SbVec4f result[num];
+  elem->get(0, num, points, normals, result);
+  for (int i = 0; i < num; i++) {
+    if (result[i] != elem->get(0, points[i], normals[i])) *ok = FALSE;
+  }
+  return SoCallbackAction::CONTINUE;
+}
+
+BOOST_AUTO_TEST_CASE(batchFunctionMatchesPerPoint)
+{
+  SoNode * functions[] = {
+    new SoTextureCoordinatePlane,
+    new SoTextureCoordinateSphere,
+    new SoTextureCoordinateCylinder,
+    new SoTextureCoordinateCube
+  };
+  for (int i = 0; i < 4; i++) {
+    SoSeparator * root = new SoSeparator;
+    root->ref();
+    root->addChild(functions[i]);
+    root->addChild(new SoCube);
+
+    SbBool ok = TRUE;
+    SoCallbackAction cba;
+    cba.addPreCallback(SoCube::getClassTypeId(), batchCompareCB, &ok);
+    cba.apply(root);
+    BOOST_CHECK_MESSAGE(ok, functions[i]->getTypeId().getName().getString());
+    root->unref();
+  }
+}
+
+static SoCallbackAction::Response
+nodeIdCB(void * userdata, SoCallbackAction * action, const SoNode *)
+{
+  SbUniqueId * id = (SbUniqueId *) userdata;
+  *id = SoMultiTextureCoordinateElement::getInstance(action->getState())->getNodeId(0);
+  return SoCallbackAction::CONTINUE;
+}
+
+BOOST_AUTO_TEST_CASE(functionNodeId)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoTextureCoordinatePlane * plane = new SoTextureCoordinatePlane;
+  root->addChild(plane);
+  root->addChild(new SoCube);
+
+  SbUniqueId id = 0;
+  SoCallbackAction cba;
+  cba.addPreCallback(SoCube::getClassTypeId(), nodeIdCB, &id);
+  cba.apply(root);
+  BOOST_CHECK_EQUAL(id, plane->getNodeId());
+
+  plane->directionS = SbVec3f(0, 1, 0);
+  cba.apply(root);
+  BOOST_CHECK_EQUAL(id, plane->getNodeId());
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -55,6 +55,7 @@
 #include "tidbitsp.h"
 #include "engines/SoSubEngineP.h"
 #include "misc/SbHash.h"
+#include "misc/SoDBP.h"
 
 // *************************************************************************
 
@@ -661,7 +662,7 @@ static void to_and_from_sftrigger(SoField * COIN_UNUSED_ARG(from), SoField * to)
 static void
 register_convertfunc(convert_func * f, SoType from, SoType to)
 {
-  SoDB::addConverter(from, to, SoConvertAll::getClassTypeId());
+  SoDBP::addConverter(from, to, SoConvertAll::getClassTypeId());
   uint32_t val = (static_cast<uint32_t>(from.getKey()) << 16) + to.getKey();
   SbBool nonexist = convertfunc_dict->put(val, f);
   assert(nonexist);
@@ -690,6 +691,36 @@ SoConvertAll::initClass(void)
   // doesn't have a default constructor), so use the ABSTRACT macros.
   SO_ENGINE_INTERNAL_INIT_ABSTRACT_CLASS(SoConvertAll);
 
+  // Add conversion to and from SoSFTrigger for all other
+  // non-abstract field types (all conversions done by the same
+  // function). This is done here, and not with the other built-in
+  // conversions, so that the set of trigger conversions doesn't
+  // depend on when the converter table is first used.
+
+  SoTypeList allfieldtypes;
+  int nrfieldtypes = SoType::getAllDerivedFrom(SoField::getClassTypeId(),
+                                               allfieldtypes);
+  for (int i=0; i < nrfieldtypes; i++) {
+    if (allfieldtypes[i].canCreateInstance() &&
+        allfieldtypes[i] != SoSFTrigger::getClassTypeId()) {
+      register_convertfunc(to_and_from_sftrigger,
+                           SoSFTrigger::getClassTypeId(),
+                           allfieldtypes[i]);
+      register_convertfunc(to_and_from_sftrigger,
+                           allfieldtypes[i],
+                           SoSFTrigger::getClassTypeId());
+    }
+  }
+}
+
+/*!
+  Registers the conversions between the built-in field types, except
+  the SoSFTrigger conversions set up by initClass(). Called the first
+  time SoDB's converter table is used.
+*/
+void
+SoConvertAll::registerConverters(void)
+{
   struct Conversion {
     convert_func * func;
     const char * from;
@@ -1077,29 +1108,9 @@ SoConvertAll::initClass(void)
     register_convertfunc(allconverters[i].func,
                          SoType::fromName(allconverters[i].from),
                          SoType::fromName(allconverters[i].to));
-    // Performance note: it may look slow to do all that
-    // SoType::fromName()'ing, but the full loop only takes about 2
-    // milliseconds on an 850MHz x86 CPU, so there would be little use
-    // in trying to optimize this.
-  }
-
-  // Now add conversion to and from SoSFTrigger for all other
-  // non-abstract field types (all conversions done by the same
-  // function).
-
-  SoTypeList allfieldtypes;
-  int nrfieldtypes = SoType::getAllDerivedFrom(SoField::getClassTypeId(),
-                                               allfieldtypes);
-  for (i=0; i < nrfieldtypes; i++) {
-    if (allfieldtypes[i].canCreateInstance() &&
-        allfieldtypes[i] != SoSFTrigger::getClassTypeId()) {
-      register_convertfunc(to_and_from_sftrigger,
-                           SoSFTrigger::getClassTypeId(),
-                           allfieldtypes[i]);
-      register_convertfunc(to_and_from_sftrigger,
-                           allfieldtypes[i],
-                           SoSFTrigger::getClassTypeId());
-    }
+    // Performance note: all the SoType::fromName()'ing makes this
+    // loop a noticeable part of Coin's startup time, which is why
+    // this is not done until SoDB's converter table is first used.
   }
 }
 
@@ -51,6 +51,7 @@ class SoConvertAll : public SoFieldConverter {
 
 public:
   static void initClass(void);
+  static void registerConverters(void);
   SoConvertAll(const SoType from, const SoType to);
 
 protected:
@@ -71,6 +71,7 @@
 #include <Inventor/lists/SoEngineOutputList.h>
 
 #include "engines/SoSubEngineP.h"
+#include "misc/SoDBP.h"
 
 // *************************************************************************
 
@@ -114,6 +115,20 @@ SO_ENGINE_SOURCE(SoElapsedTime);
 
 // *************************************************************************
 
+// Called from SoDBP::updateRealTimeFieldCB() together with all other
+// realtime animators. The output is only enabled while the engine is
+// running, so a stopped or paused engine can skip the tick.
+static void
+soelapsedtime_realtime_animator(SoBase * animator, SoNotList * list)
+{
+  SoElapsedTime * engine = static_cast<SoElapsedTime *>(animator);
+  if (engine->timeOut.isEnabled()) {
+    SoDBP::notifyRealTimeInput(&engine->timeIn, list);
+  }
+}
+
+// *************************************************************************
+
 /*!
   \copybrief SoBase::initClass(void)
 */
@@ -144,6 +159,8 @@ SoElapsedTime::SoElapsedTime(void)
   this->currtime = SbTime::zero();
   this->lasttime = coin_assert_cast<SoSFTime *>(realtime)->getValue();
   this->status = SoElapsedTime::RUNNING;
+
+  SoDBP::addRealTimeAnimator(soelapsedtime_realtime_animator, this);
 }
 
 /*!
@@ -151,6 +168,17 @@ SoElapsedTime::SoElapsedTime(void)
 */
 SoElapsedTime::~SoElapsedTime()
 {
+  SoDBP::removeRealTimeAnimator(this);
+}
+
+// Documented in superclass. Overridden to ignore the realTime field's
+// own notification of timeIn during a realTime update, as the tick is
+// passed on from soelapsedtime_realtime_animator().
+void
+SoElapsedTime::notify(SoNotList * list)
+{
+  if (SoDBP::isRealTimeTick(list, &this->timeIn)) return;
+  inherited::notify(list);
 }
 
 // *************************************************************************
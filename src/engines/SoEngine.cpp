@@ -62,17 +62,25 @@
 
 #include "SbBasicP.h"
 
+#include <cstdlib>
+
+#include <Inventor/SbBasic.h>
 #include <Inventor/engines/SoEngines.h>
 #include <Inventor/engines/SoNodeEngine.h>
 #include <Inventor/engines/SoOutputData.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/lists/SoEngineList.h>
 #include <Inventor/lists/SoEngineOutputList.h>
+#include <Inventor/lists/SoFieldList.h>
+#include <Inventor/fields/SoField.h>
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif // HAVE_CONFIG_H
 #include "coindefs.h" // COIN_STUB()
+#include "tidbitsp.h"
+#include "misc/SbHash.h"
+#include "threads/threadsutilp.h"
 #ifdef COIN_THREADSAFE
 #include "threads/recmutexp.h"
 #endif // COIN_THREADSAFE
@@ -95,6 +103,25 @@ SoType SoEngine::classTypeId STATIC_SOTYPE_INIT;
 
 // *************************************************************************
 
+// Engines which have become dirty since the last call to
+// SoEngine::evaluateScheduledEngines().
+static SbList <SoEngine *> * soengine_scheduled = NULL;
+static void * soengine_scheduledmutex = NULL;
+static SbBool soengine_scheduling = FALSE;
+static uint32_t soengine_evaluationcount = 0;
+
+static void
+soengine_cleanup(void)
+{
+  delete soengine_scheduled;
+  soengine_scheduled = NULL;
+  CC_MUTEX_DESTRUCT(soengine_scheduledmutex);
+  soengine_scheduling = FALSE;
+  soengine_evaluationcount = 0;
+}
+
+// *************************************************************************
+
 /*!
   Default constructor.
 */
@@ -145,6 +172,13 @@ SoEngine::destroy(void)
   cc_recmutex_internal_field_unlock();
 #endif // COIN_THREADSAFE
 
+  CC_MUTEX_LOCK(soengine_scheduledmutex);
+  if (this->flags & FLAG_ISSCHEDULED) {
+    const int idx = soengine_scheduled->find(this);
+    if (idx >= 0) soengine_scheduled->removeFast(idx);
+  }
+  CC_MUTEX_UNLOCK(soengine_scheduledmutex);
+
   // SoBase destroy().
   inherited::destroy();
 
@@ -164,6 +198,12 @@ SoEngine::initClass(void)
   SoEngine::classTypeId =
     SoType::createType(SoFieldContainer::getClassTypeId(), SbName("Engine"));
 
+  soengine_scheduled = new SbList <SoEngine *>;
+  CC_MUTEX_CONSTRUCT(soengine_scheduledmutex);
+  const char * env = coin_getenv("COIN_ENGINE_SCHEDULING");
+  soengine_scheduling = env && (atoi(env) > 0);
+  coin_atexit((coin_atexit_f*) soengine_cleanup, CC_ATEXIT_NORMAL);
+
   SoEngine::initClasses();
 }
 
@@ -322,7 +362,7 @@ SoEngine::notify(SoNotList * nl)
   // The notification invocation could stem from a value change in
   // whatever this engine is connected to, so we need to be evaluated
   // on the next attempted read on our output(s).
-  this->flags |= FLAG_ISDIRTY;
+  this->setDirty();
 
   // Call inputChanged() only if we're being notified through one of
   // the engine's fields (lastrec == CONTAINER, set in
@@ -372,6 +412,7 @@ SoEngine::evaluateWrapper(void)
   if(!(this->flags & FLAG_ISDIRTY)) { return; }
 
   this->flags &= ~FLAG_ISDIRTY;
+  soengine_evaluationcount++;
 
   int i, n = outputs->getNumOutputs();
   for (i = 0; i < n; i++) {
@@ -551,4 +592,261 @@ void
 SoEngine::setDirty(void)
 {
   this->flags |= FLAG_ISDIRTY;
+  if (soengine_scheduling) this->schedule();
+}
+
+// Adds the engine to the list of engines evaluated by
+// evaluateScheduledEngines(), unless it's already there. The flag is
+// tested and set with the mutex locked, so that an engine made dirty
+// from several threads is only added once.
+void
+SoEngine::schedule(void)
+{
+  CC_MUTEX_LOCK(soengine_scheduledmutex);
+  if (!(this->flags & FLAG_ISSCHEDULED)) {
+    this->flags |= FLAG_ISSCHEDULED;
+    soengine_scheduled->append(this);
+  }
+  CC_MUTEX_UNLOCK(soengine_scheduledmutex);
+}
+
+/*!
+  Enables or disables scheduled evaluation of engines.
+
+  Engines are normally evaluated on demand, when one of the fields
+  connected to an engine output is read. This means that a deep
+  network of engines is evaluated recursively from the field being
+  read, and that engines are evaluated at any time during scene graph
+  traversal.
+
+  When scheduling is enabled, engines which become dirty are recorded,
+  and SoRenderManager evaluates them all once before each frame is
+  rendered (see evaluateScheduledEngines()). Engines are still
+  evaluated on demand if a field connected to a dirty engine is read
+  before this, so enabling scheduling never changes the values read
+  from the engine outputs.
+
+  Scheduling can also be enabled by setting the environment variable
+  COIN_ENGINE_SCHEDULING to "1".
+
+  \sa evaluateScheduledEngines()
+  \since Coin 4.1
+*/
+void
+SoEngine::enableEvaluationScheduling(const SbBool onoff)
+{
+  soengine_scheduling = onoff;
 }
+
+/*!
+  Returns whether scheduled evaluation of engines is enabled.
+
+  \sa enableEvaluationScheduling()
+  \since Coin 4.1
+*/
+SbBool
+SoEngine::isEvaluationSchedulingEnabled(void)
+{
+  return soengine_scheduling;
+}
+
+// Returns the number of engines between \a engine and an engine with
+// no engine inputs. Engine loops are cut where they are detected.
+static int
+soengine_get_depth(SoEngine * engine, SbHash<SoEngine *, int> & depths)
+{
+  int depth;
+  if (depths.get(engine, depth)) return SbMax(depth, 0);
+
+  (void) depths.put(engine, -1); // mark as in progress
+  depth = 0;
+  SoFieldList fields;
+  const int numfields = engine->getFields(fields);
+  for (int i = 0; i < numfields; i++) {
+    SoEngineOutput * master;
+    if (fields[i]->getConnectedEngine(master) && !master->isNodeEngineOutput()) {
+      SoEngine * src = master->getContainer();
+      if (src) depth = SbMax(depth, soengine_get_depth(src, depths) + 1);
+    }
+  }
+  (void) depths.put(engine, depth);
+  return depth;
+}
+
+typedef struct {
+  int depth;
+  int idx;
+} soengine_sortitem;
+
+extern "C" {
+static int
+soengine_compare_depth(const void * ptr1, const void * ptr2)
+{
+  const soengine_sortitem * item1 = (const soengine_sortitem *) ptr1;
+  const soengine_sortitem * item2 = (const soengine_sortitem *) ptr2;
+  if (item1->depth != item2->depth) return item1->depth - item2->depth;
+  return item1->idx - item2->idx;
+}
+}
+
+/*!
+  Evaluates all engines which have become dirty since the last call
+  to this function, and which have not been evaluated on demand in the
+  meantime. The engines are evaluated in topological order, so that an
+  engine is evaluated after the engines it is connected to. Each
+  engine is thereby evaluated once, without recursing through the
+  engine network.
+
+  Returns the number of engines evaluated.
+
+  This function is called by SoRenderManager before rendering a frame
+  when scheduling is enabled, but it can also be called by the
+  application.
+
+  \sa enableEvaluationScheduling(), getEvaluationCount()
+  \since Coin 4.1
+*/
+int
+SoEngine::evaluateScheduledEngines(void)
+{
+  int i;
+  CC_MUTEX_LOCK(soengine_scheduledmutex);
+  SbList <SoEngine *> engines(*soengine_scheduled);
+  soengine_scheduled->truncate(0);
+  for (i = 0; i < engines.getLength(); i++) {
+    // make sure the engine isn't destructed while we evaluate the
+    // engines it is connected to
+    engines[i]->ref();
+    engines[i]->flags &= ~FLAG_ISSCHEDULED;
+  }
+  CC_MUTEX_UNLOCK(soengine_scheduledmutex);
+
+  const int n = engines.getLength();
+  if (n == 0) return 0;
+
+  SbHash<SoEngine *, int> depths;
+  soengine_sortitem * items = new soengine_sortitem[n];
+  for (i = 0; i < n; i++) {
+    items[i].depth = soengine_get_depth(engines[i], depths);
+    items[i].idx = i;
+  }
+  qsort(items, n, sizeof(soengine_sortitem), soengine_compare_depth);
+
+  int numevaluated = 0;
+#ifdef COIN_THREADSAFE
+  cc_recmutex_internal_field_lock();
+#endif // COIN_THREADSAFE
+  for (i = 0; i < n; i++) {
+    SoEngine * engine = engines[items[i].idx];
+    if (engine->flags & FLAG_ISDIRTY) {
+      engine->evaluateWrapper();
+      numevaluated++;
+    }
+  }
+#ifdef COIN_THREADSAFE
+  cc_recmutex_internal_field_unlock();
+#endif // COIN_THREADSAFE
+
+  // unrefNoDelete(), as an engine may still be at reference count 0
+  // when the application has set its inputs before connecting it
+  for (i = 0; i < n; i++) {
+    engines[i]->unrefNoDelete();
+  }
+  delete[] items;
+  return numevaluated;
+}
+
+/*!
+  Returns the total number of engine evaluations done since Coin was
+  initialized. Can be used for profiling engine networks, for instance
+  by comparing the count before and after a frame is rendered.
+
+  \since Coin 4.1
+*/
+uint32_t
+SoEngine::getEvaluationCount(void)
+{
+  return soengine_evaluationcount;
+}
+
+// *************************************************************************
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/engines/SoCalculator.h>
+#include <Inventor/fields/SoMFFloat.h>
+
+BOOST_AUTO_TEST_CASE(scheduledEvaluation)
+{
+  const SbBool oldscheduling = SoEngine::isEvaluationSchedulingEnabled();
+  SoEngine::enableEvaluationScheduling(TRUE);
+
+  SoCalculator * first = new SoCalculator;
+  first->ref();
+  first->expression = "oa = a * 2";
+  SoCalculator * second = new SoCalculator;
+  second->ref();
+  second->expression = "oa = a + 1";
+  second->a.connectFrom(&first->oa);
+
+  SoMFFloat result;
+  result.connectFrom(&second->oa);
+  (void) SoEngine::evaluateScheduledEngines();
+
+  // several input changes should only lead to one evaluation of each
+  // engine
+  first->a.setValue(1.0f);
+  first->a.setValue(2.0f);
+  first->a.setValue(3.0f);
+  const uint32_t count = SoEngine::getEvaluationCount();
+  BOOST_CHECK_EQUAL(SoEngine::evaluateScheduledEngines(), 2);
+  BOOST_CHECK_EQUAL(SoEngine::getEvaluationCount() - count, 2u);
+  BOOST_CHECK_EQUAL(result[0], 7.0f);
+  BOOST_CHECK_MESSAGE(SoEngine::getEvaluationCount() - count == 2,
+                      "reading an evaluated engine network evaluated it again");
+  BOOST_CHECK_EQUAL(SoEngine::evaluateScheduledEngines(), 0);
+
+  // engines evaluated on demand should not be evaluated again
+  first->a.setValue(4.0f);
+  BOOST_CHECK_EQUAL(result[0], 9.0f);
+  BOOST_CHECK_EQUAL(SoEngine::evaluateScheduledEngines(), 0);
+
+  result.disconnect();
+  second->unref();
+  first->unref();
+  SoEngine::enableEvaluationScheduling(oldscheduling);
+}
+
+BOOST_AUTO_TEST_CASE(scheduledEngineUnref)
+{
+  const SbBool oldscheduling = SoEngine::isEvaluationSchedulingEnabled();
+  SoEngine::enableEvaluationScheduling(TRUE);
+  (void) SoEngine::evaluateScheduledEngines();
+
+  // an engine which the application hasn't referenced yet must
+  // survive the scheduled evaluation
+  SoCalculator * calc = new SoCalculator;
+  calc->setName("scheduledEngineUnref");
+  calc->expression = "oa = a";
+  calc->a.setValue(1.0f);
+  BOOST_CHECK_EQUAL(calc->getRefCount(), 0);
+
+  (void) SoEngine::evaluateScheduledEngines();
+  BOOST_CHECK_MESSAGE(SoBase::getNamedBase("scheduledEngineUnref",
+                                           SoCalculator::getClassTypeId()) == calc,
+                      "unreferenced engine was destructed");
+  BOOST_CHECK_EQUAL(calc->getRefCount(), 0);
+
+  // the engine can still be used after the evaluation
+  SoMFFloat result;
+  calc->ref();
+  result.connectFrom(&calc->oa);
+  calc->a.setValue(2.0f);
+  BOOST_CHECK_EQUAL(result[0], 2.0f);
+  result.disconnect();
+  calc->unref();
+
+  SoEngine::enableEvaluationScheduling(oldscheduling);
+}
+
+#endif // COIN_TEST_SUITE
@@ -48,6 +48,7 @@
 #endif // COIN_DEBUG
 
 #include "engines/SoSubEngineP.h"
+#include "misc/SoDBP.h"
 
 /*!
   \var SoSFTime SoOneShot::timeIn
@@ -106,6 +107,18 @@
 
 SO_ENGINE_SOURCE(SoOneShot);
 
+// Called from SoDBP::updateRealTimeFieldCB() together with all other
+// realtime animators. The outputs are only enabled while the engine
+// is running, so an idle engine can skip the tick.
+static void
+sooneshot_realtime_animator(SoBase * animator, SoNotList * list)
+{
+  SoOneShot * engine = static_cast<SoOneShot *>(animator);
+  if (engine->timeOut.isEnabled()) {
+    SoDBP::notifyRealTimeInput(&engine->timeIn, list);
+  }
+}
+
 /*!
   \copybrief SoBase::initClass(void)
 */
@@ -144,6 +157,8 @@ SoOneShot::SoOneShot(void)
   this->starttime = SbTime::zero();
   this->holdramp = 0.0f;
   this->holdduration = SbTime::zero();
+
+  SoDBP::addRealTimeAnimator(sooneshot_realtime_animator, this);
 }
 
 /*!
@@ -151,6 +166,17 @@ SoOneShot::SoOneShot(void)
 */
 SoOneShot::~SoOneShot()
 {
+  SoDBP::removeRealTimeAnimator(this);
+}
+
+// Documented in superclass. Overridden to ignore the realTime field's
+// own notification of timeIn during a realTime update, as the tick is
+// passed on from sooneshot_realtime_animator().
+void
+SoOneShot::notify(SoNotList * list)
+{
+  if (SoDBP::isRealTimeTick(list, &this->timeIn)) return;
+  inherited::notify(list);
 }
 
 // Documented in superclass.
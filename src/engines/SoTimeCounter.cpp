@@ -115,6 +115,7 @@
 #include "coindefs.h"
 #include "SbBasicP.h"
 #include "engines/SoSubEngineP.h"
+#include "misc/SoDBP.h"
 
 #include <Inventor/SoDB.h>
 #include <Inventor/errors/SoDebugError.h>
@@ -126,6 +127,20 @@ SO_ENGINE_SOURCE(SoTimeCounter);
 
 // *************************************************************************
 
+// Called from SoDBP::updateRealTimeFieldCB() together with all other
+// realtime animators. The counter ignores timeIn while it is off, so
+// it can skip the tick.
+static void
+sotimecounter_realtime_animator(SoBase * animator, SoNotList * list)
+{
+  SoTimeCounter * engine = static_cast<SoTimeCounter *>(animator);
+  if (engine->on.getValue()) {
+    SoDBP::notifyRealTimeInput(&engine->timeIn, list);
+  }
+}
+
+// *************************************************************************
+
 /*!
   Default constructor.
 */
@@ -158,6 +173,8 @@ SoTimeCounter::SoTimeCounter(void)
   this->ispaused = FALSE;
 
   this->timeIn.connectFrom(realtime);
+
+  SoDBP::addRealTimeAnimator(sotimecounter_realtime_animator, this);
 }
 
 /*!
@@ -174,6 +191,17 @@ SoTimeCounter::initClass(void)
  */
 SoTimeCounter::~SoTimeCounter()
 {
+  SoDBP::removeRealTimeAnimator(this);
+}
+
+// Documented in superclass. Overridden to ignore the realTime field's
+// own notification of timeIn during a realTime update, as the tick is
+// passed on from sotimecounter_realtime_animator().
+void
+SoTimeCounter::notify(SoNotList * list)
+{
+  if (SoDBP::isRealTimeTick(list, &this->timeIn)) return;
+  inherited::notify(list);
 }
 
 // *************************************************************************
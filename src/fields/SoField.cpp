@@ -181,6 +181,8 @@ public:
   SoConnectStorage(SoFieldContainer * c, SoType t)
     : container(c),
     lastnotify(NULL),
+    deferreddata(NULL),
+    numdeferred(0),
     fieldtype(t),
     maptoconverter(13) // save about ~1kB vs default nr of buckets
     {
@@ -216,6 +218,11 @@ public:
   // used to track the last notification (for fanIn handling)
   void * lastnotify;
 
+  // Binary multi-field values not decoded yet, see
+  // SoInput::setDeferredFieldDecoding().
+  const char * deferreddata;
+  int numdeferred;
+
   // Convenience functions for adding, removing and finding mappings.
 
   void addConverter(const void * item, SoFieldConverter * converter)
@@ -1600,6 +1607,33 @@ SoField::extendStorageIfNecessary(void)
   }
 }
 
+// Stores a reference to binary values which will be decoded on first
+// access. Used from SoMField.
+void
+SoField::setDeferredValues(const char * data, const int num)
+{
+  this->extendStorageIfNecessary();
+  this->storage->deferreddata = data;
+  this->storage->numdeferred = num;
+  this->setStatusBits(FLAG_DEFERRED | FLAG_NEEDEVALUATION);
+}
+
+// Returns and forgets the deferred binary values, or NULL if there
+// are none. Used from SoMField.
+const char *
+SoField::takeDeferredValues(int & num)
+{
+  if (!this->getStatus(FLAG_DEFERRED)) return NULL;
+  this->clearStatusBits(FLAG_DEFERRED);
+  if (!this->isConnected()) this->clearStatusBits(FLAG_NEEDEVALUATION);
+
+  const char * data = this->storage->deferreddata;
+  num = this->storage->numdeferred;
+  this->storage->deferreddata = NULL;
+  this->storage->numdeferred = 0;
+  return data;
+}
+
 /*!
   Add an auditor to the list. All auditors will be notified whenever
   this field changes its value(s).
@@ -2072,8 +2106,7 @@ SoField::write(SoOutput * out, const SbName & name) const
   }
   // Binary write.
   else {
-    // Cast to avoid "'s.
-    out->write(static_cast<const char *>(name));
+    out->writeIdentifier(name.getString());
     this->writeValue(out);
 
     unsigned int flags = 0;
@@ -2139,7 +2172,7 @@ SoField::countWriteRefs(SoOutput * out) const
 
 //
 // private method called from SoField::evaluate() when the field is
-// connected and dirty
+// connected and dirty, or has deferred values
 //
 void
 SoField::evaluateField(void) const
@@ -2158,6 +2191,10 @@ SoField::evaluateField(void) const
     return;
   }
 
+  if (this->getStatus(FLAG_DEFERRED)) {
+    const_cast<SoMField *>(static_cast<const SoMField *>(this))->decodeDeferredValues(TRUE);
+  }
+
   if (!this->isConnected()) return;
 
   assert(this->storage != NULL);
@@ -2224,6 +2261,8 @@ void
 SoField::setDirty(SbBool dirty)
 {
   COIN_CHECK_THREAD();
+  // fields with deferred values always need to be evaluated
+  if (this->getStatus(FLAG_DEFERRED)) dirty = TRUE;
   (void) this->changeStatusBits(FLAG_NEEDEVALUATION, dirty);
 }
 
@@ -151,12 +151,19 @@ SoFieldContainer::~SoFieldContainer()
 // Use a stack of dictionaries when copying nodes to allow recursive
 // copying.
 
-// typedef SbHash<const SoFieldContainer *, const SoFieldContainer *> SoFieldContainerCopyMap;
-
 #define SOFIELDCONTAINER_COPYDICT_DEBUG (COIN_DEBUG && 0)
 
-class SoFieldContainerCopyMap : public SbHash<const SoFieldContainer *, const SoFieldContainer *> {
-  typedef SbHash<const SoFieldContainer *, const SoFieldContainer *> inherited;
+// The copy of an original field container, and whether or not
+// copyContents() has been run on it yet. Kept in the same entry so
+// that findCopy() only needs to search one dictionary.
+struct SoFieldContainerCopy {
+  SoFieldContainerCopy(void) : copy(NULL), contentscopied(FALSE) { }
+  const SoFieldContainer * copy;
+  SbBool contentscopied;
+};
+
+class SoFieldContainerCopyMap : public SbHash<const SoFieldContainer *, SoFieldContainerCopy> {
+  typedef SbHash<const SoFieldContainer *, SoFieldContainerCopy> inherited;
 public:
   SoFieldContainerCopyMap(void) : inherited() {
 #if SOFIELDCONTAINER_COPYDICT_DEBUG
@@ -176,26 +183,33 @@ public:
     SoDebugError::postInfo("SoFieldContainerCopyMap::put",
                            "%p === %p (setting)", orig, copy);
 #endif // DEBUG
-    return inherited::put(orig, copy);
+    SoFieldContainerCopy entry;
+    entry.copy = copy;
+    return inherited::put(orig, entry);
   }
-  SbBool get(const SoFieldContainer * orig, const SoFieldContainer * & copy)
+  SbBool get(const SoFieldContainer * orig, SoFieldContainerCopy & entry)
   {
-    SbBool ok = inherited::get(orig, copy);
+    SbBool ok = inherited::get(orig, entry);
 #if SOFIELDCONTAINER_COPYDICT_DEBUG
     SoDebugError::postInfo("SoFieldContainerCopyMap::get",
-                           "%p ::= %p%s", orig, copy,
+                           "%p ::= %p%s", orig, entry.copy,
                            ok ? " (found)" : " (NOT FOUND)");
 #endif // DEBUG
     return ok;
   }
+  // Marks the contents of orig as copied. Returns FALSE if this had
+  // already been done.
+  SbBool setContentsCopied(const SoFieldContainer * orig) {
+    SoFieldContainerCopy & entry = (*this)[orig];
+    assert(entry.copy && "no copy registered");
+    if (entry.contentscopied) return FALSE;
+    entry.contentscopied = TRUE;
+    return TRUE;
+  }
 };
 
-
-typedef SbHash<const SoFieldContainer *, SbBool> ContentsCopiedMap;
-
 typedef struct {
   SbList<SoFieldContainerCopyMap *> * copiedinstancestack;
-  SbList<ContentsCopiedMap *> * contentscopiedstack;
 } sofieldcontainer_copydict;
 
 void
@@ -204,7 +218,6 @@ sofieldcontainer_construct_copydict(void * closure)
   sofieldcontainer_copydict * data = static_cast<sofieldcontainer_copydict *>(closure);
 
   data->copiedinstancestack = new SbList<SoFieldContainerCopyMap *>;
-  data->contentscopiedstack = new SbList<ContentsCopiedMap *>;
 }
 
 void
@@ -212,7 +225,6 @@ sofieldcontainer_destruct_copydict(void * closure)
 {
   sofieldcontainer_copydict * data = static_cast<sofieldcontainer_copydict *>(closure);
   delete data->copiedinstancestack;
-  delete data->contentscopiedstack;
 }
 
 // use thread local storage to store copydict in threadsafe version of
@@ -840,13 +852,11 @@ SoFieldContainer::initCopyDict(void)
   sofieldcontainer_copydict * copydict =
     sofieldcontainer_get_copydict();
 
-  // Create two new dictionaries and _insert_ them in slot 0 in their
-  // corresponding parallel lists, so they are stacked atop of the
-  // already existing copy dictionaries (if any).
+  // Create a new dictionary and _insert_ it in slot 0, so it is
+  // stacked atop of the already existing copy dictionaries (if any).
 
   // Push on stack.
   copydict->copiedinstancestack->insert(new SoFieldContainerCopyMap, 0);
-  copydict->contentscopiedstack->insert(new ContentsCopiedMap, 0);
 }
 
 
@@ -871,15 +881,10 @@ SoFieldContainer::addCopy(const SoFieldContainer * orig,
   copy->ref();
 
   SoFieldContainerCopyMap * copiedinstances = (*(copydict->copiedinstancestack))[0];
-  ContentsCopiedMap * contentscopied  = (*(copydict->contentscopiedstack))[0];
-
   assert(copiedinstances);
-  assert(contentscopied);
 
   SbBool s = copiedinstances->put(orig, copy);
   assert(s);
-  s = contentscopied->put(orig, FALSE);
-  assert(s);
 }
 
 
@@ -896,11 +901,11 @@ SoFieldContainer::checkCopy(const SoFieldContainer * orig)
   SoFieldContainerCopyMap * copiedinstances = (*(copydict->copiedinstancestack))[0];
   assert(copiedinstances);
 
-  const SoFieldContainer * fccopy;
+  SoFieldContainerCopy entry;
   // FIXME: ugly constness cast. 20050520 mortene.
   return const_cast<SoFieldContainer *>
     (
-     copiedinstances->get(orig, fccopy) ? fccopy : NULL
+     copiedinstances->get(orig, entry) ? entry.copy : NULL
      );
 }
 
@@ -938,10 +943,7 @@ SoFieldContainer::findCopy(const SoFieldContainer * orig,
   if (copydict->copiedinstancestack->getLength() == 0) return NULL;
 
   SoFieldContainerCopyMap * copiedinstances = (*(copydict->copiedinstancestack))[0];
-  ContentsCopiedMap * contentscopied  = (*(copydict->contentscopiedstack))[0];
-
   assert(copiedinstances);
-  assert(contentscopied);
 
   const SoNode * protonode = coin_safe_cast<const SoNode *>(orig);
   SoProtoInstance * protoinst = protonode ?
@@ -984,22 +986,16 @@ SoFieldContainer::findCopy(const SoFieldContainer * orig,
   // Don't call copyContents for the proto instance root node, since
   // this is handled by the Proto node.
   if (!protoinst) {
-    SbBool copied = FALSE;
-    SbBool chk = contentscopied->get(orig, copied);
-    assert(chk);
-
-    if (!copied) {
-      // we have to update the dictionary _before_ calling
-      // copyContents in case we have an SoSFNode field in the node
-      // that has a pointer to the node. Example scene graph:
-      //
-      // DEF mynode Script {
-      //   field SFNode self USE mynode
-      // }
-      //
-      // pederb, 2002-09-04
-      chk = contentscopied->put(orig, TRUE);
-      assert(!chk && "the key already exists");
+    // we have to update the dictionary _before_ calling
+    // copyContents in case we have an SoSFNode field in the node
+    // that has a pointer to the node. Example scene graph:
+    //
+    // DEF mynode Script {
+    //   field SFNode self USE mynode
+    // }
+    //
+    // pederb, 2002-09-04
+    if (copiedinstances->setContentsCopied(orig)) {
       cp->copyContents(orig, copyconnections);
     }
   }
@@ -1020,10 +1016,7 @@ SoFieldContainer::copyDone(void)
     sofieldcontainer_get_copydict();
 
   SoFieldContainerCopyMap * copiedinstances = (*(copydict->copiedinstancestack))[0];
-  ContentsCopiedMap * contentscopied  = (*(copydict->contentscopiedstack))[0];
-
   assert(copiedinstances);
-  assert(contentscopied);
 
   // unref all copied instances. See comment in addCopy().
   for(
@@ -1032,16 +1025,13 @@ SoFieldContainer::copyDone(void)
       iter!=copiedinstances->const_end();
       ++iter
       ) {
-    iter->obj->unref();
+    iter->obj.copy->unref();
   }
 
-
   delete copiedinstances;
-  delete contentscopied;
 
   // Pop off stack.
   copydict->copiedinstancestack->remove(0);
-  copydict->contentscopiedstack->remove(0);
 }
 
 // Documented in superclass.
@@ -1296,3 +1286,74 @@ SoFieldContainer::getUserData(void) const
 
 #undef FLAG_DONOTIFY
 #undef FLAG_FIRSTINSTANCE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+// Nodes used more than once in the original must be shared the same
+// way in the copy.
+BOOST_AUTO_TEST_CASE(copySharedInstances)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCube * shared = new SoCube;
+  shared->width = 3.0f;
+  for (int i = 0; i < 3; i++) {
+    SoSeparator * sep = new SoSeparator;
+    SoTranslation * trans = new SoTranslation;
+    trans->translation.setValue(float(i), 0.0f, 0.0f);
+    sep->addChild(trans);
+    sep->addChild(shared);
+    root->addChild(sep);
+  }
+
+  SoSeparator * copy = static_cast<SoSeparator *>(root->copy());
+  copy->ref();
+  BOOST_REQUIRE_EQUAL(copy->getNumChildren(), 3);
+  SoNode * sharedcopy = static_cast<SoSeparator *>(copy->getChild(0))->getChild(1);
+  BOOST_CHECK(sharedcopy != shared);
+  BOOST_CHECK_EQUAL(static_cast<SoCube *>(sharedcopy)->width.getValue(), 3.0f);
+  for (int i = 0; i < 3; i++) {
+    SoSeparator * sep = static_cast<SoSeparator *>(copy->getChild(i));
+    BOOST_CHECK(sep != root->getChild(i));
+    BOOST_CHECK(sep->getChild(1) == sharedcopy);
+    SoTranslation * trans = static_cast<SoTranslation *>(sep->getChild(0));
+    BOOST_CHECK(trans->translation.getValue() == SbVec3f(float(i), 0.0f, 0.0f));
+  }
+  copy->unref();
+  root->unref();
+}
+
+// Large coordinate arrays are shared by the copy until either node
+// changes them.
+BOOST_AUTO_TEST_CASE(copySharesLargeArrays)
+{
+  SoCoordinate3 * coords = new SoCoordinate3;
+  coords->ref();
+  const int numpoints = 1000;
+  coords->point.setNum(numpoints);
+  SbVec3f * points = coords->point.startEditing();
+  for (int i = 0; i < numpoints; i++) points[i].setValue(float(i), 0.0f, 0.0f);
+  coords->point.finishEditing();
+
+  SoCoordinate3 * copy = static_cast<SoCoordinate3 *>(coords->copy());
+  copy->ref();
+  BOOST_CHECK(copy->point.getValues(0) == coords->point.getValues(0));
+  BOOST_CHECK(copy->point == coords->point);
+
+  // the copy keeps its values when the original changes
+  coords->point.set1Value(0, SbVec3f(-1.0f, 0.0f, 0.0f));
+  BOOST_CHECK(copy->point.getValues(0) != coords->point.getValues(0));
+  BOOST_CHECK(copy->point[0] == SbVec3f(0.0f, 0.0f, 0.0f));
+  BOOST_CHECK(coords->point[0] == SbVec3f(-1.0f, 0.0f, 0.0f));
+  BOOST_CHECK(coords->point[1] == SbVec3f(1.0f, 0.0f, 0.0f));
+
+  copy->unref();
+  coords->unref();
+}
+
+#endif // COIN_TEST_SUITE
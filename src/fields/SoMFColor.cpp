@@ -107,6 +107,7 @@ SoMFColor::write1Value(SoOutput * out, int idx) const
 void
 SoMFColor::setValues(int start, int numarg, const float rgb[][3])
 {
+  this->evaluateDeferredValues();
   if(start+numarg > this->maxNum) this->makeRoom(start+numarg);
   else if(start+numarg > this->num) this->num = start+numarg;
 
@@ -120,6 +121,7 @@ SoMFColor::setValues(int start, int numarg, const float rgb[][3])
 void
 SoMFColor::setHSVValues(int start, int numarg, const float hsv[][3])
 {
+  this->evaluateDeferredValues();
   if(start+numarg > this->maxNum) this->makeRoom(start+numarg);
   else if(start+numarg > this->num) this->num = start+numarg;
 
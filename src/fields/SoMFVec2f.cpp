@@ -109,6 +109,7 @@ SoMFVec2f::write1Value(SoOutput * out, int idx) const
 void
 SoMFVec2f::setValues(int start, int numarg, const float xy[][2])
 {
+  this->evaluateDeferredValues();
   if (start+numarg > this->maxNum) this->allocValues(start+numarg);
   else if (start+numarg > this->num) this->num = start+numarg;
 
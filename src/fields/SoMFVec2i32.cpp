@@ -111,6 +111,7 @@ SoMFVec2i32::write1Value(SoOutput * out, int idx) const
 void
 SoMFVec2i32::setValues(int start, int numarg, const int32_t xy[][2])
 {
+  this->evaluateDeferredValues();
   if (start+numarg > this->maxNum) this->allocValues(start+numarg);
   else if (start+numarg > this->num) this->num = start+numarg;
 
@@ -120,6 +120,7 @@ SoMFVec3f::write1Value(SoOutput * out, int idx) const
 void
 SoMFVec3f::setValues(int start, int numarg, const float xyz[][3])
 {
+  this->evaluateDeferredValues();
   if (start+numarg > this->maxNum) this->allocValues(start+numarg);
   else if (start+numarg > this->num) this->num = start+numarg;
 
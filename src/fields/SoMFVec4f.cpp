@@ -111,6 +111,7 @@ SoMFVec4f::write1Value(SoOutput * out, int idx) const
 void
 SoMFVec4f::setValues(int start, int numarg, const float xyzw[][4])
 {
+  this->evaluateDeferredValues();
   if(start+numarg > this->maxNum) this->allocValues(start+numarg);
   else if(start+numarg > this->num) this->num = start+numarg;
 
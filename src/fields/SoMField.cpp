@@ -252,11 +252,33 @@
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/errors/SoReadError.h>
 #include <Inventor/fields/SoSubField.h>
-
+#include <Inventor/fields/SoMFColor.h>
+#include <Inventor/fields/SoMFFloat.h>
+#include <Inventor/fields/SoMFInt32.h>
+#include <Inventor/fields/SoMFUInt32.h>
+#include <Inventor/fields/SoMFVec2f.h>
+#include <Inventor/fields/SoMFVec2i32.h>
+#include <Inventor/fields/SoMFVec3f.h>
+#include <Inventor/fields/SoMFVec3i32.h>
+#include <Inventor/fields/SoMFVec4f.h>
+#include <Inventor/fields/SoMFVec4i32.h>
+#include <Inventor/C/tidbits.h>
+
+#include "io/SoInputP.h"
+#include "misc/SbHash.h"
 #include "threads/threadsutilp.h"
 #include "tidbitsp.h"
 #include "coindefs.h" // COIN_WORKAROUND_*
 
+#ifdef COIN_THREADSAFE
+#include "threads/recmutexp.h"
+#define SOMFIELD_RECLOCK (void) cc_recmutex_internal_field_lock()
+#define SOMFIELD_RECUNLOCK (void) cc_recmutex_internal_field_unlock()
+#else // COIN_THREADSAFE
+#define SOMFIELD_RECLOCK
+#define SOMFIELD_RECUNLOCK
+#endif // !COIN_THREADSAFE
+
 #ifndef COIN_WORKAROUND_NO_USING_STD_FUNCS
 using std::memcpy;
 using std::memset;
@@ -292,10 +314,18 @@ SoType SoMField::classTypeId STATIC_SOTYPE_INIT;
 // need one static mutex for field_buffer in SoMField::get1(SbString &)
 static void * somfield_mutex = NULL;
 
+// The number of fields using each value array shared by
+// SoMField::shareValues(). Arrays used by only one field are not
+// in the table.
+typedef SbHash<uintptr_t, int> SoMFieldSharedMap;
+static SoMFieldSharedMap * somfield_sharedvalues = NULL;
+
 static void
-somfield_mutex_cleanup(void)
+somfield_cleanup(void)
 {
   CC_MUTEX_DESTRUCT(somfield_mutex);
+  delete somfield_sharedvalues;
+  somfield_sharedvalues = NULL;
 }
 
 // *************************************************************************
@@ -319,7 +349,8 @@ SoMField::initClass(void)
   PRIVATE_FIELD_INIT_CLASS(SoMField, "MField", inherited, NULL);
 
   CC_MUTEX_CONSTRUCT(somfield_mutex);
-  coin_atexit(somfield_mutex_cleanup, CC_ATEXIT_NORMAL);
+  somfield_sharedvalues = new SoMFieldSharedMap;
+  coin_atexit(somfield_cleanup, CC_ATEXIT_NORMAL);
 }
 
 void
@@ -344,6 +375,138 @@ SoMField::SoMField(void)
 */
 SoMField::~SoMField()
 {
+  if (this->statusbits & (FLAG_DEFERRED | FLAG_COPYONWRITE)) this->detachValues(FALSE);
+}
+
+// Binary format arrays smaller than this are always decoded while
+// reading, see SoInput::setDeferredFieldDecoding().
+static const size_t SOMFIELD_DEFERRED_MINSIZE = 1024;
+
+// Value arrays smaller than this are always copied when a field is
+// assigned, see SoMField::shareValues().
+static const size_t SOMFIELD_SHARED_MINSIZE = 1024;
+
+// Returns the number of 32-bit words per value for the field types
+// where the binary format is just the in-memory values in network
+// byte order, and 0 for all other field types. The values of these
+// field types can also be copied with memcpy().
+static int
+somfield_deferred_words(const SoType & type)
+{
+  if (type == SoMFFloat::getClassTypeId() ||
+      type == SoMFInt32::getClassTypeId() ||
+      type == SoMFUInt32::getClassTypeId()) { return 1; }
+  if (type == SoMFVec2f::getClassTypeId() ||
+      type == SoMFVec2i32::getClassTypeId()) { return 2; }
+  if (type == SoMFVec3f::getClassTypeId() ||
+      type == SoMFVec3i32::getClassTypeId() ||
+      type == SoMFColor::getClassTypeId()) { return 3; }
+  if (type == SoMFVec4f::getClassTypeId() ||
+      type == SoMFVec4i32::getClassTypeId()) { return 4; }
+  return 0;
+}
+
+// Makes the field the only user of its values before they are
+// changed. If keep is FALSE, the values are about to be replaced, so
+// they are just dropped.
+void
+SoMField::detachValues(const SbBool keep)
+{
+  if (this->statusbits & FLAG_DEFERRED) this->decodeDeferredValues(keep);
+  if (this->statusbits & FLAG_COPYONWRITE) this->unshareValues(keep);
+}
+
+// Decodes the binary format values the field kept a reference to
+// when it was read, or just drops the reference if decode is FALSE.
+void
+SoMField::decodeDeferredValues(const SbBool decode)
+{
+  SOMFIELD_RECLOCK;
+  int numvals;
+  const char * data = this->takeDeferredValues(numvals);
+  if (data && decode) {
+    const int words = somfield_deferred_words(this->getTypeId());
+    assert(words * 4 == this->fieldSizeof());
+    this->makeRoom(numvals);
+
+    const size_t numbytes = size_t(numvals) * words * 4;
+    unsigned char * dst = static_cast<unsigned char *>(this->valuesPtr());
+    if (coin_host_get_endianness() == COIN_HOST_IS_BIGENDIAN) {
+      (void)memcpy(dst, data, numbytes);
+    }
+    else {
+      for (size_t i = 0; i < numbytes; i += 4) {
+        dst[i] = data[i + 3];
+        dst[i + 1] = data[i + 2];
+        dst[i + 2] = data[i + 1];
+        dst[i + 3] = data[i];
+      }
+    }
+  }
+  SOMFIELD_RECUNLOCK;
+}
+
+// Lets the field use the same value array as field, instead of
+// copying it, until either field is changed. Only done for large
+// arrays of plain values. Returns FALSE if the values must be copied.
+SbBool
+SoMField::shareValues(const SoMField & field)
+{
+  if (&field == this || field.getTypeId() != this->getTypeId()) return FALSE;
+  if (somfield_deferred_words(this->getTypeId()) == 0) return FALSE;
+
+  field.evaluate();
+  if ((field.statusbits & FLAG_DEFERRED) || field.userDataIsUsed) return FALSE;
+  if (size_t(field.num) * this->fieldSizeof() < SOMFIELD_SHARED_MINSIZE) return FALSE;
+
+  if (this->statusbits & (FLAG_DEFERRED | FLAG_COPYONWRITE)) this->detachValues(FALSE);
+  this->allocValues(0);
+
+  SoMField & source = const_cast<SoMField &>(field);
+  void * values = source.valuesPtr();
+  const uintptr_t key = reinterpret_cast<uintptr_t>(values);
+  SOMFIELD_RECLOCK;
+  int count;
+  if (!somfield_sharedvalues->get(key, count)) count = 1;
+  (void) somfield_sharedvalues->put(key, count + 1);
+  source.statusbits |= FLAG_COPYONWRITE;
+  this->statusbits |= FLAG_COPYONWRITE;
+  this->setValuesPtr(values);
+  this->num = source.num;
+  this->maxNum = source.maxNum;
+  this->userDataIsUsed = FALSE;
+  SOMFIELD_RECUNLOCK;
+
+  this->setChangedIndices();
+  this->valueChanged();
+  return TRUE;
+}
+
+// Stops sharing the values with other fields, making a copy of them
+// if keep is TRUE. The last field using an array just keeps it.
+void
+SoMField::unshareValues(const SbBool keep)
+{
+  // the lock is held while copying, so that the other fields can't
+  // change or delete the values meanwhile
+  SOMFIELD_RECLOCK;
+  this->statusbits &= ~FLAG_COPYONWRITE;
+  void * values = this->valuesPtr();
+  const uintptr_t key = reinterpret_cast<uintptr_t>(values);
+  int count;
+  if (values && somfield_sharedvalues->get(key, count)) {
+    if (count > 2) (void) somfield_sharedvalues->put(key, count - 1);
+    else (void) somfield_sharedvalues->erase(key);
+
+    const int numvalues = this->num;
+    this->setValuesPtr(NULL);
+    this->num = this->maxNum = 0;
+    if (keep && numvalues > 0) {
+      this->allocValues(numvalues);
+      (void)memcpy(this->valuesPtr(), values, size_t(numvalues) * this->fieldSizeof());
+    }
+  }
+  SOMFIELD_RECUNLOCK;
 }
 
 /*!
@@ -353,6 +516,10 @@ void
 SoMField::makeRoom(int newnum)
 {
   assert(newnum >= 0);
+  if (newnum == 0) {
+    if (this->statusbits & (FLAG_DEFERRED | FLAG_COPYONWRITE)) this->detachValues(FALSE);
+  }
+  else this->evaluateDeferredValues();
   if (newnum != this->num) this->allocValues(newnum);
 }
 
@@ -368,6 +535,7 @@ SoMField::makeRoom(int newnum)
 SbBool
 SoMField::set1(const int index, const char * const valuestring)
 {
+  this->evaluateDeferredValues();
   int oldnum = this->num;
   // make sure the array has room for the new item
   if (index >= this->maxNum) this->allocValues(index+1);
@@ -475,6 +643,10 @@ SoMField::readValue(SoInput * in)
     return FALSE; \
   }
 
+  // Any values not decoded from a previous read, or shared with
+  // other fields, are obsolete now.
+  if (this->statusbits & (FLAG_DEFERRED | FLAG_COPYONWRITE)) this->detachValues(FALSE);
+
   // ** Binary format ******************************************************
   if (in->isBinary()) {
     int numtoread;
@@ -497,6 +669,19 @@ SoMField::readValue(SoInput * in)
     }
 #endif // disabled
 
+    // Leave large arrays in the input buffer until they are accessed,
+    // if the SoInput allows it.
+    const int words = somfield_deferred_words(this->getTypeId());
+    const size_t numbytes = size_t(numtoread) * words * 4;
+    if (numbytes >= SOMFIELD_DEFERRED_MINSIZE) {
+      const char * data = SoInputP::getDeferredChunk(in, numbytes);
+      if (data) {
+        this->makeRoom(0);
+        this->setDeferredValues(data, numtoread);
+        return TRUE;
+      }
+    }
+
     this->makeRoom(numtoread);
     if (!this->readBinaryValues(in, numtoread)) { return FALSE; }
   }
@@ -647,6 +832,10 @@ SoMField::setNum(const int numarg)
   // Don't use getNum(), as that could trigger evaluate(), which is
   // _not_ supposed to be called recursively (which means setNum()
   // wouldn't have been available from within an evaluate() session).
+  if (numarg == 0) {
+    if (this->statusbits & (FLAG_DEFERRED | FLAG_COPYONWRITE)) this->detachValues(FALSE);
+  }
+  else this->evaluateDeferredValues();
   int oldnum = this->num;
 
   // Note: this method is implemented in terms of the virtual methods
@@ -684,6 +873,7 @@ SoMField::deleteValues(int start, int numarg)
   // MFNodeEnginePath.tpl).
 
   // Don't use getNum(), so we avoid recursive evaluate() calls.
+  this->evaluateDeferredValues();
   int oldnum = this->num;
 
   if (numarg == -1) numarg = oldnum - start;
@@ -757,6 +947,7 @@ SoMField::insertSpace(int start, int numarg)
   if (numarg == 0) return;
 
   // Don't use getNum(), so we avoid recursive evaluate() calls.
+  this->evaluateDeferredValues();
   int oldnum = this->num;
 #if COIN_DEBUG
   if (start < 0 || start > oldnum || numarg < 0) {
@@ -792,6 +983,7 @@ SoMField::allocValues(int newnum)
   // method as well.
 
   assert(newnum >= 0);
+  this->evaluateDeferredValues();
 
   if (newnum == 0) {
     if (!this->userDataIsUsed) {
@@ -882,3 +1074,124 @@ SoMField::setChangedIndices(const int chgidx, const int numchgind)
   this->changedIndex = chgidx;
   this->numChangedIndices = numchgind;
 }
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/fields/SoMFFloat.h>
+#include <Inventor/fields/SoMFString.h>
+#include <Inventor/fields/SoMFVec3f.h>
+
+// fills a field with numvalues consecutive values, starting at first
+static void
+somfield_fill(SoMFFloat & field, const int numvalues, const float first)
+{
+  field.setNum(numvalues);
+  float * values = field.startEditing();
+  for (int i = 0; i < numvalues; i++) values[i] = first + float(i);
+  field.finishEditing();
+}
+
+BOOST_AUTO_TEST_CASE(copyOnWriteAssignment)
+{
+  SoMFFloat a, b;
+  somfield_fill(a, 1000, 0.0f);
+  b = a;
+  BOOST_CHECK_EQUAL(b.getNum(), 1000);
+  BOOST_CHECK_MESSAGE(b.getValues(0) == a.getValues(0),
+                      "large arrays should be shared after assignment");
+
+  // writing to the copy must not change the original
+  b.set1Value(10, -1.0f);
+  BOOST_CHECK(b.getValues(0) != a.getValues(0));
+  BOOST_CHECK_EQUAL(a[10], 10.0f);
+  BOOST_CHECK_EQUAL(b[10], -1.0f);
+  BOOST_CHECK_EQUAL(b[11], 11.0f);
+
+  // and writing to the original must not change the copy
+  b = a;
+  float * values = a.startEditing();
+  values[0] = 42.0f;
+  a.finishEditing();
+  BOOST_CHECK_EQUAL(a[0], 42.0f);
+  BOOST_CHECK_EQUAL(b[0], 0.0f);
+}
+
+BOOST_AUTO_TEST_CASE(copyOnWriteEveryChange)
+{
+  // each kind of change must give the changed field its own values
+  SoMFFloat a;
+  somfield_fill(a, 1000, 0.0f);
+  const float * shared = a.getValues(0);
+
+  SoMFFloat b;
+  b = a; b.setValue(5.0f);
+  BOOST_CHECK(b.getNum() == 1 && b[0] == 5.0f);
+  b = a; b.setNum(2000);
+  BOOST_CHECK(b.getNum() == 2000 && b[999] == 999.0f);
+  b = a; b.deleteValues(0, 1);
+  BOOST_CHECK(b.getNum() == 999 && b[0] == 1.0f);
+  b = a; b.insertSpace(0, 1);
+  BOOST_CHECK(b.getNum() == 1001 && b[1] == 0.0f);
+  b = a; BOOST_CHECK(b.set1(3, "-3"));
+  BOOST_CHECK_EQUAL(b[3], -3.0f);
+  const float three[] = { 7.0f, 8.0f, 9.0f };
+  b = a; b.setValues(0, 3, three);
+  BOOST_CHECK_EQUAL(b[2], 9.0f);
+  b = a; b.setValuesPointer(3, three);
+  BOOST_CHECK(b.getNum() == 3 && b.getValues(0) == three);
+  b.setNum(0);
+
+  BOOST_CHECK(a.getValues(0) == shared);
+  BOOST_CHECK_EQUAL(a.getNum(), 1000);
+  for (int i = 0; i < 1000; i++) {
+    if (a[i] != float(i)) {
+      BOOST_ERROR("shared values were changed at index " << i);
+      break;
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(copyOnWriteLifetime)
+{
+  // the values must outlive the field they were copied from
+  SoMFFloat * a = new SoMFFloat;
+  somfield_fill(*a, 1000, 1.0f);
+  SoMFFloat b, c;
+  b = *a;
+  c = *a;
+  delete a;
+  BOOST_CHECK(b.getValues(0) == c.getValues(0));
+  b.set1Value(0, 0.0f);
+  BOOST_CHECK_EQUAL(c[0], 1.0f);
+  BOOST_CHECK_EQUAL(c[999], 1000.0f);
+  // the last field using the values can change them in place
+  const float * values = c.getValues(0);
+  c.set1Value(1, 0.0f);
+  BOOST_CHECK(c.getValues(0) == values);
+}
+
+BOOST_AUTO_TEST_CASE(copyOnWriteOnlyLargePlainArrays)
+{
+  SoMFFloat a, b;
+  somfield_fill(a, 10, 0.0f);
+  b = a;
+  BOOST_CHECK_MESSAGE(b.getValues(0) != a.getValues(0),
+                      "small arrays should be copied");
+
+  SoMFString s, t;
+  s.setNum(1000);
+  t = s;
+  BOOST_CHECK_MESSAGE(t.getValues(0) != s.getValues(0),
+                      "strings should always be copied");
+
+  SoMFVec3f v, w;
+  v.setNum(1000);
+  w = v;
+  BOOST_CHECK(w.getValues(0) == v.getValues(0));
+  const float xyz[][3] = { { 1.0f, 2.0f, 3.0f } };
+  w.setValues(0, 1, xyz);
+  BOOST_CHECK(w[0] == SbVec3f(1.0f, 2.0f, 3.0f));
+  BOOST_CHECK(v.getValues(0) != w.getValues(0));
+}
+
+#endif // COIN_TEST_SUITE
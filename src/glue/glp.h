@@ -852,6 +852,13 @@ struct cc_glglue {
   GLuint normalizationcubemap;
   GLuint specularlookup;
 
+  /* per-context lookup table for the shared primitive meshes, see
+     SoGL.cpp */
+  void * primitivemeshes;
+
+  /* single pass bump mapping program, see soshape_bumprender.cpp */
+  void * bumpprogram;
+
   SbBool can_do_bumpmapping;
   SbBool can_do_sortedlayersblend;
   SbBool can_do_anisotropic_filtering;
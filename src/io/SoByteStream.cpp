@@ -30,78 +30,255 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 \**************************************************************************/
 
-// FIXME: this class has not been implemented yet. 20000627 mortene.
+/*!
+  \class SoByteStream SoByteStream.h Inventor/misc/SoByteStream.h
+  \brief The SoByteStream class converts scene graphs to and from a block of memory.
+
+  \ingroup coin_general
+
+  Nodes, paths and path lists are written to a memory buffer in the
+  Inventor file format, for transmission to another process or
+  storage. unconvert() reads the data back into a list of paths.
+
+  \code
+  SoByteStream stream;
+  stream.convert(root);
+  send(stream.getData(), stream.getNumBytes());
+
+  // ... in the receiving process
+  SoPathList * paths = SoByteStream::unconvert(data, numbytes);
+  \endcode
+
+  \sa SoTranSender
+*/
+
+// *************************************************************************
 
 #include <Inventor/misc/SoByteStream.h>
-#include <coindefs.h> // COIN_STUB
+
 #include <cstdlib>
+#include <cstring>
+
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/lists/SoPathList.h>
+#include <Inventor/nodes/SoNode.h>
+
+// *************************************************************************
+
+class SoByteStreamP {
+public:
+  SoByteStreamP(void) : data(NULL), numbytes(0), israwdata(FALSE) { }
+  ~SoByteStreamP() { free(this->data); }
+
+  void * data;
+  size_t numbytes;
+  SbBool israwdata;
+};
+
+#define PRIVATE(obj) (static_cast<SoByteStreamP *>((obj)->pimpl))
+
+static void *
+sobytestream_realloc(void * buf, size_t size)
+{
+  return realloc(buf, size);
+}
 
+// *************************************************************************
 
+/*!
+  Constructor.
+*/
 SoByteStream::SoByteStream(void)
 {
-  COIN_STUB();
+  this->pimpl = new SoByteStreamP;
 }
 
+/*!
+  Destructor. Frees the data of the stream.
+*/
 SoByteStream::~SoByteStream()
 {
-  COIN_STUB();
+  delete PRIVATE(this);
 }
 
+/*!
+  Converts the scene graph below \a node, in binary format if \a
+  binary is \c TRUE. The data can be read back as a path list with a
+  single path containing only \a node.
+*/
 void
-SoByteStream::convert(SoNode * COIN_UNUSED_ARG(node), SbBool COIN_UNUSED_ARG(binary))
+SoByteStream::convert(SoNode * node, SbBool binary)
 {
-  COIN_STUB();
+  SoPath * path = new SoPath(node);
+  path->ref();
+  this->convert(path, binary);
+  path->unref();
 }
 
+/*!
+  Converts \a path, in binary format if \a binary is \c TRUE.
+*/
 void
-SoByteStream::convert(SoPath * COIN_UNUSED_ARG(path), SbBool COIN_UNUSED_ARG(binary))
+SoByteStream::convert(SoPath * path, SbBool binary)
 {
-  COIN_STUB();
+  SoPathList list;
+  list.append(path);
+  this->convert(&list, binary);
 }
 
+/*!
+  Converts all paths in \a pl, in binary format if \a binary is \c
+  TRUE. Any data previously in the stream is replaced.
+*/
 void
-SoByteStream::convert(SoPathList * COIN_UNUSED_ARG(pl), SbBool COIN_UNUSED_ARG(binary))
+SoByteStream::convert(SoPathList * pl, SbBool binary)
 {
-  COIN_STUB();
+  SoByteStreamP * p = PRIVATE(this);
+  free(p->data);
+  p->data = NULL;
+  p->numbytes = 0;
+  p->israwdata = FALSE;
+
+  const size_t initsize = 1024;
+  SoOutput out;
+  out.setBinary(binary);
+  out.setBuffer(malloc(initsize), initsize, sobytestream_realloc);
+
+  // SoPath::write() handles both stages of the write process, so we
+  // do them manually instead of applying the action to the paths
+  SoWriteAction wa(&out);
+  out.setStage(SoOutput::COUNT_REFS);
+  for (int i = 0; i < pl->getLength(); i++) (*pl)[i]->write(&wa);
+  out.setStage(SoOutput::WRITE);
+  for (int i = 0; i < pl->getLength(); i++) (*pl)[i]->write(&wa);
+  if (!binary) out.write('\n');
+
+  (void)out.getBuffer(p->data, p->numbytes);
 }
 
+/*!
+  Returns a pointer to the data of the stream.
+*/
 void *
 SoByteStream::getData(void)
 {
-  COIN_STUB();
-  return NULL;
+  return PRIVATE(this)->data;
 }
 
+/*!
+  Returns the number of bytes of data in the stream.
+*/
 uint32_t
 SoByteStream::getNumBytes(void)
 {
-  COIN_STUB();
-  return 0;
+  return (uint32_t)PRIVATE(this)->numbytes;
 }
 
+/*!
+  Reads back the paths converted into \a stream. The returned list
+  is allocated on the heap, and should be deleted by the caller.
+  Returns \c NULL if the data could not be read.
+*/
 SoPathList *
-SoByteStream::unconvert(SoByteStream * COIN_UNUSED_ARG(stream))
+SoByteStream::unconvert(SoByteStream * stream)
 {
-  COIN_STUB();
-  return NULL;
+  return SoByteStream::unconvert(stream->getData(), stream->getNumBytes());
 }
 
+/*!
+  Reads back the paths converted into the \a bytesinstream bytes of
+  data starting at \a data. The returned list is allocated on the
+  heap, and should be deleted by the caller. Returns \c NULL if the
+  data could not be read.
+*/
 SoPathList *
-SoByteStream::unconvert(void * COIN_UNUSED_ARG(data), uint32_t COIN_UNUSED_ARG(bytesinstream))
+SoByteStream::unconvert(void * data, uint32_t bytesinstream)
 {
-  COIN_STUB();
-  return NULL;
+  SoInput in;
+  in.setBuffer(data, bytesinstream);
+
+  SoPathList * pl = new SoPathList;
+  for (;;) {
+    SoPath * path = NULL;
+    if (!SoDB::read(&in, path)) {
+      delete pl;
+      return NULL;
+    }
+    if (path == NULL) break;
+    pl->append(path);
+  }
+  return pl;
 }
 
+/*!
+  Sets the data of the stream to a copy of the \a len bytes at \a d,
+  for instance data received from another process.
+
+  \sa isRawData()
+*/
 void
-SoByteStream::copy(void * COIN_UNUSED_ARG(d), size_t COIN_UNUSED_ARG(len))
+SoByteStream::copy(void * d, size_t len)
 {
-  COIN_STUB();
+  SoByteStreamP * p = PRIVATE(this);
+  free(p->data);
+  p->data = malloc(len);
+  (void)memcpy(p->data, d, len);
+  p->numbytes = len;
+  p->israwdata = TRUE;
 }
 
+/*!
+  Returns \c TRUE if the data of the stream was set with copy(), and
+  \c FALSE if it was made by converting a scene graph.
+*/
 SbBool
 SoByteStream::isRawData(void) const
 {
-  COIN_STUB();
-  return FALSE;
+  return PRIVATE(this)->israwdata;
 }
+
+#undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SoInput.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/SoPath.h>
+#include <Inventor/lists/SoPathList.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+BOOST_AUTO_TEST_CASE(convertRoundTrip)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  root->addChild(new SoTranslation);
+  root->addChild(new SoCube);
+
+  for (int binary = 0; binary < 2; binary++) {
+    SoByteStream stream;
+    stream.convert(root, binary ? TRUE : FALSE);
+    BOOST_CHECK(stream.getNumBytes() > 0);
+    BOOST_CHECK(!stream.isRawData());
+
+    SoByteStream copy;
+    copy.copy(stream.getData(), stream.getNumBytes());
+    BOOST_CHECK(copy.isRawData());
+
+    SoPathList * pl = SoByteStream::unconvert(&copy);
+    BOOST_REQUIRE(pl != NULL);
+    BOOST_REQUIRE_EQUAL(pl->getLength(), 1);
+    SoNode * head = (*pl)[0]->getHead();
+    BOOST_CHECK(head->isOfType(SoSeparator::getClassTypeId()));
+    BOOST_CHECK_EQUAL(static_cast<SoSeparator *>(head)->getNumChildren(), 2);
+    delete pl;
+  }
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -754,6 +754,44 @@ SoInput::setBuffer(const void * bufpointer, size_t bufsize)
   this->filestack.insert(newfile, 0);
 }
 
+/*!
+  Enables or disables deferred decoding of binary multiple-value
+  fields. Default is \c FALSE.
+
+  When enabled and reading a binary format file from an uncompressed
+  memory buffer set with setBuffer(), large arrays of floating point
+  and integer values (e.g. in SoMFVec3f, SoMFColor, SoMFFloat and
+  SoMFInt32 fields) are not decoded while reading. The fields instead
+  keep a reference to the values in the buffer, and decode them the
+  first time the field is accessed. This makes it cheap to read large
+  models only to inspect their structure.
+
+  The buffer must therefore stay valid and unchanged for as long as
+  any of the fields read from it might still be accessed, which
+  usually means for the lifetime of the scene graph. This makes the
+  mode a good fit for memory mapped files.
+
+  \since Coin 4.1
+*/
+void
+SoInput::setDeferredFieldDecoding(const SbBool flag)
+{
+  PRIVATE(this)->deferfields = flag;
+}
+
+/*!
+  Returns whether deferred decoding of binary multiple-value fields
+  is enabled.
+
+  \sa setDeferredFieldDecoding()
+  \since Coin 4.1
+*/
+SbBool
+SoInput::isDeferredFieldDecoding(void) const
+{
+  return PRIVATE(this)->deferfields;
+}
+
 /*!
   Returns number of bytes read so far from the current file or memory
   buffer.
@@ -944,36 +982,9 @@ SoInput::read(SbString & s)
   ////////////////////
 
   if (fi->isBinary()) { // Checkheader has already been called
-    // This is just a guess at a sensible limit, to help detect
-    // corrupted files and to avoid those leading to attempts at
-    // allocating gigabytes of memory.
-    const unsigned int MAXSTRLEN = 10 * 1024;
-
     unsigned int slen;
     if (!this->read(slen)) { return FALSE; }
-    if (slen == 0) { s = ""; return TRUE; }
-
-    // Inventor V1.0 binary files seems to have 0xffffffff as some
-    // sort of end-of-file tag, so handle that case.
-    if (slen == 0xffffffff) {
-      char c;
-      (void)fi->get(c); // sets the EOF flag as a side-effect
-      if (fi->isEndOfFile()) { return FALSE; }
-      fi->putBack(c);
-    }
-
-    // Sanity check
-    if (slen > MAXSTRLEN) {
-      SoReadError::post(this, "String too long (%u characters) -- "
-                        "file probably corrupt.", slen);
-      return FALSE;
-    }
-
-    char buffer[MAXSTRLEN+4+1];
-    if (!fi->getChunkOfBytes((unsigned char *)buffer, ((slen+3)/4)*4)) { return FALSE; }
-    buffer[slen] = '\0';
-    s = buffer;
-    return TRUE;
+    return PRIVATE(this)->readBinaryString(fi, slen, s);
   }
 
 
@@ -1104,7 +1115,27 @@ SoInput::read(SbName & n, SbBool validIdent)
   // Binary format.
   if (fi->isBinary()) { // Checkheader has already been called
     SbString s;
-    if (!this->read(s)) return FALSE;
+    if (fi->hasNameTable()) {
+      // see SoOutput::writeIdentifier()
+      int code;
+      if (!this->read(code)) return FALSE;
+      if (code <= SoInputP::NAMETABLE_FIRST_REFERENCE) {
+        // the name was validated when it was added to the table
+        if (fi->getTableName(SoInputP::NAMETABLE_FIRST_REFERENCE - code, n)) return TRUE;
+        SoReadError::post(this, "Invalid name table index %d -- "
+                          "file probably corrupt.",
+                          SoInputP::NAMETABLE_FIRST_REFERENCE - code);
+        return FALSE;
+      }
+      else if (code == SoInputP::NAMETABLE_DEFINITION) {
+        if (!this->read(s)) return FALSE;
+        fi->addTableName(SbName(s));
+      }
+      else if (!PRIVATE(this)->readBinaryString(fi, static_cast<unsigned int>(code), s)) {
+        return FALSE;
+      }
+    }
+    else if (!this->read(s)) return FALSE;
 
     n = s;
     const int strlength = s.getLength();
@@ -2116,9 +2147,12 @@ SoInput::checkHeader(SbBool bValidateBufferHeader)
   // <stdin> is being read from or not, we have a pretty good way of
   // telling if the user want to use <stdin> to read from or not when
   // a new file is pushed on the stack.
-  if (this->filestack.getLength() == 1 &&
-      fi->ivFilePointer() == coin_get_stdin() &&
-      !PRIVATE(this)->usingstdin) {
+  //
+  // This is done for every single primitive read, so use the flag
+  // cached in the file info instead of asking the reader.
+  if (!PRIVATE(this)->usingstdin &&
+      this->filestack.getLength() == 1 &&
+      fi->isFromStdin()) {
 
     PRIVATE(this)->usingstdin = TRUE;
   }
@@ -36,6 +36,7 @@
 #endif // HAVE_CONFIG_H
 
 #include <Inventor/SoInput.h>
+#include <Inventor/errors/SoReadError.h>
 
 #include "io/SoInputP.h"
 #include "io/SoInput_FileInfo.h"
@@ -115,6 +116,53 @@ SoInputP::getTopOfStackPopOnEOF(void)
   return fi;
 }
 
+// Returns a pointer into the memory buffer being read for the next
+// numbytes bytes, and skips past them, if deferred field decoding is
+// enabled. Returns NULL if the bytes must be read the usual way.
+const char *
+SoInputP::getDeferredChunk(SoInput * in, const size_t numbytes)
+{
+  if (!in->pimpl->deferfields) return NULL;
+  SoInput_FileInfo * fi = in->getTopOfStack();
+  return fi ? fi->skipMemBufferChunk(numbytes) : NULL;
+}
+
+// Reads the characters of a binary format string of length slen,
+// which has already been read from the stream.
+SbBool
+SoInputP::readBinaryString(SoInput_FileInfo * fi, const unsigned int slen,
+                           SbString & s)
+{
+  // This is just a guess at a sensible limit, to help detect
+  // corrupted files and to avoid those leading to attempts at
+  // allocating gigabytes of memory.
+  const unsigned int MAXSTRLEN = 10 * 1024;
+
+  if (slen == 0) { s = ""; return TRUE; }
+
+  // Inventor V1.0 binary files seems to have 0xffffffff as some
+  // sort of end-of-file tag, so handle that case.
+  if (slen == 0xffffffff) {
+    char c;
+    (void)fi->get(c); // sets the EOF flag as a side-effect
+    if (fi->isEndOfFile()) { return FALSE; }
+    fi->putBack(c);
+  }
+
+  // Sanity check
+  if (slen > MAXSTRLEN) {
+    SoReadError::post(this->owner, "String too long (%u characters) -- "
+                      "file probably corrupt.", slen);
+    return FALSE;
+  }
+
+  char buffer[MAXSTRLEN+4+1];
+  if (!fi->getChunkOfBytes((unsigned char *)buffer, ((slen+3)/4)*4)) { return FALSE; }
+  buffer[slen] = '\0';
+  s = buffer;
+  return TRUE;
+}
+
 // Helperfunctions to handle different filetypes (Inventor, VRML 1.0
 // and VRML 2.0).
 //
@@ -41,6 +41,7 @@
 
 #include "misc/SbHash.h"
 
+class SbString;
 class SoInput;
 class SoInput_FileInfo;
 
@@ -51,12 +52,17 @@ public:
   SoInputP(SoInput * owner) {
     this->owner = owner;
     this->usingstdin = FALSE;
+    this->deferfields = FALSE;
   }
 
   static SbBool debug(void);
   static SbBool debugBinary(void);
 
   SoInput_FileInfo * getTopOfStackPopOnEOF(void);
+  SbBool readBinaryString(SoInput_FileInfo * fi, const unsigned int slen,
+                          SbString & s);
+
+  static const char * getDeferredChunk(SoInput * in, const size_t numbytes);
 
   static SbBool isNameStartChar(unsigned char c, SbBool validIdent);
   static SbBool isNameChar(unsigned char c, SbBool validIdent);
@@ -65,7 +71,21 @@ public:
   static SbBool isNameStartCharVRML2(unsigned char c, SbBool validIdent);
   static SbBool isNameCharVRML2(unsigned char c, SbBool validIdent);
 
+  // Identifiers in binary files with a name table (see
+  // SoOutput::setBinaryNameTable()) are written as a string length,
+  // as usual, or as one of these markers. A definition is followed by
+  // the string, which is then added to the table, while table entry i
+  // is referenced by NAMETABLE_FIRST_REFERENCE - i.
+  enum NameTableMarker {
+    NAMETABLE_DEFINITION = -2,
+    NAMETABLE_FIRST_REFERENCE = -3
+  };
+  static const char * getNameTableHeader(void) {
+    return "#Coin V4.1 binary";
+  }
+
   SbBool usingstdin;
+  SbBool deferfields;
 
   SbHash<const char *, SoBase *> copied_references;
 
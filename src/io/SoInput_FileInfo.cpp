@@ -47,6 +47,7 @@
 
 #include "tidbitsp.h"
 #include "glue/zlib.h"
+#include "io/SoInputP.h"
 
 // *************************************************************************
 
@@ -59,6 +60,9 @@ SoInput_FileInfo::SoInput_FileInfo(SoInput_Reader * readerptr,
   : references(refs)
 {
   this->reader = readerptr;
+  // if reader == NULL, it means that we're reading from stdin
+  this->fromstdin = (readerptr == NULL) ||
+    (readerptr->getFilePointer() == coin_get_stdin());
 #if defined(HAVE_THREADS) && defined(SOINPUT_ASYNC_IO)
   this->mutex = cc_mutex_construct();
   this->condvar = cc_condvar_construct();
@@ -86,6 +90,7 @@ SoInput_FileInfo::SoInput_FileInfo(SoInput_Reader * readerptr,
   this->lastchar = -1;
   this->eof = FALSE;
   this->isbinary = FALSE;
+  this->nametable = FALSE;
   this->vrml1file = FALSE;
   this->vrml2file = FALSE;
   this->prefunc = NULL;
@@ -229,6 +234,42 @@ SoInput_FileInfo::getChunkOfBytes(unsigned char * ptr, size_t length)
   return !this->eof;
 }
 
+// Returns a pointer to the next length bytes of an uncompressed memory
+// buffer, and skips past them without copying. Returns NULL if the
+// bytes can not be accessed directly in the source buffer.
+const char *
+SoInput_FileInfo::skipMemBufferChunk(const size_t length)
+{
+#if defined(HAVE_THREADS) && defined(SOINPUT_ASYNC_IO)
+  // the buffer position of the reader thread is not in sync with ours
+  return NULL;
+#else // HAVE_THREADS && SOINPUT_ASYNC_IO
+  if ((this->reader == NULL) ||
+      (this->getReader()->getType() != SoInput_Reader::MEMBUFFER) ||
+      (this->backbuffer.getLength() > 0)) { return NULL; }
+
+  SoInput_MemBufferReader * memreader =
+    static_cast<SoInput_MemBufferReader *>(this->getReader());
+
+  // the unread part of readbuf is a copy of the bytes just before the
+  // reader's position in the source buffer
+  const size_t buffered = this->readbuflen - this->readbufidx;
+  const size_t pos = memreader->bufpos - buffered;
+  if (memreader->buflen - pos < length) { return NULL; }
+
+  if (length <= buffered) {
+    this->readbufidx += length;
+  }
+  else {
+    this->totalread += length - buffered;
+    this->readbufidx = this->readbuflen;
+    memreader->bufpos = pos + length;
+  }
+  this->lastputback = -1;
+  return memreader->buf + pos;
+#endif // !(HAVE_THREADS && SOINPUT_ASYNC_IO)
+}
+
 void
 SoInput_FileInfo::addReference(const SbName & name, SoBase * base,
                                SbBool /* addToGlobalDict */) // FIXME: why the unused arg?
@@ -385,6 +426,8 @@ SoInput_FileInfo::readHeaderInternal(SoInput * soinput)
   this->ivversion = 0.0f;
   this->vrml1file = FALSE;
   this->vrml2file = FALSE;
+  this->nametable = FALSE;
+  this->tablenames.truncate(0);
 
   char c;
   if (!this->get(c)) return FALSE;
@@ -419,6 +462,11 @@ SoInput_FileInfo::readHeaderInternal(SoInput * soinput)
                      vrml2string.getLength()) == 0) {
       this->vrml2file = TRUE;
     }
+    else if (this->isbinary) {
+      const char * nametableheader = SoInputP::getNameTableHeader();
+      this->nametable = strncmp(nametableheader, this->header.getString(),
+                                strlen(nametableheader)) == 0;
+    }
     if (this->prefunc) this->prefunc(this->userdata, soinput);
   }
   return TRUE;
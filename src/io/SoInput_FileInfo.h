@@ -79,6 +79,7 @@ public:
   size_t getNumBytesParsedSoFar(void) const;
 
   SbBool getChunkOfBytes(unsigned char * ptr, size_t length);
+  const char * skipMemBufferChunk(const size_t length);
   SbBool get(char & c);
 
   void putBack(const char c);
@@ -117,6 +118,17 @@ public:
   float ivVersion(void) {
     return this->ivversion;
   }
+  SbBool hasNameTable(void) {
+    return this->nametable;
+  }
+  void addTableName(const SbName & name) {
+    this->tablenames.append(name);
+  }
+  SbBool getTableName(const int idx, SbName & name) {
+    if (idx < 0 || idx >= this->tablenames.getLength()) return FALSE;
+    name = this->tablenames[idx];
+    return TRUE;
+  }
   SbBool isFileVRML1(void) {
     return this->vrml1file;
   }
@@ -132,6 +144,9 @@ public:
   unsigned int lineNr(void) {
     return this->linenr;
   }
+  SbBool isFromStdin(void) const {
+    return this->fromstdin;
+  }
   FILE * ivFilePointer(void) {
     // if reader == NULL, it means that we're reading from stdin
     if (this->reader == NULL) return coin_get_stdin();
@@ -227,6 +242,8 @@ private:
   SoDBHeaderCB * prefunc, * postfunc;
   void * userdata;
   SbBool isbinary;
+  SbBool nametable;
+  SbList<SbName> tablenames;
 
   char * readbuf;
   size_t readbufidx;
@@ -236,6 +253,7 @@ private:
   int lastputback; // The last character put back into the stream.
   int lastchar; // Last read character.
   SbBool headerisread, eof;
+  SbBool fromstdin;
   SbBool vrml1file;
   SbBool vrml2file;
 
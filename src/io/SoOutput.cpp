@@ -79,6 +79,8 @@
 #endif // HAVE_CONFIG_H
 
 #include <cassert>
+#include <cfloat>
+#include <cmath>
 #include <cstring>
 
 #ifdef HAVE_WINDOWS_H
@@ -100,6 +102,7 @@
 #include "glue/bzip2.h"
 #include "io/SoOutput_Writer.h"
 #include "io/SoWriterefCounter.h"
+#include "io/SoInputP.h"
 
 // *************************************************************************
 
@@ -182,8 +185,8 @@ public:
 
   SbBool binarystream;
   SbBool usercalledopenfile;
-  SbString fltprecision;
-  SbString dblprecision;
+  int fltprecision;
+  int dblprecision;
   int indentlevel;
   SbBool writecompact;
   SbBool disabledwriting;
@@ -198,6 +201,10 @@ public:
   SbName compmethod;
   float complevel;
 
+  SbBool nametable;
+  SbBool writingnametable;
+  SbHash<const char *, int> nameindices;
+
   void pushRoutes(const SbBool copyprev) {
     const int oldidx = this->routestack.getLength() - 1;
     assert(oldidx >= 0);
@@ -338,8 +345,8 @@ SoOutput::constructorCommon(void)
 
   PRIVATE(this)->usercalledopenfile = FALSE;
   PRIVATE(this)->binarystream = FALSE;
-  PRIVATE(this)->fltprecision = "%.8g";
-  PRIVATE(this)->dblprecision = "%.16lg";
+  PRIVATE(this)->fltprecision = 8;
+  PRIVATE(this)->dblprecision = 16;
   PRIVATE(this)->disabledwriting = FALSE;
   this->wroteHeader = FALSE;
   PRIVATE(this)->writecompact = FALSE;
@@ -350,6 +357,8 @@ SoOutput::constructorCommon(void)
 
   PRIVATE(this)->compmethod = SbName("NONE");
   PRIVATE(this)->complevel = 0.0f;;
+  PRIVATE(this)->nametable = FALSE;
+  PRIVATE(this)->writingnametable = FALSE;
 }
 
 /*!
@@ -665,6 +674,47 @@ SoOutput::isBinary(void) const
   return PRIVATE(this)->binarystream;
 }
 
+/*!
+  Set whether or not binary files should be written with a name
+  table.
+
+  In a plain binary Inventor file, every node type name and field
+  name is written out as a full string each time it is used, and the
+  reader has to look each of them up again. With the name table
+  enabled, a name is written in full only the first time it is used,
+  and later occurrences are written as a single integer index into
+  the table of names seen so far. This makes the files smaller, and
+  faster to import, for scene graphs with many nodes.
+
+  Files written with a name table get the header
+  "#Coin V4.1 binary", and can not be read by other Open Inventor
+  implementations or by Coin versions prior to 4.1. For this reason
+  the setting is \c FALSE by default, and it is also ignored if a
+  custom header has been set with setHeaderString().
+
+  The setting has no effect on ASCII output.
+
+  \sa isBinaryNameTable(), setBinary()
+  \since Coin 4.1
+*/
+void
+SoOutput::setBinaryNameTable(const SbBool flag)
+{
+  PRIVATE(this)->nametable = flag;
+}
+
+/*!
+  Returns whether or not binary files are written with a name table.
+
+  \sa setBinaryNameTable()
+  \since Coin 4.1
+*/
+SbBool
+SoOutput::isBinaryNameTable(void) const
+{
+  return PRIVATE(this)->nametable;
+}
+
 /*!
   Set the output file header string.
 
@@ -722,8 +772,8 @@ SoOutput::setFloatPrecision(const int precision)
   const int fltnum = SbClamp(precision, 0, 8);
   const int dblnum = precision * 2;
 
-  PRIVATE(this)->fltprecision.sprintf("%%.%dg", fltnum);
-  PRIVATE(this)->dblprecision.sprintf("%%.%dlg", dblnum);
+  PRIVATE(this)->fltprecision = fltnum;
+  PRIVATE(this)->dblprecision = dblnum;
 }
 
 /*!
@@ -838,6 +888,235 @@ SoOutput::write(const SbName & n)
   this->write(s);
 }
 
+/*!
+  \COININTERNAL
+
+  Write an identifier (a keyword, type name or field name) which will
+  be read back with SoInput::read(SbName &, TRUE). This is the same as
+  write(const char *), except when writing a binary file with a name
+  table, where all but the first occurrence of an identifier are
+  written as an index into the table.
+
+  \sa setBinaryNameTable()
+  \since Coin 4.1
+*/
+void
+SoOutput::writeIdentifier(const char * s)
+{
+  this->checkHeader();
+  if (!PRIVATE(this)->writingnametable) {
+    this->write(s);
+    return;
+  }
+
+  // the hash compares keys by pointer, so look up the name dictionary
+  // string
+  const char * key = SbName(s).getString();
+  int idx;
+  if (PRIVATE(this)->nameindices.get(key, idx)) {
+    this->write(SoInputP::NAMETABLE_FIRST_REFERENCE - idx);
+  }
+  else {
+    idx = static_cast<int>(PRIVATE(this)->nameindices.getNumElements());
+    (void)PRIVATE(this)->nameindices.put(key, idx);
+    this->write(static_cast<int>(SoInputP::NAMETABLE_DEFINITION));
+    this->write(s);
+  }
+}
+
+// *************************************************************************
+
+// Helpers for formatting numbers into a stack buffer for ASCII
+// export. These don't allocate, and don't depend on the current
+// locale, so we don't have to switch to the portable locale around
+// every single number written.
+
+// Writes the decimal representation of \a val into \a buf, which
+// must have room for at least 12 characters. Returns the number of
+// characters written.
+static int
+sooutput_format_int(char * buf, const int val)
+{
+  char tmp[12];
+  int n = 0;
+  // go through unsigned to handle INT_MIN
+  unsigned int u = val < 0 ? 0u - (unsigned int)val : (unsigned int)val;
+  do {
+    tmp[n++] = (char)('0' + (u % 10));
+    u /= 10;
+  } while (u);
+
+  int len = 0;
+  if (val < 0) buf[len++] = '-';
+  while (n > 0) buf[len++] = tmp[--n];
+  return len;
+}
+
+// Writes \a val as "0x<hexdigits>" into \a buf, which must have room
+// for at least 10 characters. Returns the number of characters
+// written.
+static int
+sooutput_format_hex(char * buf, unsigned int val)
+{
+  static const char digits[] = "0123456789abcdef";
+  char tmp[8];
+  int n = 0;
+  do {
+    tmp[n++] = digits[val & 0xf];
+    val >>= 4;
+  } while (val);
+
+  int len = 0;
+  buf[len++] = '0';
+  buf[len++] = 'x';
+  while (n > 0) buf[len++] = tmp[--n];
+  return len;
+}
+
+// Copies the output of a "%g" conversion from \a src to \a dst,
+// replacing the decimal point of the current locale with '.', and
+// writing the exponent (if any) with a sign and at least three
+// digits, so the output is the same on all platforms. \a dst must
+// have room for at least \a srclen + 2 characters. Returns the
+// number of characters written.
+static int
+sooutput_normalize_real(char * dst, const char * src, const int srclen)
+{
+  int len = 0;
+  SbBool gotpoint = FALSE;
+  for (int i = 0; i < srclen; i++) {
+    const char c = src[i];
+    if (c == 'e') {
+      const char sign = src[++i];
+      int first = ++i;
+      while (first < srclen - 1 && src[first] == '0') first++;
+      const int ndigits = srclen - first;
+      dst[len++] = 'e';
+      dst[len++] = sign;
+      for (int j = ndigits; j < 3; j++) dst[len++] = '0';
+      for (int j = first; j < srclen; j++) dst[len++] = src[j];
+      break;
+    }
+    else if ((c >= '0' && c <= '9') || c == '-' || c == '+' ||
+             (c >= 'a' && c <= 'z')) { // letters from "inf" and "nan"
+      dst[len++] = c;
+    }
+    else if (!gotpoint) {
+      // the decimal point of the current locale, which could be
+      // several bytes long
+      dst[len++] = '.';
+      gotpoint = TRUE;
+    }
+  }
+  return len;
+}
+
+// Formats \a val exactly like "%.<precision>g" followed by
+// sooutput_normalize_real() would, for precisions up to 9 digits,
+// without going through the C library.
+//
+// The value is scaled by an exactly representable power of ten so
+// the significant digits end up in the integer part. The scaling is
+// a single correctly rounded multiplication or division, and the
+// result is less than 2^30, so the error is far less than the
+// distance to the rounding point, except when we're very close to a
+// tie. In that case, or if the scale factor would not be exact, or
+// for NaN and infinity, -1 is returned and the caller should use the
+// C library instead. \a buf must have room for at least 24
+// characters. Returns the number of characters written.
+static int
+sooutput_format_real_fast(char * buf, const int precision, const double val)
+{
+  static const double pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+
+  const int prec = precision < 1 ? 1 : precision; // "%.0g" means 1 digit
+  if (prec > 9) return -1;
+
+  uint64_t bits;
+  (void)memcpy(&bits, &val, sizeof(bits));
+  const SbBool negative = (bits >> 63) != 0;
+
+  int len = 0;
+  if (negative) buf[len++] = '-';
+
+  if (val == 0.0) {
+    buf[len++] = '0';
+    return len;
+  }
+
+  const double a = negative ? -val : val;
+  if (!(a <= DBL_MAX)) return -1; // NaN or infinity
+
+  // estimate the decimal exponent from the binary one, it may be
+  // one too small, which is adjusted for below
+  int exp2;
+  (void)frexp(a, &exp2);
+  int exp10 = (int)floor((exp2 - 1) * 0.30102999566398120);
+  double y = 0.0;
+  for (int attempt = 0; ; attempt++) {
+    if (attempt == 2) return -1;
+    const int k = prec - 1 - exp10;
+    if (k < -22 || k > 22) return -1;
+    y = (k >= 0) ? (a * pow10[k]) : (a / pow10[-k]);
+    if (y >= pow10[prec]) exp10++;
+    else if (y < pow10[prec - 1]) exp10--;
+    else break;
+  }
+
+  uint32_t digits = (uint32_t)y;
+  const double frac = y - (double)digits;
+  const double eps = 1.0 / (1 << 22);
+  if (frac > 0.5 + eps) digits++;
+  else if (frac >= 0.5 - eps) return -1;
+
+  if (digits == (uint32_t)pow10[prec]) {
+    digits /= 10;
+    exp10++;
+  }
+
+  char d[9];
+  for (int i = prec - 1; i >= 0; i--) {
+    d[i] = (char)('0' + (digits % 10));
+    digits /= 10;
+  }
+  // "%g" strips trailing zeros
+  int nd = prec;
+  while (nd > 1 && d[nd - 1] == '0') nd--;
+
+  if (exp10 < -4 || exp10 >= prec) {
+    buf[len++] = d[0];
+    if (nd > 1) {
+      buf[len++] = '.';
+      for (int i = 1; i < nd; i++) buf[len++] = d[i];
+    }
+    buf[len++] = 'e';
+    buf[len++] = exp10 < 0 ? '-' : '+';
+    const int e = exp10 < 0 ? -exp10 : exp10;
+    buf[len++] = (char)('0' + e / 100);
+    buf[len++] = (char)('0' + (e / 10) % 10);
+    buf[len++] = (char)('0' + e % 10);
+  }
+  else if (exp10 >= 0) {
+    for (int i = 0; i <= exp10; i++) buf[len++] = (i < nd) ? d[i] : '0';
+    if (nd > exp10 + 1) {
+      buf[len++] = '.';
+      for (int i = exp10 + 1; i < nd; i++) buf[len++] = d[i];
+    }
+  }
+  else {
+    buf[len++] = '0';
+    buf[len++] = '.';
+    for (int i = -1; i > exp10; i--) buf[len++] = '0';
+    for (int i = 0; i < nd; i++) buf[len++] = d[i];
+  }
+  return len;
+}
+
+// *************************************************************************
+
 /*!
   Write \a i as a character string, or as an architecture independent binary
   pattern if the setBinary() flag is activated.
@@ -846,16 +1125,9 @@ void
 SoOutput::write(const int i)
 {
   if (!this->isBinary()) {
-    // Use portable locale, to make sure we don't write thousands
-    // separators for integers.
-    cc_string storedlocale;
-    SbBool changed = coin_locale_set_portable(&storedlocale);
-
-    SbString s;
-    s.sprintf("%d", i);
-    this->writeBytesWithPadding(s.getString(), s.getLength());
-
-    if (changed) { coin_locale_reset(&storedlocale); }
+    char buf[12];
+    const int len = sooutput_format_int(buf, i);
+    this->writeBytesWithPadding(buf, len);
   }
   else {
     // FIXME: breaks on 64-bit architectures, which is pretty
@@ -874,9 +1146,9 @@ void
 SoOutput::write(const unsigned int i)
 {
   if (!this->isBinary()) {
-    SbString s;
-    s.sprintf("0x%x", i);
-    this->writeBytesWithPadding(s.getString(), s.getLength());
+    char buf[10];
+    const int len = sooutput_format_hex(buf, i);
+    this->writeBytesWithPadding(buf, len);
   }
   else {
     assert(sizeof(i) == sizeof(int32_t));
@@ -894,16 +1166,9 @@ void
 SoOutput::write(const short s)
 {
   if (!this->isBinary()) {
-    // Use portable locale, to make sure we don't write thousands
-    // separators for integers.
-    cc_string storedlocale;
-    SbBool changed = coin_locale_set_portable(&storedlocale);
-
-    SbString str;
-    str.sprintf("%hd", s);
-    this->writeBytesWithPadding(str.getString(), str.getLength());
-
-    if (changed) { coin_locale_reset(&storedlocale); }
+    char buf[12];
+    const int len = sooutput_format_int(buf, s);
+    this->writeBytesWithPadding(buf, len);
   }
   else {
     this->write((int)s);
@@ -919,9 +1184,9 @@ void
 SoOutput::write(const unsigned short s)
 {
   if (!this->isBinary()) {
-    SbString str;
-    str.sprintf("0x%hx", s);
-    this->writeBytesWithPadding(str.getString(), str.getLength());
+    char buf[10];
+    const int len = sooutput_format_hex(buf, s);
+    this->writeBytesWithPadding(buf, len);
   }
   else {
     this->write((unsigned int)s);
@@ -935,28 +1200,16 @@ void
 SoOutput::write(const float f)
 {
   if (!this->isBinary()) {
-    // Use portable locale, to make sure we don't write thousands
-    // separators for integers.
-    cc_string storedlocale;
-    SbBool changed = coin_locale_set_portable(&storedlocale);
-
-    SbString s;
-    s.sprintf(PRIVATE(this)->fltprecision.getString(), f);
-    
-    // make sure scientific exponential is written in a platform independent way
-    // always with three digits
-    int pos = s.find("e");
-    if(pos>0)
-      {
-	SbString exponential;
-	exponential.sprintf("%03d",atoi(s.getSubString(pos+2).getString()));
-	s=s.getSubString(0,pos+1)+exponential;
-
-      }
-
-    this->writeBytesWithPadding(s.getString(), s.getLength());
-
-    if (changed) { coin_locale_reset(&storedlocale); }
+    char buf[34];
+    int len = sooutput_format_real_fast(buf, PRIVATE(this)->fltprecision, f);
+    if (len < 0) {
+      // the float precision is clamped, so this will always fit
+      char tmp[32];
+      const int n = coin_snprintf(tmp, sizeof(tmp), "%.*g", PRIVATE(this)->fltprecision, (double)f);
+      assert(n >= 0);
+      len = sooutput_normalize_real(buf, tmp, n);
+    }
+    this->writeBytesWithPadding(buf, len);
   }
   else {
     char buff[sizeof(f)];
@@ -972,28 +1225,26 @@ void
 SoOutput::write(const double d)
 {
   if (!this->isBinary()) {
-    // Use portable locale, to make sure we don't write thousands
-    // separators for integers.
-    cc_string storedlocale;
-    SbBool changed = coin_locale_set_portable(&storedlocale);
-
-    SbString s;
-    s.sprintf(PRIVATE(this)->dblprecision.getString(), d);
-
-    // make sure scientific exponential is written in a platform independent way
-    // always with three digits
-    int pos = s.find("e");
-    if(pos>0)
-      {
-	SbString exponential;
-	exponential.sprintf("%03d",atoi(s.getSubString(pos+2).getString()));
-	s=s.getSubString(0,pos+1)+exponential;
-      }
-
-
-    this->writeBytesWithPadding(s.getString(), s.getLength());
-
-    if (changed) { coin_locale_reset(&storedlocale); }
+    char tmp[64], buf[sizeof(tmp) + 2];
+    const int prec = PRIVATE(this)->dblprecision;
+    const int fastlen = sooutput_format_real_fast(buf, prec, d);
+    const int n = (fastlen < 0) ? coin_snprintf(tmp, sizeof(tmp), "%.*g", prec, d) : 0;
+    if (fastlen >= 0) {
+      this->writeBytesWithPadding(buf, fastlen);
+    }
+    else if (n >= 0) {
+      this->writeBytesWithPadding(buf, sooutput_normalize_real(buf, tmp, n));
+    }
+    else {
+      // a very high precision was set with setFloatPrecision(), so
+      // take the slow path through dynamically allocated buffers
+      SbString s;
+      s.sprintf("%.*g", prec, d);
+      char * dynbuf = new char[s.getLength() + 2];
+      const int len = sooutput_normalize_real(dynbuf, s.getString(), s.getLength());
+      this->writeBytesWithPadding(dynbuf, len);
+      delete[] dynbuf;
+    }
   }
   else {
     char buff[sizeof(d)];
@@ -1309,8 +1560,15 @@ SoOutput::checkHeader(void)
     // end up in an eternal double-recursive loop.
     this->wroteHeader = TRUE;
 
+    PRIVATE(this)->writingnametable = FALSE;
+    PRIVATE(this)->nameindices.clear();
+
     SbString h;
     if (PRIVATE(this)->headerstring) h = *(PRIVATE(this)->headerstring);
+    else if (this->isBinary() && PRIVATE(this)->nametable) {
+      h = SoInputP::getNameTableHeader();
+      PRIVATE(this)->writingnametable = TRUE;
+    }
     else if (this->isBinary()) h = SoOutput::getDefaultBinaryHeader();
     else h = SoOutput::getDefaultASCIIHeader();
 
@@ -1716,3 +1974,155 @@ SoOutput_getHeaderString(const SoOutputP * pout)
 }
 
 #undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SoOutput.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/nodes/SoCoordinate3.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoIndexedFaceSet.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <cstdlib>
+
+static void *
+test_realloc_buffer(void * buf, size_t size)
+{
+  return realloc(buf, size);
+}
+
+BOOST_AUTO_TEST_CASE(asciiNumberFormatting)
+{
+  SoOutput out;
+  out.setBuffer(malloc(64), 64, test_realloc_buffer);
+  out.write(1.5f); out.write(' ');
+  out.write(-0.0f); out.write(' ');
+  out.write(0.0009765625f); out.write(' ');
+  out.write(0.00001f); out.write(' ');
+  out.write(1e20f); out.write(' ');
+  out.write(123456789.0f); out.write(' ');
+  out.write(0.1f); out.write(' ');
+  out.write(2.5); out.write(' ');
+  out.write(-2147483647 - 1); out.write(' ');
+  out.write((unsigned int)0xbeef); out.write(' ');
+  out.write((short)-42);
+
+  void * buf;
+  size_t size;
+  BOOST_REQUIRE(out.getBuffer(buf, size));
+  const char * expected =
+    "1.5 -0 0.0009765625 9.9999997e-006 1e+020 1.2345679e+008 0.1 2.5 "
+    "-2147483648 0xbeef -42";
+  const size_t len = strlen(expected);
+  BOOST_REQUIRE(size >= len);
+  const SbString written((const char *)buf + size - len);
+  BOOST_CHECK_MESSAGE(written == expected,
+                      (SbString("unexpected output: ") + written).getString());
+  free(buf);
+}
+
+BOOST_AUTO_TEST_CASE(binaryNameTable)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  for (int i = 0; i < 10; i++) {
+    SoCube * cube = new SoCube;
+    cube->width = float(i);
+    root->addChild(cube);
+  }
+  root->addChild(root->getChild(0)); // written as USE
+
+  size_t sizes[2];
+  for (int nametable = 0; nametable < 2; nametable++) {
+    SoOutput out;
+    out.setBinary(TRUE);
+    out.setBinaryNameTable(nametable ? TRUE : FALSE);
+    out.setBuffer(malloc(1024), 1024, test_realloc_buffer);
+    SoWriteAction wa(&out);
+    wa.apply(root);
+
+    void * buf;
+    BOOST_REQUIRE(out.getBuffer(buf, sizes[nametable]));
+    SoInput in;
+    in.setBuffer(buf, sizes[nametable]);
+    BOOST_CHECK(in.isBinary());
+    SoSeparator * copy = SoDB::readAll(&in);
+    BOOST_REQUIRE(copy != NULL);
+    copy->ref();
+    BOOST_REQUIRE_EQUAL(copy->getNumChildren(), 11);
+    for (int i = 0; i < 10; i++) {
+      BOOST_REQUIRE(copy->getChild(i)->isOfType(SoCube::getClassTypeId()));
+      BOOST_CHECK_EQUAL(static_cast<SoCube *>(copy->getChild(i))->width.getValue(), float(i));
+    }
+    BOOST_CHECK(copy->getChild(10) == copy->getChild(0));
+    copy->unref();
+    free(buf);
+  }
+  BOOST_CHECK(sizes[1] < sizes[0]);
+  root->unref();
+}
+
+BOOST_AUTO_TEST_CASE(deferredFieldDecoding)
+{
+  const int NUM = 1000;
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCoordinate3 * coords = new SoCoordinate3;
+  SoIndexedFaceSet * faceset = new SoIndexedFaceSet;
+  for (int i = 0; i < NUM; i++) {
+    coords->point.set1Value(i, SbVec3f(float(i), -0.5f, 1e10f));
+    faceset->coordIndex.set1Value(i, (i % 4 == 3) ? -1 : i);
+  }
+  root->addChild(coords);
+  root->addChild(faceset);
+
+  SoOutput out;
+  out.setBinary(TRUE);
+  out.setBuffer(malloc(1024), 1024, test_realloc_buffer);
+  SoWriteAction wa(&out);
+  wa.apply(root);
+  void * buf;
+  size_t size;
+  BOOST_REQUIRE(out.getBuffer(buf, size));
+
+  for (int pass = 0; pass < 4; pass++) {
+    char * data = static_cast<char *>(malloc(size));
+    memcpy(data, buf, size);
+    SoInput in;
+    in.setBuffer(data, size);
+    in.setDeferredFieldDecoding(TRUE);
+    SoSeparator * copy = SoDB::readAll(&in);
+    BOOST_REQUIRE(copy != NULL);
+    copy->ref();
+    BOOST_REQUIRE_EQUAL(copy->getNumChildren(), 2);
+    SoCoordinate3 * c = static_cast<SoCoordinate3 *>(copy->getChild(0));
+    SoIndexedFaceSet * f = static_cast<SoIndexedFaceSet *>(copy->getChild(1));
+
+    if (pass == 0) {
+      BOOST_CHECK(c->point == coords->point);
+      BOOST_CHECK(f->coordIndex == faceset->coordIndex);
+    }
+    else if (pass == 1) {
+      // modifying a field must decode its values first
+      c->point.set1Value(5, SbVec3f(1.0f, 2.0f, 3.0f));
+      BOOST_CHECK_EQUAL(c->point.getNum(), NUM);
+      BOOST_CHECK(c->point[5] == SbVec3f(1.0f, 2.0f, 3.0f));
+      BOOST_CHECK(c->point[6] == SbVec3f(6.0f, -0.5f, 1e10f));
+    }
+    else if (pass == 2) {
+      // the values are only decoded from the buffer on first access
+      memset(data, 0, size);
+      BOOST_CHECK_EQUAL(c->point.getNum(), NUM);
+      BOOST_CHECK(c->point[6] == SbVec3f(0.0f, 0.0f, 0.0f));
+    }
+    // ..and for the last pass, they are never decoded at all
+    copy->unref();
+    free(data);
+  }
+  free(buf);
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -30,25 +30,318 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 \**************************************************************************/
 
-// FIXME: this class has not been implemented yet. 20000627 mortene.
+/*!
+  \class SoTranReceiver SoTranReceiver.h Inventor/misc/SoTranReceiver.h
+  \brief The SoTranReceiver class applies scene graph changes sent by an SoTranSender.
+
+  \ingroup coin_general
+
+  The receiver reads the commands written by an SoTranSender, and
+  applies them to a scene graph below the root group given to the
+  constructor, mirroring the sender's scene graph.
+
+  \code
+  SoSeparator * mirror = new SoSeparator;
+  mirror->ref();
+  SoTranReceiver receiver(mirror);
+
+  // ... for each batch received from the sending process
+  SoInput in;
+  in.setBuffer(data, size);
+  receiver.interpret(&in);
+  \endcode
+
+  The receiver keeps a reference to all nodes it has received, so
+  they can be referred to in later commands. They are released when
+  the sender calls SoTranSender::reset().
+
+  \sa SoTranSender
+*/
+
+// *************************************************************************
 
 #include <Inventor/misc/SoTranReceiver.h>
-#include <coindefs.h> // COIN_STUB
 
+#include <Inventor/misc/SoBase.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/errors/SoReadError.h>
+#include <Inventor/fields/SoField.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/nodes/SoGroup.h>
+
+#include "io/SoTranscribeP.h"
+
+// *************************************************************************
+
+class SoTranReceiverP {
+public:
+  SoTranReceiverP(SoGroup * r) : root(r) { }
+
+  SoGroup * root;
+  // all received nodes, indexed by id
+  SbList<SoNode *> nodes;
+
+  SoNode * getNode(SoInput * in);
+  SoGroup * getGroup(SoInput * in);
+  SoNode * readNode(SoInput * in);
+  SbBool modify(SoInput * in);
+  void clear(void);
+};
+
+#define PRIVATE(obj) (static_cast<SoTranReceiverP *>((obj)->pimpl))
+
+// *************************************************************************
+
+// Reads a node id, and returns the node.
+SoNode *
+SoTranReceiverP::getNode(SoInput * in)
+{
+  int id;
+  if (!in->read(id)) return NULL;
+  if (id < 0 || id >= this->nodes.getLength()) {
+    SoReadError::post(in, "invalid node id %d", id);
+    return NULL;
+  }
+  return this->nodes[id];
+}
+
+// Reads a node id, and returns the node if it is a group.
+SoGroup *
+SoTranReceiverP::getGroup(SoInput * in)
+{
+  SoNode * node = this->getNode(in);
+  if (node == NULL) return NULL;
+  if (!node->isOfType(SoGroup::getClassTypeId())) {
+    SoReadError::post(in, "node is not a group");
+    return NULL;
+  }
+  return static_cast<SoGroup *>(node);
+}
+
+// Reads a full subgraph, and numbers its nodes the same way the
+// sender did.
+SoNode *
+SoTranReceiverP::readNode(SoInput * in)
+{
+  // SoDB::read() would probe for foreign file formats, so read
+  // exactly one object from the current position instead
+  SoBase * base = NULL;
+  if (!SoBase::read(in, base, SoNode::getClassTypeId()) || base == NULL) {
+    return NULL;
+  }
+  SoNode * node = static_cast<SoNode *>(base);
+
+  SbList<SoNode *> subgraph;
+  sotranscribe_collect_nodes(node, subgraph);
+  for (int i = 0; i < subgraph.getLength(); i++) {
+    subgraph[i]->ref();
+    this->nodes.append(subgraph[i]);
+  }
+  return node;
+}
+
+SbBool
+SoTranReceiverP::modify(SoInput * in)
+{
+  SoNode * node = this->getNode(in);
+  int numfields;
+  if (node == NULL || !in->read(numfields)) return FALSE;
+
+  for (int i = 0; i < numfields; i++) {
+    SbName name;
+    if (!in->read(name, TRUE)) return FALSE;
+    SoField * field = node->getField(name);
+    if (field == NULL) {
+      SoReadError::post(in, "unknown field \"%s\"", name.getString());
+      return FALSE;
+    }
+    if (!field->read(in, name)) return FALSE;
+  }
+  return TRUE;
+}
 
-SoTranReceiver::SoTranReceiver(SoGroup * COIN_UNUSED_ARG(root))
+// Releases all received nodes except the root.
+void
+SoTranReceiverP::clear(void)
 {
-  COIN_STUB();
+  for (int i = 1; i < this->nodes.getLength(); i++) this->nodes[i]->unref();
+  this->nodes.truncate(1);
 }
 
+// *************************************************************************
+
+/*!
+  Constructor. Received scene graphs will be added below \a root.
+*/
+SoTranReceiver::SoTranReceiver(SoGroup * root)
+{
+  this->pimpl = new SoTranReceiverP(root);
+  root->ref();
+  PRIVATE(this)->nodes.append(root);
+}
+
+/*!
+  Destructor.
+*/
 SoTranReceiver::~SoTranReceiver()
 {
-  COIN_STUB();
+  SoTranReceiverP * p = PRIVATE(this);
+  p->clear();
+  p->root->unref();
+  delete p;
 }
 
+/*!
+  Reads commands from \a input and applies them to the scene graph,
+  until the end of a batch of commands written by
+  SoTranSender::prepareToSend(). Returns \c FALSE if the input could
+  not be parsed, or ended before the end of the batch.
+*/
 SbBool
-SoTranReceiver::interpret(SoInput * COIN_UNUSED_ARG(in))
+SoTranReceiver::interpret(SoInput * input)
+{
+  SoTranReceiverP * p = PRIVATE(this);
+
+  // the header tells whether the stream is binary, and must be parsed
+  // before the first command can be read
+  if (!input->isValidFile()) {
+    SoReadError::post(input, "missing or invalid file header");
+    return FALSE;
+  }
+
+  for (;;) {
+    int cmd;
+    if (!input->read(cmd)) return FALSE;
+
+    switch (cmd) {
+    case SOTRANSCRIBE_END:
+      return TRUE;
+
+    case SOTRANSCRIBE_INSERT:
+    case SOTRANSCRIBE_INSERT_REF:
+    case SOTRANSCRIBE_REPLACE:
+    case SOTRANSCRIBE_REPLACE_REF:
+      {
+        SoGroup * parent = p->getGroup(input);
+        int idx;
+        if (parent == NULL || !input->read(idx)) return FALSE;
+        const SbBool isref =
+          (cmd == SOTRANSCRIBE_INSERT_REF) || (cmd == SOTRANSCRIBE_REPLACE_REF);
+        SoNode * node = isref ? p->getNode(input) : p->readNode(input);
+        if (node == NULL) return FALSE;
+
+        if (cmd == SOTRANSCRIBE_INSERT || cmd == SOTRANSCRIBE_INSERT_REF) {
+          if (idx < 0 || idx > parent->getNumChildren()) parent->addChild(node);
+          else parent->insertChild(node, idx);
+        }
+        else {
+          if (idx < 0 || idx >= parent->getNumChildren()) {
+            SoReadError::post(input, "invalid child index %d", idx);
+            return FALSE;
+          }
+          parent->replaceChild(idx, node);
+        }
+      }
+      break;
+
+    case SOTRANSCRIBE_REMOVE:
+      {
+        SoGroup * parent = p->getGroup(input);
+        int idx;
+        if (parent == NULL || !input->read(idx)) return FALSE;
+        if (idx < 0 || idx >= parent->getNumChildren()) {
+          SoReadError::post(input, "invalid child index %d", idx);
+          return FALSE;
+        }
+        parent->removeChild(idx);
+      }
+      break;
+
+    case SOTRANSCRIBE_MODIFY:
+      if (!p->modify(input)) return FALSE;
+      break;
+
+    case SOTRANSCRIBE_RESET:
+      p->root->removeAllChildren();
+      p->clear();
+      break;
+
+    default:
+      SoReadError::post(input, "unknown command %d", cmd);
+      return FALSE;
+    }
+  }
+}
+
+#undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <cstdlib>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/misc/SoTranSender.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+static void *
+test_transcribe_realloc(void * buf, size_t size)
+{
+  return realloc(buf, size);
+}
+
+// After a reset, both ends have released the nodes sent before, and
+// changes to them are no longer sent.
+BOOST_AUTO_TEST_CASE(transcribeReset)
 {
-  COIN_STUB();
-  return FALSE;
+  SoSeparator * scene = new SoSeparator;
+  scene->ref();
+  SoCube * cube = new SoCube;
+  scene->addChild(cube);
+  SoTranslation * trans = new SoTranslation;
+  trans->ref();
+
+  SoOutput out;
+  out.setBuffer(malloc(1024), 1024, test_transcribe_realloc);
+  SoTranSender * sender = new SoTranSender(&out);
+  sender->insert(scene);
+  sender->prepareToSend();
+  BOOST_CHECK(scene->getRefCount() > 1);
+
+  sender->reset();
+  BOOST_CHECK_EQUAL(scene->getRefCount(), 1);
+  BOOST_CHECK_EQUAL(cube->getRefCount(), 1);
+  cube->width = 5.0f;
+  sender->insert(trans);
+  sender->prepareToSend();
+  void * buf;
+  size_t size;
+  (void)out.getBuffer(buf, size);
+  delete sender;
+
+  SoInput in;
+  in.setBuffer(buf, size);
+  SoSeparator * mirror = new SoSeparator;
+  mirror->ref();
+  SoTranReceiver * receiver = new SoTranReceiver(mirror);
+  BOOST_REQUIRE(receiver->interpret(&in));
+  BOOST_REQUIRE_EQUAL(mirror->getNumChildren(), 1);
+  SoNode * mscene = mirror->getChild(0);
+  mscene->ref();
+  BOOST_REQUIRE(receiver->interpret(&in));
+  BOOST_REQUIRE_EQUAL(mirror->getNumChildren(), 1);
+  BOOST_CHECK(mirror->getChild(0)->isOfType(SoTranslation::getClassTypeId()));
+  // only our own reference is left
+  BOOST_CHECK_EQUAL(mscene->getRefCount(), 1);
+  BOOST_CHECK_EQUAL(static_cast<SoCube *>(static_cast<SoSeparator *>(mscene)->getChild(0))->width.getValue(), 2.0f);
+  mscene->unref();
+
+  delete receiver;
+  mirror->unref();
+  trans->unref();
+  scene->unref();
+  free(buf);
 }
+
+#endif // COIN_TEST_SUITE
@@ -30,61 +30,604 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 \**************************************************************************/
 
-// FIXME: this class has not been implemented yet. 20000627 mortene.
+/*!
+  \class SoTranSender SoTranSender.h Inventor/misc/SoTranSender.h
+  \brief The SoTranSender class is used for transmitting scene graph changes.
+
+  \ingroup coin_general
+
+  SoTranSender writes a compact description of changes made to a
+  scene graph to an SoOutput, for instance a memory buffer or a file
+  shared with another process. An SoTranReceiver reading the stream
+  applies the same changes to a mirrored scene graph, so scene graphs
+  can be replicated without resending them in full for every change.
+
+  Subgraphs are sent in full when they are inserted. The sender then
+  monitors the subgraphs inserted below the receiver's root, and
+  field changes in them are collected and sent as modifications of
+  only the changed fields on the next call to prepareToSend().
+  Structural changes (adding, removing or replacing children) are not
+  picked up automatically, and must be described with the insert(),
+  remove() and replace() methods.
+
+  \code
+  SoOutput out;
+  out.setBinary(TRUE);
+  out.setBuffer(buf, size, realloc);
+  SoTranSender sender(&out);
+
+  sender.insert(scene);
+  // ... change fields in scene, or insert(), remove() and replace()
+  // nodes to describe structural changes
+  sender.prepareToSend();
+  // ... transmit the buffer to the receiving process
+  \endcode
+
+  The sender keeps a reference to all nodes it has sent, so they can
+  be referred to in later commands. Use reset() to release them.
+
+  Each node is sent only once. A node which has been sent can be
+  inserted again by passing it directly to insert() or replace(),
+  which sends a reference to it, but not as part of a new subgraph.
+
+  \sa SoTranReceiver
+*/
+
+// *************************************************************************
 
 #include <Inventor/misc/SoTranSender.h>
-#include <coindefs.h> // COIN_STUB
-#include <cstdlib>
 
-SoTranSender::SoTranSender(SoOutput * COIN_UNUSED_ARG(output))
+#include <cassert>
+#include <cstdio>
+
+#include <Inventor/SoOutput.h>
+#include <Inventor/actions/SoWriteAction.h>
+#include <Inventor/errors/SoDebugError.h>
+#include <Inventor/fields/SoField.h>
+#include <Inventor/fields/SoFieldData.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/nodes/SoNode.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+
+#include "io/SoTranscribeP.h"
+#include "misc/SbHash.h"
+
+// *************************************************************************
+
+class SoTranSenderP {
+public:
+  SoTranSenderP(SoOutput * out) : output(out), nextid(1) { }
+  ~SoTranSenderP() { this->clear(); }
+
+  SoOutput * output;
+  // maps from sent nodes to their ids
+  SbHash<const SoBase *, int> nodeids;
+  SbList<SoNode *> sentnodes;
+  int nextid;
+  // one sensor for each subgraph inserted below the receiver's root.
+  // Nodes inserted further down are covered by the sensor of the
+  // subgraph they are inserted in.
+  SbList<SoNodeSensor *> sensors;
+
+  // nodes with field changes not yet sent, and the indices of the
+  // changed fields (-1 for all fields)
+  SbList<SoNode *> modifiednodes;
+  SbHash<const SoBase *, SbList<int> *> modifiedfields;
+
+  void writeInt(const int val);
+  void writeNode(SoNode * node);
+  int getId(SoNode * node);
+  SbBool canSend(SoNode * node, const char * funcname);
+  void addModified(SoNode * node, const int fieldidx);
+  void writeModified(SoNode * node, const SbList<int> & fields);
+  void clear(void);
+
+  static void sensorCB(void * closure, SoSensor * sensor);
+};
+
+#define PRIVATE(obj) (static_cast<SoTranSenderP *>((obj)->pimpl))
+
+// *************************************************************************
+
+void
+SoTranSenderP::writeInt(const int val)
+{
+  this->output->write(val);
+  if (!this->output->isBinary()) this->output->write(' ');
+}
+
+// Returns the id of a node sent earlier, or -1 if it hasn't been sent.
+int
+SoTranSenderP::getId(SoNode * node)
 {
-  COIN_STUB();
+  SbHash<const SoBase *, int>::const_iterator it = this->nodeids.find(node);
+  return (it != this->nodeids.const_end()) ? it->obj : -1;
 }
 
+// Returns TRUE if the subgraph rooted at node, which has not been
+// sent, can be written with writeNode(). A node which has already
+// been sent can only be referred to by its id, and would be mirrored
+// by a second node on the receiving side if it was written again as
+// part of a new subgraph.
+SbBool
+SoTranSenderP::canSend(SoNode * node, const char * funcname)
+{
+  SbList<SoNode *> nodes;
+  sotranscribe_collect_nodes(node, nodes);
+  for (int i = 0; i < nodes.getLength(); i++) {
+    if (this->getId(nodes[i]) >= 0) {
+      SoDebugError::postWarning(funcname,
+                                "subgraph contains a node which has "
+                                "already been sent");
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+// Writes a full subgraph, and numbers its nodes the same way the
+// receiver will. None of the nodes can have been sent before, see
+// canSend().
+void
+SoTranSenderP::writeNode(SoNode * node)
+{
+  SoWriteAction wa(this->output);
+  wa.apply(node);
+
+  SbList<SoNode *> nodes;
+  sotranscribe_collect_nodes(node, nodes);
+  for (int i = 0; i < nodes.getLength(); i++) {
+    SoNode * n = nodes[i];
+    assert(this->getId(n) < 0);
+    n->ref();
+    this->sentnodes.append(n);
+    this->nodeids[n] = this->nextid++;
+  }
+}
+
+// Releases all sent nodes, and stops monitoring them.
+void
+SoTranSenderP::clear(void)
+{
+  for (int i = 0; i < this->sensors.getLength(); i++) delete this->sensors[i];
+  this->sensors.truncate(0);
+  for (int i = 0; i < this->modifiednodes.getLength(); i++) {
+    delete this->modifiedfields[this->modifiednodes[i]];
+  }
+  this->modifiednodes.truncate(0);
+  this->modifiedfields.clear();
+  for (int i = 0; i < this->sentnodes.getLength(); i++) this->sentnodes[i]->unref();
+  this->sentnodes.truncate(0);
+  this->nodeids.clear();
+  this->nextid = 1;
+}
+
+void
+SoTranSenderP::addModified(SoNode * node, const int fieldidx)
+{
+  SbList<int> * fields;
+  SbHash<const SoBase *, SbList<int> *>::const_iterator it =
+    this->modifiedfields.find(node);
+  if (it == this->modifiedfields.const_end()) {
+    fields = new SbList<int>;
+    this->modifiedfields[node] = fields;
+    this->modifiednodes.append(node);
+  }
+  else {
+    fields = it->obj;
+  }
+  if (fields->getLength() == 1 && (*fields)[0] == -1) return;
+  if (fieldidx == -1) fields->truncate(0);
+  if (fields->find(fieldidx) < 0) fields->append(fieldidx);
+}
+
+void
+SoTranSenderP::writeModified(SoNode * node, const SbList<int> & fields)
+{
+  const SoFieldData * fd = node->getFieldData();
+  if (fd == NULL) return;
+
+  SbList<int> indices;
+  if (fields.getLength() == 1 && fields[0] == -1) {
+    for (int i = 0; i < fd->getNumFields(); i++) indices.append(i);
+  }
+  else {
+    indices = fields;
+  }
+
+  this->writeInt(SOTRANSCRIBE_MODIFY);
+  this->writeInt(this->getId(node));
+  this->writeInt(indices.getLength());
+  if (!this->output->isBinary()) this->output->write('\n');
+
+  for (int i = 0; i < indices.getLength(); i++) {
+    SoField * field = fd->getField(node, indices[i]);
+    const SbName & name = fd->getFieldName(indices[i]);
+
+    // default fields are written without a value, but the receiver
+    // needs one to match our state
+    const SbBool wasdefault = field->isDefault();
+    field->setDefault(FALSE);
+    this->output->setStage(SoOutput::COUNT_REFS);
+    field->write(this->output, name);
+    this->output->setStage(SoOutput::WRITE);
+    field->write(this->output, name);
+    field->setDefault(wasdefault);
+  }
+}
+
+// Collects field changes in the nodes we have sent.
+void
+SoTranSenderP::sensorCB(void * closure, SoSensor * sensor)
+{
+  SoTranSenderP * thisp = static_cast<SoTranSenderP *>(closure);
+  SoNodeSensor * ns = static_cast<SoNodeSensor *>(sensor);
+  SoNode * node = ns->getTriggerNode();
+  SoField * field = ns->getTriggerField();
+  // only field changes are tracked, changes to children lists must
+  // be sent explicitly
+  if (node == NULL || field == NULL || thisp->getId(node) < 0) return;
+
+  const SoFieldData * fd = node->getFieldData();
+  const int idx = fd ? fd->getIndex(node, field) : -1;
+  if (idx >= 0) thisp->addModified(node, idx);
+}
+
+// *************************************************************************
+
+/*!
+  Constructor. Commands will be written to \a output.
+*/
+SoTranSender::SoTranSender(SoOutput * output)
+{
+  this->pimpl = new SoTranSenderP(output);
+}
+
+/*!
+  Destructor.
+*/
 SoTranSender::~SoTranSender()
 {
-  COIN_STUB();
+  delete PRIVATE(this);
 }
 
+/*!
+  Returns the SoOutput instance commands are written to.
+*/
 SoOutput *
 SoTranSender::getOutput(void) const
 {
-  COIN_STUB();
-  return NULL;
+  return PRIVATE(this)->output;
 }
 
+/*!
+  Adds \a node as the last child of the receiver's root.
+
+  If \a node has been sent before, only a reference to it is
+  transmitted. Otherwise, none of the nodes below it can have been
+  sent before.
+*/
 void
-SoTranSender::insert(SoNode * COIN_UNUSED_ARG(node))
+SoTranSender::insert(SoNode * node)
 {
-  COIN_STUB();
+  SoTranSenderP * p = PRIVATE(this);
+  const int id = p->getId(node);
+  if (id < 0 && !p->canSend(node, "SoTranSender::insert")) return;
+  p->writeInt(id < 0 ? SOTRANSCRIBE_INSERT : SOTRANSCRIBE_INSERT_REF);
+  p->writeInt(0);
+  p->writeInt(-1);
+  if (id < 0) {
+    p->writeNode(node);
+    SoNodeSensor * sensor = new SoNodeSensor(SoTranSenderP::sensorCB, p);
+    sensor->setPriority(0);
+    sensor->attach(node);
+    p->sensors.append(sensor);
+  }
+  else {
+    p->writeInt(id);
+  }
+  if (!p->output->isBinary()) p->output->write('\n');
 }
 
+/*!
+  Inserts \a node as child number \a n of \a parent, which must be a
+  group node already sent to the receiver.
+
+  If \a node has been sent before, only a reference to it is
+  transmitted. Otherwise, none of the nodes below it can have been
+  sent before.
+
+  Field changes in \a node are picked up through the subgraph \a
+  parent belongs to, so \a node should be added to \a parent before
+  it is changed.
+*/
 void
-SoTranSender::insert(SoNode * COIN_UNUSED_ARG(node), SoNode * COIN_UNUSED_ARG(parent), int COIN_UNUSED_ARG(n))
+SoTranSender::insert(SoNode * node, SoNode * parent, int n)
 {
-  COIN_STUB();
+  SoTranSenderP * p = PRIVATE(this);
+  const int parentid = p->getId(parent);
+  if (parentid < 0) {
+    SoDebugError::postWarning("SoTranSender::insert",
+                              "parent node has not been sent");
+    return;
+  }
+  const int id = p->getId(node);
+  if (id < 0 && !p->canSend(node, "SoTranSender::insert")) return;
+  p->writeInt(id < 0 ? SOTRANSCRIBE_INSERT : SOTRANSCRIBE_INSERT_REF);
+  p->writeInt(parentid);
+  p->writeInt(n);
+  if (id < 0) p->writeNode(node);
+  else p->writeInt(id);
+  if (!p->output->isBinary()) p->output->write('\n');
 }
 
+/*!
+  Removes child number \a n from \a parent, which must be a group node
+  already sent to the receiver.
+*/
 void
-SoTranSender::remove(SoNode * COIN_UNUSED_ARG(parent), int COIN_UNUSED_ARG(n))
+SoTranSender::remove(SoNode * parent, int n)
 {
-  COIN_STUB();
+  SoTranSenderP * p = PRIVATE(this);
+  const int parentid = p->getId(parent);
+  if (parentid < 0) {
+    SoDebugError::postWarning("SoTranSender::remove",
+                              "parent node has not been sent");
+    return;
+  }
+  p->writeInt(SOTRANSCRIBE_REMOVE);
+  p->writeInt(parentid);
+  p->writeInt(n);
+  if (!p->output->isBinary()) p->output->write('\n');
 }
 
+/*!
+  Replaces child number \a n of \a parent, which must be a group node
+  already sent to the receiver, with \a newnode.
+
+  If \a newnode has been sent before, only a reference to it is
+  transmitted. Otherwise, none of the nodes below it can have been
+  sent before.
+*/
 void
-SoTranSender::replace(SoNode * COIN_UNUSED_ARG(parent), int COIN_UNUSED_ARG(n), SoNode * COIN_UNUSED_ARG(newnode))
+SoTranSender::replace(SoNode * parent, int n, SoNode * newnode)
 {
-  COIN_STUB();
+  SoTranSenderP * p = PRIVATE(this);
+  const int parentid = p->getId(parent);
+  if (parentid < 0) {
+    SoDebugError::postWarning("SoTranSender::replace",
+                              "parent node has not been sent");
+    return;
+  }
+  const int id = p->getId(newnode);
+  if (id < 0 && !p->canSend(newnode, "SoTranSender::replace")) return;
+  p->writeInt(id < 0 ? SOTRANSCRIBE_REPLACE : SOTRANSCRIBE_REPLACE_REF);
+  p->writeInt(parentid);
+  p->writeInt(n);
+  if (id < 0) p->writeNode(newnode);
+  else p->writeInt(id);
+  if (!p->output->isBinary()) p->output->write('\n');
 }
 
+/*!
+  Schedules all fields of \a node, which must have been sent before,
+  to be sent on the next call to prepareToSend(). Changes to fields of
+  sent nodes are detected automatically, so this is only necessary if
+  notification has been disabled for the node or its fields.
+*/
 void
-SoTranSender::modify(SoNode * COIN_UNUSED_ARG(node))
+SoTranSender::modify(SoNode * node)
 {
-  COIN_STUB();
+  SoTranSenderP * p = PRIVATE(this);
+  if (p->getId(node) < 0) {
+    SoDebugError::postWarning("SoTranSender::modify",
+                              "node has not been sent");
+    return;
+  }
+  p->addModified(node, -1);
 }
 
+/*!
+  Writes all pending field modifications, and ends the current batch
+  of commands. Call this before transmitting the contents of the
+  output to the receiver.
+*/
 void
 SoTranSender::prepareToSend(void)
 {
-  COIN_STUB();
+  SoTranSenderP * p = PRIVATE(this);
+  for (int i = 0; i < p->modifiednodes.getLength(); i++) {
+    SoNode * node = p->modifiednodes[i];
+    SbList<int> * fields = p->modifiedfields[node];
+    p->writeModified(node, *fields);
+    delete fields;
+  }
+  p->modifiednodes.truncate(0);
+  p->modifiedfields.clear();
+
+  p->writeInt(SOTRANSCRIBE_END);
+  if (!p->output->isBinary()) p->output->write('\n');
+  // make the batch available to a receiver reading the same file
+  FILE * fp = p->output->getFilePointer();
+  if (fp) (void)fflush(fp);
+}
+
+/*!
+  Tells the receiver to remove all children of its root, and releases
+  all nodes sent so far. Field changes not yet sent are discarded.
+  Use this to start over, for instance when the sender's scene graph
+  is replaced, since the sender otherwise keeps a reference to every
+  node it has sent.
+
+  \since Coin 4.1
+*/
+void
+SoTranSender::reset(void)
+{
+  SoTranSenderP * p = PRIVATE(this);
+  p->writeInt(SOTRANSCRIBE_RESET);
+  if (!p->output->isBinary()) p->output->write('\n');
+  p->clear();
+}
+
+#undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <cstdlib>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoOutput.h>
+#include <Inventor/misc/SoTranReceiver.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <Inventor/nodes/SoTranslation.h>
+
+static void *
+test_transcribe_realloc(void * buf, size_t size)
+{
+  return realloc(buf, size);
+}
+
+// The sender writes a continuous stream of batches to a memory
+// buffer, which the receiver then interprets one batch at a time.
+BOOST_AUTO_TEST_CASE(transcribeDeltas)
+{
+  for (int binary = 0; binary < 2; binary++) {
+    SoSeparator * scene = new SoSeparator;
+    scene->ref();
+    SoTranslation * trans = new SoTranslation;
+    scene->addChild(trans);
+    SoCube * cube = new SoCube;
+    scene->addChild(cube);
+
+    SoOutput out;
+    out.setBinary(binary ? TRUE : FALSE);
+    out.setBuffer(malloc(1024), 1024, test_transcribe_realloc);
+    void * buf;
+    size_t size[3];
+
+    SoTranSender * sender = new SoTranSender(&out);
+
+    // 1: the initial scene graph
+    sender->insert(scene);
+    sender->prepareToSend();
+    (void)out.getBuffer(buf, size[0]);
+
+    // 2: field changes, picked up through notification
+    trans->translation.setValue(1.0f, 2.0f, 3.0f);
+    cube->width = 5.0f;
+    sender->prepareToSend();
+    (void)out.getBuffer(buf, size[1]);
+
+    // 3: structural changes
+    SoCube * cube2 = new SoCube;
+    scene->insertChild(cube2, 0);
+    sender->insert(cube2, scene, 0);
+    scene->removeChild(2);
+    sender->remove(scene, 2);
+    sender->prepareToSend();
+    (void)out.getBuffer(buf, size[2]);
+
+    // 4: changes in inserted nodes are tracked as well
+    cube2->depth = 7.0f;
+    sender->prepareToSend();
+    delete sender;
+
+    // only the changed fields should be sent
+    BOOST_CHECK(size[1] - size[0] < size[0]);
+
+    size_t total;
+    (void)out.getBuffer(buf, total);
+    SoInput in;
+    in.setBuffer(buf, total);
+
+    SoSeparator * mirror = new SoSeparator;
+    mirror->ref();
+    SoTranReceiver * receiver = new SoTranReceiver(mirror);
+
+    BOOST_REQUIRE(receiver->interpret(&in));
+    BOOST_REQUIRE_EQUAL(mirror->getNumChildren(), 1);
+    SoSeparator * mscene = static_cast<SoSeparator *>(mirror->getChild(0));
+    BOOST_REQUIRE_EQUAL(mscene->getNumChildren(), 2);
+    SoTranslation * mtrans = static_cast<SoTranslation *>(mscene->getChild(0));
+    SoCube * mcube = static_cast<SoCube *>(mscene->getChild(1));
+    BOOST_CHECK(mtrans->translation.getValue() == SbVec3f(0.0f, 0.0f, 0.0f));
+
+    BOOST_REQUIRE(receiver->interpret(&in));
+    BOOST_CHECK(mtrans->translation.getValue() == SbVec3f(1.0f, 2.0f, 3.0f));
+    BOOST_CHECK_EQUAL(mcube->width.getValue(), 5.0f);
+    BOOST_CHECK_EQUAL(mcube->height.getValue(), 2.0f);
+
+    BOOST_REQUIRE(receiver->interpret(&in));
+    BOOST_REQUIRE_EQUAL(mscene->getNumChildren(), 2);
+    BOOST_CHECK(mscene->getChild(0)->isOfType(SoCube::getClassTypeId()));
+    BOOST_CHECK(mscene->getChild(1) == mtrans);
+
+    BOOST_REQUIRE(receiver->interpret(&in));
+    BOOST_CHECK_EQUAL(static_cast<SoCube *>(mscene->getChild(0))->depth.getValue(), 7.0f);
+
+    delete receiver;
+    mirror->unref();
+    scene->unref();
+    free(buf);
+  }
+}
+
+// A node which has been sent can't be sent again as part of a new
+// subgraph, since the receiver would mirror it with a second node.
+BOOST_AUTO_TEST_CASE(transcribeSentNodeInNewSubgraph)
+{
+  SoSeparator * scene = new SoSeparator;
+  scene->ref();
+  SoCube * cube = new SoCube;
+  scene->addChild(cube);
+  SoSeparator * group = new SoSeparator;
+  group->ref();
+  group->addChild(cube);
+
+  SoOutput out;
+  out.setBuffer(malloc(1024), 1024, test_transcribe_realloc);
+  SoTranSender * sender = new SoTranSender(&out);
+  sender->insert(scene);
+  sender->prepareToSend();
+  void * buf;
+  size_t size[2];
+  (void)out.getBuffer(buf, size[0]);
+
+  static const char * filters[] = { "already been sent", NULL };
+  TestSuite::PushMessageSuppressFilters(filters);
+  sender->insert(group, scene, -1);
+  sender->replace(scene, 0, group);
+  sender->insert(group);
+  TestSuite::PopMessageSuppressFilters();
+  (void)out.getBuffer(buf, size[1]);
+  BOOST_CHECK_EQUAL(size[0], size[1]);
+
+  // the node itself can still be inserted again
+  sender->insert(cube, scene, -1);
+  cube->width = 5.0f;
+  sender->prepareToSend();
+  delete sender;
+
+  size_t total;
+  (void)out.getBuffer(buf, total);
+  SoInput in;
+  in.setBuffer(buf, total);
+  SoSeparator * mirror = new SoSeparator;
+  mirror->ref();
+  SoTranReceiver * receiver = new SoTranReceiver(mirror);
+  BOOST_REQUIRE(receiver->interpret(&in));
+  BOOST_REQUIRE(receiver->interpret(&in));
+  SoSeparator * mscene = static_cast<SoSeparator *>(mirror->getChild(0));
+  BOOST_REQUIRE_EQUAL(mscene->getNumChildren(), 2);
+  BOOST_CHECK(mscene->getChild(0) == mscene->getChild(1));
+  BOOST_CHECK_EQUAL(static_cast<SoCube *>(mscene->getChild(0))->width.getValue(), 5.0f);
+
+  delete receiver;
+  mirror->unref();
+  group->unref();
+  scene->unref();
+  free(buf);
 }
+
+#endif // COIN_TEST_SUITE
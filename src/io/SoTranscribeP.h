@@ -0,0 +1,100 @@
+#ifndef COIN_SOTRANSCRIBEP_H
+#define COIN_SOTRANSCRIBEP_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* ! COIN_INTERNAL */
+
+// Shared by SoTranSender and SoTranReceiver, which implement a simple
+// protocol for mirroring changes to a scene graph.
+//
+// The stream is a sequence of commands, each written as an int32
+// command code followed by its arguments. Nodes are referenced by
+// integer ids, where id 0 is the receiver's root. Other ids are
+// never transmitted when nodes are sent: both ends number the nodes
+// of each transmitted subgraph by traversing it in the same depth
+// first order, see sotranscribe_collect_nodes().
+
+#include <Inventor/lists/SbList.h>
+#include <Inventor/misc/SoChildList.h>
+#include <Inventor/nodes/SoNode.h>
+
+#include "misc/SbHash.h"
+
+enum SoTranscribeCommand {
+  // ends a batch of commands, written by SoTranSender::prepareToSend()
+  SOTRANSCRIBE_END = 0,
+  // <parentid> <index> <node>, index -1 means append
+  SOTRANSCRIBE_INSERT,
+  // <parentid> <index> <nodeid>, for nodes already sent
+  SOTRANSCRIBE_INSERT_REF,
+  // <parentid> <index>
+  SOTRANSCRIBE_REMOVE,
+  // <parentid> <index> <node>
+  SOTRANSCRIBE_REPLACE,
+  // <parentid> <index> <nodeid>, for nodes already sent
+  SOTRANSCRIBE_REPLACE_REF,
+  // <nodeid> <numfields> followed by the fields, as written in files
+  SOTRANSCRIBE_MODIFY,
+  // removes all children of the receiver's root, and forgets all ids
+  SOTRANSCRIBE_RESET
+};
+
+// Appends all nodes in the subgraph rooted at \a node to \a list, in
+// depth first order, each node only once.
+inline void
+sotranscribe_collect_nodes(SoNode * node, SbList<SoNode *> & list,
+                           SbHash<const SoBase *, void *> & visited)
+{
+  if (visited.find(node) != visited.const_end()) return;
+  visited[node] = NULL;
+  list.append(node);
+
+  const SoChildList * children = node->getChildren();
+  if (children) {
+    for (int i = 0; i < children->getLength(); i++) {
+      sotranscribe_collect_nodes((*children)[i], list, visited);
+    }
+  }
+}
+
+inline void
+sotranscribe_collect_nodes(SoNode * node, SbList<SoNode *> & list)
+{
+  SbHash<const SoBase *, void *> visited;
+  sotranscribe_collect_nodes(node, list, visited);
+}
+
+#endif // !COIN_SOTRANSCRIBEP_H
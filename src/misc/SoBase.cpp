@@ -83,6 +83,7 @@
 #include <Inventor/misc/SoProto.h>
 #include <Inventor/misc/SoProtoInstance.h>
 #include <Inventor/sensors/SoDataSensor.h>
+#include <Inventor/sensors/SoIdleSensor.h>
 
 #include "misc/SoBaseP.h"
 #include "nodes/SoUnknownNode.h"
@@ -205,6 +206,7 @@ SoBase::SoBase(void)
   cc_rbptree_init(&this->auditortree);
 
   this->objdata.referencecount = 0;
+  this->objdata.deferred = 0;
 
   // For debugging -- we try to catch dangling references after
   // premature destruction. See the SoBase::assertAlive() method for
@@ -249,6 +251,8 @@ SoBase::~SoBase()
   }
   cc_rbptree_clean(&this->auditortree);
 
+  if (this->objdata.deferred) SoBase::PImpl::undefer(this);
+
 #if COIN_DEBUG
   if (SoBase::PImpl::trackbaseobjects) {
     CC_MUTEX_LOCK(SoBase::PImpl::allbaseobj_mutex);
@@ -557,7 +561,12 @@ SoBase::unref(void) const
 #endif // COIN_DEBUG
   if (refcount == 0) {
     SoBase * base = const_cast<SoBase *>(this);
-    base->destroy();
+    if (SoBase::PImpl::deferdestruction) {
+      SoBase::PImpl::deferDestruction(base);
+    }
+    else {
+      base->destroy();
+    }
   }
 }
 
@@ -1184,6 +1193,80 @@ SoBase::getTraceRefs(void)
   return SoBase::PImpl::tracerefs;
 }
 
+/*!
+  Enable or disable deferred destruction.
+
+  By default, an object is destroyed as soon as its reference count
+  reaches zero in unref(). Releasing the root of a very large scene
+  graph will then run all destructors, cache deletions and name
+  bookkeeping of the whole graph synchronously, which can freeze an
+  interactive application for a noticeable amount of time.
+
+  With deferred destruction enabled, objects reaching a zero reference
+  count are instead put in a queue, and destroyed in time-limited
+  batches from an SoIdleSensor. Since children are only released when
+  their parent is destroyed, a large graph is torn down over several
+  idle periods. OpenGL resources are released the usual way, through
+  SoGLCacheContextElement::scheduleDeleteCallback() on the context
+  owning them.
+
+  Note that sensors attached to a queued object will not get their
+  delete callbacks invoked until the object is actually destroyed.
+  An object which is ref'ed again before the idle sensor gets to it
+  is not destroyed. Queued objects lose their names at once, so they
+  can't be found with getNamedBase() or SoNode::getByName().
+
+  Disabling deferred destruction destroys all queued objects
+  immediately.
+
+  \sa flushDeferredDestruction()
+  \since Coin 4.1
+*/
+void
+SoBase::enableDeferredDestruction(const SbBool on)
+{
+  if (on && SoBase::PImpl::deferredlist == NULL) {
+    SoBase::PImpl::deferredlist = new SbList<SoBase *>;
+    SoBase::PImpl::deferredsensor =
+      new SoIdleSensor(SoBase::PImpl::deferred_destruction_cb, NULL);
+    coin_atexit((coin_atexit_f *)SoBase::PImpl::cleanup_deferred,
+                CC_ATEXIT_DEFERRED_DESTRUCTION);
+  }
+  SoBase::PImpl::deferdestruction = on;
+  if (!on) (void) SoBase::flushDeferredDestruction();
+}
+
+/*!
+  Returns \c TRUE if deferred destruction is enabled.
+
+  \sa enableDeferredDestruction()
+  \since Coin 4.1
+*/
+SbBool
+SoBase::isDeferredDestructionEnabled(void)
+{
+  return SoBase::PImpl::deferdestruction;
+}
+
+/*!
+  Immediately destroys all objects queued for deferred destruction,
+  including the children released by destroying them. Returns the
+  number of objects destroyed.
+
+  \sa enableDeferredDestruction()
+  \since Coin 4.1
+*/
+int
+SoBase::flushDeferredDestruction(void)
+{
+  const int num = SoBase::PImpl::destroyDeferred(-1.0);
+  if (SoBase::PImpl::deferredsensor &&
+      SoBase::PImpl::deferredsensor->isScheduled()) {
+    SoBase::PImpl::deferredsensor->unschedule();
+  }
+  return num;
+}
+
 /*!
   Returns \c TRUE if this object will be written more than once upon
   export. Note that the result from this method is only valid during the
@@ -1234,7 +1317,7 @@ SoBase::writeHeader(SoOutput * out, SbBool isgroup, SbBool isengine) const
 
   // Write the node
   if (!firstwrite) {
-    out->write(PImpl::USE_KEYWORD);
+    out->writeIdentifier(PImpl::USE_KEYWORD);
     if (!out->isBinary()) out->write(' ');
     out->write(writename.getString());
 
@@ -1247,7 +1330,7 @@ SoBase::writeHeader(SoOutput * out, SbBool isgroup, SbBool isengine) const
   }
   else {
     if (name != SbName::empty() || multiref) {
-      out->write(PImpl::DEF_KEYWORD);
+      out->writeIdentifier(PImpl::DEF_KEYWORD);
       if (!out->isBinary()) out->write(' ');
 
       out->write(writename.getString());
@@ -1284,7 +1367,7 @@ SoBase::writeHeader(SoOutput * out, SbBool isgroup, SbBool isengine) const
       }
     }
     else {
-      out->write(this->getFileFormatName());
+      out->writeIdentifier(this->getFileFormatName());
     }
     if (out->isBinary()) {
       unsigned int flags = 0x0;
@@ -1837,6 +1920,55 @@ DEF root Separator {
 	   newroot->unref();
  }
 
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+
+static void
+deferred_dying_cb(void * closure, SoSensor *)
+{
+  *((SbBool *)closure) = TRUE;
+}
+
+BOOST_AUTO_TEST_CASE(deferredDestruction)
+{
+  SoBase::enableDeferredDestruction(TRUE);
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoCube * cube = new SoCube;
+  root->addChild(cube);
+
+  SbBool rootdied = FALSE, cubedied = FALSE;
+  SoNodeSensor rootsensor, cubesensor;
+  rootsensor.setDeleteCallback(deferred_dying_cb, &rootdied);
+  rootsensor.attach(root);
+  cubesensor.setDeleteCallback(deferred_dying_cb, &cubedied);
+  cubesensor.attach(cube);
+
+  root->setName("deferredDestructionRoot");
+  root->unref();
+  BOOST_CHECK_MESSAGE(!rootdied && !cubedied,
+                      "objects destroyed before deferred destruction was processed");
+  BOOST_CHECK_MESSAGE(SoNode::getByName("deferredDestructionRoot") == NULL,
+                      "queued object can still be found by name");
+
+  // the cube is released when the separator is destroyed, and must
+  // also be destroyed by the flush
+  BOOST_CHECK_EQUAL(SoBase::flushDeferredDestruction(), 2);
+  BOOST_CHECK_MESSAGE(rootdied && cubedied, "deferred objects not destroyed");
+
+  // objects ref'ed again while queued must survive
+  SoCube * survivor = new SoCube;
+  survivor->ref();
+  survivor->unref();
+  survivor->ref();
+  BOOST_CHECK_EQUAL(SoBase::flushDeferredDestruction(), 0);
+  BOOST_CHECK_EQUAL(survivor->getRefCount(), 1);
+
+  SoBase::enableDeferredDestruction(FALSE);
+  survivor->unref();
+}
+
 #endif // COIN_TEST_SUITE
 
 /* *********************************************************************** */
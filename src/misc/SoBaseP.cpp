@@ -35,6 +35,7 @@
 
 #include <Inventor/SbName.h>
 #include <Inventor/SbString.h>
+#include <Inventor/SbTime.h>
 #include <Inventor/SoInput.h>
 #include <Inventor/errors/SoReadError.h>
 #include <Inventor/lists/SbPList.h>
@@ -44,6 +45,7 @@
 #include <Inventor/misc/SoProtoInstance.h>
 #include <Inventor/SoDB.h>
 #include <Inventor/fields/SoField.h>
+#include <Inventor/sensors/SoIdleSensor.h>
 
 #include "threads/threadsutilp.h"
 #include "upgraders/SoUpgrader.h"
@@ -90,6 +92,15 @@ SbBool SoBase::PImpl::trackbaseobjects = FALSE;
 void * SoBase::PImpl::allbaseobj_mutex = NULL;
 SoBaseSet * SoBase::PImpl::allbaseobj = NULL; // maps from SoBase * to NULL
 
+// Objects which reached a zero reference count while deferred
+// destruction was enabled, waiting to be destroyed from the idle
+// sensor. The deferred flag of the objects guards against queueing an
+// object twice if it is ref'ed and unref'ed again before it is
+// destroyed.
+SbBool SoBase::PImpl::deferdestruction = FALSE;
+SbList<SoBase *> * SoBase::PImpl::deferredlist = NULL;
+SoIdleSensor * SoBase::PImpl::deferredsensor = NULL;
+
 SbString * SoBase::PImpl::refwriteprefix = NULL;
 
 SbBool SoBase::PImpl::tracerefs = FALSE;
@@ -97,6 +108,113 @@ uint32_t SoBase::PImpl::writecounter = 0;
 
 // *************************************************************************
 
+// Queue an object with a zero reference count for destruction from
+// the idle sensor. The object's name is removed right away, so that
+// it can't be found with getByName() and revived while it is waiting
+// to be destroyed.
+void
+SoBase::PImpl::deferDestruction(SoBase * base)
+{
+  CC_MUTEX_LOCK(SoBase::PImpl::mutex);
+  const SbBool queue = !base->objdata.deferred;
+  if (queue) {
+    base->objdata.deferred = 1;
+    SoBase::PImpl::deferredlist->append(base);
+  }
+  CC_MUTEX_UNLOCK(SoBase::PImpl::mutex);
+
+  if (queue) {
+    const SbName name = base->getName();
+    if (name != SbName::empty()) {
+      SoBase::PImpl::removeName2Obj(base, name.getString());
+      SoBase::PImpl::removeObj2Name(base, name.getString());
+    }
+  }
+
+  if (!SoBase::PImpl::deferredsensor->isScheduled()) {
+    SoBase::PImpl::deferredsensor->schedule();
+  }
+}
+
+// Remove an object from the deferred destruction queue. Called from
+// the SoBase destructor in the rare case that a queued object was
+// ref'ed again and then deleted by other means.
+void
+SoBase::PImpl::undefer(SoBase * base)
+{
+  CC_MUTEX_LOCK(SoBase::PImpl::mutex);
+  const int idx = SoBase::PImpl::deferredlist->find(base);
+  assert(idx >= 0);
+  SoBase::PImpl::deferredlist->remove(idx);
+  base->objdata.deferred = 0;
+  CC_MUTEX_UNLOCK(SoBase::PImpl::mutex);
+}
+
+// Destroy queued objects until the queue is empty or until \a maxtime
+// seconds have passed. A negative \a maxtime means no time limit.
+// Returns the number of objects destroyed.
+//
+// Destroying a group unrefs its children, which are then queued in
+// turn, so a large scene graph is torn down a few objects at a time
+// instead of recursively in one go.
+int
+SoBase::PImpl::destroyDeferred(double maxtime)
+{
+  if (SoBase::PImpl::deferredlist == NULL) return 0;
+
+  const SbTime start = SbTime::getTimeOfDay();
+  int num = 0;
+  for (;;) {
+    CC_MUTEX_LOCK(SoBase::PImpl::mutex);
+    if (SoBase::PImpl::deferredlist->getLength() == 0) {
+      CC_MUTEX_UNLOCK(SoBase::PImpl::mutex);
+      break;
+    }
+    SoBase * base = SoBase::PImpl::deferredlist->pop();
+    base->objdata.deferred = 0;
+    // the object may have been ref'ed again after it was queued
+    const SbBool dead = base->objdata.referencecount == 0;
+    CC_MUTEX_UNLOCK(SoBase::PImpl::mutex);
+
+    if (dead) {
+      base->destroy();
+      num++;
+      // checking the clock is not free, so only do it now and then
+      if (maxtime >= 0.0 && (num & 0x3f) == 0 &&
+          (SbTime::getTimeOfDay() - start).getValue() > maxtime) {
+        break;
+      }
+    }
+  }
+  return num;
+}
+
+// Idle sensor callback destroying queued objects in time-limited
+// batches, to keep the application responsive while a large scene
+// graph is released.
+void
+SoBase::PImpl::deferred_destruction_cb(void * COIN_UNUSED_ARG(closure), SoSensor * COIN_UNUSED_ARG(sensor))
+{
+  (void) SoBase::PImpl::destroyDeferred(1.0 / 100.0);
+  if (SoBase::PImpl::deferredlist->getLength() > 0) {
+    SoBase::PImpl::deferredsensor->schedule();
+  }
+}
+
+void
+SoBase::PImpl::cleanup_deferred(void)
+{
+  SoBase::PImpl::deferdestruction = FALSE;
+  (void) SoBase::PImpl::destroyDeferred(-1.0);
+
+  delete SoBase::PImpl::deferredsensor;
+  SoBase::PImpl::deferredsensor = NULL;
+  delete SoBase::PImpl::deferredlist;
+  SoBase::PImpl::deferredlist = NULL;
+}
+
+// *************************************************************************
+
 // Create a new SoNode-derived instance from the input stream.
 SoNode *
 SoBase::PImpl::readNode(SoInput * in)
@@ -33,9 +33,13 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 \**************************************************************************/
 
+#include <Inventor/lists/SbList.h>
+
 #include "misc/SbHash.h"
 
 class SoBase;
+class SoSensor;
+class SoIdleSensor;
 class SoNode;
 class SoAuditorList;
 class SbPList;
@@ -76,12 +80,22 @@ public:
   static void * allbaseobj_mutex;
   static SoBaseSet * allbaseobj; // maps from SoBase * to NULL
 
+  static SbBool deferdestruction;
+  static SbList<SoBase *> * deferredlist;
+  static SoIdleSensor * deferredsensor;
+
   static SbString * refwriteprefix;
   static SbBool tracerefs;
   static uint32_t writecounter;
 
   static void cleanup_auditordict(void);
 
+  static void deferDestruction(SoBase * base);
+  static void undefer(SoBase * base);
+  static int destroyDeferred(double maxtime);
+  static void deferred_destruction_cb(void * closure, SoSensor * sensor);
+  static void cleanup_deferred(void);
+
   static void removeName2Obj(SoBase * const base, const char * const name);
   static void removeObj2Name(SoBase * const base, const char * const name);
 
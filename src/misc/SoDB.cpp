@@ -112,12 +112,14 @@
 #include "shaders/SoShader.h"
 #include "tidbitsp.h"
 #include "fields/SoGlobalField.h"
+#include "io/SoInputP.h"
 #include "misc/CoinStaticObjectInDLL.h"
 #include "misc/systemsanity.icc"
 #include "misc/SoDBP.h"
 #include "misc/SbHash.h"
 #include "misc/SoConfigSettings.h"
 #include "rendering/SoVBO.h"
+#include "threads/threadsutilp.h"
 
 #ifdef HAVE_VRML97
 #include <Inventor/VRMLnodes/SoVRML.h>
@@ -247,6 +249,7 @@ SoDB::init(void)
   SoDBP::sensormanager = new SoSensorManager;
   SoDBP::converters = new UInt32ToInt16Map;
   // FIXME: these are never cleaned up
+  CC_MUTEX_CONSTRUCT(SoDBP::realtimeanimatormutex);
 
   // NB! There are dependencies in the order of initialization of
   // components below.
@@ -359,6 +362,10 @@ SoDB::init(void)
                        NULL, NULL, NULL);
   SoDB::registerHeader(SbString("#Inventor V2.1 binary  "), TRUE, 2.1f,
                        NULL, NULL, NULL);
+  // Inventor V2.1 binary, with identifiers written through a name
+  // table. See SoOutput::setBinaryNameTable().
+  SoDB::registerHeader(SbString(SoInputP::getNameTableHeader()), TRUE, 2.1f,
+                       NULL, NULL, NULL);
 
   // FIXME: this is really only valid if the HAVE_VRML97 define is in
   // place. If it is not, we should register the header in a way so
@@ -1089,18 +1096,8 @@ SoDB::doSelect(int COIN_UNUSED_ARG(nfds), void * COIN_UNUSED_ARG(readfds), void
 void
 SoDB::addConverter(SoType from, SoType to, SoType converter)
 {
-  const uint32_t linkid = (((uint32_t)from.getKey()) << 16) + to.getKey();
-  SbBool nonexist = SoDBP::converters->put(linkid, converter.getKey());
-  if (!nonexist) {
-#if COIN_DEBUG
-    SoDebugError::postWarning("SoDB::addConverter",
-                              "Conversion from ``%s'' to ``%s'' is already "
-                              "handled by instances of ``%s''",
-                              from.getName().getString(),
-                              to.getName().getString(),
-                              converter.getName().getString());
-#endif // COIN_DEBUG
-  }
+  SoDBP::registerBuiltinConverters();
+  SoDBP::addConverter(from, to, converter);
 }
 
 /*!
@@ -1116,6 +1113,8 @@ SoDB::addConverter(SoType from, SoType to, SoType converter)
 SoType
 SoDB::getConverter(SoType from, SoType to)
 {
+  SoDBP::registerBuiltinConverters();
+
   uint32_t val = (((uint32_t)from.getKey()) << 16) + to.getKey();
   int16_t key;
   if (!SoDBP::converters->get(val, key)) { return SoType::badType(); }
@@ -1692,13 +1691,22 @@ SoDB::removeRoute(SoNode * fromnode, const char * eventout,
 #include <Inventor/SoInput.h>
 #include <Inventor/SoInteraction.h>
 #include <Inventor/errors/SoReadError.h>
+#include <Inventor/fields/SoMFFloat.h>
 #include <Inventor/fields/SoMFNode.h>
+#include <Inventor/fields/SoSFFloat.h>
+#include <Inventor/fields/SoSFNode.h>
+#include <Inventor/fields/SoSFString.h>
 #include <Inventor/fields/SoSFTime.h>
+#include <Inventor/fields/SoSFTrigger.h>
+#include <Inventor/engines/SoElapsedTime.h>
 #include <Inventor/nodekits/SoNodeKit.h>
 #include <Inventor/nodes/SoGroup.h>
 #include <Inventor/nodes/SoNode.h>
 #include <Inventor/nodes/SoSeparator.h>
 #include <Inventor/nodes/SoRotationXYZ.h>
+#include <Inventor/nodes/SoRotor.h>
+#include <Inventor/sensors/SoNodeSensor.h>
+#include <Inventor/sensors/SoSensorManager.h>
 #include <boost/detail/workaround.hpp>
 
 BOOST_AUTO_TEST_CASE(globalRealTimeField)
@@ -1898,4 +1906,97 @@ BOOST_AUTO_TEST_CASE(globalfield_import)
 
 // *************************************************************************
 
+static void
+count_triggers_cb(void * closure, SoSensor *)
+{
+  (*((int *)closure))++;
+}
+
+// Processes the timer queue until the realTime timer has triggered.
+// The tests set an interval so short that it is due right away.
+static void
+tick_realtime(void)
+{
+  SoSFTime * realtime = static_cast<SoSFTime *>(SoDB::getGlobalField("realTime"));
+  const SbTime before = realtime->getValue();
+  while (realtime->getValue() == before) {
+    SoDB::getSensorManager()->processTimerQueue();
+  }
+}
+
+// Tests that a realTime tick updates all realtime animated nodes and
+// engines in one batch, triggering sensors above them only once.
+BOOST_AUTO_TEST_CASE(batchedRealTimeAnimation)
+{
+  const SbTime oldinterval = SoDB::getRealTimeInterval();
+  SoDB::setRealTimeInterval(SbTime(0.000001));
+  // other tests may have set realTime to some old value, which the
+  // engines would start counting from
+  tick_realtime();
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  for (int i = 0; i < 5; i++) {
+    SoSeparator * sep = new SoSeparator;
+    sep->addChild(new SoRotor);
+    root->addChild(sep);
+  }
+  // removing animators in the middle of the list moves others around
+  root->removeChild(3);
+  root->removeChild(1);
+
+  SoElapsedTime * elapsed = new SoElapsedTime;
+  SoRotationXYZ * rotation = new SoRotationXYZ;
+  rotation->angle.connectFrom(&elapsed->timeOut);
+  root->addChild(rotation);
+
+  SoElapsedTime * stopped = new SoElapsedTime;
+  stopped->on = FALSE;
+  SoRotationXYZ * stoppedrotation = new SoRotationXYZ;
+  stoppedrotation->angle.connectFrom(&stopped->timeOut);
+  root->addChild(stoppedrotation);
+
+  // first tick just initializes the rotors' start time
+  tick_realtime();
+  const float angle = rotation->angle.getValue();
+  const float stoppedangle = stoppedrotation->angle.getValue();
+
+  int triggers = 0;
+  SoNodeSensor * sensor = new SoNodeSensor(count_triggers_cb, &triggers);
+  sensor->setPriority(0);
+  sensor->attach(root);
+
+  tick_realtime();
+  BOOST_CHECK_MESSAGE(triggers == 1,
+                      "realTime update should notify the root once");
+  BOOST_CHECK_MESSAGE(rotation->angle.getValue() > angle,
+                      "running engine should get the realTime tick");
+  BOOST_CHECK_EQUAL(stoppedrotation->angle.getValue(), stoppedangle);
+
+  delete sensor;
+  root->unref();
+  SoDB::setRealTimeInterval(oldinterval);
+}
+
+// *************************************************************************
+
+// The built-in field converters are registered on first use, and
+// must be in place for both lookups and connections.
+BOOST_AUTO_TEST_CASE(builtinConverters)
+{
+  BOOST_CHECK(SoDB::getConverter(SoSFFloat::getClassTypeId(),
+                                 SoMFFloat::getClassTypeId()) != SoType::badType());
+  BOOST_CHECK(SoDB::getConverter(SoSFTrigger::getClassTypeId(),
+                                 SoSFFloat::getClassTypeId()) != SoType::badType());
+  BOOST_CHECK(SoDB::getConverter(SoSFFloat::getClassTypeId(),
+                                 SoSFNode::getClassTypeId()) == SoType::badType());
+
+  SoSFFloat from;
+  SoSFString to;
+  from.setValue(2.5f);
+  BOOST_REQUIRE(to.connectFrom(&from));
+  BOOST_CHECK(to.getValue() == "2.5");
+  to.disconnect();
+}
+
 #endif // COIN_TEST_SUITE
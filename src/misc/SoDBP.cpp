@@ -4,6 +4,7 @@
 #include <Inventor/SoInput.h>
 #include <Inventor/fields/SoField.h>
 #include <Inventor/fields/SoSFTime.h>
+#include <Inventor/misc/SoNotification.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/sensors/SoTimerSensor.h>
 
@@ -16,6 +17,8 @@
 #endif // HAVE_3DS_IMPORT_CAPABILITIES
 
 #include "fields/SoGlobalField.h"
+#include "engines/SoConvertAll.h"
+#include "threads/threadsutilp.h"
 #include "coindefs.h"
 
 #ifdef COIN_THREADSAFE
@@ -28,9 +31,16 @@ SbList<SoDB_HeaderInfo *> * SoDBP::headerlist = NULL;
 SoSensorManager * SoDBP::sensormanager = NULL;
 SoTimerSensor * SoDBP::globaltimersensor = NULL;
 UInt32ToInt16Map * SoDBP::converters = NULL;
+SbBool SoDBP::builtinconverters = FALSE;
 SbBool SoDBP::isinitialized = FALSE;
 int SoDBP::notificationcounter = 0;
 SbList<SoDBP::ProgressCallbackInfo> * SoDBP::progresscblist = NULL;
+SbList<SoDBP::RealTimeAnimatorInfo> * SoDBP::realtimeanimators = NULL;
+SbHash<const SoBase *, int> * SoDBP::realtimeanimatorindex = NULL;
+void * SoDBP::realtimeanimatormutex = NULL;
+SbBool SoDBP::realtimeupdating = FALSE;
+SbBool SoDBP::realtimeiterating = FALSE;
+SbBool SoDBP::realtimedelivering = FALSE;
 
 // *************************************************************************
 // FIXME: this should be moved into a function in tidsbits.c. 20050509 mortene.
@@ -109,6 +119,11 @@ SoDBP::clean(void)
 {
   delete SoDBP::progresscblist;
   SoDBP::progresscblist = NULL;
+  delete SoDBP::realtimeanimators;
+  SoDBP::realtimeanimators = NULL;
+  delete SoDBP::realtimeanimatorindex;
+  SoDBP::realtimeanimatorindex = NULL;
+  CC_MUTEX_DESTRUCT(SoDBP::realtimeanimatormutex);
 
   // Avoid having the SoSensorManager instance trigging the callback
   // into the So@Gui@ class -- not only have it possible "died", but
@@ -124,6 +139,7 @@ SoDBP::clean(void)
   SoDBP::globaltimersensor = NULL;
   delete SoDBP::converters;
   SoDBP::converters = NULL;
+  SoDBP::builtinconverters = FALSE;
 
   delete SoDBP::sensormanager;
   SoDBP::sensormanager = NULL;
@@ -157,15 +173,152 @@ SoDBP::removeRealTimeFieldCB(void)
 
 // This is the timer sensor callback which updates the realTime global
 // field.
+//
+// The field and all registered realtime animators are updated as one
+// batch: every change is propagated with a copy of the same
+// notification list, so nodes reachable from several animated nodes
+// (typically the scene graph root) are only notified once per tick,
+// and immediate sensors (like the redraw sensor of a scene manager)
+// are processed once when the outermost endNotify() is reached.
 void
 SoDBP::updateRealTimeFieldCB(void * COIN_UNUSED_ARG(data), SoSensor * COIN_UNUSED_ARG(sensor))
 {
   SoField * f = SoDB::getGlobalField("realTime");
   if (f && (f->getTypeId() == SoSFTime::getClassTypeId())) {
+    SoDB::startNotify();
+    SoDBP::realtimeupdating = TRUE;
+
+    SoNotList list;
+    const SbBool oldnotify = f->enableNotify(FALSE);
     ((SoSFTime *)f)->setValue(SbTime::getTimeOfDay());
+    (void) f->enableNotify(oldnotify);
+    if (oldnotify) {
+      SoNotList fieldlist(&list);
+      f->notify(&fieldlist);
+    }
+
+    // Animators may be added or removed while we're iterating (a node
+    // can die from a notification). Removed entries are only cleared
+    // during the loop, and the list is compacted afterwards.
+    SoDBP::realtimeiterating = TRUE;
+    for (int i = 0; ; i++) {
+      CC_MUTEX_LOCK(SoDBP::realtimeanimatormutex);
+      const SbBool done = (SoDBP::realtimeanimators == NULL) ||
+        (i >= SoDBP::realtimeanimators->getLength());
+      RealTimeAnimatorInfo info;
+      if (!done) info = (*SoDBP::realtimeanimators)[i];
+      CC_MUTEX_UNLOCK(SoDBP::realtimeanimatormutex);
+      if (done) break;
+      if (info.func) info.func(info.animator, &list);
+    }
+
+    CC_MUTEX_LOCK(SoDBP::realtimeanimatormutex);
+    SoDBP::realtimeiterating = FALSE;
+    if (SoDBP::realtimeanimators) {
+      int n = 0;
+      for (int i = 0; i < SoDBP::realtimeanimators->getLength(); i++) {
+        const RealTimeAnimatorInfo info = (*SoDBP::realtimeanimators)[i];
+        if (info.func == NULL) continue;
+        if (n != i) {
+          (*SoDBP::realtimeanimators)[n] = info;
+          SoDBP::realtimeanimatorindex->put(info.animator, n);
+        }
+        n++;
+      }
+      SoDBP::realtimeanimators->truncate(n);
+    }
+    CC_MUTEX_UNLOCK(SoDBP::realtimeanimatormutex);
+
+    SoDB::endNotify();
+    SoDBP::realtimeupdating = FALSE;
   }
 }
 
+void
+SoDBP::addRealTimeAnimator(RealTimeAnimatorCB * func, SoBase * animator)
+{
+  CC_MUTEX_LOCK(SoDBP::realtimeanimatormutex);
+  if (SoDBP::realtimeanimators == NULL) {
+    SoDBP::realtimeanimators = new SbList<RealTimeAnimatorInfo>;
+    SoDBP::realtimeanimatorindex = new SbHash<const SoBase *, int>;
+  }
+  RealTimeAnimatorInfo info;
+  info.func = func;
+  info.animator = animator;
+  SoDBP::realtimeanimatorindex->put(animator, SoDBP::realtimeanimators->getLength());
+  SoDBP::realtimeanimators->append(info);
+  CC_MUTEX_UNLOCK(SoDBP::realtimeanimatormutex);
+}
+
+void
+SoDBP::removeRealTimeAnimator(SoBase * animator)
+{
+  CC_MUTEX_LOCK(SoDBP::realtimeanimatormutex);
+  int idx;
+  if (SoDBP::realtimeanimatorindex &&
+      SoDBP::realtimeanimatorindex->get(animator, idx)) {
+    SoDBP::realtimeanimatorindex->erase(animator);
+    SbList<RealTimeAnimatorInfo> & animators = *SoDBP::realtimeanimators;
+    if (SoDBP::realtimeiterating) {
+      // keep the positions of the others stable for the update loop
+      animators[idx].func = NULL;
+      animators[idx].animator = NULL;
+    }
+    else {
+      // move the last animator into the free slot
+      const int last = animators.getLength() - 1;
+      if (idx != last) {
+        animators[idx] = animators[last];
+        SoDBP::realtimeanimatorindex->put(animators[idx].animator, idx);
+      }
+      animators.truncate(last);
+    }
+  }
+  CC_MUTEX_UNLOCK(SoDBP::realtimeanimatormutex);
+}
+
+// Returns TRUE while updateRealTimeFieldCB() is propagating a new
+// realTime value, including the immediate sensors processed at the
+// end of that notification.
+SbBool
+SoDBP::isUpdatingRealTime(void)
+{
+  return SoDBP::realtimeupdating;
+}
+
+// Returns TRUE if \a list is the realTime field notifying \a timein
+// through its connection during updateRealTimeFieldCB(). The engine
+// gets the tick from notifyRealTimeInput() instead.
+SbBool
+SoDBP::isRealTimeTick(const SoNotList * list, const SoField * timein)
+{
+  if (!SoDBP::realtimeupdating || SoDBP::realtimedelivering) return FALSE;
+  if (list->getLastField() != timein) return FALSE;
+  SoField * master;
+  return timein->getConnectedField(master) &&
+    master == SoDB::getGlobalField("realTime");
+}
+
+// Passes the realTime tick on to the \a timein field connected to
+// it, as the field's connection would have done.
+void
+SoDBP::notifyRealTimeInput(SoField * timein, SoNotList * list)
+{
+  SoField * realtime = SoDB::getGlobalField("realTime");
+  SoField * master;
+  if (!timein->getConnectedField(master) || master != realtime) return;
+
+  SoNotList l(list);
+  SoNotRec rec(realtime->getContainer());
+  l.append(&rec, realtime);
+  l.setLastType(SoNotRec::FIELD);
+
+  const SbBool old = SoDBP::realtimedelivering;
+  SoDBP::realtimedelivering = TRUE;
+  timein->notify(&l);
+  SoDBP::realtimedelivering = old;
+}
+
 SbBool
 SoDBP::is3dsFile(SoInput * in)
 {
@@ -301,3 +454,41 @@ SoDBP::progress(const SbName & itemid,
     }
   }
 }
+
+// *************************************************************************
+
+// Registering the conversions between all the built-in field types
+// is a considerable part of the time spent in SoDB::init(), and many
+// applications never connect fields of different types, so it is
+// done the first time the converter table is used. The flag is set
+// after the registration is done, so the global lock is only needed
+// until then.
+void
+SoDBP::registerBuiltinConverters(void)
+{
+  if (SoDBP::builtinconverters) return;
+
+  CC_GLOBAL_LOCK;
+  if (!SoDBP::builtinconverters) {
+    SoConvertAll::registerConverters();
+    SoDBP::builtinconverters = TRUE;
+  }
+  CC_GLOBAL_UNLOCK;
+}
+
+void
+SoDBP::addConverter(SoType from, SoType to, SoType converter)
+{
+  const uint32_t linkid = (((uint32_t)from.getKey()) << 16) + to.getKey();
+  SbBool nonexist = SoDBP::converters->put(linkid, converter.getKey());
+  if (!nonexist) {
+#if COIN_DEBUG
+    SoDebugError::postWarning("SoDB::addConverter",
+                              "Conversion from ``%s'' to ``%s'' is already "
+                              "handled by instances of ``%s''",
+                              from.getName().getString(),
+                              to.getName().getString(),
+                              converter.getName().getString());
+#endif // COIN_DEBUG
+  }
+}
@@ -47,6 +47,9 @@
 #include "misc/SbHash.h"
 
 class SoSensor;
+class SoNotList;
+class SoBase;
+class SoField;
 class SbRWMutex;
 
 // *************************************************************************
@@ -84,6 +87,26 @@ public:
   static void updateRealTimeFieldCB(void * data, SoSensor * sensor);
   static void listWin32ProcessModules(void);
 
+  // Nodes and engines animated from the realTime global field
+  // register here instead of reacting to it from their own sensors or
+  // field connections, so a realTime tick updates all of them in one
+  // pass sharing a single notification list.
+  typedef void RealTimeAnimatorCB(SoBase * animator, SoNotList * list);
+  static void addRealTimeAnimator(RealTimeAnimatorCB * func, SoBase * animator);
+  static void removeRealTimeAnimator(SoBase * animator);
+  static SbBool isUpdatingRealTime(void);
+
+  // Engines with a time input connected to realTime ignore the
+  // field's own notification of the input during a tick, and get it
+  // from their animator callback instead, only while they are running.
+  static SbBool isRealTimeTick(const SoNotList * list, const SoField * timein);
+  static void notifyRealTimeInput(SoField * timein, SoNotList * list);
+
+  // The built-in field converters are registered on first use of the
+  // converter table, instead of up front from SoDB::init().
+  static void registerBuiltinConverters(void);
+  static void addConverter(SoType from, SoType to, SoType converter);
+
 #ifdef COIN_THREADSAFE
   static SbRWMutex * globalmutex;
 #endif // COIN_THREADSAFE
@@ -91,6 +114,7 @@ public:
   static SoSensorManager * sensormanager;
   static SoTimerSensor * globaltimersensor;
   static UInt32ToInt16Map * converters;
+  static SbBool builtinconverters;
   static int notificationcounter;
   static SbBool isinitialized;
 
@@ -110,6 +134,18 @@ public:
     }
   };
   static SbList<struct ProgressCallbackInfo> * progresscblist;
+
+  struct RealTimeAnimatorInfo {
+    RealTimeAnimatorCB * func;
+    SoBase * animator;
+  };
+  static SbList<struct RealTimeAnimatorInfo> * realtimeanimators;
+  // index of each animator in realtimeanimators, for O(1) removal
+  static SbHash<const SoBase *, int> * realtimeanimatorindex;
+  static void * realtimeanimatormutex;
+  static SbBool realtimeupdating;
+  static SbBool realtimeiterating;
+  static SbBool realtimedelivering;
 };
 
 #endif // !COIN_SODBP_H
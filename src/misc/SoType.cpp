@@ -167,7 +167,9 @@ struct SoTypeData {
              const SoType theParent = SoType::badType(),
              const SoType::instantiationMethod createMethod = NULL)
     : name(theName), type(type), isPublic(ispublic), data(theData),
-      parent(theParent), method(createMethod) { };
+      parent(theParent), method(createMethod),
+      depth(0), ancestors(NULL) { };
+  ~SoTypeData() { delete[] this->ancestors; }
 
   SbName name;
   SoType type;
@@ -175,6 +177,12 @@ struct SoTypeData {
   uint16_t data;
   SoType parent;
   SoType::instantiationMethod method;
+
+  // Keys of all the ancestors of this type, indexed by their depth in
+  // the hierarchy, from the root type at index 0 to this type at
+  // index 'depth'. Makes isDerivedFrom() a single lookup.
+  int depth;
+  int16_t * ancestors;
 };
 
 // OBSOLETED: this code was only active for GCC 2.7.x, and I don't
@@ -299,6 +307,17 @@ SoType::createType(const SoType parent, const SbName name,
   SoType newType;
   newType.index = SoType::typedatalist->getLength();
   SoTypeData * typeData = new SoTypeData(name, newType, TRUE, data, parent, method);
+
+  const SoTypeData * parentdata =
+    parent.isBad() ? NULL : (*SoType::typedatalist)[(int)parent.getKey()];
+  assert(parent.isBad() || parentdata);
+  if (parentdata) typeData->depth = parentdata->depth + 1;
+  typeData->ancestors = new int16_t[typeData->depth + 1];
+  for (int i = 0; i < typeData->depth; i++) {
+    typeData->ancestors[i] = parentdata->ancestors[i];
+  }
+  typeData->ancestors[typeData->depth] = newType.getKey();
+
   SoType::typedatalist->append(typeData);
 
   // add to dictionary for fast lookup
@@ -730,13 +749,14 @@ SoType::badType(void)
 
 /*!
   This method returns \c TRUE if the given type is derived from (or \e
-  is) the \a parent type, and \c FALSE otherwise.
+  is) the \a parent type, and \c FALSE otherwise. The bad type is not
+  derived from any type.
 */
 
 SbBool
 SoType::isDerivedFrom(const SoType parent) const
 {
-  assert(!this->isBad());
+  if (this->isBad()) return FALSE;
 
   if (parent.isBad()) {
 #if COIN_DEBUG
@@ -747,19 +767,16 @@ SoType::isDerivedFrom(const SoType parent) const
     return FALSE;
   }
 
-  SoType type = *this;
-  do {
-#if COIN_DEBUG && 0 // debug
-    SoDebugError::postInfo("SoType::isDerivedFrom",
-                           "this: '%s' parent: '%s'",
-                           type.getName().getString(),
-                           parent.getName().getString());
-#endif // debug
-    if (type == parent) return TRUE;
-    type = (*SoType::typedatalist)[(int)type.getKey()]->parent;
-  } while (!type.isBad());
+  // A type's ancestor list contains the parent type at the parent's
+  // own depth if and only if it is derived from it, so there is no
+  // need to walk the chain of parent types.
+  const SoTypeData * data = (*SoType::typedatalist)[(int)this->getKey()];
+  const SoTypeData * parentdata = (*SoType::typedatalist)[(int)parent.getKey()];
+  // removed types
+  if (data == NULL || data->ancestors == NULL || parentdata == NULL) return FALSE;
 
-  return FALSE;
+  const int depth = parentdata->depth;
+  return (depth <= data->depth) && (data->ancestors[depth] == parent.getKey());
 }
 
 /*!
@@ -967,6 +984,8 @@ SoType::isInternal(void) const
 #include <Inventor/SoType.h>
 #include <Inventor/SbName.h>
 #include <Inventor/nodes/SoNode.h>
+#include <Inventor/fields/SoField.h>
+#include <Inventor/lists/SoTypeList.h>
 
 static void * createInstance(void)
 {
@@ -987,4 +1006,35 @@ BOOST_AUTO_TEST_CASE(testRemoveType)
                       "Type didn't deregister correctly");
 }
 
+BOOST_AUTO_TEST_CASE(testIsDerivedFrom)
+{
+  SoType nodetype = SoNode::getClassTypeId();
+  SoType a = SoType::createType(nodetype, SbName("MyClassA"), NULL, 0);
+  SoType b = SoType::createType(a, SbName("MyClassB"), createInstance, 0);
+  SoType c = SoType::createType(a, SbName("MyClassC"), createInstance, 0);
+  SoType d = SoType::createType(b, SbName("MyClassD"), createInstance, 0);
+
+  BOOST_CHECK(d.isDerivedFrom(d));
+  BOOST_CHECK(d.isDerivedFrom(b));
+  BOOST_CHECK(d.isDerivedFrom(a));
+  BOOST_CHECK(d.isDerivedFrom(nodetype));
+  BOOST_CHECK(d.isDerivedFrom(SoBase::getClassTypeId()));
+  BOOST_CHECK(!d.isDerivedFrom(c));
+  BOOST_CHECK(!c.isDerivedFrom(b));
+  BOOST_CHECK(!a.isDerivedFrom(b));
+  BOOST_CHECK(!nodetype.isDerivedFrom(a));
+  BOOST_CHECK(!d.isDerivedFrom(SoField::getClassTypeId()));
+  BOOST_CHECK(!SoField::getClassTypeId().isDerivedFrom(nodetype));
+  BOOST_CHECK(!SoType::badType().isDerivedFrom(SoBase::getClassTypeId()));
+  BOOST_CHECK(!SoType::badType().isDerivedFrom(SoField::getClassTypeId()));
+
+  SoTypeList list;
+  BOOST_CHECK_EQUAL(SoType::getAllDerivedFrom(a, list), 4);
+
+  BOOST_CHECK(SoType::removeType(SbName("MyClassD")));
+  BOOST_CHECK(SoType::removeType(SbName("MyClassC")));
+  BOOST_CHECK(SoType::removeType(SbName("MyClassB")));
+  BOOST_CHECK(SoType::removeType(SbName("MyClassA")));
+}
+
 #endif // COIN_TEST_SUITE
@@ -334,6 +334,11 @@ SbUniqueId is not really a class, just a \c typedef.
   Node was introduced with Coin 4.0.
 */
 
+/*!
+  \var SoNode::NodeType SoNode::COIN_4_1
+  Node was introduced with Coin 4.1.
+*/
+
 /*!
   \var SoNode::NodeType SoNode::EXTENSION
   Node is a client code extension.
@@ -618,6 +623,7 @@ SoNode::initClasses(void)
   SoFaceSet::initClass();
   SoLineSet::initClass();
   SoPointSet::initClass();
+  SoPointCloud::initClass();
   SoMarkerSet::initClass();
   SoQuadMesh::initClass();
   SoTriangleStripSet::initClass();
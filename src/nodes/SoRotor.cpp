@@ -71,9 +71,11 @@
 #include <Inventor/SoDB.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/fields/SoSFTime.h>
+#include <Inventor/misc/SoNotification.h>
 #include <Inventor/sensors/SoFieldSensor.h>
 
 #include "coindefs.h"
+#include "misc/SoDBP.h"
 #include "nodes/SoSubNodeP.h"
 
 // *************************************************************************
@@ -117,8 +119,9 @@ public:
   SoFieldSensor * speedfieldsensor;
 
   static void rtFieldSensorCB(void * d, SoSensor * s);
+  static void realTimeAnimatorCB(SoBase * animator, SoNotList * list);
   static void fieldSensorCB(void * d, SoSensor * s);
-  void setRotation(void);
+  void setRotation(SoNotList * list = NULL);
 
 private:
   SoRotor * master;
@@ -145,6 +148,7 @@ SoRotor::SoRotor(void)
   PRIVATE(this)->rtfieldsensor = new SoFieldSensor(SoRotorP::rtFieldSensorCB, this);
   PRIVATE(this)->rtfieldsensor->attach(f);
   PRIVATE(this)->rtfieldsensor->setPriority(0);
+  SoDBP::addRealTimeAnimator(SoRotorP::realTimeAnimatorCB, this);
   PRIVATE(this)->onfieldsensor = new SoFieldSensor(SoRotorP::fieldSensorCB, this);
   PRIVATE(this)->onfieldsensor->setPriority(0);
   PRIVATE(this)->onfieldsensor->attach(&this->on);
@@ -165,6 +169,7 @@ SoRotor::SoRotor(void)
 */
 SoRotor::~SoRotor()
 {
+  SoDBP::removeRealTimeAnimator(this);
   delete PRIVATE(this)->rotfieldsensor;
   delete PRIVATE(this)->rtfieldsensor;
   delete PRIVATE(this)->onfieldsensor;
@@ -205,9 +210,13 @@ SoRotorP::fieldSensorCB(void * d, SoSensor * s)
 }
 
 
+// handles realTime changes made by others than the realtime timer
+// sensor, which updates us through realTimeAnimatorCB()
 void
 SoRotorP::rtFieldSensorCB(void * d, SoSensor *)
 {
+  if (SoDBP::isUpdatingRealTime()) return;
+
   SoRotor * thisp = (SoRotor *) d;
   // got to check value of on field here in case rtfieldsensor
   // triggers before onfieldsensor.
@@ -216,9 +225,22 @@ SoRotorP::rtFieldSensorCB(void * d, SoSensor *)
   }
 }
 
-// sets rotation based on time passed from starttime
+// called from SoDBP::updateRealTimeFieldCB() together with all other
+// realtime animated nodes
+void
+SoRotorP::realTimeAnimatorCB(SoBase * animator, SoNotList * list)
+{
+  SoRotor * thisp = (SoRotor *) animator;
+  if (thisp->on.getValue()) {
+    PRIVATE(thisp)->setRotation(list);
+  }
+}
+
+// sets rotation based on time passed from starttime. If \a list is
+// non-NULL, the change is propagated with a copy of it instead of
+// starting a separate notification.
 void
-SoRotorP::setRotation(void)
+SoRotorP::setRotation(SoNotList * list)
 {
   if (this->starttime == SbTime::zero()) {
     // don't do anything first time we get here
@@ -240,9 +262,21 @@ SoRotorP::setRotation(void)
     angle = (float) fmod((double)angle, M_PI * 2.0);
   }
   
+  SoSFRotation & rotation = PUBLIC(this)->rotation;
   this->rotfieldsensor->detach();
-  PUBLIC(this)->rotation.setValue(SbRotation(this->startaxis, angle));
-  this->rotfieldsensor->attach(&PUBLIC(this)->rotation);
+  if (list) {
+    const SbBool oldnotify = rotation.enableNotify(FALSE);
+    rotation.setValue(SbRotation(this->startaxis, angle));
+    (void) rotation.enableNotify(oldnotify);
+    if (oldnotify) {
+      SoNotList l(list);
+      rotation.notify(&l);
+    }
+  }
+  else {
+    rotation.setValue(SbRotation(this->startaxis, angle));
+  }
+  this->rotfieldsensor->attach(&rotation);
 }
 
 #undef PRIVATE
@@ -61,6 +61,13 @@
   are equal to a whole power-of-two, see documentation for
   SoSceneTexture::size.
 
+  The sub scene is rendered lazily from GLRender(), so a texture node
+  which is culled away (e.g. below a culled SoSeparator) is not
+  updated until it becomes visible again. For animated sub scenes,
+  SoSceneTexture2::maxUpdateRate can be used to limit how often the
+  texture is re-rendered, and SoSceneTexture2::shareTexture lets
+  several nodes using the same sub scene render it only once.
+
   <b>FILE FORMAT/DEFAULTS:</b>
   \code
     SceneTexture2 {
@@ -74,6 +81,8 @@
         wrapT REPEAT
         model MODULATE
         blendColor 0 0 0
+        maxUpdateRate 0
+        shareTexture FALSE
     }
   \endcode
 
@@ -245,6 +254,33 @@
 
 */
 
+/*!
+  \var SoSFFloat SoSceneTexture2::maxUpdateRate
+
+  The maximum number of times per second the sub scene will be
+  rendered into the texture. When the sub scene changes more often
+  than this, the previous texture is used until the interval has
+  elapsed, and a redraw is scheduled so that the texture catches up
+  with the last change. Default value is 0.0, which means that the
+  texture is updated on every change.
+
+  \since Coin 4.1
+*/
+
+/*!
+  \var SoSFBool SoSceneTexture2::shareTexture
+
+  When TRUE, this node will reuse the texture rendered by another
+  SoSceneTexture2 node with shareTexture set, as long as both have
+  the same SoSceneTexture2::scene, SoSceneTexture2::size,
+  SoSceneTexture2::type, SoSceneTexture2::backgroundColor and
+  SoSceneTexture2::sceneTransparencyType values, and are rendered in
+  the same OpenGL context. Only textures rendered through frame
+  buffer objects can be shared. Default value is FALSE.
+
+  \since Coin 4.1
+*/
+
 /*!
   \var SoSceneTexture2::Type SoSceneTexture2::RGBA8
   Specifies an RGBA texture with 8 bits per component.
@@ -269,6 +305,7 @@
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/sensors/SoFieldSensor.h>
 #include <Inventor/sensors/SoOneShotSensor.h>
+#include <Inventor/sensors/SoAlarmSensor.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/SoOffscreenRenderer.h>
 #include <Inventor/misc/SoNotification.h>
@@ -299,6 +336,7 @@
 #include <Inventor/errors/SoReadError.h>
 #include <Inventor/sensors/SoFieldSensor.h>
 #include <Inventor/lists/SbStringList.h>
+#include <Inventor/lists/SbList.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/SbImage.h>
 #include <Inventor/C/glue/gl.h>
@@ -317,6 +355,8 @@
 
 #include "nodes/SoSubNodeP.h"
 #include "elements/SoTextureScalePolicyElement.h"
+#include "threads/threadsutilp.h"
+#include "tidbitsp.h"
 
 
 // FIXME: The multicontex handling in this class is very messy. Clean
@@ -411,8 +451,31 @@ public:
   SbBool canrendertotexture;
   unsigned char * offscreenbuffer;
   int offscreenbuffersize;
+
+  uint32_t getTransparencyFlags(void) const;
+
+  // update rate limiting
+  SbTime lastupdate;
+  SoAlarmSensor * updatesensor;
+  SbBool delayUpdate(void);
+  static void updatesensorCB(void * data, SoSensor * sensor);
+
+  // texture sharing between instances rendering the same scene
+  SbBool usedfbo;
+  SoGLDisplayList * shareddl;
+  SbBool canShareWith(const SoSceneTexture2P * other, const int32_t cachecontext) const;
+  SbBool shareTexture(SoState * state);
+  SbBool isSharedTextureValid(const int32_t cachecontext) const;
+  void stopSharing(SoState * state);
+
+  static SbList <SoSceneTexture2P *> * instances;
+  static void * instancesmutex;
+  static void cleanupClass(void);
 };
 
+SbList <SoSceneTexture2P *> * SoSceneTexture2P::instances = NULL;
+void * SoSceneTexture2P::instancesmutex = NULL;
+
 // *************************************************************************
 
 #define PRIVATE(obj) obj->pimpl
@@ -437,6 +500,10 @@ SoSceneTexture2::initClass(void)
 {
   SO_NODE_INTERNAL_INIT_CLASS(SoSceneTexture2, SO_FROM_COIN_2_2);
 
+  SoSceneTexture2P::instances = new SbList <SoSceneTexture2P *>;
+  CC_MUTEX_CONSTRUCT(SoSceneTexture2P::instancesmutex);
+  coin_atexit((coin_atexit_f*) SoSceneTexture2P::cleanupClass, CC_ATEXIT_NORMAL);
+
   SO_ENABLE(SoGLRenderAction, SoGLMultiTextureImageElement);
   SO_ENABLE(SoGLRenderAction, SoGLMultiTextureEnabledElement);
 
@@ -471,6 +538,8 @@ SoSceneTexture2::SoSceneTexture2(void)
   SO_NODE_ADD_FIELD(model, (MODULATE));
   SO_NODE_ADD_FIELD(blendColor, (0.0f, 0.0f, 0.0f));
   SO_NODE_ADD_FIELD(type, (RGBA8));
+  SO_NODE_ADD_FIELD(maxUpdateRate, (0.0f));
+  SO_NODE_ADD_FIELD(shareTexture, (FALSE));
 
   SO_NODE_DEFINE_ENUM_VALUE(Model, MODULATE);
   SO_NODE_DEFINE_ENUM_VALUE(Model, DECAL);
@@ -550,8 +619,20 @@ SoSceneTexture2::GLRender(SoGLRenderAction * action)
   }
   LOCK_GLIMAGE(this);
 
-  if (root && (!PRIVATE(this)->buffervalid || !PRIVATE(this)->glimagevalid)) {
-    PRIVATE(this)->updateBuffer(state, quality);
+  // the instance we share the texture with may have recreated or
+  // deleted its frame buffer objects
+  if (PRIVATE(this)->shareddl &&
+      !PRIVATE(this)->isSharedTextureValid(cachecontext)) {
+    PRIVATE(this)->buffervalid = FALSE;
+  }
+
+  if (root && (!PRIVATE(this)->buffervalid || !PRIVATE(this)->glimagevalid) &&
+      !PRIVATE(this)->delayUpdate()) {
+    if (!this->shareTexture.getValue() || !PRIVATE(this)->shareTexture(state)) {
+      PRIVATE(this)->stopSharing(state);
+      PRIVATE(this)->updateBuffer(state, quality);
+    }
+    PRIVATE(this)->lastupdate = SbTime::getTimeOfDay();
 
     // don't cache when we change the glimage
     SoCacheElement::setInvalid(TRUE);
@@ -662,6 +743,9 @@ SoSceneTexture2::notify(SoNotList * list)
     // no need to render scene again, but update the texture object
     PRIVATE(this)->glimagevalid = FALSE;
   }
+  else if (f == &this->shareTexture) {
+    PRIVATE(this)->buffervalid = FALSE;
+  }
   inherited::notify(list);
 }
 
@@ -695,10 +779,24 @@ SoSceneTexture2P::SoSceneTexture2P(SoSceneTexture2 * apiptr)
   this->canrendertotexture = FALSE;
   this->contextid = -1;
   this->fbodata = NULL;
+  this->updatesensor = NULL;
+  this->usedfbo = FALSE;
+  this->shareddl = NULL;
+
+  CC_MUTEX_LOCK(SoSceneTexture2P::instancesmutex);
+  SoSceneTexture2P::instances->append(this);
+  CC_MUTEX_UNLOCK(SoSceneTexture2P::instancesmutex);
 }
 
 SoSceneTexture2P::~SoSceneTexture2P()
 {
+  if (SoSceneTexture2P::instances) {
+    CC_MUTEX_LOCK(SoSceneTexture2P::instancesmutex);
+    SoSceneTexture2P::instances->removeItem(this);
+    CC_MUTEX_UNLOCK(SoSceneTexture2P::instancesmutex);
+  }
+  delete this->updatesensor;
+
   this->deleteFrameBufferObjects(NULL, NULL);
   delete this->fbodata;
 
@@ -772,27 +870,15 @@ SoSceneTexture2P::updateFrameBuffer(SoState * state, const float COIN_UNUSED_ARG
     if (this->glimage == NULL) {
       this->glimage = new SoGLImage;
       this->glimagecontext = SoGLCacheContextElement::get(state);
-      uint32_t flags = this->glimage->getFlags();
-      switch ((SoSceneTexture2::TransparencyFunction) (PUBLIC(this)->transparencyFunction.getValue())) {
-      case SoSceneTexture2::NONE:
-        flags |= SoGLImage::FORCE_TRANSPARENCY_FALSE|SoGLImage::FORCE_ALPHA_TEST_FALSE;
-        break;
-      case SoSceneTexture2::ALPHA_TEST:
-        flags |= SoGLImage::FORCE_TRANSPARENCY_TRUE|SoGLImage::FORCE_ALPHA_TEST_TRUE;
-        break;
-      case SoSceneTexture2::ALPHA_BLEND:
-        flags |= SoGLImage::FORCE_TRANSPARENCY_TRUE|SoGLImage::FORCE_ALPHA_TEST_FALSE;
-        break;
-      default:
-        assert(0 && "should not get here");
-        break;
-      }
-      this->glimage->setFlags(flags);
+      this->glimage->setFlags(this->glimage->getFlags() | this->getTransparencyFlags());
     }
 
     SbBool finished = FALSE;
 
     SoSceneTexture2::Type type = (SoSceneTexture2::Type) PUBLIC(this)->type.getValue();
+    // instances sharing our texture look up the frame buffer objects
+    // while holding the instance list lock
+    CC_MUTEX_LOCK(SoSceneTexture2P::instancesmutex);
     while (!finished) {
       this->deleteFrameBufferObjects(glue, state);
       finished = TRUE;
@@ -805,6 +891,7 @@ SoSceneTexture2P::updateFrameBuffer(SoState * state, const float COIN_UNUSED_ARG
         }
       }
     }
+    CC_MUTEX_UNLOCK(SoSceneTexture2P::instancesmutex);
 
     // FIXME: for some reason we need to do this every frame. Investigate why.
     if (PUBLIC(this)->type.getValue() == SoSceneTexture2::DEPTH) {
@@ -905,6 +992,7 @@ SoSceneTexture2P::updateFrameBuffer(SoState * state, const float COIN_UNUSED_ARG
 
   this->buffervalid = TRUE;
   this->glimagevalid = TRUE;
+  this->usedfbo = TRUE;
 }
 
 void
@@ -1025,20 +1113,7 @@ SoSceneTexture2P::updatePBuffer(SoState * state, const float quality)
     if (this->glrectangle) {
       flags |= SoGLImage::RECTANGLE;
     }
-    switch ((SoSceneTexture2::TransparencyFunction) (PUBLIC(this)->transparencyFunction.getValue())) {
-    case SoSceneTexture2::NONE:
-      flags |= SoGLImage::FORCE_TRANSPARENCY_FALSE|SoGLImage::FORCE_ALPHA_TEST_FALSE;
-      break;
-    case SoSceneTexture2::ALPHA_TEST:
-      flags |= SoGLImage::FORCE_TRANSPARENCY_TRUE|SoGLImage::FORCE_ALPHA_TEST_TRUE;
-      break;
-    case SoSceneTexture2::ALPHA_BLEND:
-      flags |= SoGLImage::FORCE_TRANSPARENCY_TRUE|SoGLImage::FORCE_ALPHA_TEST_FALSE;
-      break;
-    default:
-      assert(0 && "should not get here");
-      break;
-    }
+    flags |= this->getTransparencyFlags();
     if (this->canrendertotexture) {
       // bind texture to pbuffer
       this->glimage->setPBuffer(state, this->glcontext,
@@ -1060,6 +1135,7 @@ SoSceneTexture2P::updatePBuffer(SoState * state, const float quality)
   }
   this->glimagevalid = TRUE;
   this->buffervalid = TRUE;
+  this->usedfbo = FALSE;
 }
 
 void
@@ -1371,6 +1447,168 @@ SoSceneTexture2P::getTransparencyType(SoState * state)
     SoShapeStyleElement::getTransparencyType(state);
 }
 
+uint32_t
+SoSceneTexture2P::getTransparencyFlags(void) const
+{
+  switch ((SoSceneTexture2::TransparencyFunction) (PUBLIC(this)->transparencyFunction.getValue())) {
+  case SoSceneTexture2::NONE:
+    return SoGLImage::FORCE_TRANSPARENCY_FALSE|SoGLImage::FORCE_ALPHA_TEST_FALSE;
+  case SoSceneTexture2::ALPHA_TEST:
+    return SoGLImage::FORCE_TRANSPARENCY_TRUE|SoGLImage::FORCE_ALPHA_TEST_TRUE;
+  case SoSceneTexture2::ALPHA_BLEND:
+    return SoGLImage::FORCE_TRANSPARENCY_TRUE|SoGLImage::FORCE_ALPHA_TEST_FALSE;
+  default:
+    assert(0 && "should not get here");
+    break;
+  }
+  return 0;
+}
+
+// Returns TRUE if the texture should not be updated yet because of
+// SoSceneTexture2::maxUpdateRate. A redraw is then scheduled for when
+// the update is allowed, so that the last change isn't lost.
+SbBool
+SoSceneTexture2P::delayUpdate(void)
+{
+  const float rate = PUBLIC(this)->maxUpdateRate.getValue();
+  // never delay if we don't have a usable texture to show meanwhile
+  if (rate <= 0.0f || !this->glimagevalid || this->glimage == NULL) return FALSE;
+
+  const SbTime interval(1.0 / rate);
+  if (SbTime::getTimeOfDay() - this->lastupdate >= interval) return FALSE;
+
+  if (this->updatesensor == NULL) {
+    this->updatesensor = new SoAlarmSensor(SoSceneTexture2P::updatesensorCB, this);
+  }
+  if (!this->updatesensor->isScheduled()) {
+    this->updatesensor->setTime(this->lastupdate + interval);
+    this->updatesensor->schedule();
+  }
+  return TRUE;
+}
+
+void
+SoSceneTexture2P::updatesensorCB(void * data, SoSensor * COIN_UNUSED_ARG(sensor))
+{
+  SoSceneTexture2P * thisp = (SoSceneTexture2P *) data;
+  // trigger a redraw. The buffer is still marked as invalid
+  PUBLIC(thisp)->touch();
+}
+
+// Returns TRUE if other has a valid texture, rendered by itself, that
+// can be used instead of rendering the scene again.
+SbBool
+SoSceneTexture2P::canShareWith(const SoSceneTexture2P * other,
+                               const int32_t cachecontext) const
+{
+  const SoSceneTexture2 * a = PUBLIC(this);
+  const SoSceneTexture2 * b = PUBLIC(other);
+
+  if (other == this || !b->shareTexture.getValue()) return FALSE;
+  if (!other->usedfbo || other->shareddl != NULL || !other->buffervalid) return FALSE;
+  if (other->fbodata == NULL || other->fbodata->cachecontext != cachecontext) return FALSE;
+
+  return
+    a->scene.getValue() == b->scene.getValue() &&
+    a->size.getValue() == b->size.getValue() &&
+    a->type.getValue() == b->type.getValue() &&
+    a->backgroundColor.getValue() == b->backgroundColor.getValue() &&
+    a->sceneTransparencyType.getValue() == b->sceneTransparencyType.getValue();
+}
+
+// Tries to use the texture of another instance. Returns FALSE if no
+// suitable instance was found.
+SbBool
+SoSceneTexture2P::shareTexture(SoState * state)
+{
+  const int32_t cachecontext = SoGLCacheContextElement::get(state);
+  const SbBool depth = PUBLIC(this)->type.getValue() == SoSceneTexture2::DEPTH;
+  SbBool found = FALSE;
+
+  CC_MUTEX_LOCK(SoSceneTexture2P::instancesmutex);
+  for (int i = 0; !found && i < SoSceneTexture2P::instances->getLength(); i++) {
+    const SoSceneTexture2P * other = (*SoSceneTexture2P::instances)[i];
+    if (!this->canShareWith(other, cachecontext)) continue;
+
+    SoGLDisplayList * dl = depth ?
+      other->fbodata->fbo_depthmap : other->fbodata->fbo_texture;
+    if (dl == NULL) continue;
+
+    if (this->shareddl != dl || !this->glimagevalid || this->glimage == NULL) {
+      if (this->glimage) this->glimage->unref(state);
+      this->glimage = new SoGLImage;
+      this->glimage->setFlags(this->glimage->getFlags() | this->getTransparencyFlags());
+      if (depth) {
+        this->glimage->setGLDisplayList(dl, state, SoGLImage::CLAMP, SoGLImage::CLAMP);
+      }
+      else {
+        this->glimage->setGLDisplayList(dl, state);
+      }
+      this->shareddl = dl;
+    }
+    found = TRUE;
+  }
+  CC_MUTEX_UNLOCK(SoSceneTexture2P::instancesmutex);
+
+  if (!found) return FALSE;
+
+  // our own frame buffer objects are no longer needed
+  if (this->fbodata) {
+    CC_MUTEX_LOCK(SoSceneTexture2P::instancesmutex);
+    this->deleteFrameBufferObjects(cc_glglue_instance(cachecontext), state);
+    CC_MUTEX_UNLOCK(SoSceneTexture2P::instancesmutex);
+    this->fbodata->fbo_size.setValue(-1, -1);
+  }
+  this->glimagecontext = cachecontext;
+  this->buffervalid = TRUE;
+  this->glimagevalid = TRUE;
+  return TRUE;
+}
+
+// Returns TRUE if the texture we share is still the current texture
+// of an instance which renders it itself. The owner replaces its
+// textures when it is resized, and the old texture, kept alive by our
+// reference, is then never updated again.
+SbBool
+SoSceneTexture2P::isSharedTextureValid(const int32_t cachecontext) const
+{
+  SbBool valid = FALSE;
+  CC_MUTEX_LOCK(SoSceneTexture2P::instancesmutex);
+  for (int i = 0; !valid && i < SoSceneTexture2P::instances->getLength(); i++) {
+    const SoSceneTexture2P * other = (*SoSceneTexture2P::instances)[i];
+    if (other == this || !other->usedfbo || other->shareddl != NULL ||
+        other->fbodata == NULL) continue;
+    valid =
+      other->fbodata->cachecontext == cachecontext &&
+      (other->fbodata->fbo_texture == this->shareddl ||
+       other->fbodata->fbo_depthmap == this->shareddl);
+  }
+  CC_MUTEX_UNLOCK(SoSceneTexture2P::instancesmutex);
+  return valid;
+}
+
+// Drops a texture borrowed from another instance, if any.
+void
+SoSceneTexture2P::stopSharing(SoState * state)
+{
+  if (this->shareddl == NULL) return;
+  if (this->glimage) {
+    this->glimage->unref(state);
+    this->glimage = NULL;
+    this->glimagecontext = 0;
+  }
+  this->shareddl = NULL;
+  this->glimagevalid = FALSE;
+}
+
+void
+SoSceneTexture2P::cleanupClass(void)
+{
+  delete SoSceneTexture2P::instances;
+  SoSceneTexture2P::instances = NULL;
+  CC_MUTEX_DESTRUCT(SoSceneTexture2P::instancesmutex);
+}
+
 
 #undef PUBLIC
 
@@ -1378,3 +1616,175 @@ SoSceneTexture2P::getTransparencyType(SoState * state)
 #undef UNLOCK_GLIMAGE
 
 // **************************************************************
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/C/glue/gl.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/elements/SoGLCacheContextElement.h>
+#include <Inventor/nodes/SoCallback.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <cstring>
+
+BOOST_AUTO_TEST_CASE(readUpdateFields)
+{
+  SoSceneTexture2 * node = new SoSceneTexture2;
+  node->ref();
+  BOOST_CHECK_EQUAL(node->maxUpdateRate.getValue(), 0.0f);
+  BOOST_CHECK(!node->shareTexture.getValue());
+  node->unref();
+
+  const char * scene =
+    "#Inventor V2.1 ascii\n\n"
+    "SceneTexture2 { maxUpdateRate 2.5 shareTexture TRUE }\n";
+  SoInput in;
+  in.setBuffer(scene, strlen(scene));
+  SoSeparator * root = SoDB::readAll(&in);
+  BOOST_REQUIRE(root != NULL);
+  root->ref();
+  BOOST_REQUIRE(root->getNumChildren() == 1);
+  BOOST_REQUIRE(root->getChild(0)->isOfType(SoSceneTexture2::getClassTypeId()));
+  node = static_cast<SoSceneTexture2 *>(root->getChild(0));
+  BOOST_CHECK_EQUAL(node->maxUpdateRate.getValue(), 2.5f);
+  BOOST_CHECK(node->shareTexture.getValue());
+  root->unref();
+}
+
+// Counts the number of times the sub scene is rendered.
+static void
+scenetexture2_countCB(void * closure, SoAction * action)
+{
+  if (action->isOfType(SoGLRenderAction::getClassTypeId())) {
+    (*((int *) closure))++;
+  }
+}
+
+static void
+scenetexture2_fboCB(void * closure, SoAction * action)
+{
+  if (action->isOfType(SoGLRenderAction::getClassTypeId())) {
+    const cc_glglue * glue =
+      cc_glglue_instance(SoGLCacheContextElement::get(action->getState()));
+    *((SbBool *) closure) = cc_glglue_has_framebuffer_objects(glue);
+  }
+}
+
+// Sets up a scene with two scene textures using the same sub
+// scene. The textures are not connected to the scene, and are
+// unref'ed with root.
+static SoSeparator *
+scenetexture2_createScene(SoSceneTexture2 * textures[2], SoMaterial *& submaterial,
+                          int & count, SbBool & hasfbo)
+{
+  SoSeparator * sub = new SoSeparator;
+  SoCallback * counter = new SoCallback;
+  counter->setCallback(scenetexture2_countCB, &count);
+  sub->addChild(counter);
+  submaterial = new SoMaterial;
+  sub->addChild(submaterial);
+  sub->addChild(new SoCube);
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  root->addChild(new SoOrthographicCamera);
+  SoCallback * fbo = new SoCallback;
+  fbo->setCallback(scenetexture2_fboCB, &hasfbo);
+  root->addChild(fbo);
+  for (int i = 0; i < 2; i++) {
+    textures[i] = new SoSceneTexture2;
+    textures[i]->size.setValue(16, 16);
+    textures[i]->scene = sub;
+    root->addChild(textures[i]);
+    root->addChild(new SoCube);
+  }
+  return root;
+}
+
+// Returns FALSE if no GL context can be created for the tests below.
+static SbBool
+scenetexture2_canRender(void)
+{
+#if !defined(_WIN32) && !defined(__APPLE__)
+  // offscreen contexts need an X display with GLX
+  if (coin_getenv("DISPLAY") == NULL) return FALSE;
+#endif // !_WIN32 && !__APPLE__
+  return TRUE;
+}
+
+BOOST_AUTO_TEST_CASE(maxUpdateRate)
+{
+  if (!scenetexture2_canRender()) {
+    BOOST_WARN_MESSAGE(FALSE, "maxUpdateRate skipped: no X display");
+    return;
+  }
+  SoSceneTexture2 * textures[2];
+  SoMaterial * submaterial;
+  int count = 0;
+  SbBool hasfbo = FALSE;
+  SoSeparator * root = scenetexture2_createScene(textures, submaterial, count, hasfbo);
+  root->removeChild(textures[1]);
+  textures[0]->maxUpdateRate = 0.001f;
+
+  SoOffscreenRenderer renderer(SbViewportRegion(32, 32));
+  if (!renderer.render(root)) {
+    BOOST_WARN_MESSAGE(FALSE, "maxUpdateRate skipped: no GL context");
+    root->unref();
+    return;
+  }
+  BOOST_CHECK_EQUAL(count, 1);
+
+  // the change is delayed for 1000 seconds
+  submaterial->diffuseColor.setValue(1.0f, 0.0f, 0.0f);
+  BOOST_REQUIRE(renderer.render(root));
+  BOOST_CHECK_EQUAL(count, 1);
+
+  textures[0]->maxUpdateRate = 0.0f;
+  BOOST_REQUIRE(renderer.render(root));
+  BOOST_CHECK_EQUAL(count, 2);
+  root->unref();
+}
+
+BOOST_AUTO_TEST_CASE(shareTexture)
+{
+  if (!scenetexture2_canRender()) {
+    BOOST_WARN_MESSAGE(FALSE, "shareTexture skipped: no X display");
+    return;
+  }
+  SoSceneTexture2 * textures[2];
+  SoMaterial * submaterial;
+  int count = 0;
+  SbBool hasfbo = FALSE;
+  SoSeparator * root = scenetexture2_createScene(textures, submaterial, count, hasfbo);
+  textures[0]->shareTexture = TRUE;
+  textures[1]->shareTexture = TRUE;
+
+  SoOffscreenRenderer renderer(SbViewportRegion(32, 32));
+  if (!renderer.render(root) || !hasfbo) {
+    // only frame buffer object textures are shared
+    BOOST_WARN_MESSAGE(FALSE, "shareTexture skipped: no frame buffer objects");
+    root->unref();
+    return;
+  }
+  BOOST_CHECK_EQUAL(count, 1);
+
+  submaterial->diffuseColor.setValue(1.0f, 0.0f, 0.0f);
+  BOOST_REQUIRE(renderer.render(root));
+  BOOST_CHECK_EQUAL(count, 2);
+
+  // the first texture recreates its frame buffer objects, so the
+  // second one can't use its old texture any more
+  textures[0]->size.setValue(32, 32);
+  BOOST_REQUIRE(renderer.render(root));
+  BOOST_CHECK_EQUAL(count, 4);
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
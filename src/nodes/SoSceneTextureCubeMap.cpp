@@ -32,6 +32,9 @@
 
 #include <Inventor/nodes/SoSceneTextureCubeMap.h>
 #include "coindefs.h"
+
+#include <cstring>
+
 #include <Inventor/SoInput.h>
 #include <Inventor/nodes/SoSubNode.h>
 #include <Inventor/actions/SoCallbackAction.h>
@@ -50,6 +53,8 @@
 #include <Inventor/errors/SoReadError.h>
 #include <Inventor/misc/SoGLCubeMapImage.h>
 #include <Inventor/sensors/SoFieldSensor.h>
+#include <Inventor/sensors/SoAlarmSensor.h>
+#include <Inventor/lists/SbList.h>
 #include <Inventor/lists/SbStringList.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/nodes/SoSeparator.h>
@@ -67,6 +72,9 @@
 #include <Inventor/threads/SbMutex.h>
 #endif // COIN_THREADSAFE
 
+#include "threads/threadsutilp.h"
+#include "tidbitsp.h"
+
 // *************************************************************************
 
 /*!
@@ -74,9 +82,66 @@
   \brief Renders a scene into a texture cube map.
 
   \ingroup coin_nodes
+
+  Rendering the six faces of the cube map is expensive, so for
+  animated sub scenes the SoSceneTextureCubeMap::maxUpdateRate,
+  SoSceneTextureCubeMap::faceUpdate and
+  SoSceneTextureCubeMap::shareTexture fields can be used to control
+  how much work is done each frame.
+
   \since Coin 2.5
 */
 
+/*!
+  \enum SoSceneTextureCubeMap::FaceUpdate
+
+  Strategies for re-rendering the cube map faces when the sub scene
+  changes.
+
+  \since Coin 4.1
+*/
+/*!
+  \var SoSceneTextureCubeMap::FaceUpdate SoSceneTextureCubeMap::ALL_FACES
+  All six faces are rendered in the frame where the change is detected.
+*/
+/*!
+  \var SoSceneTextureCubeMap::FaceUpdate SoSceneTextureCubeMap::ONE_FACE_PER_FRAME
+  One face is rendered per frame, in a round-robin fashion, until all
+  faces are up to date. The initial rendering of the cube map always
+  renders all faces.
+*/
+
+/*!
+  \var SoSFFloat SoSceneTextureCubeMap::maxUpdateRate
+
+  The maximum number of times per second the sub scene will be
+  rendered into the cube map. Changes happening more often than this
+  are delayed, and a redraw is scheduled so that the cube map catches
+  up with the last change. Default value is 0.0, which means that the
+  cube map is updated on every change.
+
+  \since Coin 4.1
+*/
+/*!
+  \var SoSFEnum SoSceneTextureCubeMap::faceUpdate
+
+  How to update the faces when the sub scene changes. Default value
+  is SoSceneTextureCubeMap::ALL_FACES.
+
+  \since Coin 4.1
+*/
+/*!
+  \var SoSFBool SoSceneTextureCubeMap::shareTexture
+
+  When TRUE, this node will copy the cube map rendered by another
+  SoSceneTextureCubeMap node with shareTexture set, instead of
+  rendering the scene again, as long as both have the same
+  SoSceneTextureCubeMap::scene, SoSceneTextureCubeMap::size and
+  SoSceneTextureCubeMap::backgroundColor values. Default value is FALSE.
+
+  \since Coin 4.1
+*/
+
 // FIXME: more detailed description on how the camera is to be set 20050429 martin
 // if scene does not contain a camera, a default camera is inserted into the
 // cachedScene (the original scene stays untouched!)
@@ -125,6 +190,24 @@ class SoSceneTextureCubeMapP {
   SbBool hadSceneCamera;
   SbBool hasSceneChanged;
 
+  // update rate limiting and round-robin face updates
+  SbTime lastupdate;
+  SoAlarmSensor * updatesensor;
+  int nextface;
+  int facesleft;
+  SbBool delayUpdate(void);
+  void scheduleUpdate(const SbTime & when);
+  static void updatesensorCB(void * data, SoSensor * sensor);
+
+  // sharing between instances rendering the same scene
+  SbBool canShareWith(const SoSceneTextureCubeMapP * other) const;
+  SbBool shareTexture(SoState * state, const float quality);
+  void createGLImage(SoState * state, const float quality);
+
+  static SbList <SoSceneTextureCubeMapP *> * instances;
+  static void * instancesmutex;
+  static void cleanupClass(void);
+
   // FIXME: this will not work on all platforms/compilers
   static SbRotation ROT_NEG_X;
   static SbRotation ROT_POS_X;
@@ -152,6 +235,9 @@ SbRotation SoSceneTextureCubeMapP::ROT_POS_Z =
   SbRotation(SbVec3f(0,1,0), (float) M_PI) *
   SbRotation(SbVec3f(0,0,1), (float) M_PI);
 
+SbList <SoSceneTextureCubeMapP *> * SoSceneTextureCubeMapP::instances = NULL;
+void * SoSceneTextureCubeMapP::instancesmutex = NULL;
+
 #define PRIVATE(p) (p->pimpl)
 
 #ifdef COIN_THREADSAFE
@@ -191,6 +277,9 @@ SoSceneTextureCubeMap::SoSceneTextureCubeMap(void)
   SO_NODE_ADD_FIELD(wrapR, (REPEAT));
   SO_NODE_ADD_FIELD(model, (MODULATE));
   SO_NODE_ADD_FIELD(blendColor, (0.0f, 0.0f, 0.0f));
+  SO_NODE_ADD_FIELD(maxUpdateRate, (0.0f));
+  SO_NODE_ADD_FIELD(faceUpdate, (ALL_FACES));
+  SO_NODE_ADD_FIELD(shareTexture, (FALSE));
 
   SO_NODE_DEFINE_ENUM_VALUE(Wrap, REPEAT);
   SO_NODE_DEFINE_ENUM_VALUE(Wrap, CLAMP);
@@ -209,6 +298,10 @@ SoSceneTextureCubeMap::SoSceneTextureCubeMap(void)
   SO_NODE_DEFINE_ENUM_VALUE(TransparencyFunction, ALPHA_BLEND);
   SO_NODE_DEFINE_ENUM_VALUE(TransparencyFunction, ALPHA_TEST);
   SO_NODE_SET_SF_ENUM_TYPE(transparencyFunction, TransparencyFunction);
+
+  SO_NODE_DEFINE_ENUM_VALUE(FaceUpdate, ALL_FACES);
+  SO_NODE_DEFINE_ENUM_VALUE(FaceUpdate, ONE_FACE_PER_FRAME);
+  SO_NODE_SET_SF_ENUM_TYPE(faceUpdate, FaceUpdate);
 }
 
 /*!
@@ -229,6 +322,10 @@ SoSceneTextureCubeMap::initClass(void)
 {
   SO_NODE_INIT_CLASS(SoSceneTextureCubeMap, SoNode, "Node");
 
+  SoSceneTextureCubeMapP::instances = new SbList <SoSceneTextureCubeMapP *>;
+  CC_MUTEX_CONSTRUCT(SoSceneTextureCubeMapP::instancesmutex);
+  coin_atexit((coin_atexit_f*) SoSceneTextureCubeMapP::cleanupClass, CC_ATEXIT_NORMAL);
+
   SO_ENABLE(SoGLRenderAction, SoGLMultiTextureImageElement);
   SO_ENABLE(SoGLRenderAction, SoGLMultiTextureEnabledElement);
 
@@ -255,9 +352,17 @@ SoSceneTextureCubeMap::GLRender(SoGLRenderAction * action)
 
   LOCK_GLIMAGE(this);
 
-  if (root && (!PRIVATE(this)->glimagevalid || !PRIVATE(this)->pbuffervalid)) {
-    PRIVATE(this)->updatePBuffer(state, quality);
-    
+  if (root && (!PRIVATE(this)->glimagevalid || !PRIVATE(this)->pbuffervalid) &&
+      !PRIVATE(this)->delayUpdate()) {
+    if (!this->shareTexture.getValue() || !PRIVATE(this)->shareTexture(state, quality)) {
+      PRIVATE(this)->updatePBuffer(state, quality);
+    }
+    PRIVATE(this)->lastupdate = SbTime::getTimeOfDay();
+    if (!PRIVATE(this)->pbuffervalid) {
+      // more faces to render, make sure we get another frame
+      PRIVATE(this)->scheduleUpdate(PRIVATE(this)->lastupdate);
+    }
+
     // don't cache when we change the glimage
     SoCacheElement::setInvalid(TRUE);
     if (state->isCacheOpen()) {
@@ -332,9 +437,12 @@ SoSceneTextureCubeMap::notify(SoNotList * list)
   if (f == &this->scene) {
     PRIVATE(this)->hasSceneChanged = TRUE; // refetch camera and scene
     PRIVATE(this)->pbuffervalid = FALSE; // rerender scene
+    PRIVATE(this)->facesleft = 6;
   }
-  else if (f == &this->size) {
+  else if (f == &this->size || f == &this->backgroundColor ||
+           f == &this->shareTexture) {
     PRIVATE(this)->pbuffervalid = FALSE; // rerender scene
+    PRIVATE(this)->facesleft = 6;
   }
   else if (f == &this->wrapS || f == &this->wrapT || f == &this->wrapR ||
            f == &this->model || f == &this->transparencyFunction) {
@@ -368,10 +476,23 @@ SoSceneTextureCubeMapP::SoSceneTextureCubeMapP(SoSceneTextureCubeMap * apiptr)
   this->cachedCamera = NULL;
   this->hadSceneCamera = FALSE;
   this->hasSceneChanged = TRUE;
+  this->updatesensor = NULL;
+  this->nextface = 0;
+  this->facesleft = 6;
+
+  CC_MUTEX_LOCK(SoSceneTextureCubeMapP::instancesmutex);
+  SoSceneTextureCubeMapP::instances->append(this);
+  CC_MUTEX_UNLOCK(SoSceneTextureCubeMapP::instancesmutex);
 }
 
 SoSceneTextureCubeMapP::~SoSceneTextureCubeMapP()
 {
+  if (SoSceneTextureCubeMapP::instances) {
+    CC_MUTEX_LOCK(SoSceneTextureCubeMapP::instancesmutex);
+    SoSceneTextureCubeMapP::instances->removeItem(this);
+    CC_MUTEX_UNLOCK(SoSceneTextureCubeMapP::instancesmutex);
+  }
+  delete this->updatesensor;
   if (this->glimage) this->glimage->unref(NULL);
   this->destroyCamera();
   if (this->glcontext != NULL) {
@@ -464,6 +585,10 @@ SoSceneTextureCubeMapP::updatePBuffer(SoState * state, const float quality)
     this->glimagevalid = FALSE;
   }
 
+  // the faces rendered in this frame
+  int first = 0;
+  int count = 6;
+
   if (!this->pbuffervalid) {
     assert(this->glaction != NULL);
     assert(this->glcontext != NULL);
@@ -479,82 +604,102 @@ SoSceneTextureCubeMapP::updatePBuffer(SoState * state, const float quality)
       SbVec2s size = this->glcontextsize;
       int cubeSideSize = size[0]*size[1]*4;
       int reqbytes = cubeSideSize*6; // 6 cube sides
+
+      // only render a single face if we already have a complete cube
+      // map in the buffer
+      if (PUBLIC(this)->faceUpdate.getValue() == SoSceneTextureCubeMap::ONE_FACE_PER_FRAME &&
+          this->glimagevalid && this->glimage &&
+          reqbytes <= this->offscreenbuffersize) {
+        first = this->nextface;
+        count = 1;
+      }
+
       if (reqbytes > this->offscreenbuffersize) {
         delete[] this->offscreenbuffer;
         this->offscreenbuffer = new unsigned char[reqbytes];
         this->offscreenbuffersize = reqbytes;
       }
 
-      unsigned char * cubeSidePtr = this->offscreenbuffer;
-                  
-      for (int i=0; i<6; i++) {
-        this->glaction->apply(this->updateCamera((SoGLCubeMapImage::Target)i));
+      for (int i = first; i < first + count; i++) {
+        const int face = i % 6;
+        unsigned char * cubeSidePtr = this->offscreenbuffer + face * cubeSideSize;
+        this->glaction->apply(this->updateCamera((SoGLCubeMapImage::Target)face));
         glFlush();
 
         glPixelStorei(GL_PACK_ALIGNMENT, 1);
         glReadPixels(0,0,size[0],size[1],GL_RGBA,GL_UNSIGNED_BYTE,cubeSidePtr);
         glPixelStorei(GL_PACK_ALIGNMENT, 4);
-        cubeSidePtr += cubeSideSize;
       }
+      this->nextface = (first + count) % 6;
+      this->facesleft = (count == 6) ? 0 : this->facesleft - count;
+    }
+    else {
+      this->facesleft = 0;
     }
 
     cc_glglue_context_reinstate_previous(this->glcontext);
   }
 
   if (!this->glimagevalid || (this->glimage == NULL)) {
-    // just delete old glimage
-    if (this->glimage) {
-      this->glimage->unref(state);
-      this->glimage = NULL;
-    }
-    this->glimage = new SoGLCubeMapImage;
-    uint32_t flags = this->glimage->getFlags();
-    if (this->glrectangle) {
-      flags |= SoGLImage::RECTANGLE;
-    }
-    switch ((SoSceneTextureCubeMap::TransparencyFunction) (PUBLIC(this)->transparencyFunction.getValue())) {
-    case SoSceneTextureCubeMap::NONE:
-      flags |= SoGLImage::FORCE_TRANSPARENCY_FALSE|SoGLImage::FORCE_ALPHA_TEST_FALSE;
-      break;
-    case SoSceneTextureCubeMap::ALPHA_TEST:
-      flags |= SoGLImage::FORCE_TRANSPARENCY_TRUE|SoGLImage::FORCE_ALPHA_TEST_TRUE;
-      break;
-    case SoSceneTextureCubeMap::ALPHA_BLEND:
-      flags |= SoGLImage::FORCE_TRANSPARENCY_TRUE|SoGLImage::FORCE_ALPHA_TEST_FALSE;
-      break;
-    default:
-      assert(0 && "should not get here");
-      break;
-    }
-    this->glimage->setFlags(flags);
-
-    if (this->canrendertotexture) {
-      // FIXME: not implemented yet - 20050427 martin
-
-      // bind texture to pbuffer
-      this->glimage->setPBuffer(state, this->glcontext,
-                                translateWrap((SoSceneTextureCubeMap::Wrap)PUBLIC(this)->wrapS.getValue()),
-                                translateWrap((SoSceneTextureCubeMap::Wrap)PUBLIC(this)->wrapT.getValue()),
-                                quality);
-    }
+    this->createGLImage(state, quality);
   }
 
   if (!this->canrendertotexture && !this->pbuffervalid) {
     assert(this->glimage);
     assert(this->offscreenbuffer);
     int cubeSideSize = this->glcontextsize[0] * this->glcontextsize[1] * 4;
-    unsigned char * cubeSidePtr = this->offscreenbuffer;
-        
+
     // FIXME: what about  wrapS, wrapT, wrapR, and quality? - martin 20050427
-    for (int i=0; i<6; i++) {
-      this->glimage->setCubeMapImage((SoGLCubeMapImage::Target)i, 
-                                     cubeSidePtr, 
+    // only the faces rendered now need to be uploaded again
+    for (int i = first; i < first + count; i++) {
+      const int face = i % 6;
+      this->glimage->setCubeMapImage((SoGLCubeMapImage::Target)face,
+                                     this->offscreenbuffer + face * cubeSideSize,
                                      this->glcontextsize, 4);
-      cubeSidePtr += cubeSideSize;
     }
   }
   this->glimagevalid = TRUE;
-  this->pbuffervalid = TRUE;
+  this->pbuffervalid = (this->facesleft <= 0);
+}
+
+void
+SoSceneTextureCubeMapP::createGLImage(SoState * state, const float quality)
+{
+  // just delete old glimage
+  if (this->glimage) {
+    this->glimage->unref(state);
+    this->glimage = NULL;
+  }
+  this->glimage = new SoGLCubeMapImage;
+  uint32_t flags = this->glimage->getFlags();
+  if (this->glrectangle) {
+    flags |= SoGLImage::RECTANGLE;
+  }
+  switch ((SoSceneTextureCubeMap::TransparencyFunction) (PUBLIC(this)->transparencyFunction.getValue())) {
+  case SoSceneTextureCubeMap::NONE:
+    flags |= SoGLImage::FORCE_TRANSPARENCY_FALSE|SoGLImage::FORCE_ALPHA_TEST_FALSE;
+    break;
+  case SoSceneTextureCubeMap::ALPHA_TEST:
+    flags |= SoGLImage::FORCE_TRANSPARENCY_TRUE|SoGLImage::FORCE_ALPHA_TEST_TRUE;
+    break;
+  case SoSceneTextureCubeMap::ALPHA_BLEND:
+    flags |= SoGLImage::FORCE_TRANSPARENCY_TRUE|SoGLImage::FORCE_ALPHA_TEST_FALSE;
+    break;
+  default:
+    assert(0 && "should not get here");
+    break;
+  }
+  this->glimage->setFlags(flags);
+
+  if (this->canrendertotexture) {
+    // FIXME: not implemented yet - 20050427 martin
+
+    // bind texture to pbuffer
+    this->glimage->setPBuffer(state, this->glcontext,
+                              translateWrap((SoSceneTextureCubeMap::Wrap)PUBLIC(this)->wrapS.getValue()),
+                              translateWrap((SoSceneTextureCubeMap::Wrap)PUBLIC(this)->wrapT.getValue()),
+                              quality);
+  }
 }
 
 void
@@ -694,7 +839,319 @@ SoSceneTextureCubeMapP::prerendercb(void * userdata, SoGLRenderAction * COIN_UNU
   glClear(GL_DEPTH_BUFFER_BIT|GL_COLOR_BUFFER_BIT);
 }
 
+// Returns TRUE if the cube map should not be updated yet because of
+// SoSceneTextureCubeMap::maxUpdateRate.
+SbBool
+SoSceneTextureCubeMapP::delayUpdate(void)
+{
+  const float rate = PUBLIC(this)->maxUpdateRate.getValue();
+  // never delay if we don't have a usable texture to show meanwhile
+  if (rate <= 0.0f || !this->glimagevalid || this->glimage == NULL) return FALSE;
+
+  const SbTime interval(1.0 / rate);
+  if (SbTime::getTimeOfDay() - this->lastupdate >= interval) return FALSE;
+
+  this->scheduleUpdate(this->lastupdate + interval);
+  return TRUE;
+}
+
+// Schedules a redraw at the given time, so that a delayed or partial
+// update is completed even if nothing else triggers a redraw.
+void
+SoSceneTextureCubeMapP::scheduleUpdate(const SbTime & when)
+{
+  if (this->updatesensor == NULL) {
+    this->updatesensor = new SoAlarmSensor(SoSceneTextureCubeMapP::updatesensorCB, this);
+  }
+  if (!this->updatesensor->isScheduled()) {
+    this->updatesensor->setTime(when);
+    this->updatesensor->schedule();
+  }
+}
+
+void
+SoSceneTextureCubeMapP::updatesensorCB(void * data, SoSensor * COIN_UNUSED_ARG(sensor))
+{
+  SoSceneTextureCubeMapP * thisp = (SoSceneTextureCubeMapP *) data;
+  PUBLIC(thisp)->touch();
+}
+
+// Returns TRUE if other has a complete cube map in its offscreen
+// buffer that can be used instead of rendering the scene again.
+SbBool
+SoSceneTextureCubeMapP::canShareWith(const SoSceneTextureCubeMapP * other) const
+{
+  const SoSceneTextureCubeMap * a = PUBLIC(this);
+  const SoSceneTextureCubeMap * b = PUBLIC(other);
+
+  if (other == this || !b->shareTexture.getValue()) return FALSE;
+  if (!other->pbuffervalid || !other->glimagevalid) return FALSE;
+  if (other->canrendertotexture || other->offscreenbuffer == NULL) return FALSE;
+
+  return
+    a->scene.getValue() == b->scene.getValue() &&
+    a->size.getValue() == b->size.getValue() &&
+    a->backgroundColor.getValue() == b->backgroundColor.getValue();
+}
+
+// Tries to copy the cube map of another instance. Returns FALSE if
+// no suitable instance was found.
+SbBool
+SoSceneTextureCubeMapP::shareTexture(SoState * state, const float quality)
+{
+  SbBool found = FALSE;
+
+  CC_MUTEX_LOCK(SoSceneTextureCubeMapP::instancesmutex);
+  for (int i = 0; !found && i < SoSceneTextureCubeMapP::instances->getLength(); i++) {
+    SoSceneTextureCubeMapP * other = (*SoSceneTextureCubeMapP::instances)[i];
+    if (other == this) continue;
+#ifdef COIN_THREADSAFE
+    // the other node may be rendering into its buffer. Don't wait for
+    // it, as it might be waiting for the instance list while holding
+    // its lock
+    if (!other->mutex.tryLock()) continue;
+#endif // COIN_THREADSAFE
+    if (!this->canShareWith(other)) {
+#ifdef COIN_THREADSAFE
+      other->mutex.unlock();
+#endif // COIN_THREADSAFE
+      continue;
+    }
+
+    const int reqbytes = other->glcontextsize[0] * other->glcontextsize[1] * 4 * 6;
+    if (reqbytes > this->offscreenbuffersize) {
+      delete[] this->offscreenbuffer;
+      this->offscreenbuffer = new unsigned char[reqbytes];
+      this->offscreenbuffersize = reqbytes;
+    }
+    memcpy(this->offscreenbuffer, other->offscreenbuffer, reqbytes);
+    this->glcontextsize = other->glcontextsize;
+    this->glrectangle = other->glrectangle;
+#ifdef COIN_THREADSAFE
+    other->mutex.unlock();
+#endif // COIN_THREADSAFE
+
+    // our own offscreen context is no longer needed
+    if (this->glcontext) {
+      cc_glglue_context_destruct(this->glcontext);
+      this->glcontext = NULL;
+    }
+    delete this->glaction;
+    this->glaction = NULL;
+
+    this->canrendertotexture = FALSE;
+    found = TRUE;
+  }
+  CC_MUTEX_UNLOCK(SoSceneTextureCubeMapP::instancesmutex);
+
+  if (!found) return FALSE;
+
+  if (!this->glimagevalid || this->glimage == NULL) {
+    this->createGLImage(state, quality);
+  }
+  const int cubeSideSize = this->glcontextsize[0] * this->glcontextsize[1] * 4;
+  for (int i = 0; i < 6; i++) {
+    this->glimage->setCubeMapImage((SoGLCubeMapImage::Target)i,
+                                   this->offscreenbuffer + i * cubeSideSize,
+                                   this->glcontextsize, 4);
+  }
+  this->facesleft = 0;
+  this->glimagevalid = TRUE;
+  this->pbuffervalid = TRUE;
+  return TRUE;
+}
+
+void
+SoSceneTextureCubeMapP::cleanupClass(void)
+{
+  delete SoSceneTextureCubeMapP::instances;
+  SoSceneTextureCubeMapP::instances = NULL;
+  CC_MUTEX_DESTRUCT(SoSceneTextureCubeMapP::instancesmutex);
+}
+
 #undef LOCK_GLIMAGE
 #undef UNLOCK_GLIMAGE
 #undef PRIVATE
 #undef PUBLIC
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoDB.h>
+#include <Inventor/SoInput.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/nodes/SoCallback.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoMaterial.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <cstring>
+
+BOOST_AUTO_TEST_CASE(readUpdateFields)
+{
+  SoSceneTextureCubeMap * node = new SoSceneTextureCubeMap;
+  node->ref();
+  BOOST_CHECK_EQUAL(node->maxUpdateRate.getValue(), 0.0f);
+  BOOST_CHECK_EQUAL(node->faceUpdate.getValue(), (int) SoSceneTextureCubeMap::ALL_FACES);
+  BOOST_CHECK(!node->shareTexture.getValue());
+  node->unref();
+
+  const char * scene =
+    "#Inventor V2.1 ascii\n\n"
+    "SoSceneTextureCubeMap {\n"
+    "  maxUpdateRate 2.5 faceUpdate ONE_FACE_PER_FRAME shareTexture TRUE\n"
+    "}\n";
+  SoInput in;
+  in.setBuffer(scene, strlen(scene));
+  SoSeparator * root = SoDB::readAll(&in);
+  BOOST_REQUIRE(root != NULL);
+  root->ref();
+  BOOST_REQUIRE(root->getNumChildren() == 1);
+  BOOST_REQUIRE(root->getChild(0)->isOfType(SoSceneTextureCubeMap::getClassTypeId()));
+  node = static_cast<SoSceneTextureCubeMap *>(root->getChild(0));
+  BOOST_CHECK_EQUAL(node->maxUpdateRate.getValue(), 2.5f);
+  BOOST_CHECK_EQUAL(node->faceUpdate.getValue(),
+                    (int) SoSceneTextureCubeMap::ONE_FACE_PER_FRAME);
+  BOOST_CHECK(node->shareTexture.getValue());
+  root->unref();
+}
+
+// Counts the number of cube map faces rendered.
+static void
+scenetexturecubemap_countCB(void * closure, SoAction * action)
+{
+  if (action->isOfType(SoGLRenderAction::getClassTypeId())) {
+    (*((int *) closure))++;
+  }
+}
+
+// Sets up a scene with two cube maps using the same sub scene.
+static SoSeparator *
+scenetexturecubemap_createScene(SoSceneTextureCubeMap * textures[2],
+                                SoMaterial *& submaterial, int & count)
+{
+  SoSeparator * sub = new SoSeparator;
+  SoCallback * counter = new SoCallback;
+  counter->setCallback(scenetexturecubemap_countCB, &count);
+  sub->addChild(counter);
+  submaterial = new SoMaterial;
+  sub->addChild(submaterial);
+  sub->addChild(new SoCube);
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  root->addChild(new SoOrthographicCamera);
+  for (int i = 0; i < 2; i++) {
+    textures[i] = new SoSceneTextureCubeMap;
+    textures[i]->size.setValue(16, 16);
+    textures[i]->scene = sub;
+    root->addChild(textures[i]);
+    root->addChild(new SoCube);
+  }
+  return root;
+}
+
+// Renders the initial cube maps. Returns FALSE, and reports the test
+// as skipped, if there is no GL context or if the faces are rendered
+// directly into the texture, which is not done face by face.
+static SbBool
+scenetexturecubemap_initialRender(SoOffscreenRenderer & renderer, SoNode * root,
+                                  const int & count, const char * test)
+{
+#if !defined(_WIN32) && !defined(__APPLE__)
+  // offscreen contexts need an X display with GLX
+  if (coin_getenv("DISPLAY") == NULL) {
+    BOOST_WARN_MESSAGE(FALSE, test << " skipped: no X display");
+    return FALSE;
+  }
+#endif // !_WIN32 && !__APPLE__
+  if (!renderer.render(root)) {
+    BOOST_WARN_MESSAGE(FALSE, test << " skipped: no GL context");
+    return FALSE;
+  }
+  if (count == 0) {
+    BOOST_WARN_MESSAGE(FALSE, test << " skipped: render to texture");
+    return FALSE;
+  }
+  return TRUE;
+}
+
+BOOST_AUTO_TEST_CASE(maxUpdateRate)
+{
+  SoSceneTextureCubeMap * textures[2];
+  SoMaterial * submaterial;
+  int count = 0;
+  SoSeparator * root = scenetexturecubemap_createScene(textures, submaterial, count);
+  root->removeChild(textures[1]);
+  textures[0]->maxUpdateRate = 0.001f;
+
+  SoOffscreenRenderer renderer(SbViewportRegion(32, 32));
+  if (scenetexturecubemap_initialRender(renderer, root, count, "maxUpdateRate")) {
+    BOOST_CHECK_EQUAL(count, 6);
+
+    // the change is delayed for 1000 seconds
+    submaterial->diffuseColor.setValue(1.0f, 0.0f, 0.0f);
+    BOOST_REQUIRE(renderer.render(root));
+    BOOST_CHECK_EQUAL(count, 6);
+
+    textures[0]->maxUpdateRate = 0.0f;
+    BOOST_REQUIRE(renderer.render(root));
+    BOOST_CHECK_EQUAL(count, 12);
+  }
+  root->unref();
+}
+
+BOOST_AUTO_TEST_CASE(faceUpdate)
+{
+  SoSceneTextureCubeMap * textures[2];
+  SoMaterial * submaterial;
+  int count = 0;
+  SoSeparator * root = scenetexturecubemap_createScene(textures, submaterial, count);
+  root->removeChild(textures[1]);
+  textures[0]->faceUpdate = SoSceneTextureCubeMap::ONE_FACE_PER_FRAME;
+
+  SoOffscreenRenderer renderer(SbViewportRegion(32, 32));
+  if (scenetexturecubemap_initialRender(renderer, root, count, "faceUpdate")) {
+    // the initial cube map is always rendered completely
+    BOOST_CHECK_EQUAL(count, 6);
+
+    submaterial->diffuseColor.setValue(1.0f, 0.0f, 0.0f);
+    for (int i = 1; i <= 6; i++) {
+      BOOST_REQUIRE(renderer.render(root));
+      BOOST_CHECK_EQUAL(count, 6 + i);
+    }
+    // all faces are up to date
+    BOOST_REQUIRE(renderer.render(root));
+    BOOST_CHECK_EQUAL(count, 12);
+  }
+  root->unref();
+}
+
+BOOST_AUTO_TEST_CASE(shareTexture)
+{
+  SoSceneTextureCubeMap * textures[2];
+  SoMaterial * submaterial;
+  int count = 0;
+  SoSeparator * root = scenetexturecubemap_createScene(textures, submaterial, count);
+  textures[0]->shareTexture = TRUE;
+  textures[1]->shareTexture = TRUE;
+
+  SoOffscreenRenderer renderer(SbViewportRegion(32, 32));
+  if (scenetexturecubemap_initialRender(renderer, root, count, "shareTexture")) {
+    BOOST_CHECK_EQUAL(count, 6);
+
+    submaterial->diffuseColor.setValue(1.0f, 0.0f, 0.0f);
+    BOOST_REQUIRE(renderer.render(root));
+    BOOST_CHECK_EQUAL(count, 12);
+
+    // different sizes can't be shared
+    textures[1]->size.setValue(32, 32);
+    BOOST_REQUIRE(renderer.render(root));
+    BOOST_CHECK_EQUAL(count, 18);
+  }
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
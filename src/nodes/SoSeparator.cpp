@@ -81,18 +81,22 @@
 #include <Inventor/elements/SoCullElement.h>
 #include <Inventor/elements/SoLocalBBoxMatrixElement.h>
 #include <Inventor/elements/SoSoundElement.h>
+#include <Inventor/nodes/SoShape.h>
+#include <Inventor/lists/SbList.h>
 #include <Inventor/misc/SoChildList.h>
 #include <Inventor/misc/SoState.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/system/gl.h>
 #include <Inventor/C/tidbits.h> // coin_getenv()
 #include <Inventor/threads/SbStorage.h>
+#include <Inventor/SoFullPath.h>
 
 #ifdef COIN_THREADSAFE
 #include <Inventor/threads/SbMutex.h>
 #endif // COIN_THREADSAFE
 
 #include "coindefs.h" // COIN_OBSOLETED()
+#include "SbBasicP.h"
 #include "nodes/SoSubNodeP.h"
 #include "glue/glp.h"
 #include "rendering/SoGL.h"
@@ -302,10 +306,9 @@ soseparator_storage_destruct(void * data)
 class SoSeparatorP {
 public:
   SoSeparatorP(void) {
-    this->glcachestorage =
-      new SbStorage(sizeof(soseparator_storage),
-                    soseparator_storage_construct,
-                    soseparator_storage_destruct);
+    // the GL cache storage is allocated on first use, as most
+    // separators in large scene graphs will never get a render cache
+    this->glcachestorage = NULL;
     this->pub = NULL;
   }
   ~SoSeparatorP() {
@@ -318,6 +321,34 @@ public:
   uint32_t bboxcache_usecount;
   uint32_t bboxcache_destroycount;
 
+  // bounding box of a single child, in the local coordinate system of
+  // the separator, used when refitting the separator bbox cache. The
+  // box includes the transformations of the preceding siblings, which
+  // are not tracked by the cache, so the matrix is stored as well.
+  struct ChildBBox {
+    SoNode * node;
+    SoBoundingBoxCache * cache;
+    SbMatrix localmatrix;
+  };
+  SbList<ChildBBox> childbboxes;
+  static SbBool bboxrefit;
+
+  static SbBool isolatesState(const SoNode * node) {
+    return
+      node->isOfType(SoSeparator::getClassTypeId()) ||
+      node->isOfType(SoShape::getClassTypeId());
+  }
+  void truncateChildBBoxes(const int length) {
+    for (int i = length; i < this->childbboxes.getLength(); i++) {
+      if (this->childbboxes[i].cache) this->childbboxes[i].cache->unref();
+    }
+    if (length < this->childbboxes.getLength()) {
+      this->childbboxes.truncate(length);
+    }
+  }
+  void invalidateChildBBoxes(const SoBase * from);
+  void refitBoundingBox(SoGetBoundingBoxAction * action);
+
 #ifdef COIN_THREADSAFE
   // FIXME: a mutex for every SoSeparator instance seems a bit
   // excessive, especially since Microsoft Windows might have rather strict
@@ -339,7 +370,9 @@ public:
   SoGLCacheList * getGLCacheList(SbBool createifnull);
 
   void invalidateGLCaches(void) {
-    glcachestorage->applyToAll(invalidate_gl_cache, NULL);
+    if (this->glcachestorage) {
+      this->glcachestorage->applyToAll(invalidate_gl_cache, NULL);
+    }
   }
 
   void lock(void) {
@@ -357,6 +390,8 @@ public:
                        SbBool (* cullfunc)(SoState *, const SbBox3f &, const SbBool));
 };
 
+SbBool SoSeparatorP::bboxrefit = FALSE;
+
 #define PRIVATE(obj) ((obj)->pimpl)
 #define PUBLIC(obj) ((obj)->pub)
 
@@ -365,6 +400,14 @@ public:
 SoGLCacheList *
 SoSeparatorP::getGLCacheList(SbBool createifnull)
 {
+  // called with the instance mutex locked
+  if (this->glcachestorage == NULL) {
+    if (!createifnull) return NULL;
+    this->glcachestorage =
+      new SbStorage(sizeof(soseparator_storage),
+                    soseparator_storage_construct,
+                    soseparator_storage_destruct);
+  }
   soseparator_storage * ptr =
     (soseparator_storage*) this->glcachestorage->get();
   if (createifnull && ptr->glcachelist == NULL) {
@@ -466,6 +509,7 @@ SoSeparator::~SoSeparator()
   if (PRIVATE(this)->bboxcache) {
     PRIVATE(this)->bboxcache->unref();
   }
+  PRIVATE(this)->truncateChildBBoxes(0);
 }
 
 /*!
@@ -490,6 +534,31 @@ SoSeparator::doAction(SoAction * action)
   action->getState()->pop();
 }
 
+// Returns TRUE if the bounding box might be reset while traversing
+// the children of the node at the tail of the current path. Cached
+// bounding boxes can't be used in that case.
+static SbBool
+soseparator_reset_below(SoGetBoundingBoxAction * action)
+{
+  const SoFullPath * curpath =
+    reclassify_cast<const SoFullPath *>(action->getCurPath());
+  const SoFullPath * resetpath =
+    reclassify_cast<const SoFullPath *>(action->getResetPath());
+
+  // SoGetBoundingBoxAction resets when the current path contains the
+  // reset path. When both paths start in the same node, which is the
+  // common case (e.g. for SoSurroundScale), this can only happen below
+  // us if the current path is a true prefix of the reset path. Be
+  // conservative for other reset paths.
+  if (resetpath->getHead() != curpath->getHead()) return TRUE;
+  const int len = curpath->getLength();
+  if (resetpath->getLength() <= len) return FALSE;
+  for (int i = 1; i < len; i++) {
+    if (curpath->getIndex(i) != resetpath->getIndex(i)) return FALSE;
+  }
+  return TRUE;
+}
+
 // Doc from superclass.
 void
 SoSeparator::getBoundingBox(SoGetBoundingBoxAction * action)
@@ -516,7 +585,10 @@ SoSeparator::getBoundingBox(SoGetBoundingBoxAction * action)
   case SoAction::BELOW_PATH:
   case SoAction::NO_PATH:
     // check if this is a normal traversal
-    if (action->isInCameraSpace() || action->isResetPath()) iscaching = FALSE;
+    if (action->isInCameraSpace()) iscaching = FALSE;
+    // the bounding box cache is stored in local coordinates, so it
+    // can be used as long as there is no reset below this node
+    else if (action->isResetPath() && soseparator_reset_below(action)) iscaching = FALSE;
     break;
   default:
     iscaching = FALSE;
@@ -542,7 +614,8 @@ SoSeparator::getBoundingBox(SoGetBoundingBoxAction * action)
     SbBool storedinvalid = FALSE;
 
     // check if we should disable auto caching
-    if (PRIVATE(this)->bboxcache_destroycount > 10 && this->boundingBoxCaching.getValue() == AUTO) {
+    if (PRIVATE(this)->bboxcache_destroycount > 10 && this->boundingBoxCaching.getValue() == AUTO &&
+        !SoSeparatorP::bboxrefit) {
       if (float(PRIVATE(this)->bboxcache_usecount) / float(PRIVATE(this)->bboxcache_destroycount) < 5.0f) {
         iscaching = FALSE;
       }
@@ -571,7 +644,12 @@ SoSeparator::getBoundingBox(SoGetBoundingBoxAction * action)
 
     SoLocalBBoxMatrixElement::makeIdentity(state);
     action->getXfBoundingBox().makeEmpty();
-    inherited::getBoundingBox(action);
+    if (iscaching && SoSeparatorP::bboxrefit) {
+      PRIVATE(this)->refitBoundingBox(action);
+    }
+    else {
+      inherited::getBoundingBox(action);
+    }
 
     childrenbbox = action->getXfBoundingBox();
     childrencenterset = action->isCenterSet();
@@ -752,6 +830,24 @@ SoSeparator::GLRenderBelowPath(SoGLRenderAction * action)
   }
 }
 
+/*!
+  Returns the render cache list used by the current thread, or \c NULL
+  if this separator has not been rendered with render caching
+  enabled. Useful for inspecting the per-separator caching
+  statistics.
+
+  \since Coin 4.1
+*/
+const SoGLCacheList *
+SoSeparator::getGLCacheList(void) const
+{
+  SoSeparatorP * thisp = &PRIVATE(this).get();
+  thisp->lock();
+  SoGLCacheList * glcachelist = thisp->getGLCacheList(FALSE);
+  thisp->unlock();
+  return glcachelist;
+}
+
 // Doc from superclass.
 void
 SoSeparator::GLRenderInPath(SoGLRenderAction * action)
@@ -927,6 +1023,44 @@ SoSeparator::getNumRenderCaches(void)
   return SoSeparator::numrendercaches;
 }
 
+/*!
+  Set whether SoSeparator nodes should refit their bounding box
+  caches from cached bounding boxes of their children, instead of
+  traversing the complete subgraph again when the cache has been
+  invalidated.
+
+  When enabled, each separator with bounding box caching keeps a
+  bounding box cache for every child separator and shape node. After
+  a change deep down in the scene graph, the bounding box is then
+  recalculated by traversing only the path down to the changed node,
+  while the boxes of unchanged siblings are reused. This makes
+  repeated SoGetBoundingBoxAction queries on large, frequently edited
+  scene graphs much cheaper, at the cost of some extra memory per
+  child node.
+
+  The default value is \c FALSE.
+
+  \since Coin 4.1
+*/
+void
+SoSeparator::setBoundingBoxRefit(const SbBool onoff)
+{
+  SoSeparatorP::bboxrefit = onoff;
+}
+
+/*!
+  Returns whether bounding box caches are refitted from the cached
+  bounding boxes of the children.
+
+  \sa setBoundingBoxRefit()
+  \since Coin 4.1
+*/
+SbBool
+SoSeparator::getBoundingBoxRefit(void)
+{
+  return SoSeparatorP::bboxrefit;
+}
+
 // Doc from superclass.
 SbBool
 SoSeparator::affectsState(void) const
@@ -948,12 +1082,15 @@ SoSeparator::getPrimitiveCount(SoGetPrimitiveCountAction * action)
 void
 SoSeparator::notify(SoNotList * nl)
 {
+  // fetch the notifying child before a record for this node is appended
+  const SoNotRec * rec = nl->getLastRec();
   inherited::notify(nl);
 
   // lock before using the cache pointers so that we know the pointers
   // are valid while reading them
   PRIVATE(this)->lock();
   if (PRIVATE(this)->bboxcache) PRIVATE(this)->bboxcache->invalidate();
+  PRIVATE(this)->invalidateChildBBoxes(rec ? rec->getBase() : NULL);
   PRIVATE(this)->invalidateGLCaches();
   PRIVATE(this)->hassoundchild = SoSeparatorP::MAYBE;
   PRIVATE(this)->unlock();
@@ -1011,6 +1148,120 @@ SoSeparatorP::doCull(SoSeparatorP * thisp, SoState * state,
   return outside;
 }
 
+// Invalidates the child bounding boxes which might be affected by a
+// notification from \a from. A change in a child that might affect
+// the traversal state invalidates all the boxes following it. Changes
+// in inherited state are caught when refitting, by the cache element
+// dependencies and the stored SoLocalBBoxMatrixElement matrix.
+void
+SoSeparatorP::invalidateChildBBoxes(const SoBase * from)
+{
+  // called with the instance mutex locked
+  const int n = this->childbboxes.getLength();
+  if (n == 0) return;
+
+  int first = (from == this->pub) ? 0 : -1;
+  if (first < 0) {
+    const SoChildList * children = this->pub->getChildren();
+    const int numchildren = SbMin(n, children->getLength());
+    for (int i = 0; i < numchildren; i++) {
+      if ((*children)[i] == from) {
+        if (!SoSeparatorP::isolatesState((*children)[i])) {
+          first = i;
+          break;
+        }
+        if (this->childbboxes[i].cache) this->childbboxes[i].cache->invalidate();
+        if (first < 0) first = n;
+      }
+    }
+    if (first < 0) first = 0; // unknown source
+  }
+  for (int i = first; i < n; i++) {
+    if (this->childbboxes[i].cache) this->childbboxes[i].cache->invalidate();
+  }
+}
+
+// Calculates the bounding box of the children by reusing the cached
+// bounding boxes of separators and shapes which haven't changed since
+// the last traversal. Other children are always traversed, since they
+// might change the traversal state.
+void
+SoSeparatorP::refitBoundingBox(SoGetBoundingBoxAction * action)
+{
+  SoState * state = action->getState();
+  SoChildList * children = this->pub->getChildren();
+  const int numchildren = children->getLength();
+
+  this->lock();
+  this->truncateChildBBoxes(numchildren);
+  while (this->childbboxes.getLength() < numchildren) {
+    ChildBBox entry;
+    entry.node = NULL;
+    entry.cache = NULL;
+    this->childbboxes.append(entry);
+  }
+  this->unlock();
+
+  SbVec3f acccenter(0.0f, 0.0f, 0.0f);
+  int numcenters = 0;
+
+  for (int i = 0; i < numchildren; i++) {
+    SoNode * child = (*children)[i];
+    ChildBBox & entry = this->childbboxes[i];
+
+    if (!SoSeparatorP::isolatesState(child)) {
+      children->traverse(action, i);
+    }
+    else if (entry.node == child && entry.cache && entry.cache->isValid(state) &&
+             entry.localmatrix == SoLocalBBoxMatrixElement::get(state)) {
+      SoCacheElement::addCacheDependency(state, entry.cache);
+      const SbXfBox3f & box = entry.cache->getBox();
+      if (!box.isEmpty()) action->getXfBoundingBox().extendBy(box);
+      if (entry.cache->isCenterSet()) {
+        acccenter += entry.cache->getCenter();
+        numcenters++;
+      }
+      if (entry.cache->hasLinesOrPoints()) {
+        SoBoundingBoxCache::setHasLinesOrPoints(state);
+      }
+    }
+    else {
+      SbXfBox3f abox = action->getXfBoundingBox();
+      state->push();
+
+      this->lock();
+      if (entry.cache) entry.cache->unref();
+      entry.node = child;
+      entry.localmatrix = SoLocalBBoxMatrixElement::get(state);
+      entry.cache = new SoBoundingBoxCache(state);
+      entry.cache->ref();
+      this->unlock();
+      SoCacheElement::set(state, entry.cache);
+
+      action->getXfBoundingBox().makeEmpty();
+      children->traverse(action, i);
+
+      SbXfBox3f childbox = action->getXfBoundingBox();
+      const SbBool centerset = action->isCenterSet();
+      const SbVec3f center = centerset ? action->getCenter() : SbVec3f(0.0f, 0.0f, 0.0f);
+      entry.cache->set(childbox, centerset, center);
+      state->pop();
+
+      action->getXfBoundingBox() = abox;
+      if (!childbox.isEmpty()) action->getXfBoundingBox().extendBy(childbox);
+    }
+
+    if (action->isCenterSet()) {
+      acccenter += action->getCenter();
+      numcenters++;
+      action->resetCenter();
+    }
+  }
+
+  if (numcenters != 0)
+    action->setCenter(acccenter / float(numcenters), FALSE);
+}
+
 /*!
   Internal method which do view frustum culling. For now, view frustum
   culling is performed if the renderCulling field is \c AUTO or \c ON,
@@ -1041,3 +1292,177 @@ SoSeparator::cullTestNoPush(SoState * state)
 #undef PRIVATE
 #undef PUBLIC
 #undef GLCACHE_DEBUG
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoTranslation.h>
+#include <Inventor/nodes/SoUnits.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/SoPath.h>
+
+// Bounding box caches must be used and created during traversals with
+// a reset path, but only when the reset happens outside the cached
+// separator.
+BOOST_AUTO_TEST_CASE(bboxCacheWithResetPath)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+
+  SoSeparator * left = new SoSeparator;
+  SoCube * leftcube = new SoCube;
+  leftcube->width = 20.0f;
+  left->addChild(leftcube);
+  root->addChild(left);
+
+  SoSeparator * reset = new SoSeparator;
+  SoCube * resetcube = new SoCube;
+  reset->addChild(resetcube);
+  root->addChild(reset);
+
+  SoSeparator * right = new SoSeparator;
+  SoTranslation * translation = new SoTranslation;
+  translation->translation = SbVec3f(5.0f, 0.0f, 0.0f);
+  right->addChild(translation);
+  right->addChild(new SoCube);
+  root->addChild(right);
+
+  SoPath * resetpath = new SoPath(root);
+  resetpath->ref();
+  resetpath->append(reset);
+
+  SbViewportRegion vp(100, 100);
+  SoGetBoundingBoxAction bboxaction(vp);
+  bboxaction.setResetPath(resetpath, FALSE, SoGetBoundingBoxAction::ALL);
+
+  // first traversal creates caches, the second uses them
+  for (int i = 0; i < 2; i++) {
+    bboxaction.apply(root);
+    SbBox3f box = bboxaction.getBoundingBox();
+    BOOST_CHECK_MESSAGE(box.getMin() == SbVec3f(4.0f, -1.0f, -1.0f) &&
+                        box.getMax() == SbVec3f(6.0f, 1.0f, 1.0f),
+                        "wrong bounding box after reset");
+  }
+
+  // reset inside a separator which has a valid cache
+  resetpath->truncate(1);
+  resetpath->append(left);
+  resetpath->append(leftcube);
+  bboxaction.setResetPath(resetpath, FALSE, SoGetBoundingBoxAction::ALL);
+  bboxaction.apply(root);
+  SbBox3f box = bboxaction.getBoundingBox();
+  BOOST_CHECK_MESSAGE(box.getMin() == SbVec3f(-1.0f, -1.0f, -1.0f) &&
+                      box.getMax() == SbVec3f(6.0f, 1.0f, 1.0f),
+                      "cache used for separator containing the reset path");
+
+  resetpath->unref();
+  root->unref();
+}
+
+// Refitted bounding boxes must match the ones calculated by a full
+// traversal, also after changes in children which affect the state
+// of the following siblings.
+BOOST_AUTO_TEST_CASE(bboxRefit)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+
+  SoTranslation * rootshift = new SoTranslation;
+  root->addChild(rootshift);
+  SoTranslation * leafshift[4];
+  SoCube * leafcube[4];
+  for (int i = 0; i < 4; i++) {
+    SoSeparator * group = new SoSeparator;
+    for (int j = 0; j < 4; j++) {
+      SoSeparator * leaf = new SoSeparator;
+      SoTranslation * translation = new SoTranslation;
+      translation->translation = SbVec3f(float(i * 4 + j), 0.0f, 0.0f);
+      leaf->addChild(translation);
+      SoCube * cube = new SoCube;
+      leaf->addChild(cube);
+      group->addChild(leaf);
+      if (j == 3) {
+        leafshift[i] = translation;
+        leafcube[i] = cube;
+      }
+    }
+    root->addChild(group);
+  }
+
+  SbViewportRegion vp(100, 100);
+  SoGetBoundingBoxAction bboxaction(vp);
+
+  SoSeparator::setBoundingBoxRefit(TRUE);
+  for (int i = 0; i < 6; i++) {
+    switch (i) {
+    case 1: leafshift[3]->translation = SbVec3f(30.0f, 0.0f, 0.0f); break;
+    case 2: leafcube[1]->height = 10.0f; break;
+    case 3: rootshift->translation = SbVec3f(0.0f, 0.0f, 4.0f); break;
+    case 4: leafshift[3]->translation = SbVec3f(0.0f, 0.0f, 0.0f); break;
+    default: break;
+    }
+    bboxaction.apply(root);
+    const SbBox3f refitbox = bboxaction.getBoundingBox();
+    const SbVec3f refitcenter = bboxaction.getCenter();
+
+    SoSeparator::setBoundingBoxRefit(FALSE);
+    root->boundingBoxCaching.touch(); // invalidate the root cache
+    bboxaction.apply(root);
+    SoSeparator::setBoundingBoxRefit(TRUE);
+
+    BOOST_CHECK_MESSAGE(refitbox.getMin() == bboxaction.getBoundingBox().getMin() &&
+                        refitbox.getMax() == bboxaction.getBoundingBox().getMax(),
+                        "refitted bounding box differs from traversed box");
+    BOOST_CHECK_MESSAGE((refitcenter - bboxaction.getCenter()).length() < 1e-4f,
+                        "refitted center differs from traversed center");
+  }
+  SoSeparator::setBoundingBoxRefit(FALSE);
+
+  bboxaction.apply(root);
+  SbBox3f box = bboxaction.getBoundingBox();
+  BOOST_CHECK_MESSAGE(box.getMin() == SbVec3f(-1.0f, -5.0f, 3.0f) &&
+                      box.getMax() == SbVec3f(15.0f, 5.0f, 5.0f),
+                      "wrong bounding box after edits");
+
+  root->unref();
+}
+
+// A change in inherited state must not reuse child boxes which were
+// calculated with a different transformation from the preceding
+// siblings, even if the child caches are still valid.
+BOOST_AUTO_TEST_CASE(bboxRefitInheritedState)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoUnits * outer = new SoUnits;
+  outer->units = SoUnits::METERS;
+  root->addChild(outer);
+  SoSeparator * sep = new SoSeparator;
+  SoUnits * inner = new SoUnits;
+  inner->units = SoUnits::CENTIMETERS;
+  sep->addChild(inner);
+  sep->addChild(new SoCube);
+  root->addChild(sep);
+
+  SbViewportRegion vp(100, 100);
+  SoGetBoundingBoxAction bboxaction(vp);
+
+  SoSeparator::setBoundingBoxRefit(TRUE);
+  bboxaction.apply(root);
+  SbBox3f box = bboxaction.getBoundingBox();
+  BOOST_CHECK_MESSAGE(box.getMax()[0] > 0.0099f && box.getMax()[0] < 0.0101f,
+                      "wrong bounding box before units change");
+
+  // the inner SoUnits node now has no effect inside the separator,
+  // but the resulting bounding box should be the same
+  outer->units = SoUnits::CENTIMETERS;
+  bboxaction.apply(root);
+  box = bboxaction.getBoundingBox();
+  BOOST_CHECK_MESSAGE(box.getMax()[0] > 0.0099f && box.getMax()[0] < 0.0101f,
+                      "child box reused after inherited units change");
+  SoSeparator::setBoundingBoxRefit(FALSE);
+
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -103,8 +103,11 @@
 // instead of having to update all node source files on each new Coin
 // major release.
 
+#define SO_FROM_COIN_4_1 \
+  (SoNode::COIN_4_1)
+
 #define SO_FROM_COIN_4_0 \
-  (SoNode::COIN_4_0)
+  (SoNode::COIN_4_0|SO_FROM_COIN_4_1)
 
 #define SO_FROM_COIN_3_0 \
   (SoNode::COIN_3_0|SO_FROM_COIN_4_0)
@@ -441,6 +441,9 @@ SoSurroundScale::updateMySurroundParams(SoAction * action,
   // reset bbox when returning from surroundscale branch,
   // meaning we'll calculate the bbox of only the geometry
   // to the right of this branch, getting the wanted result.
+  // Separators below the container that are not on the reset path
+  // will still use (and create) their bounding box caches, so only
+  // the changed parts of the container are traversed.
   if (resetpath) {
     bboxaction.setResetPath(resetpath, FALSE, SoGetBoundingBoxAction::ALL);
   }
@@ -127,6 +127,7 @@ private:
 };
 
 static const SbVec4f & textureCoordinateCubeCallback(void * userdata, const SbVec3f & point, const SbVec3f & normal);
+static void textureCoordinateCubeBatchCallback(void * userdata, const int num, const SbVec3f * points, const SbVec3f * normals, SbVec4f * result);
 
 #define PRIVATE(p) (p->pimpl)
 #define PUBLIC(p) (p->master)
@@ -169,15 +170,11 @@ SoTextureCoordinateCube::initClass(void)
   SO_ENABLE(SoPickAction, SoMultiTextureCoordinateElement);
 }
 
-const SbVec4f &
-textureCoordinateCubeCallback(void * userdata,
-                          const SbVec3f & point,
-                          const SbVec3f & normal)
+// Fetches the bounding box of the shape currently being traversed,
+// if it differs from the last one.
+static void
+so_texcoordcube_update_shape(so_texcoordcube_data * data)
 {
-
-  SoTextureCoordinateCubeP * pimpl = (SoTextureCoordinateCubeP *) userdata;
-  so_texcoordcube_data * data = pimpl->so_texcoord_get_data();
-
   SoState * state = data->currentstate;
   SoFullPath * path = (SoFullPath *) state->getAction()->getCurPath();
   SoNode * node = path->getTail();
@@ -214,12 +211,36 @@ textureCoordinateCubeCallback(void * userdata,
     data->boundingbox.setBounds(c[0] - sx, c[1] - sx, c[2] - sx,
                                 c[0] + sx, c[1] + sx, c[2] + sx);
   }
+}
 
-  const SbVec4f & ret = pimpl->calculateTextureCoordinate(point, normal);
+const SbVec4f &
+textureCoordinateCubeCallback(void * userdata,
+                              const SbVec3f & point,
+                              const SbVec3f & normal)
+{
+  SoTextureCoordinateCubeP * pimpl = (SoTextureCoordinateCubeP *) userdata;
+  so_texcoordcube_data * data = pimpl->so_texcoord_get_data();
+  so_texcoordcube_update_shape(data);
 
-  data->texcoordreturn = ret;
+  data->texcoordreturn = pimpl->calculateTextureCoordinate(point, normal);
   return data->texcoordreturn;
+}
 
+static void
+textureCoordinateCubeBatchCallback(void * userdata,
+                                   const int num,
+                                   const SbVec3f * points,
+                                   const SbVec3f * normals,
+                                   SbVec4f * result)
+{
+  SoTextureCoordinateCubeP * pimpl = (SoTextureCoordinateCubeP *) userdata;
+  so_texcoordcube_update_shape(pimpl->so_texcoord_get_data());
+
+  const SbVec3f defaultnormal(0.0f, 0.0f, 1.0f);
+  for (int i = 0; i < num; i++) {
+    result[i] = pimpl->calculateTextureCoordinate(points[i],
+                                                  normals ? normals[i] : defaultnormal);
+  }
 }
 
 SbVec4f
@@ -284,6 +305,7 @@ SoTextureCoordinateCube::doAction(SoAction * action)
   int unit = SoTextureUnitElement::get(data->currentstate);
   SoMultiTextureCoordinateElement::setFunction(data->currentstate, this,
                                                unit, textureCoordinateCubeCallback,
+                                               textureCoordinateCubeBatchCallback,
                                                PRIVATE(this));
 }
 
@@ -302,6 +324,7 @@ SoTextureCoordinateCube::GLRender(SoGLRenderAction * action)
   if (unit < maxunits) {        
     SoMultiTextureCoordinateElement::setFunction(data->currentstate, this,
                                                  unit, textureCoordinateCubeCallback,
+                                                 textureCoordinateCubeBatchCallback,
                                                  PRIVATE(this));
   }
 }
@@ -121,6 +121,7 @@ private:
 
 
 static const SbVec4f & textureCoordinateCylinderCallback(void * userdata, const SbVec3f & point, const SbVec3f & normal);
+static void textureCoordinateCylinderBatchCallback(void * userdata, const int num, const SbVec3f * points, const SbVec3f * normals, SbVec4f * result);
 
 #define PRIVATE(p) (p->pimpl)
 #define PUBLIC(p) (p->master)
@@ -169,15 +170,11 @@ SoTextureCoordinateCylinder::initClass(void)
 
 }
 
-const SbVec4f &
-textureCoordinateCylinderCallback(void * userdata, 
-                          const SbVec3f & point, 
-                          const SbVec3f & normal)
+// Fetches the bounding box of the shape currently being traversed,
+// if it differs from the last one.
+static void
+so_texcoordcylinder_update_shape(so_texcoordcylinder_data * data)
 {
-  
-  SoTextureCoordinateCylinderP * pimpl = (SoTextureCoordinateCylinderP *) userdata;
-  so_texcoordcylinder_data * data = pimpl->so_texcoord_get_data();
- 
   SoState * state = data->currentstate;
   SoFullPath * path = (SoFullPath *) state->getAction()->getCurPath();
   SoNode * node = path->getTail();
@@ -203,12 +200,36 @@ textureCoordinateCylinderCallback(void * userdata,
     }
     data->currentshape = shape;
   }
+}
 
-  const SbVec4f & ret = pimpl->calculateTextureCoordinate(point, normal);
+const SbVec4f &
+textureCoordinateCylinderCallback(void * userdata,
+                                  const SbVec3f & point,
+                                  const SbVec3f & normal)
+{
+  SoTextureCoordinateCylinderP * pimpl = (SoTextureCoordinateCylinderP *) userdata;
+  so_texcoordcylinder_data * data = pimpl->so_texcoord_get_data();
+  so_texcoordcylinder_update_shape(data);
 
-  data->texcoordreturn = ret;
+  data->texcoordreturn = pimpl->calculateTextureCoordinate(point, normal);
   return data->texcoordreturn;
-  
+}
+
+static void
+textureCoordinateCylinderBatchCallback(void * userdata,
+                                       const int num,
+                                       const SbVec3f * points,
+                                       const SbVec3f * normals,
+                                       SbVec4f * result)
+{
+  SoTextureCoordinateCylinderP * pimpl = (SoTextureCoordinateCylinderP *) userdata;
+  so_texcoordcylinder_update_shape(pimpl->so_texcoord_get_data());
+
+  const SbVec3f defaultnormal(0.0f, 0.0f, 1.0f);
+  for (int i = 0; i < num; i++) {
+    result[i] = pimpl->calculateTextureCoordinate(points[i],
+                                                  normals ? normals[i] : defaultnormal);
+  }
 }
 
 SbVec4f
@@ -272,6 +293,7 @@ SoTextureCoordinateCylinder::doAction(SoAction * action)
   int unit = SoTextureUnitElement::get(data->currentstate);
   SoMultiTextureCoordinateElement::setFunction(data->currentstate, this,
                                                unit, textureCoordinateCylinderCallback,
+                                               textureCoordinateCylinderBatchCallback,
                                                PRIVATE(this));
 }
 
@@ -290,6 +312,7 @@ SoTextureCoordinateCylinder::GLRender(SoGLRenderAction * action)
   if (unit < maxunits) {        
     SoMultiTextureCoordinateElement::setFunction(data->currentstate, this,
                                                  unit, textureCoordinateCylinderCallback,
+                                                 textureCoordinateCylinderBatchCallback,
                                                  PRIVATE(this));
   }
 }
@@ -126,6 +126,7 @@
 #include <Inventor/C/glue/gl.h>
 
 #include "nodes/SoSubNodeP.h"
+#include "coindefs.h"
 
 /*!
   \var SoSFVec3f SoTextureCoordinatePlane::directionS
@@ -212,6 +213,30 @@ SoTextureCoordinatePlane::generate(void * userdata,
   return PRIVATE(thisp)->ret;
 }
 
+// batch version of generate(), used when texture coordinates are
+// needed for complete vertex arrays
+void
+SoTextureCoordinatePlane::generateBatch(void * userdata, const int num,
+                                        const SbVec3f * points,
+                                        const SbVec3f * COIN_UNUSED_ARG(normals),
+                                        SbVec4f * result)
+{
+  SoTextureCoordinatePlane * thisp =
+    (SoTextureCoordinatePlane*) userdata;
+
+  const float * s = PRIVATE(thisp)->s.getValue();
+  const float * t = PRIVATE(thisp)->t.getValue();
+  const float * r = PRIVATE(thisp)->r.getValue();
+
+  for (int i = 0; i < num; i++) {
+    const float * p = points[i].getValue();
+    result[i].setValue(s[0]*p[0] + s[1]*p[1] + s[2]*p[2],
+                       t[0]*p[0] + t[1]*p[1] + t[2]*p[2],
+                       r[0]*p[0] + r[1]*p[1] + r[2]*p[2],
+                       1.0f);
+  }
+}
+
 // doc from parent
 void
 SoTextureCoordinatePlane::doAction(SoAction * action)
@@ -221,6 +246,7 @@ SoTextureCoordinatePlane::doAction(SoAction * action)
   int unit = SoTextureUnitElement::get(state);
   SoMultiTextureCoordinateElement::setFunction(action->getState(), this, unit,
                                                SoTextureCoordinatePlane::generate,
+                                               SoTextureCoordinatePlane::generateBatch,
                                                this);
 }
 
@@ -121,6 +121,7 @@ private:
 
 
 static const SbVec4f & textureCoordinateSphereCallback(void * userdata, const SbVec3f & point, const SbVec3f & normal);
+static void textureCoordinateSphereBatchCallback(void * userdata, const int num, const SbVec3f * points, const SbVec3f * normals, SbVec4f * result);
 
 #define PRIVATE(p) (p->pimpl)
 #define PUBLIC(p) (p->master)
@@ -165,15 +166,11 @@ SoTextureCoordinateSphere::initClass(void)
 
 }
 
-const SbVec4f &
-textureCoordinateSphereCallback(void * userdata,
-                          const SbVec3f & point,
-                          const SbVec3f & normal)
+// Fetches the bounding box of the shape currently being traversed,
+// if it differs from the last one.
+static void
+so_texcoordsphere_update_shape(so_texcoordsphere_data * data)
 {
-
-  SoTextureCoordinateSphereP * pimpl = (SoTextureCoordinateSphereP *) userdata;
-  so_texcoordsphere_data * data = pimpl->so_texcoord_get_data();
-
   SoState * state = data->currentstate;
   SoFullPath * path = (SoFullPath *) state->getAction()->getCurPath();
   SoNode * node = path->getTail();
@@ -200,12 +197,36 @@ textureCoordinateSphereCallback(void * userdata,
     }
     data->currentshape = shape;
   }
+}
 
-  const SbVec4f & ret = pimpl->calculateTextureCoordinate(point, normal);
+const SbVec4f &
+textureCoordinateSphereCallback(void * userdata,
+                                const SbVec3f & point,
+                                const SbVec3f & normal)
+{
+  SoTextureCoordinateSphereP * pimpl = (SoTextureCoordinateSphereP *) userdata;
+  so_texcoordsphere_data * data = pimpl->so_texcoord_get_data();
+  so_texcoordsphere_update_shape(data);
 
-  data->texcoordreturn = ret;
+  data->texcoordreturn = pimpl->calculateTextureCoordinate(point, normal);
   return data->texcoordreturn;
+}
 
+static void
+textureCoordinateSphereBatchCallback(void * userdata,
+                                     const int num,
+                                     const SbVec3f * points,
+                                     const SbVec3f * normals,
+                                     SbVec4f * result)
+{
+  SoTextureCoordinateSphereP * pimpl = (SoTextureCoordinateSphereP *) userdata;
+  so_texcoordsphere_update_shape(pimpl->so_texcoord_get_data());
+
+  const SbVec3f defaultnormal(0.0f, 0.0f, 1.0f);
+  for (int i = 0; i < num; i++) {
+    result[i] = pimpl->calculateTextureCoordinate(points[i],
+                                                  normals ? normals[i] : defaultnormal);
+  }
 }
 
 SbVec4f
@@ -239,6 +260,7 @@ SoTextureCoordinateSphere::doAction(SoAction * action)
   int unit = SoTextureUnitElement::get(data->currentstate);
   SoMultiTextureCoordinateElement::setFunction(data->currentstate, this,
                                                unit, textureCoordinateSphereCallback,
+                                               textureCoordinateSphereBatchCallback,
                                                PRIVATE(this));
 }
 
@@ -257,6 +279,7 @@ SoTextureCoordinateSphere::GLRender(SoGLRenderAction * action)
   if (unit < maxunits) {        
     SoMultiTextureCoordinateElement::setFunction(data->currentstate, this,
                                                  unit, textureCoordinateSphereCallback,
+                                                 textureCoordinateSphereBatchCallback,
                                                  PRIVATE(this));
   }
 }
@@ -60,6 +60,7 @@
 #include <Inventor/elements/SoGLCoordinateElement.h>
 #include <Inventor/elements/SoGLMultiTextureEnabledElement.h>
 #include <Inventor/elements/SoGLMultiTextureImageElement.h>
+#include <Inventor/elements/SoGLVBOElement.h>
 #include <Inventor/elements/SoModelMatrixElement.h>
 #include <Inventor/elements/SoMultiTextureEnabledElement.h>
 #include <Inventor/elements/SoProfileElement.h>
@@ -70,6 +71,7 @@
 #include <Inventor/elements/SoViewportRegionElement.h>
 #include <Inventor/errors/SoDebugError.h>
 #include <Inventor/lists/SbList.h>
+#include <Inventor/misc/SoContextHandler.h>
 #include <Inventor/nodes/SoCallback.h>
 #include <Inventor/nodes/SoProfile.h>
 #include <Inventor/nodes/SoShape.h>
@@ -79,6 +81,8 @@
 #include "glue/GLUWrapper.h"
 #include "tidbitsp.h"
 #include "glue/glp.h"
+#include "rendering/SoVBO.h"
+#include "threads/threadsutilp.h"
 
 // *************************************************************************
 
@@ -139,6 +143,492 @@ sogl_generate_2d_circle(SbVec2f *coords, const int num, const float radius)
   }
 }
 
+// *************************************************************************
+
+// Shared meshes for the built-in primitives.
+//
+// Instead of generating coordinates and sending them in immediate
+// mode each time a sphere, cone, cylinder or cube is rendered, a unit
+// sized mesh is generated once per complexity level and stored in a
+// vertex buffer object. The VBO is shared between all nodes (SoVBO
+// takes care of creating one GL buffer per context), and the mesh is
+// rendered with a scale applied to the model matrix. GL_NORMALIZE is
+// always enabled in Coin, so normals will be correct also for
+// non-uniform scales.
+//
+// Shared meshes are only used when no render cache is being built,
+// since the display list will store the geometry anyway.
+
+namespace {
+
+enum sogl_mesh_type {
+  SOGL_MESH_SPHERE = 0,
+  SOGL_MESH_CONE,
+  SOGL_MESH_CYLINDER,
+  SOGL_MESH_CUBE
+};
+
+class sogl_primitive_mesh {
+public:
+  enum { MAXPARTS = 6 };
+
+  sogl_primitive_mesh(void) : numparts(0), numvertices(0), vbo(NULL) { }
+  ~sogl_primitive_mesh() { delete this->vbo; }
+
+  // a part which is rendered unless the primitive's flags are
+  // missing renderflag. The material index is sent before the part is
+  // rendered if sendmaterial is TRUE and SOGL_MATERIAL_PER_PART is set
+  void beginPart(const unsigned int renderflag, const SbBool sendmaterial) {
+    assert(this->numparts < MAXPARTS);
+    this->partflag[this->numparts] = renderflag;
+    this->partsendmaterial[this->numparts] = sendmaterial;
+    this->partstart[this->numparts] = this->coords.getLength();
+  }
+  void endPart(void) {
+    this->partcount[this->numparts] =
+      this->coords.getLength() - this->partstart[this->numparts];
+    this->numparts++;
+  }
+
+  void addVertex(const SbVec3f & c, const SbVec3f & n,
+                 const SbVec2f & tc, const SbVec3f & tc3) {
+    this->coords.append(c);
+    this->normals.append(n);
+    this->texcoords.append(tc);
+    this->texcoords3d.append(tc3);
+  }
+
+  // add triangles for a quad strip stored as top/bottom vertex pairs
+  void addQuadStrip(const sogl_primitive_mesh & strip) {
+    const int n = strip.coords.getLength() / 2;
+    for (int i = 0; i < n-1; i++) {
+      const int idx[] = { 2*i, 2*i+1, 2*i+2, 2*i+2, 2*i+1, 2*i+3 };
+      for (int j = 0; j < 6; j++) { this->addFrom(strip, idx[j]); }
+    }
+  }
+
+  // add triangles for a triangle fan
+  void addFan(const sogl_primitive_mesh & fan) {
+    const int n = fan.coords.getLength();
+    for (int i = 1; i < n-1; i++) {
+      this->addFrom(fan, 0);
+      this->addFrom(fan, i);
+      this->addFrom(fan, i+1);
+    }
+  }
+
+  void addFrom(const sogl_primitive_mesh & src, const int idx) {
+    this->addVertex(src.coords[idx], src.normals[idx],
+                    src.texcoords[idx], src.texcoords3d[idx]);
+  }
+
+  // move the vertex data into a VBO
+  void finish(void) {
+    this->numvertices = this->coords.getLength();
+    const intptr_t n = this->numvertices;
+    this->normaloffset = n * sizeof(SbVec3f);
+    this->texcoordoffset = 2 * n * sizeof(SbVec3f);
+    this->texcoord3doffset = this->texcoordoffset + n * sizeof(SbVec2f);
+    const intptr_t size = this->texcoord3doffset + n * sizeof(SbVec3f);
+
+    this->vbo = new SoVBO(GL_ARRAY_BUFFER, GL_STATIC_DRAW);
+    char * dst = static_cast<char *>(this->vbo->allocBufferData(size));
+    memcpy(dst, this->coords.getArrayPtr(), n * sizeof(SbVec3f));
+    memcpy(dst + this->normaloffset, this->normals.getArrayPtr(), n * sizeof(SbVec3f));
+    memcpy(dst + this->texcoordoffset, this->texcoords.getArrayPtr(), n * sizeof(SbVec2f));
+    memcpy(dst + this->texcoord3doffset, this->texcoords3d.getArrayPtr(), n * sizeof(SbVec3f));
+
+    this->coords.truncate(0, TRUE);
+    this->normals.truncate(0, TRUE);
+    this->texcoords.truncate(0, TRUE);
+    this->texcoords3d.truncate(0, TRUE);
+  }
+
+  SbList <SbVec3f> coords;
+  SbList <SbVec3f> normals;
+  SbList <SbVec2f> texcoords;
+  SbList <SbVec3f> texcoords3d;
+
+  int numparts;
+  unsigned int partflag[MAXPARTS];
+  SbBool partsendmaterial[MAXPARTS];
+  int partstart[MAXPARTS];
+  int partcount[MAXPARTS];
+
+  int numvertices;
+  intptr_t normaloffset;
+  intptr_t texcoordoffset;
+  intptr_t texcoord3doffset;
+  SoVBO * vbo;
+};
+
+} // anonymous namespace
+
+typedef SbHash<uint32_t, sogl_primitive_mesh *> sogl_mesh_map;
+
+// all meshes, protected by the global lock, which also guards the
+// lazy creation of the hash. Each context has its own lookup table in
+// cc_glglue::primitivemeshes, which is only used while rendering in
+// that context, so the global lock is only taken the first time a
+// mesh is used in a context.
+static sogl_mesh_map * sogl_mesh_hash = NULL;
+// the per-context lookup tables, protected by the global lock
+static SbHash<uint32_t, sogl_mesh_map *> * sogl_context_meshes = NULL;
+static int sogl_shared_meshes = -1;
+
+static void
+sogl_mesh_context_destruction_cb(uint32_t contextid, void * COIN_UNUSED_ARG(closure))
+{
+  sogl_mesh_map * meshes = NULL;
+  CC_GLOBAL_LOCK;
+  if (sogl_context_meshes && sogl_context_meshes->get(contextid, meshes)) {
+    (void) sogl_context_meshes->erase(contextid);
+  }
+  CC_GLOBAL_UNLOCK;
+  if (meshes) {
+    // the cc_glglue instance is destructed after the callbacks
+    cc_glglue * glue = const_cast<cc_glglue *>(cc_glglue_instance(contextid));
+    glue->primitivemeshes = NULL;
+    delete meshes;
+  }
+}
+
+static void
+sogl_mesh_cleanup(void)
+{
+  SoContextHandler::removeContextDestructionCallback(sogl_mesh_context_destruction_cb, NULL);
+  // the cc_glglue instances might be gone already, so just delete
+  // the lookup tables
+  for (SbHash<uint32_t, sogl_mesh_map *>::const_iterator iter =
+         sogl_context_meshes->const_begin();
+       iter != sogl_context_meshes->const_end();
+       ++iter) {
+    delete iter->obj;
+  }
+  delete sogl_context_meshes;
+  sogl_context_meshes = NULL;
+
+  SbList<uint32_t> keys;
+  sogl_mesh_hash->makeKeyList(keys);
+  for (int i = 0; i < keys.getLength(); i++) {
+    sogl_primitive_mesh * mesh = NULL;
+    (void) sogl_mesh_hash->get(keys[i], mesh);
+    delete mesh;
+  }
+  delete sogl_mesh_hash;
+  sogl_mesh_hash = NULL;
+  sogl_shared_meshes = -1;
+}
+
+static void
+sogl_generate_sphere_mesh(sogl_primitive_mesh * mesh, const int stacks, const int slices)
+{
+  // generates the same triangles as sogl_render_sphere(), with
+  // radius 1
+  SbVec3f coords[129];
+  SbVec3f normals[129];
+  SbVec3f texcoords[129];
+  float S[129];
+
+  const float drho = float(M_PI) / (float) (stacks-1);
+  const float dtheta = 2.0f * float(M_PI) / (float) slices;
+  const float incs = 1.0f / (float)slices;
+  const float dT = 1.0f / (float) (stacks-1);
+  const SbVec3f half(0.5f, 0.5f, 0.5f);
+
+  float rho = drho;
+  float theta = 0.0f;
+  float currs = 0.0f;
+  float T = 1.0f - dT;
+  float tc = (float) cos(rho);
+  float ts = - (float) sin(rho);
+  SbVec3f tmp(0.0f, tc, ts);
+  normals[0] = coords[0] = tmp;
+  texcoords[0] = tmp/2 + half;
+  S[0] = currs;
+
+  mesh->beginPart(0, FALSE);
+  int i, j;
+  for (j = 1; j <= slices; j++) {
+    mesh->addVertex(SbVec3f(0.0f, 1.0f, 0.0f), SbVec3f(0.0f, 1.0f, 0.0f),
+                    SbVec2f(currs + 0.5f * incs, 1.0f), SbVec3f(0.5f, 1.0f, 0.5f));
+    mesh->addVertex(coords[j-1], normals[j-1], SbVec2f(currs, T), texcoords[j-1]);
+
+    currs += incs;
+    theta += dtheta;
+    tmp.setValue(float(sin(theta))*ts, tc, float(cos(theta))*ts);
+    normals[j] = coords[j] = tmp;
+    texcoords[j] = tmp/2 + half;
+    S[j] = currs;
+    mesh->addVertex(coords[j], normals[j], SbVec2f(currs, T), texcoords[j]);
+  }
+  rho += drho;
+
+  sogl_primitive_mesh strip;
+  for (i = 2; i < stacks-1; i++) {
+    tc = (float)cos(rho);
+    ts = - (float) sin(rho);
+    theta = 0.0f;
+    strip.coords.truncate(0);
+    strip.normals.truncate(0);
+    strip.texcoords.truncate(0);
+    strip.texcoords3d.truncate(0);
+    for (j = 0; j <= slices; j++) {
+      strip.addVertex(coords[j], normals[j], SbVec2f(S[j], T), texcoords[j]);
+      tmp.setValue(float(sin(theta))*ts, tc, float(cos(theta))*ts);
+      normals[j] = coords[j] = tmp;
+      texcoords[j] = tmp/2 + half;
+      strip.addVertex(coords[j], normals[j], SbVec2f(S[j], T - dT), texcoords[j]);
+      theta += dtheta;
+    }
+    mesh->addQuadStrip(strip);
+    rho += drho;
+    T -= dT;
+  }
+
+  for (j = 0; j < slices; j++) {
+    mesh->addVertex(coords[j], normals[j], SbVec2f(S[j], T), texcoords[j]);
+    mesh->addVertex(SbVec3f(0.0f, -1.0f, 0.0f), SbVec3f(0.0f, -1.0f, 0.0f),
+                    SbVec2f(S[j]+incs*0.5f, 0.0f), SbVec3f(0.5f, 0.0f, 0.5f));
+    mesh->addVertex(coords[j+1], normals[j+1], SbVec2f(S[j+1], T), texcoords[j+1]);
+  }
+  mesh->endPart();
+}
+
+static void
+sogl_generate_cone_mesh(sogl_primitive_mesh * mesh, const int slices)
+{
+  // generates the same triangles as sogl_render_cone(), with radius
+  // and height 1
+  SbVec3f coords[129];
+  SbVec3f normals[130];
+  SbVec2f texcoords[129];
+  const float h2 = 0.5f;
+  int i;
+
+  sogl_generate_3d_circle(coords, slices, 1.0f, -h2);
+  coords[slices] = coords[0];
+  sogl_generate_2d_circle(texcoords, slices, 0.5f);
+  texcoords[slices] = texcoords[0];
+  const double a = atan(1.0);
+  sogl_generate_3d_circle(normals, slices, float(sin(a)), float(cos(a)));
+  normals[slices] = normals[0];
+  normals[slices+1] = normals[1];
+
+  mesh->beginPart(SOGL_RENDER_SIDE, FALSE);
+  float t = 1.0f;
+  const float delta = 1.0f / slices;
+  for (i = 0; i < slices; i++) {
+    mesh->addVertex(SbVec3f(0.0f, h2, 0.0f), (normals[i] + normals[i+1])*0.5f,
+                    SbVec2f(t - delta*0.5f, 1.0f), SbVec3f(0.5f, 1.0f, 0.5f));
+    mesh->addVertex(coords[i], normals[i], SbVec2f(t, 0.0f),
+                    SbVec3f(texcoords[i][0]+0.5f, 0.0f, texcoords[i][1]+0.5f));
+    mesh->addVertex(coords[i+1], normals[i+1], SbVec2f(t - delta, 0.0f),
+                    SbVec3f(texcoords[i+1][0]+0.5f, 0.0f, texcoords[i+1][1]+0.5f));
+    t -= delta;
+  }
+  mesh->endPart();
+
+  mesh->beginPart(SOGL_RENDER_BOTTOM, TRUE);
+  sogl_primitive_mesh fan;
+  const SbVec3f n(0.0f, -1.0f, 0.0f);
+  for (i = slices-1; i >= 0; i--) {
+    fan.addVertex(coords[i], n,
+                  SbVec2f(texcoords[i][0]+0.5f, texcoords[i][1]+0.5f),
+                  SbVec3f(texcoords[i][0]+0.5f, 0.0f, texcoords[i][1]+0.5f));
+  }
+  mesh->addFan(fan);
+  mesh->endPart();
+}
+
+static void
+sogl_generate_cylinder_mesh(sogl_primitive_mesh * mesh, const int slices)
+{
+  // generates the same triangles as sogl_render_cylinder(), with
+  // radius and height 1
+  SbVec3f coords[129];
+  SbVec3f normals[130];
+  SbVec2f texcoords[129];
+  const float h2 = 0.5f;
+  int i;
+
+  sogl_generate_3d_circle(coords, slices, 1.0f, -h2);
+  coords[slices] = coords[0];
+  sogl_generate_2d_circle(texcoords, slices, 0.5f);
+  texcoords[slices] = texcoords[0];
+  sogl_generate_3d_circle(normals, slices, 1.0f, 0.0f);
+  normals[slices] = normals[0];
+  normals[slices+1] = normals[1];
+
+  mesh->beginPart(SOGL_RENDER_SIDE, FALSE);
+  sogl_primitive_mesh strip;
+  float t = 0.0f;
+  const float inc = 1.0f / slices;
+  for (i = 0; i <= slices; i++) {
+    const SbVec3f & c = coords[i];
+    strip.addVertex(SbVec3f(c[0], h2, c[2]), normals[i], SbVec2f(t, 1.0f),
+                    SbVec3f(texcoords[i][0]+0.5f, 1.0f, 1.0f - texcoords[i][1]-0.5f));
+    strip.addVertex(c, normals[i], SbVec2f(t, 0.0f),
+                    SbVec3f(texcoords[i][0]+0.5f, 0.0f, 1.0f - texcoords[i][1]-0.5f));
+    t += inc;
+  }
+  mesh->addQuadStrip(strip);
+  mesh->endPart();
+
+  mesh->beginPart(SOGL_RENDER_TOP, TRUE);
+  sogl_primitive_mesh topfan;
+  for (i = 0; i < slices; i++) {
+    const SbVec3f & c = coords[i];
+    topfan.addVertex(SbVec3f(c[0], h2, c[2]), SbVec3f(0.0f, 1.0f, 0.0f),
+                     SbVec2f(texcoords[i][0]+0.5f, 1.0f - texcoords[i][1]-0.5f),
+                     SbVec3f(texcoords[i][0]+0.5f, 1.0f, 1.0f - texcoords[i][1]-0.5f));
+  }
+  mesh->addFan(topfan);
+  mesh->endPart();
+
+  mesh->beginPart(SOGL_RENDER_BOTTOM, TRUE);
+  sogl_primitive_mesh bottomfan;
+  for (i = slices-1; i >= 0; i--) {
+    bottomfan.addVertex(coords[i], SbVec3f(0.0f, -1.0f, 0.0f),
+                        SbVec2f(texcoords[i][0]+0.5f, texcoords[i][1]+0.5f),
+                        SbVec3f(texcoords[i][0]+0.5f, 0.0f, 1.0f - texcoords[i][1]-0.5f));
+  }
+  mesh->addFan(bottomfan);
+  mesh->endPart();
+}
+
+static void sogl_generate_cube_mesh(sogl_primitive_mesh * mesh);
+
+// Renders a shared mesh for a primitive, if possible. Returns FALSE
+// if the primitive must be rendered in immediate mode.
+static SbBool
+sogl_render_shared_mesh(SoState * state,
+                        const sogl_mesh_type type,
+                        const int stacks,
+                        const int slices,
+                        const SbVec3f & scale,
+                        SoMaterialBundle * const material,
+                        const unsigned int flags)
+{
+  if (sogl_shared_meshes < 0) {
+    const char * env = coin_getenv("COIN_SHARED_PRIMITIVE_MESHES");
+    sogl_shared_meshes = env ? atoi(env) : 1;
+  }
+  if (!sogl_shared_meshes || !state) return FALSE;
+  if (flags & SOGL_NEED_MULTITEXCOORDS) return FALSE;
+  // a degenerate or mirrored scale would give bad normals or flip the
+  // face orientation
+  if (scale[0] <= 0.0f || scale[1] <= 0.0f || scale[2] <= 0.0f) return FALSE;
+  if (stacks > 128) return FALSE;
+  if (!state->getAction()->isOfType(SoGLRenderAction::getClassTypeId())) return FALSE;
+  if (SoCacheElement::anyOpen(state)) return FALSE;
+
+  const uint32_t key =
+    (uint32_t(type) << 16) | (uint32_t(stacks) << 8) | uint32_t(slices);
+  // a context is only rendered by one thread at a time, so its
+  // lookup table needs no lock
+  cc_glglue * glue = const_cast<cc_glglue *>(sogl_glue_instance(state));
+  sogl_mesh_map * meshes = static_cast<sogl_mesh_map *>(glue->primitivemeshes);
+  sogl_primitive_mesh * mesh = NULL;
+  if (meshes == NULL || !meshes->get(key, mesh)) {
+    CC_GLOBAL_LOCK;
+    if (sogl_mesh_hash == NULL) {
+      sogl_mesh_hash = new sogl_mesh_map;
+      sogl_context_meshes = new SbHash<uint32_t, sogl_mesh_map *>;
+      SoContextHandler::addContextDestructionCallback(sogl_mesh_context_destruction_cb, NULL);
+      coin_atexit((coin_atexit_f*) sogl_mesh_cleanup, CC_ATEXIT_NORMAL);
+    }
+    if (!sogl_mesh_hash->get(key, mesh)) {
+      mesh = new sogl_primitive_mesh;
+      switch (type) {
+      case SOGL_MESH_SPHERE: sogl_generate_sphere_mesh(mesh, stacks, slices); break;
+      case SOGL_MESH_CONE: sogl_generate_cone_mesh(mesh, slices); break;
+      case SOGL_MESH_CYLINDER: sogl_generate_cylinder_mesh(mesh, slices); break;
+      case SOGL_MESH_CUBE: sogl_generate_cube_mesh(mesh); break;
+      }
+      mesh->finish();
+      sogl_mesh_hash->put(key, mesh);
+    }
+    if (meshes == NULL) {
+      meshes = new sogl_mesh_map;
+      sogl_context_meshes->put(glue->contextid, meshes);
+      glue->primitivemeshes = meshes;
+    }
+    CC_GLOBAL_UNLOCK;
+    meshes->put(key, mesh);
+  }
+
+  if (!SoGLVBOElement::shouldCreateVBO(state, mesh->numvertices)) return FALSE;
+
+
+  const SbBool normals = (flags & SOGL_NEED_NORMALS) != 0;
+  SbBool texcoords = (flags & SOGL_NEED_TEXCOORDS) != 0;
+  SbBool texcoords3d = (flags & SOGL_NEED_3DTEXCOORDS) != 0;
+  // sogl_render_cube() prefers 3D texture coordinates, the other
+  // primitives prefer 2D texture coordinates
+  if (texcoords && texcoords3d) {
+    if (type == SOGL_MESH_CUBE) texcoords = FALSE;
+    else texcoords3d = FALSE;
+  }
+
+  mesh->vbo->bindBuffer(glue->contextid);
+  cc_glglue_glVertexPointer(glue, 3, GL_FLOAT, 0, NULL);
+  cc_glglue_glEnableClientState(glue, GL_VERTEX_ARRAY);
+  if (normals) {
+    cc_glglue_glNormalPointer(glue, GL_FLOAT, 0,
+                              reinterpret_cast<const GLvoid *>(mesh->normaloffset));
+    cc_glglue_glEnableClientState(glue, GL_NORMAL_ARRAY);
+  }
+  if (texcoords) {
+    cc_glglue_glTexCoordPointer(glue, 2, GL_FLOAT, 0,
+                                reinterpret_cast<const GLvoid *>(mesh->texcoordoffset));
+    cc_glglue_glEnableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  }
+  else if (texcoords3d) {
+    cc_glglue_glTexCoordPointer(glue, 3, GL_FLOAT, 0,
+                                reinterpret_cast<const GLvoid *>(mesh->texcoord3doffset));
+    cc_glglue_glEnableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  }
+
+  glPushMatrix();
+  glScalef(scale[0], scale[1], scale[2]);
+
+  int matnr = 0;
+  for (int i = 0; i < mesh->numparts; i++) {
+    if (mesh->partflag[i] && !(flags & mesh->partflag[i])) continue;
+    if (mesh->partsendmaterial[i] && (flags & SOGL_MATERIAL_PER_PART)) {
+      material->send(matnr, TRUE);
+    }
+    cc_glglue_glDrawArrays(glue, GL_TRIANGLES, mesh->partstart[i], mesh->partcount[i]);
+    matnr++;
+  }
+
+  glPopMatrix();
+
+  cc_glglue_glDisableClientState(glue, GL_VERTEX_ARRAY);
+  if (normals) cc_glglue_glDisableClientState(glue, GL_NORMAL_ARRAY);
+  if (texcoords || texcoords3d) cc_glglue_glDisableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, 0);
+  return TRUE;
+}
+
+// Auto cache handling shared by sphere, cone and cylinder
+static void
+sogl_autocache_primitive(SoState * state)
+{
+  if (state && (SoComplexityTypeElement::get(state) ==
+                SoComplexityTypeElement::OBJECT_SPACE)) {
+    // encourage auto caching for object space
+    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DO_AUTO_CACHE);
+    SoGLCacheContextElement::incNumShapes(state);
+  }
+  else {
+    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DONT_AUTO_CACHE);
+  }
+}
+
+// *************************************************************************
+
 void
 sogl_render_cone(const float radius,
                  const float height,
@@ -170,6 +660,13 @@ sogl_render_cone(const float radius,
   if (slices > 128) slices = 128;
   if (slices < 4) slices = 4;
 
+  if (sogl_render_shared_mesh(state, SOGL_MESH_CONE, 0, slices,
+                              SbVec3f(radius, height, radius),
+                              material, flags)) {
+    sogl_autocache_primitive(state);
+    return;
+  }
+
   float h2 = height * 0.5f;
 
   // put coordinates on the stack
@@ -298,15 +795,7 @@ sogl_render_cone(const float radius,
     }
     glEnd();
   }
-  if (state && (SoComplexityTypeElement::get(state) ==
-                SoComplexityTypeElement::OBJECT_SPACE)) {
-    // encourage auto caching for object space
-    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DO_AUTO_CACHE);
-    SoGLCacheContextElement::incNumShapes(state);
-  }
-  else {
-    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DONT_AUTO_CACHE);
-  }
+  sogl_autocache_primitive(state);
 }
 
 void
@@ -338,6 +827,13 @@ sogl_render_cylinder(const float radius,
   if (slices > 128) slices = 128;
   if (slices < 4) slices = 4;
 
+  if (sogl_render_shared_mesh(state, SOGL_MESH_CYLINDER, 0, slices,
+                              SbVec3f(radius, height, radius),
+                              material, flags)) {
+    sogl_autocache_primitive(state);
+    return;
+  }
+
   float h2 = height * 0.5f;
 
   SbVec3f coords[129];
@@ -472,22 +968,14 @@ sogl_render_cylinder(const float radius,
     }
     glEnd();
   }
-  if (state && (SoComplexityTypeElement::get(state) ==
-                SoComplexityTypeElement::OBJECT_SPACE)) {
-    // encourage auto caching for object space
-    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DO_AUTO_CACHE);
-    SoGLCacheContextElement::incNumShapes(state);
-  }
-  else {
-    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DONT_AUTO_CACHE);
-  }
+  sogl_autocache_primitive(state);
 }
 
 void
 sogl_render_sphere(const float radius,
                    const int numstacks,
                    const int numslices,
-                   SoMaterialBundle * const /* material */,
+                   SoMaterialBundle * const material,
                    const unsigned int flagsin,
                    SoState * state)
 {
@@ -515,6 +1003,13 @@ sogl_render_sphere(const float radius,
 
   if (slices > 128) slices = 128;
 
+  if (sogl_render_shared_mesh(state, SOGL_MESH_SPHERE, stacks, slices,
+                              SbVec3f(radius, radius, radius),
+                              material, flags)) {
+    sogl_autocache_primitive(state);
+    return;
+  }
+
   // used to cache last stack's data
   SbVec3f coords[129];
   SbVec3f normals[129];
@@ -727,15 +1222,7 @@ sogl_render_sphere(const float radius,
   }
   glEnd(); // GL_TRIANGLES
 
-  if (state && (SoComplexityTypeElement::get(state) ==
-                SoComplexityTypeElement::OBJECT_SPACE)) {
-    // encourage auto caching for object space
-    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DO_AUTO_CACHE);
-    SoGLCacheContextElement::incNumShapes(state);
-  }
-  else {
-    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DONT_AUTO_CACHE);
-  }
+  sogl_autocache_primitive(state);
 }
 
 //
@@ -794,6 +1281,30 @@ sogl_generate_cube_vertices(SbVec3f *varray,
   }
 }
 
+static void
+sogl_generate_cube_mesh(sogl_primitive_mesh * mesh)
+{
+  // generates the same faces as sogl_render_cube(), with width,
+  // height and depth 1
+  SbVec3f varray[8];
+  sogl_generate_cube_vertices(varray, 0.5f, 0.5f, 0.5f);
+
+  const int * iptr = sogl_cube_vindices;
+  for (int i = 0; i < 6; i++) {
+    mesh->beginPart(0, TRUE);
+    sogl_primitive_mesh quad;
+    for (int j = 0; j < 4; j++) {
+      quad.addVertex(varray[*iptr],
+                     SbVec3f(&sogl_cube_normals[i*3]),
+                     SbVec2f(sogl_cube_texcoords[j<<1], sogl_cube_texcoords[(j<<1)+1]),
+                     SbVec3f(sogl_cube_3dtexcoords[*iptr]));
+      iptr++;
+    }
+    mesh->addFan(quad);
+    mesh->endPart();
+  }
+}
+
 
 void
 sogl_render_cube(const float width,
@@ -819,6 +1330,14 @@ sogl_render_cube(const float width,
     else maxunit = -1;
   }
 
+  if (sogl_render_shared_mesh(state, SOGL_MESH_CUBE, 0, 0,
+                              SbVec3f(width, height, depth),
+                              material, flags)) {
+    // always encourage auto caching for cubes
+    SoGLCacheContextElement::shouldAutoCache(state, SoGLCacheContextElement::DO_AUTO_CACHE);
+    SoGLCacheContextElement::incNumShapes(state);
+    return;
+  }
 
   SbVec3f varray[8];
   sogl_generate_cube_vertices(varray,
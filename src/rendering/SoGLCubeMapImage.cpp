@@ -108,26 +108,38 @@ public:
   class dldata {
   public:
     dldata(void)
-      : dlist(NULL), age(0) { }
+      : dlist(NULL), age(0), dirtyfaces(0) { }
     dldata(SoGLDisplayList *dl)
       : dlist(dl),
-        age(0) { }
+        age(0),
+        dirtyfaces(0) { }
     dldata(const dldata & org)
       : dlist(org.dlist),
-        age(org.age) { }
+        age(org.age),
+        dirtyfaces(org.dirtyfaces) { }
     SoGLDisplayList * dlist;
     uint32_t age;
+    // faces changed since they were uploaded, one bit per face
+    unsigned int dirtyfaces;
   };
 
-  SoGLDisplayList * findDL(SoState *state) {
+  int findDL(SoState *state) {
     int currcontext = SoGLCacheContextElement::get(state);
     int i, n = this->dlists.getLength();
-    SoGLDisplayList *dl;
     for (i = 0; i < n; i++) {
-      dl = this->dlists[i].dlist;
-      if (dl->getContext() == currcontext) return dl;
+      if (this->dlists[i].dlist->getContext() == currcontext) return i;
+    }
+    return -1;
+  }
+
+  static GLenum getFormat(const int numcomponents) {
+    switch (numcomponents) {
+    default: // avoid compiler warnings
+    case 1: return GL_LUMINANCE;
+    case 2: return GL_LUMINANCE_ALPHA;
+    case 3: return GL_RGB;
+    case 4: return GL_RGBA;
     }
-    return NULL;
   }
 
   SbList <dldata> dlists;
@@ -263,13 +275,24 @@ SoGLCubeMapImage::setCubeMapImage(const Target target,
                                   const int numcomponents)
 {
   int idx = (int) target;
+  SbVec2s oldsize;
+  int oldnc;
+  const SbBool hadbytes = PRIVATE(this)->image[idx].getValue(oldsize, oldnc) != NULL;
   PRIVATE(this)->image[idx].setValuePtr(size, numcomponents, bytes);
 
   PRIVATE(this)->lock();
-  for (int i = 0; i < PRIVATE(this)->dlists.getLength(); i++) {
-    PRIVATE(this)->dlists[i].dlist->unref(NULL);
+  if (bytes && hadbytes && oldsize == size && oldnc == numcomponents) {
+    // just upload the new face into the existing texture objects
+    for (int i = 0; i < PRIVATE(this)->dlists.getLength(); i++) {
+      PRIVATE(this)->dlists[i].dirtyfaces |= 1 << idx;
+    }
+  }
+  else {
+    for (int i = 0; i < PRIVATE(this)->dlists.getLength(); i++) {
+      PRIVATE(this)->dlists[i].dlist->unref(NULL);
+    }
+    PRIVATE(this)->dlists.truncate(0);
   }
-  PRIVATE(this)->dlists.truncate(0);
   PRIVATE(this)->unlock();
 
   // FIXME: this is a hack. Just set one of the images in
@@ -310,7 +333,22 @@ SoGLDisplayList *
 SoGLCubeMapImage::getGLDisplayList(SoState * state)
 {
   PRIVATE(this)->lock();
-  SoGLDisplayList * dl = PRIVATE(this)->findDL(state);
+  const int dlidx = PRIVATE(this)->findDL(state);
+  SoGLDisplayList * dl = dlidx >= 0 ? PRIVATE(this)->dlists[dlidx].dlist : NULL;
+  if (dl && PRIVATE(this)->dlists[dlidx].dirtyfaces) {
+    dl->open(state);
+    for (int i = 0; i < 6; i++) {
+      if (!(PRIVATE(this)->dlists[dlidx].dirtyfaces & (1 << i))) continue;
+      SbVec2s size;
+      int numcomponents;
+      unsigned char * bytes = PRIVATE(this)->image[i].getValue(size, numcomponents);
+      glTexSubImage2D(get_gltarget((Target) i), 0, 0, 0, size[0], size[1],
+                      SoGLCubeMapImageP::getFormat(numcomponents),
+                      GL_UNSIGNED_BYTE, bytes);
+    }
+    dl->close(state);
+    PRIVATE(this)->dlists[dlidx].dirtyfaces = 0;
+  }
   if (!dl) {
     dl = new SoGLDisplayList(state,
                              SoGLDisplayList::TEXTURE_OBJECT);
@@ -326,14 +364,7 @@ SoGLCubeMapImage::getGLDisplayList(SoState * state)
           SbVec2s size;
           int numcomponents;
           unsigned char * bytes = img->getValue(size, numcomponents);
-          GLenum format;
-          switch (numcomponents) {
-          default: // avoid compiler warnings
-          case 1: format = GL_LUMINANCE; break;
-          case 2: format = GL_LUMINANCE_ALPHA; break;
-          case 3: format = GL_RGB; break;
-          case 4: format = GL_RGBA; break;
-          }
+          GLenum format = SoGLCubeMapImageP::getFormat(numcomponents);
 
           // FIXME: resize image if not power of two
           glTexImage2D(get_gltarget((Target) i),
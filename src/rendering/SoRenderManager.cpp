@@ -72,6 +72,7 @@
 #include <Inventor/fields/SoSFTime.h>
 #include <Inventor/misc/SoAudioDevice.h>
 #include <Inventor/SoDB.h>
+#include <Inventor/engines/SoEngine.h>
 
 #include "coindefs.h"
 #include "tidbitsp.h"
@@ -657,6 +658,10 @@ SoRenderManager::render(SoGLRenderAction * action,
   SbBool clearwindow_tmp = clearwindow; // make sure we only clear the color buffer once
   PRIVATE(this)->invokePreRenderCallbacks();
 
+  if (SoEngine::isEvaluationSchedulingEnabled()) {
+    (void) SoEngine::evaluateScheduledEngines();
+  }
+
   if (PRIVATE(this)->superimpositions) {
     for (int i = 0; i < PRIVATE(this)->superimpositions->getLength(); i++) {
       Superimposition * s = (Superimposition *) (*PRIVATE(this)->superimpositions)[i];
@@ -125,6 +125,7 @@
 
 #include "nodes/SoSubNodeP.h"
 #include "misc/SbHash.h"
+#include "glue/cg.h"
 #include "shaders/SoGLARBShaderObject.h"
 #include "shaders/SoGLCgShaderObject.h"
 #include "shaders/SoGLSLShaderObject.h"
@@ -597,9 +598,8 @@ SoShaderObjectP::isSupported(SoShaderObject::SourceType sourceType, const cc_glg
     else if (sourceType == SoShaderObject::GLSL_PROGRAM) {
       return SoGLDriverDatabase::isSupported(glue, SO_GL_ARB_SHADER_OBJECT);
     }
-    // FIXME: Add support for detecting missing Cg support
-    // (20050427 handegar)
-    else if (sourceType == SoShaderObject::CG_PROGRAM) return TRUE;
+    // loads the Cg library on first use
+    else if (sourceType == SoShaderObject::CG_PROGRAM) return cc_cgglue_available();
     return FALSE;
   }
   else if (this->owner->isOfType(SoFragmentShader::getClassTypeId())) {
@@ -612,9 +612,8 @@ SoShaderObjectP::isSupported(SoShaderObject::SourceType sourceType, const cc_glg
     else if (sourceType == SoShaderObject::GLSL_PROGRAM) {
       return SoGLDriverDatabase::isSupported(glue, SO_GL_ARB_SHADER_OBJECT);
     }
-    // FIXME: Add support for detecting missing Cg support (20050427
-    // handegar)
-    else if (sourceType == SoShaderObject::CG_PROGRAM) return TRUE;
+    // loads the Cg library on first use
+    else if (sourceType == SoShaderObject::CG_PROGRAM) return cc_cgglue_available();
     return FALSE;
   }
   else {
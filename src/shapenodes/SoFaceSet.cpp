@@ -74,6 +74,7 @@
 
 #include <Inventor/misc/SoState.h>
 #include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoCallbackAction.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/system/gl.h>
 #include <Inventor/elements/SoGLCoordinateElement.h>
@@ -104,6 +105,7 @@
 #include "nodes/SoSubNodeP.h"
 #include "rendering/SoVBO.h"
 #include "rendering/SoGL.h"
+#include "shapenodes/soshape_batch.h"
 
 // *************************************************************************
 
@@ -906,6 +908,85 @@ SoFaceSet::generatePrimitives(SoAction *action)
     state->pop();
 }
 
+// Doc in parent. Triangle batch callbacks get arrays built directly
+// from the numVertices field, with no SoPrimitiveVertex or per
+// triangle callback involved. Non-convex polygons with more than four
+// vertices need the tessellator, and are left to
+// generatePrimitives().
+void
+SoFaceSet::callback(SoCallbackAction * action)
+{
+  if (!(this->numVertices.getNum() == 1 && this->numVertices[0] == 0) &&
+      action->shouldGenerateTriangleBatch(this)) {
+    SoState * state = action->getState();
+
+    if (this->vertexProperty.getValue()) {
+      state->push();
+      this->vertexProperty.getValue()->doAction(action);
+    }
+
+    const SoCoordinateElement * coords;
+    const SbVec3f * normals;
+    SoVertexShape::getVertexData(state, coords, normals, TRUE);
+
+    SoTextureCoordinateBundle tb(action, FALSE, FALSE);
+    const SbBool texindices = tb.needCoordinates() && !tb.isFunction();
+
+    Binding mbind = this->findMaterialBinding(state);
+    Binding nbind = this->findNormalBinding(state);
+
+    SoNormalCache * nc = NULL;
+    if (normals == NULL) {
+      nc = this->generateAndReadLockNormalCache(state);
+      normals = nc->getNormals();
+    }
+
+    int32_t idx = this->startIndex.getValue();
+    int32_t dummyarray[1];
+    const int32_t * ptr = this->numVertices.getValues(0);
+    const int32_t * end = ptr + this->numVertices.getNum();
+    this->fixNumVerticesPointers(state, ptr, end, dummyarray);
+
+    SbBool ok = !(tb.needCoordinates() && tb.isFunction() && tb.needIndices());
+    const SbBool convex =
+      SoShapeHintsElement::getFaceType(state) == SoShapeHintsElement::CONVEX;
+
+    int numhint = 0;
+    for (const int32_t * p = ptr; p < end; p++) numhint += *p;
+    soshape_batch batch(coords, normals, numhint);
+    SbList <int32_t> face(64);
+    int32_t mat = 0;
+    int32_t normal = normals ? 0 : -1;
+    int matnr = 0;
+    int normnr = 0;
+    int texnr = 0;
+
+    while (ok && ptr < end) {
+      const int n = *ptr++;
+      if (n > 4 && !convex) ok = FALSE;
+      face.truncate(0);
+      for (int i = 0; i < n; i++) {
+        if (i == 0 ? nbind != OVERALL : nbind == PER_VERTEX) normal = normnr++;
+        if (i == 0 ? mbind != OVERALL : mbind == PER_VERTEX) mat = matnr++;
+        const int32_t tex = texindices ? texnr++ : -1;
+        face.append(batch.vertex(idx++, normal, tex, mat));
+      }
+      for (int i = 1; i < n - 1; i++) {
+        batch.triangle(face[0], face[i], face[i+1]);
+      }
+    }
+    if (ok) batch.send(action, this, tb);
+
+    if (nc) {
+      this->readUnlockNormalCache();
+    }
+    if (this->vertexProperty.getValue()) {
+      state->pop();
+    }
+  }
+  inherited::callback(action);
+}
+
 // Documented in superclass.
 void
 SoFaceSet::notify(SoNotList * l)
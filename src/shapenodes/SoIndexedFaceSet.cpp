@@ -189,6 +189,7 @@
 #endif // HAVE_CONFIG_H
 
 #include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoCallbackAction.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/actions/SoGetPrimitiveCountAction.h>
 #include <Inventor/actions/SoRayPickAction.h>
@@ -229,6 +230,7 @@
 #include "rendering/SoVertexArrayIndexer.h"
 #include "rendering/SoVBO.h"
 #include "rendering/SoGL.h"
+#include "shapenodes/soshape_batch.h"
 
 // *************************************************************************
 
@@ -539,6 +541,9 @@ SoIndexedFaceSet::GLRender(SoGLRenderAction * action)
     !convexcacheused && !normalCacheUsed &&
     ((nbind == OVERALL) || ((nbind == PER_VERTEX_INDEXED) && ((nindices == cindices) || (nindices == NULL)))) &&
     ((tbind == NONE && !tb.needCoordinates()) || // no 
+     // function coordinates are generated for the vertex array
+     (tbind == NONE && tb.isFunction() && coords->is3D() &&
+      (nbind == PER_VERTEX_INDEXED)) ||
      ((tbind == PER_VERTEX_INDEXED) && ((tindices == cindices) || (tindices == NULL)))) &&
     ((mbind == NONE) || ((mbind == PER_VERTEX_INDEXED) && ((mindices == cindices) || (mindices == NULL)))) &&
     SoGLDriverDatabase::isSupported(sogl_glue_instance(state), SO_GL_VERTEX_ARRAY);
@@ -915,6 +920,130 @@ SoIndexedFaceSet::generatePrimitives(SoAction *action)
 
 #undef DO_VERTEX
 
+// Doc in parent. Triangle batch callbacks get arrays built directly
+// from the index fields, with no SoPrimitiveVertex or per triangle
+// callback involved. Non-convex polygons with more than four vertices
+// need the tessellator, and are left to generatePrimitives().
+void
+SoIndexedFaceSet::callback(SoCallbackAction * action)
+{
+  if (this->coordIndex.getNum() >= 3 &&
+      action->shouldGenerateTriangleBatch(this)) {
+    SoState * state = action->getState();
+
+    if (this->vertexProperty.getValue()) {
+      state->push();
+      this->vertexProperty.getValue()->doAction(action);
+    }
+
+    Binding mbind = this->findMaterialBinding(state);
+    Binding nbind = this->findNormalBinding(state);
+
+    const SoCoordinateElement * coords;
+    const SbVec3f * normals;
+    const int32_t * cindices;
+    int numindices;
+    const int32_t * nindices;
+    const int32_t * tindices;
+    const int32_t * mindices;
+    SbBool normalCacheUsed;
+
+    this->getVertexData(state, coords, normals, cindices,
+                        nindices, tindices, mindices, numindices,
+                        TRUE, normalCacheUsed);
+
+    SoTextureCoordinateBundle tb(action, FALSE, FALSE);
+
+    if (normalCacheUsed && nbind == PER_VERTEX) {
+      nbind = PER_VERTEX_INDEXED;
+    }
+    else if (normalCacheUsed && nbind == PER_FACE_INDEXED) {
+      nbind = PER_FACE;
+    }
+    if (this->getNodeType() == SoNode::VRML1) {
+      if (mbind == PER_VERTEX) {
+        mbind = PER_VERTEX_INDEXED;
+        mindices = cindices;
+      }
+      if (nbind == PER_VERTEX) {
+        nbind = PER_VERTEX_INDEXED;
+        nindices = cindices;
+      }
+    }
+    Binding tbind = NONE;
+    if (tb.needCoordinates() && !tb.isFunction()) {
+      if (SoTextureCoordinateBindingElement::get(state) ==
+          SoTextureCoordinateBindingElement::PER_VERTEX) {
+        tbind = PER_VERTEX;
+        tindices = NULL;
+      }
+      else {
+        tbind = PER_VERTEX_INDEXED;
+        if (tindices == NULL) tindices = cindices;
+      }
+    }
+    if (nbind == PER_VERTEX_INDEXED && nindices == NULL) {
+      nindices = cindices;
+    }
+    if (mbind == PER_VERTEX_INDEXED && mindices == NULL) {
+      mindices = cindices;
+    }
+
+    SbBool ok = !(tb.needCoordinates() && tb.isFunction() && tb.needIndices());
+    const SbBool convex =
+      SoShapeHintsElement::getFaceType(state) == SoShapeHintsElement::CONVEX;
+
+    soshape_batch batch(coords, normals, numindices);
+    SbList <int32_t> face(64);
+    const int32_t * viptr = cindices;
+    const int32_t * viendptr = viptr + numindices;
+    int32_t mat = 0;
+    int32_t normal = normals ? 0 : -1;
+    int matnr = 0;
+    int normnr = 0;
+    int texnr = 0;
+
+    while (ok && viptr + 2 < viendptr) {
+      if (mbind == PER_FACE) mat = matnr++;
+      else if (mbind == PER_FACE_INDEXED) mat = *mindices++;
+      if (nbind == PER_FACE) normal = normnr++;
+      else if (nbind == PER_FACE_INDEXED) normal = *nindices++;
+
+      face.truncate(0);
+      int32_t v = *viptr++;
+      while (v >= 0) {
+        if (mbind == PER_VERTEX) mat = matnr++;
+        else if (mbind == PER_VERTEX_INDEXED) mat = *mindices++;
+        if (nbind == PER_VERTEX) normal = normnr++;
+        else if (nbind == PER_VERTEX_INDEXED) normal = *nindices++;
+        int32_t tex = -1;
+        if (tbind == PER_VERTEX) tex = texnr++;
+        else if (tbind == PER_VERTEX_INDEXED) tex = *tindices++;
+        face.append(batch.vertex(v, normal, tex, mat));
+        v = viptr < viendptr ? *viptr++ : -1;
+      }
+      // generatePrimitives() stops at the first degenerate face
+      if (face.getLength() < 3) break;
+      if (face.getLength() > 4 && !convex) ok = FALSE;
+      for (int i = 1; i < face.getLength() - 1; i++) {
+        batch.triangle(face[0], face[i], face[i+1]);
+      }
+      if (mbind == PER_VERTEX_INDEXED) mindices++;
+      if (nbind == PER_VERTEX_INDEXED) nindices++;
+      if (tindices) tindices++;
+    }
+    if (ok) batch.send(action, this, tb);
+
+    if (normalCacheUsed) {
+      this->readUnlockNormalCache();
+    }
+    if (this->vertexProperty.getValue()) {
+      state->pop();
+    }
+  }
+  inherited::callback(action);
+}
+
 // doc from parent
 void
 SoIndexedFaceSet::getPrimitiveCount(SoGetPrimitiveCountAction *action)
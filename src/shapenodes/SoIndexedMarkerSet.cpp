@@ -118,6 +118,7 @@
 
 #include "nodes/SoSubNodeP.h"
 #include "rendering/SoGL.h"
+#include "shapenodes/SoMarkerSetP.h"
 
 SO_NODE_SOURCE(SoIndexedMarkerSet);
 
@@ -232,6 +233,8 @@ SoIndexedMarkerSet::GLRender(SoGLRenderAction * action)
   glLoadIdentity();
   glOrtho(0, vpsize[0], 0, vpsize[1], -1.0f, 1.0f);
 
+  SoMarkerSetP * sprites = SoMarkerSetP::beginMarkers(state);
+
   for (int i = 0; i < numindices; i++) {
     int32_t idx = cindices[i];
 
@@ -263,8 +266,10 @@ SoIndexedMarkerSet::GLRender(SoGLRenderAction * action)
     SbBool validMarker = SoMarkerSet::getMarker(marker, size, bytes, isLSBFirst);
     if (!validMarker) continue;
 
-    if (mbind == PER_VERTEX_INDEXED) mb.send(mindices[i], TRUE);
-    else if (mbind == PER_VERTEX) mb.send(i, TRUE);
+    int matidx = 0;
+    if (mbind == PER_VERTEX_INDEXED) matidx = mindices[i];
+    else if (mbind == PER_VERTEX) matidx = i;
+    if (!sprites && mbind != OVERALL) mb.send(matidx, TRUE);
 
     SbVec3f point = glcoords->get3(idx);
 
@@ -291,6 +296,11 @@ SoIndexedMarkerSet::GLRender(SoGLRenderAction * action)
     point[0] = point[0] - (size[0] - 1) / 2;
     point[1] = point[1] - (size[1] - 1) / 2;
 
+    if (sprites) {
+      sprites->addMarker(marker, SbVec3f(point[0], point[1], -point[2]), matidx);
+      continue;
+    }
+
     //FIXME: this will probably fail if someone has overwritten one of the
     //built-in markers. Currently there is no way of fetching a marker's
     //alignment from outside the SoMarkerSet class though. 20090424 wiesener
@@ -299,6 +309,7 @@ SoIndexedMarkerSet::GLRender(SoGLRenderAction * action)
     glRasterPos3f(point[0], point[1], -point[2]);
     glBitmap(size[0], size[1], 0, 0, 0, 0, bytes);
   }
+  if (sprites) sprites->endMarkers(state);
 
   for (GLint i = 0; i < numPlanes; ++i) {
     if (planesEnabled[i]) {
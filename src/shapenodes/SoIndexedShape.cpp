@@ -53,6 +53,7 @@
 #include <Inventor/nodes/SoVertexProperty.h>
 
 #include "nodes/SoSubNodeP.h"
+#include "shapenodes/soshape_bbox.h"
 #include "coindefs.h" // COIN_OBSOLETED()
 
 /*!
@@ -156,29 +157,20 @@ SoIndexedShape::computeBBox(SoAction * action, SbBox3f & box, SbVec3f & center)
   }
 
   const int numcoords = vpvtx ? vp->vertex.getNum() : coordelem->getNum();
-  int numacc = 0; // to calculate weighted center point
-  center.setValue(0.0f, 0.0f, 0.0f);
 
   if (vpvtx || coordelem->is3D()) {
     const SbVec3f * coords = vpvtx ?
       vp->vertex.getValues(0) :
       coordelem->getArrayPtr3();
 
-    const int32_t * ptr = this->coordIndex.getValues(0);
-    const int32_t * endptr = ptr + this->coordIndex.getNum();
-    while (ptr < endptr) {
-      const int idx = *ptr++;
-      if (idx < numcoords) {
-        if (idx >= 0) {
-          box.extendBy(coords[idx]);
-          center += coords[idx];
-          numacc++;
-        }
-      }
+    const int32_t * indices = this->coordIndex.getValues(0);
+    const int numindices = this->coordIndex.getNum();
+    if (!soshape_bbox::computeIndexed(coords, numcoords, indices, numindices,
+                                      box, center)) {
 #if COIN_DEBUG
-      else {
-        const ptrdiff_t faultyidxpos = (ptr - this->coordIndex.getValues(0)) - 1;
-        error_idx_out_of_bounds(this, (int)faultyidxpos, numcoords - 1);
+      for (int i = 0; i < numindices; i++) {
+        if (indices[i] < numcoords) continue;
+        error_idx_out_of_bounds(this, i, numcoords - 1);
         if (numcoords <= 1) break; // give only one error msg on missing coords
         // (the default state is that there's a default
         // SoCoordinateElement element with a single default
@@ -188,6 +180,8 @@ SoIndexedShape::computeBBox(SoAction * action, SbBox3f & box, SbVec3f & center)
     }
   }
   else {
+    int numacc = 0; // to calculate weighted center point
+    center.setValue(0.0f, 0.0f, 0.0f);
     SbVec3f tmp;
     const SbVec4f * coords = coordelem->getArrayPtr4();
     const int32_t * ptr = this->coordIndex.getValues(0);
@@ -214,8 +208,8 @@ SoIndexedShape::computeBBox(SoAction * action, SbBox3f & box, SbVec3f & center)
       }
 #endif // COIN_DEBUG
     }
+    if (numacc) center /= (float) numacc;
   }
-  if (numacc) center /= (float) numacc;
 }
 
 /*!
@@ -355,3 +349,86 @@ SoIndexedShape::getVertexData(SoState * state,
   }
   return TRUE;
 }
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/nodes/SoIndexedPointSet.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+#include <cmath>
+
+// The bounding box and center must match a plain loop over the
+// coordinates, also for arrays large enough to be split over threads.
+BOOST_AUTO_TEST_CASE(computeBBox)
+{
+  const int sizes[] = { 1, 7, 4099, (1 << 21) + 3 };
+  for (int s = 0; s < int(sizeof(sizes) / sizeof(sizes[0])); s++) {
+    const int num = sizes[s];
+    SoVertexProperty * vp = new SoVertexProperty;
+    SoIndexedPointSet * ps = new SoIndexedPointSet;
+    ps->ref();
+    ps->vertexProperty = vp;
+    vp->vertex.setNum(num);
+    ps->coordIndex.setNum(num + 1);
+    SbVec3f * coords = vp->vertex.startEditing();
+    int32_t * indices = ps->coordIndex.startEditing();
+    for (int i = 0; i < num; i++) {
+      coords[i].setValue(float(((i % 1000) * 7919) % 1000) - 500.0f,
+                         float((i * 7) % 333) * 0.5f,
+                         float(i % 17) - float(i % 5) * 3.0f);
+      // every other coordinate is used, in reverse order
+      indices[i] = (i % 2) ? -1 : num - 1 - i;
+    }
+    indices[num] = 0;
+    SbBox3f refbox;
+    double refsum[3] = { 0.0, 0.0, 0.0 };
+    int refnum = 0;
+    for (int i = 0; i <= num; i++) {
+      if (indices[i] >= 0) {
+        refbox.extendBy(coords[indices[i]]);
+        for (int j = 0; j < 3; j++) refsum[j] += coords[indices[i]][j];
+        refnum++;
+      }
+    }
+    const SbVec3f refcenter(float(refsum[0] / refnum),
+                            float(refsum[1] / refnum),
+                            float(refsum[2] / refnum));
+    vp->vertex.finishEditing();
+    ps->coordIndex.finishEditing();
+
+    SoGetBoundingBoxAction bba(SbViewportRegion(100, 100));
+    bba.apply(ps);
+    BOOST_CHECK(bba.getBoundingBox().getMin() == refbox.getMin());
+    BOOST_CHECK(bba.getBoundingBox().getMax() == refbox.getMax());
+    BOOST_CHECK_MESSAGE((bba.getCenter() - refcenter).length() < 1e-3f,
+                        "wrong center for " << num << " coordinates");
+    ps->unref();
+  }
+}
+
+// NaN coordinates must be skipped, and not reset the box.
+BOOST_AUTO_TEST_CASE(computeBBoxNaN)
+{
+  const float nan = float(std::sqrt(-1.0));
+  SoVertexProperty * vp = new SoVertexProperty;
+  const SbVec3f coords[] = {
+    SbVec3f(nan, nan, nan), SbVec3f(-1.0f, 2.0f, 0.0f),
+    SbVec3f(nan, 0.0f, nan), SbVec3f(3.0f, -4.0f, 5.0f),
+    SbVec3f(nan, nan, nan)
+  };
+  vp->vertex.setValues(0, 5, coords);
+  SoIndexedPointSet * ps = new SoIndexedPointSet;
+  ps->ref();
+  ps->vertexProperty = vp;
+  const int32_t indices[] = { 0, 1, 2, 3, 4 };
+  ps->coordIndex.setValues(0, 5, indices);
+
+  SoGetBoundingBoxAction bba(SbViewportRegion(100, 100));
+  bba.apply(ps);
+  BOOST_CHECK(bba.getBoundingBox().getMin() == SbVec3f(-1.0f, -4.0f, 0.0f));
+  BOOST_CHECK(bba.getBoundingBox().getMax() == SbVec3f(3.0f, 2.0f, 5.0f));
+  ps->unref();
+}
+
+#endif // COIN_TEST_SUITE
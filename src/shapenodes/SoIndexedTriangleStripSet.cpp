@@ -90,6 +90,7 @@
 #endif // HAVE_CONFIG_H
 
 #include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoCallbackAction.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/actions/SoGetPrimitiveCountAction.h>
 #include <Inventor/bundles/SoMaterialBundle.h>
@@ -111,6 +112,7 @@
 
 #include "nodes/SoSubNodeP.h"
 #include "rendering/SoGL.h"
+#include "shapenodes/soshape_batch.h"
 
 SO_NODE_SOURCE(SoIndexedTriangleStripSet);
 
@@ -718,3 +720,140 @@ SoIndexedTriangleStripSet::generatePrimitives(SoAction * action)
     state->pop();
   }
 }
+
+// Doc in parent. Triangle batch callbacks get arrays built directly
+// from the index fields, with no SoPrimitiveVertex or per triangle
+// callback involved.
+void
+SoIndexedTriangleStripSet::callback(SoCallbackAction * action)
+{
+  if (this->coordIndex.getNum() >= 3 &&
+      action->shouldGenerateTriangleBatch(this)) {
+    SoState * state = action->getState();
+
+    if (this->vertexProperty.getValue()) {
+      state->push();
+      this->vertexProperty.getValue()->doAction(action);
+    }
+
+    Binding mbind = this->findMaterialBinding(state);
+    Binding nbind = this->findNormalBinding(state);
+
+    const SoCoordinateElement * coords;
+    const SbVec3f * normals;
+    const int32_t * cindices;
+    int numindices;
+    const int32_t * nindices;
+    const int32_t * tindices;
+    const int32_t * mindices;
+    SbBool normalcacheused;
+
+    this->getVertexData(state, coords, normals, cindices,
+                        nindices, tindices, mindices, numindices,
+                        TRUE, normalcacheused);
+
+    SoTextureCoordinateBundle tb(action, FALSE, FALSE);
+    const SbBool texindices = tb.needCoordinates() && !tb.isFunction();
+    if (texindices) {
+      if (SoTextureCoordinateBindingElement::get(state) ==
+          SoTextureCoordinateBindingElement::PER_VERTEX) {
+        tindices = NULL;
+      }
+      else if (tindices == NULL) {
+        tindices = cindices;
+      }
+    }
+    if (nbind == PER_VERTEX_INDEXED && nindices == NULL) {
+      nindices = cindices;
+    }
+    if (mbind == PER_VERTEX_INDEXED && mindices == NULL) {
+      mindices = cindices;
+    }
+    if (normalcacheused && nbind == PER_VERTEX) {
+      nbind = PER_VERTEX_INDEXED;
+    }
+    else if (normalcacheused && nbind == PER_TRIANGLE_INDEXED) {
+      nbind = PER_TRIANGLE;
+    }
+    else if (normalcacheused && nbind == PER_STRIP_INDEXED) {
+      nbind = PER_STRIP;
+    }
+
+    // per strip and per triangle values are used for all three
+    // vertices of a triangle
+    const SbBool matpertri =
+      mbind != PER_VERTEX && mbind != PER_VERTEX_INDEXED;
+    const SbBool normalpertri =
+      nbind != PER_VERTEX && nbind != PER_VERTEX_INDEXED;
+
+    soshape_batch batch(coords, normals, numindices);
+    // coordinate, normal, texture coordinate and material index for
+    // each vertex in the strip
+    SbList <int32_t> strip(256);
+    const int32_t * viptr = cindices;
+    const int32_t * viendptr = viptr + numindices;
+    int32_t mat = 0;
+    int32_t normal = normals ? 0 : -1;
+    int matnr = 0;
+    int normnr = 0;
+    int texnr = 0;
+
+    const SbBool ok = !(tb.needCoordinates() && tb.isFunction() && tb.needIndices());
+    while (ok && viptr + 2 < viendptr) {
+      strip.truncate(0);
+      int k = 0;
+      int32_t v = *viptr++;
+      while (v >= 0) {
+        if (k == 0) {
+          if (mbind == PER_VERTEX || mbind == PER_TRIANGLE || mbind == PER_STRIP) mat = matnr++;
+          else if (mbind != OVERALL) mat = *mindices++;
+          if (nbind == PER_VERTEX || nbind == PER_TRIANGLE || nbind == PER_STRIP) normal = normnr++;
+          else if (nbind != OVERALL) normal = *nindices++;
+        }
+        else if (k < 3) {
+          if (mbind == PER_VERTEX) mat = matnr++;
+          else if (mbind == PER_VERTEX_INDEXED) mat = *mindices++;
+          if (nbind == PER_VERTEX) normal = normnr++;
+          else if (nbind == PER_VERTEX_INDEXED) normal = *nindices++;
+        }
+        else {
+          if (mbind == PER_VERTEX || mbind == PER_TRIANGLE) mat = matnr++;
+          else if (mbind == PER_VERTEX_INDEXED || mbind == PER_TRIANGLE_INDEXED) mat = *mindices++;
+          if (nbind == PER_VERTEX || nbind == PER_TRIANGLE) normal = normnr++;
+          else if (nbind == PER_VERTEX_INDEXED || nbind == PER_TRIANGLE_INDEXED) normal = *nindices++;
+        }
+        strip.append(v);
+        strip.append(normal);
+        strip.append(texindices ? (tindices ? *tindices++ : texnr++) : -1);
+        strip.append(mat);
+
+        if (k >= 2) {
+          // every other triangle has its first two vertices swapped
+          const int t = k - 2;
+          const int order[3] = { (t & 1) ? t + 1 : t, (t & 1) ? t : t + 1, t + 2 };
+          int32_t tri[3];
+          for (int j = 0; j < 3; j++) {
+            const int32_t * c = strip.getArrayPtr() + order[j] * 4;
+            tri[j] = batch.vertex(c[0], normalpertri ? normal : c[1], c[2],
+                                  matpertri ? mat : c[3]);
+          }
+          batch.triangle(tri[0], tri[1], tri[2]);
+        }
+        k++;
+        v = viptr < viendptr ? *viptr++ : -1;
+      }
+      if (mbind == PER_VERTEX_INDEXED) mindices++;
+      if (nbind == PER_VERTEX_INDEXED) nindices++;
+      if (tindices) tindices++;
+    }
+    if (ok) batch.send(action, this, tb);
+
+    if (normalcacheused) {
+      this->readUnlockNormalCache();
+    }
+    if (this->vertexProperty.getValue()) {
+      state->pop();
+    }
+  }
+  inherited::callback(action);
+}
@@ -49,6 +49,13 @@
   in TGS' Inventor implementation. (Note that TGS's implementation
   doesn't support the NONE markerIndex value.)
 
+  Markers are rendered as textured quads from a texture holding all
+  the marker bitmaps, with a single draw call for the complete set.
+  The result is pixel for pixel the same as drawing each marker with
+  glBitmap(), which is still done if the OpenGL driver lacks vertex
+  array support, or if the environment variable
+  COIN_MARKERSET_BITMAPS is set to 1.
+
   <b>FILE FORMAT/DEFAULTS:</b>
   \code
     MarkerSet {
@@ -92,6 +99,14 @@
 #include <Inventor/elements/SoViewportRegionElement.h>
 #include <Inventor/elements/SoCullElement.h>
 #include <Inventor/elements/SoGLCacheContextElement.h>
+#include <Inventor/misc/SoGLImage.h>
+#include <Inventor/elements/SoGLDisplayList.h>
+#include <Inventor/misc/SoGLDriverDatabase.h>
+#include <Inventor/threads/SbStorage.h>
+#include <Inventor/threads/SbMutex.h>
+#include <Inventor/C/glue/gl.h>
+#include <Inventor/C/tidbits.h>
+#include <Inventor/SbColor.h>
 
 #include <Inventor/system/gl.h>
 #if COIN_DEBUG
@@ -101,6 +116,7 @@
 #include "coindefs.h" // COIN_OBSOLETED
 #include "tidbitsp.h"
 #include "nodes/SoSubNodeP.h"
+#include "shapenodes/SoMarkerSetP.h"
 
 /*!
   \enum SoMarkerSet::MarkerType
@@ -161,6 +177,7 @@ free_marker_images(void)
     }
   }
   delete markerlist;
+  SoMarkerSetP::cleanup();
 }
 
 /*!
@@ -183,6 +200,7 @@ SoMarkerSet::initClass(void)
     temp.deletedata = FALSE;
     markerlist->append(temp);
   }
+  SoMarkerSetP::initClass();
 }
 
 // Internal method which translates the current material binding found
@@ -1208,6 +1226,8 @@ SoMarkerSet::GLRender(SoGLRenderAction * action)
   glLoadIdentity();
   glOrtho(0, vpsize[0], 0, vpsize[1], -1.0f, 1.0f);
 
+  SoMarkerSetP * sprites = SoMarkerSetP::beginMarkers(state);
+
   for (int i = 0; i < numpts; i++) {
     int midx = SbMin(i, this->markerIndex.getNum() - 1);
 #if COIN_DEBUG
@@ -1225,7 +1245,11 @@ SoMarkerSet::GLRender(SoGLRenderAction * action)
       }
 #endif // COIN_DEBUG
 
-    if (mbind == PER_VERTEX) mb.send(matnr++, TRUE);
+    const int curmatnr = matnr;
+    if (mbind == PER_VERTEX) {
+      if (!sprites) mb.send(matnr, TRUE);
+      matnr++;
+    }
 
     SbVec3f point = coords->get3(idx);
     idx++;
@@ -1255,10 +1279,17 @@ SoMarkerSet::GLRender(SoGLRenderAction * action)
     point[0] = point[0] - (tmp->width - 1) / 2;
     point[1] = point[1] - (tmp->height - 1) / 2;
 
+    if (sprites) {
+      sprites->addMarker(this->markerIndex[midx],
+                         SbVec3f(point[0], point[1], -point[2]),
+                         (mbind == PER_VERTEX) ? curmatnr : 0);
+      continue;
+    }
     glPixelStorei(GL_UNPACK_ALIGNMENT, tmp->align);
     glRasterPos3f(point[0], point[1], -point[2]);
     glBitmap(tmp->width, tmp->height, 0, 0, 0, 0, tmp->data);
   }
+  if (sprites) sprites->endMarkers(state);
 
   for (GLint i = 0; i < numPlanes; ++i) {
     if (planesEnabled[i]) {
@@ -1277,6 +1308,353 @@ SoMarkerSet::GLRender(SoGLRenderAction * action)
   state->pop(); // we pushed, remember
 }
 
+// *************************************************************************
+
+// The marker atlas is shared by all contexts and threads, and is
+// rebuilt when markers are added or removed. The generation is
+// increased each time it is rebuilt.
+static SbStorage * somarkerset_storage = NULL;
+static SoGLImage * somarkerset_atlas = NULL;
+static unsigned char * somarkerset_atlasdata = NULL;
+static SbList <somarkerset_atlasentry> * somarkerset_atlasentries = NULL;
+static SbVec2f somarkerset_atlasscale;
+static SbBool somarkerset_atlasvalid = FALSE;
+static uint32_t somarkerset_atlasgeneration = 0;
+static SbMutex * somarkerset_mutex = NULL;
+
+#ifdef COIN_THREADSAFE
+#define LOCK_MARKERATLAS somarkerset_mutex->lock()
+#define UNLOCK_MARKERATLAS somarkerset_mutex->unlock()
+#else // COIN_THREADSAFE
+#define LOCK_MARKERATLAS
+#define UNLOCK_MARKERATLAS
+#endif // !COIN_THREADSAFE
+
+static void
+somarkerset_construct_data(void * closure)
+{
+  *static_cast<SoMarkerSetP **>(closure) = new SoMarkerSetP;
+}
+
+static void
+somarkerset_destruct_data(void * closure)
+{
+  delete *static_cast<SoMarkerSetP **>(closure);
+}
+
+void
+SoMarkerSetP::initClass(void)
+{
+  somarkerset_storage = new SbStorage(sizeof(SoMarkerSetP *),
+                                      somarkerset_construct_data,
+                                      somarkerset_destruct_data);
+  somarkerset_atlasentries = new SbList <somarkerset_atlasentry>;
+  somarkerset_mutex = new SbMutex;
+}
+
+// called from free_marker_images()
+void
+SoMarkerSetP::cleanup(void)
+{
+  delete somarkerset_storage;
+  somarkerset_storage = NULL;
+  if (somarkerset_atlas) somarkerset_atlas->unref(NULL);
+  somarkerset_atlas = NULL;
+  delete[] somarkerset_atlasdata;
+  somarkerset_atlasdata = NULL;
+  delete somarkerset_atlasentries;
+  somarkerset_atlasentries = NULL;
+  somarkerset_atlasvalid = FALSE;
+  delete somarkerset_mutex;
+  somarkerset_mutex = NULL;
+}
+
+void
+SoMarkerSetP::atlasChanged(void)
+{
+  LOCK_MARKERATLAS;
+  somarkerset_atlasvalid = FALSE;
+  UNLOCK_MARKERATLAS;
+}
+
+static int
+somarkerset_next_pow2(const int val)
+{
+  int pow2 = 1;
+  while (pow2 < val) pow2 <<= 1;
+  return pow2;
+}
+
+// Packs all markers into rows of the atlas image. Must be called with
+// the atlas mutex locked.
+SbBool
+SoMarkerSetP::updateAtlas(void)
+{
+  if (somarkerset_atlasvalid) return TRUE;
+
+  const int nummarkers = markerlist->getLength();
+  int width = 256;
+  int i;
+  for (i = 0; i < nummarkers; i++) {
+    width = SbMax(width, somarkerset_next_pow2((*markerlist)[i].width));
+  }
+  if (width > 32767) return FALSE;
+
+  somarkerset_atlasentries->truncate(0);
+  int x = 0, y = 0, rowheight = 0;
+  for (i = 0; i < nummarkers; i++) {
+    const so_marker & marker = (*markerlist)[i];
+    somarkerset_atlasentry entry;
+    entry.x = entry.y = -1;
+    entry.width = static_cast<short>(marker.width);
+    entry.height = static_cast<short>(marker.height);
+    if (marker.data && marker.width > 0 && marker.height > 0) {
+      if (x + marker.width > width) {
+        x = 0;
+        y += rowheight;
+        rowheight = 0;
+      }
+      entry.x = static_cast<short>(x);
+      entry.y = static_cast<short>(y);
+      x += marker.width;
+      rowheight = SbMax(rowheight, marker.height);
+    }
+    somarkerset_atlasentries->append(entry);
+  }
+  const int height = somarkerset_next_pow2(y + rowheight);
+  if (height > 32767) return FALSE;
+
+  // luminance-alpha image, with alpha set for the bits which are set
+  // in the marker bitmaps. The rows of a bitmap are stored bottom up,
+  // with the most significant bit of each byte to the left.
+  delete[] somarkerset_atlasdata;
+  somarkerset_atlasdata = new unsigned char[width * height * 2];
+  for (i = 0; i < width * height; i++) {
+    somarkerset_atlasdata[i * 2] = 255;
+    somarkerset_atlasdata[i * 2 + 1] = 0;
+  }
+  for (i = 0; i < nummarkers; i++) {
+    const so_marker & marker = (*markerlist)[i];
+    const somarkerset_atlasentry & entry = (*somarkerset_atlasentries)[i];
+    if (entry.x < 0) continue;
+    somarkerset_unpack_bitmap(marker.data, marker.width, marker.height, marker.align,
+                              somarkerset_atlasdata + (entry.y * width + entry.x) * 2,
+                              width);
+  }
+
+  if (somarkerset_atlas == NULL) {
+    somarkerset_atlas = new SoGLImage;
+    somarkerset_atlas->setFlags(SoGLImage::NO_MIPMAP |
+                                SoGLImage::FORCE_ALPHA_TEST_TRUE |
+                                SoGLImage::INVINCIBLE);
+  }
+  somarkerset_atlas->setData(somarkerset_atlasdata, SbVec2s(width, height), 2,
+                             SoGLImage::CLAMP_TO_EDGE, SoGLImage::CLAMP_TO_EDGE);
+  somarkerset_atlasscale.setValue(1.0f / width, 1.0f / height);
+  somarkerset_atlasvalid = TRUE;
+  somarkerset_atlasgeneration++;
+  return TRUE;
+}
+
+void
+somarkerset_unpack_bitmap(const unsigned char * bitmap,
+                          const int width, const int height, const int align,
+                          unsigned char * dst, const int dstwidth)
+{
+  const int rowalign = align > 0 ? align : 1;
+  const int stride = (((width + 7) / 8 + rowalign - 1) / rowalign) * rowalign;
+  for (int row = 0; row < height; row++) {
+    const unsigned char * src = bitmap + row * stride;
+    unsigned char * dstrow = dst + row * dstwidth * 2;
+    for (int col = 0; col < width; col++) {
+      if (src[col >> 3] & (0x80 >> (col & 7))) dstrow[col * 2 + 1] = 255;
+    }
+  }
+}
+
+SoMarkerSetP *
+SoMarkerSetP::beginMarkers(SoState * state)
+{
+  static int COIN_MARKERSET_BITMAPS = -1;
+  if (COIN_MARKERSET_BITMAPS < 0) {
+    const char * env = coin_getenv("COIN_MARKERSET_BITMAPS");
+    COIN_MARKERSET_BITMAPS = env ? atoi(env) : 0;
+  }
+  if (COIN_MARKERSET_BITMAPS) return NULL;
+
+  const cc_glglue * glue = cc_glglue_instance(SoGLCacheContextElement::get(state));
+  if (!SoGLDriverDatabase::isSupported(glue, SO_GL_VERTEX_ARRAY)) return NULL;
+
+  // the alpha test is used to discard the unset bitmap pixels, and
+  // can't be combined with the one set up by the application
+  float alpharef;
+  if (SoLazyElement::getAlphaTest(state, alpharef)) return NULL;
+
+  SoMarkerSetP * thisp = *static_cast<SoMarkerSetP **>(somarkerset_storage->get());
+
+  // the texture is uploaded, and what addMarker() needs is copied,
+  // while the atlas can't be rebuilt
+  LOCK_MARKERATLAS;
+  SoGLDisplayList * dl = NULL;
+  if (SoMarkerSetP::updateAtlas()) {
+    dl = somarkerset_atlas->getGLDisplayList(state);
+  }
+  if (dl) {
+    dl->ref();
+    if (thisp->atlasgeneration != somarkerset_atlasgeneration) {
+      thisp->atlasentries = *somarkerset_atlasentries;
+      thisp->atlasscale = somarkerset_atlasscale;
+      thisp->atlasgeneration = somarkerset_atlasgeneration;
+    }
+  }
+  UNLOCK_MARKERATLAS;
+  if (dl == NULL) return NULL;
+  thisp->atlasdl = dl;
+
+  const SbVec2s vpsize = SoViewportRegionElement::get(state).getViewportSizePixels();
+  thisp->vpsize.setValue(vpsize[0], vpsize[1]);
+
+  const SoLazyElement * lelem = SoLazyElement::getInstance(state);
+  thisp->numdiffuse = lelem->getNumDiffuse();
+  thisp->numtransp = lelem->getNumTransparencies();
+  // the alpha value of the color only has an effect when blending
+  int sfactor, dfactor;
+  thisp->alphamask = SoLazyElement::getBlending(state, sfactor, dfactor) ? 0x00 : 0xff;
+  if (lelem->isPacked()) {
+    thisp->packedcolors = lelem->getPackedPointer();
+    thisp->diffusecolors = NULL;
+    thisp->transparencies = NULL;
+  }
+  else {
+    thisp->packedcolors = NULL;
+    thisp->diffusecolors = lelem->getDiffusePointer();
+    thisp->transparencies = lelem->getTransparencyPointer();
+  }
+  thisp->vertices.truncate(0);
+  thisp->texcoords.truncate(0);
+  thisp->colors.truncate(0);
+  return thisp;
+}
+
+void
+SoMarkerSetP::addMarker(const int marker, const SbVec3f & rasterpos,
+                        const int materialindex)
+{
+  // glRasterPos3f() gives an invalid raster position, and glBitmap()
+  // draws nothing, for positions outside the window coordinate
+  // projection
+  if (rasterpos[0] < 0.0f || rasterpos[0] > this->vpsize[0] ||
+      rasterpos[1] < 0.0f || rasterpos[1] > this->vpsize[1] ||
+      rasterpos[2] < -1.0f || rasterpos[2] > 1.0f) return;
+
+  if (marker < 0 || marker >= this->atlasentries.getLength()) return;
+  const somarkerset_atlasentry & entry = this->atlasentries[marker];
+  if (entry.x < 0) return;
+
+  // glBitmap() puts the lower left corner of the bitmap at the raster
+  // position rounded down. Drivers add a small epsilon before
+  // rounding, so that positions which are integers before the
+  // projection roundtrip don't end up one pixel off.
+  const float x0 = static_cast<float>(floor(rasterpos[0] + 0.0001f));
+  const float y0 = static_cast<float>(floor(rasterpos[1] + 0.0001f));
+  const float x1 = x0 + entry.width;
+  const float y1 = y0 + entry.height;
+  const float z = rasterpos[2];
+  this->vertices.append(SbVec3f(x0, y0, z));
+  this->vertices.append(SbVec3f(x1, y0, z));
+  this->vertices.append(SbVec3f(x1, y1, z));
+  this->vertices.append(SbVec3f(x0, y1, z));
+
+  const float s0 = entry.x * this->atlasscale[0];
+  const float t0 = entry.y * this->atlasscale[1];
+  const float s1 = (entry.x + entry.width) * this->atlasscale[0];
+  const float t1 = (entry.y + entry.height) * this->atlasscale[1];
+  this->texcoords.append(SbVec2f(s0, t0));
+  this->texcoords.append(SbVec2f(s1, t0));
+  this->texcoords.append(SbVec2f(s1, t1));
+  this->texcoords.append(SbVec2f(s0, t1));
+
+  uint32_t col;
+  if (this->packedcolors) {
+    col = this->packedcolors[SbClamp(materialindex, 0, this->numdiffuse - 1)];
+  }
+  else {
+    const SbColor & c = this->diffusecolors[SbClamp(materialindex, 0, this->numdiffuse - 1)];
+    const float t = this->transparencies[SbClamp(materialindex, 0, this->numtransp - 1)];
+    col = c.getPackedValue(t);
+  }
+  col |= this->alphamask;
+  // stored in memory as RGBA for the color array
+  uint8_t rgba[4];
+  rgba[0] = static_cast<uint8_t>(col >> 24);
+  rgba[1] = static_cast<uint8_t>((col >> 16) & 0xff);
+  rgba[2] = static_cast<uint8_t>((col >> 8) & 0xff);
+  rgba[3] = static_cast<uint8_t>(col & 0xff);
+  uint32_t packed;
+  memcpy(&packed, rgba, sizeof(packed));
+  for (int i = 0; i < 4; i++) this->colors.append(packed);
+}
+
+void
+SoMarkerSetP::endMarkers(SoState * state)
+{
+  const int numvertices = this->vertices.getLength();
+  if (numvertices == 0) {
+    this->atlasdl->unref(state);
+    this->atlasdl = NULL;
+    return;
+  }
+
+  const cc_glglue * glue = cc_glglue_instance(SoGLCacheContextElement::get(state));
+
+  // make sure the quads are rasterized just like bitmaps: filled,
+  // without culling, stippling, offset or generated texture
+  // coordinates
+  glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_POLYGON_BIT |
+               GL_COLOR_BUFFER_BIT | GL_CURRENT_BIT);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_POLYGON_STIPPLE);
+  glDisable(GL_POLYGON_OFFSET_FILL);
+  glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  glDisable(GL_TEXTURE_GEN_S);
+  glDisable(GL_TEXTURE_GEN_T);
+  glDisable(GL_TEXTURE_GEN_R);
+  glDisable(GL_TEXTURE_GEN_Q);
+
+  glEnable(GL_TEXTURE_2D);
+  this->atlasdl->call(state);
+  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+  glEnable(GL_ALPHA_TEST);
+  glAlphaFunc(GL_GREATER, 0.0f);
+
+  glMatrixMode(GL_TEXTURE);
+  glPushMatrix();
+  glLoadIdentity();
+
+  cc_glglue_glVertexPointer(glue, 3, GL_FLOAT, 0, this->vertices.getArrayPtr());
+  cc_glglue_glTexCoordPointer(glue, 2, GL_FLOAT, 0, this->texcoords.getArrayPtr());
+  cc_glglue_glColorPointer(glue, 4, GL_UNSIGNED_BYTE, 0, this->colors.getArrayPtr());
+  cc_glglue_glEnableClientState(glue, GL_VERTEX_ARRAY);
+  cc_glglue_glEnableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  cc_glglue_glEnableClientState(glue, GL_COLOR_ARRAY);
+
+  cc_glglue_glDrawArrays(glue, GL_QUADS, 0, numvertices);
+
+  cc_glglue_glDisableClientState(glue, GL_COLOR_ARRAY);
+  cc_glglue_glDisableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  cc_glglue_glDisableClientState(glue, GL_VERTEX_ARRAY);
+
+  glPopMatrix();
+  glMatrixMode(GL_MODELVIEW);
+  glPopAttrib();
+
+  this->atlasdl->unref(state);
+  this->atlasdl = NULL;
+}
+
+#undef LOCK_MARKERATLAS
+#undef UNLOCK_MARKERATLAS
+
 // ----------------------------------------------------------------------------------------------------
 
 // Documented in superclass.
@@ -1456,6 +1834,7 @@ SoMarkerSet::addMarker(int idx, const SbVec2s & size,
   if (isLSBFirst) { swap_leftright(temp->data,size[0],size[1]); }
   if (isUpToDown) { swap_updown(temp->data,size[0],size[1]); }
   if (appendnew) markerlist->append(tempmarker);
+  SoMarkerSetP::atlasChanged();
 }
 
 /*!
@@ -1496,6 +1875,7 @@ SoMarkerSet::removeMarker(int idx)
   so_marker * tmp = &(*markerlist)[idx];
   if (tmp->deletedata) delete[] tmp->data;
   markerlist->remove(idx);
+  SoMarkerSetP::atlasChanged();
   return TRUE;
 }
 
@@ -1510,3 +1890,89 @@ SoMarkerSet::isMarkerBitSet(int COIN_UNUSED_ARG(idx), int COIN_UNUSED_ARG(bitNum
   COIN_OBSOLETED();
   return FALSE;
 }
+
+#ifdef COIN_TEST_SUITE
+
+#include <cstring>
+#include <Inventor/nodes/SoMarkerSet.h>
+
+// somarkerset_unpack_bitmap() is internal, so it is declared here
+// instead of including SoMarkerSetP.h.
+extern "C" {
+void somarkerset_unpack_bitmap(const unsigned char * bitmap,
+                               const int width, const int height,
+                               const int align,
+                               unsigned char * dst, const int dstwidth);
+}
+
+// returns the alpha of pixel (x, y) in a luminance-alpha image
+static unsigned char
+somarkerset_alpha(const unsigned char * image, const int width,
+                  const int x, const int y)
+{
+  return image[(y * width + x) * 2 + 1];
+}
+
+BOOST_AUTO_TEST_CASE(unpackBitOrder)
+{
+  // the most significant bit is the leftmost pixel
+  const unsigned char bitmap[] = { 0x81, 0x40 };
+  unsigned char image[10 * 2];
+  memset(image, 0, sizeof(image));
+  somarkerset_unpack_bitmap(bitmap, 10, 1, 1, image, 10);
+
+  for (int x = 0; x < 10; x++) {
+    const SbBool set = (x == 0 || x == 7 || x == 9);
+    BOOST_CHECK_MESSAGE(somarkerset_alpha(image, 10, x, 0) == (set ? 255 : 0),
+                        "wrong alpha for pixel " << x);
+    BOOST_CHECK_MESSAGE(image[x * 2] == 0, "luminance should not be touched");
+  }
+}
+
+BOOST_AUTO_TEST_CASE(unpackAlignment)
+{
+  // 10 pixels wide rows use 2 bytes, padded to 4 with align 4. The
+  // padding bytes are set, and must not show up in the image.
+  const unsigned char aligned[] = {
+    0x80, 0x00, 0xff, 0xff,
+    0x00, 0x40, 0xff, 0xff
+  };
+  const unsigned char packed[] = {
+    0x80, 0x00,
+    0x00, 0x40
+  };
+
+  // unpack into a wider image to check the destination stride too
+  const int dstwidth = 16;
+  unsigned char image1[dstwidth * 2 * 2];
+  unsigned char image4[dstwidth * 2 * 2];
+  memset(image1, 0, sizeof(image1));
+  memset(image4, 0, sizeof(image4));
+  somarkerset_unpack_bitmap(packed, 10, 2, 1, image1, dstwidth);
+  somarkerset_unpack_bitmap(aligned, 10, 2, 4, image4, dstwidth);
+
+  BOOST_CHECK_MESSAGE(memcmp(image1, image4, sizeof(image1)) == 0,
+                      "align 1 and align 4 bitmaps should unpack to the same image");
+  int numset = 0;
+  for (int y = 0; y < 2; y++) {
+    for (int x = 0; x < dstwidth; x++) {
+      if (somarkerset_alpha(image4, dstwidth, x, y)) numset++;
+    }
+  }
+  BOOST_CHECK_MESSAGE(numset == 2, "expected 2 set pixels, got " << numset);
+  BOOST_CHECK(somarkerset_alpha(image4, dstwidth, 0, 0) == 255);
+  BOOST_CHECK(somarkerset_alpha(image4, dstwidth, 9, 1) == 255);
+}
+
+BOOST_AUTO_TEST_CASE(unpackDefaultAlignment)
+{
+  // align 0 is treated as byte aligned rows
+  const unsigned char bitmap[] = { 0x01, 0x80 };
+  unsigned char image[8 * 2 * 2];
+  memset(image, 0, sizeof(image));
+  somarkerset_unpack_bitmap(bitmap, 8, 2, 0, image, 8);
+  BOOST_CHECK(somarkerset_alpha(image, 8, 7, 0) == 255);
+  BOOST_CHECK(somarkerset_alpha(image, 8, 0, 1) == 255);
+}
+
+#endif // COIN_TEST_SUITE
@@ -0,0 +1,111 @@
+#ifndef COIN_SOMARKERSETP_H
+#define COIN_SOMARKERSETP_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/SbVec3f.h>
+#include <Inventor/SbVec2f.h>
+#include <Inventor/lists/SbList.h>
+
+class SoState;
+class SbColor;
+class SoGLDisplayList;
+
+// position and size of a marker in the texture atlas, in pixels
+struct somarkerset_atlasentry {
+  short x, y;
+  short width, height;
+};
+
+// Renders markers as textured quads in a single draw call, instead of
+// one glBitmap() call per marker. The bitmaps of all defined markers
+// are packed into one texture atlas, and each marker is drawn as a
+// quad covering exactly the pixels glBitmap() would have covered.
+// Used by SoMarkerSet and SoIndexedMarkerSet.
+class SoMarkerSetP {
+public:
+  SoMarkerSetP(void) : atlasgeneration(0), atlasdl(NULL) { }
+
+  // returns NULL if markers should be drawn with glBitmap(). The
+  // projection must be set up for window coordinates before the
+  // first call to addMarker().
+  static SoMarkerSetP * beginMarkers(SoState * state);
+
+  // adds a marker at the position which would have been passed to
+  // glRasterPos3f()
+  void addMarker(const int marker, const SbVec3f & rasterpos,
+                 const int materialindex);
+  void endMarkers(SoState * state);
+
+  static void initClass(void);
+  static void cleanup(void);
+  static void atlasChanged(void);
+
+private:
+  static SbBool updateAtlas(void);
+
+  // copied from the shared atlas in beginMarkers(), as the atlas may
+  // be rebuilt by other threads while the markers are added
+  SbList <somarkerset_atlasentry> atlasentries;
+  SbVec2f atlasscale;
+  uint32_t atlasgeneration;
+  SoGLDisplayList * atlasdl;
+
+  SbVec2f vpsize;
+  const uint32_t * packedcolors;
+  const SbColor * diffusecolors;
+  const float * transparencies;
+  int numdiffuse;
+  int numtransp;
+  uint32_t alphamask;
+
+  SbList <SbVec3f> vertices;
+  SbList <SbVec2f> texcoords;
+  SbList <uint32_t> colors;
+};
+
+// Sets the alpha of the pixels in the luminance-alpha image dst for
+// the bits which are set in bitmap. The rows of the bitmap are
+// aligned to align bytes, and the most significant bit of each byte
+// is the leftmost pixel. dstwidth is the width of dst in pixels.
+extern "C" void somarkerset_unpack_bitmap(const unsigned char * bitmap,
+                                          const int width, const int height,
+                                          const int align,
+                                          unsigned char * dst,
+                                          const int dstwidth);
+
+#endif // !COIN_SOMARKERSETP_H
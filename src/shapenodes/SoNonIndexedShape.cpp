@@ -47,6 +47,7 @@
 #include <Inventor/elements/SoCoordinateElement.h>
 
 #include "nodes/SoSubNodeP.h"
+#include "shapenodes/soshape_bbox.h"
 
 /*!  
   \var SoSFInt32 SoNonIndexedShape::startIndex 
@@ -124,19 +125,15 @@ SoNonIndexedShape::computeCoordBBox(SoAction * action, int numVertices,
     return;
   }
 
-  center.setValue(0.0f, 0.0f, 0.0f);
-  
   if (vpvtx || coordelem->is3D()) {
     const SbVec3f * coords = vpvtx ?
       vp->vertex.getValues(0) :
       coordelem->getArrayPtr3();
-    
-    for (int i = startidx; i <= lastidx; i++) {
-      box.extendBy(coords[i]);
-      center += coords[i];
-    }
+
+    soshape_bbox::compute(coords + startidx, lastidx + 1 - startidx, box, center);
   }
   else { // 4D
+    center.setValue(0.0f, 0.0f, 0.0f);
     SbVec3f tmp;
     const SbVec4f * coords = coordelem->getArrayPtr4();
     for (int i = startidx; i <= lastidx; i++) {
@@ -145,9 +142,9 @@ SoNonIndexedShape::computeCoordBBox(SoAction * action, int numVertices,
       box.extendBy(tmp);
       center += tmp;
     }
-  }
-  if (lastidx+1 - startidx) {
-    center /= float(lastidx + 1 - startidx);
+    if (lastidx+1 - startidx) {
+      center /= float(lastidx + 1 - startidx);
+    }
   }
 }
 
@@ -182,3 +179,144 @@ SoNonIndexedShape::fixNumVerticesPointers(SoState *state, const int32_t *&start,
     end = numCoords > 1 ? start + 1 : start;
   }
 }
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/nodes/SoFaceSet.h>
+#include <Inventor/nodes/SoPointSet.h>
+#include <Inventor/nodes/SoVertexProperty.h>
+#include <cmath>
+
+// Fills vp with start + num + 1 coordinates. Only the num coordinates
+// from start and on are inside the box, and their bounding box and
+// average are returned in refbox and refcenter.
+static void
+nonindexedshape_fill(SoVertexProperty * vp, const int start, const int num,
+                     SbBox3f & refbox, SbVec3f & refcenter)
+{
+  vp->vertex.setNum(start + num + 1);
+  SbVec3f * coords = vp->vertex.startEditing();
+  for (int i = 0; i < start; i++) coords[i].setValue(1e6f, 1e6f, 1e6f);
+  coords[start + num].setValue(-1e6f, -1e6f, -1e6f);
+
+  double sum[3] = { 0.0, 0.0, 0.0 };
+  refbox.makeEmpty();
+  for (int i = 0; i < num; i++) {
+    SbVec3f & c = coords[start + i];
+    c.setValue(float(((i % 1000) * 7919) % 1000) - 500.0f,
+               float((i * 7) % 333) * 0.5f,
+               float(i % 17) - float(i % 5) * 3.0f);
+    refbox.extendBy(c);
+    for (int j = 0; j < 3; j++) sum[j] += c[j];
+  }
+  vp->vertex.finishEditing();
+  refcenter.setValue(float(sum[0] / num), float(sum[1] / num), float(sum[2] / num));
+}
+
+// The contiguous reduction must match a plain loop over the
+// coordinates for every split into SSE blocks and tail, and for
+// arrays large enough to be split over threads.
+BOOST_AUTO_TEST_CASE(computeCoordBBox)
+{
+  const int sizes[] = { 1, 3, 5, 4097, (1 << 21) + 3 };
+  const int start = 2;
+  for (int s = 0; s < int(sizeof(sizes) / sizeof(sizes[0])); s++) {
+    const int num = sizes[s];
+    SoVertexProperty * vp = new SoVertexProperty;
+    vp->ref();
+    SbBox3f refbox;
+    SbVec3f refcenter;
+    nonindexedshape_fill(vp, start, num, refbox, refcenter);
+
+    SoPointSet * ps = new SoPointSet;
+    ps->vertexProperty = vp;
+    ps->startIndex = start;
+    ps->numPoints = num;
+    SoFaceSet * fs = new SoFaceSet;
+    fs->vertexProperty = vp;
+    fs->startIndex = start;
+    fs->numVertices = num;
+
+    SoVertexShape * shapes[] = { ps, fs };
+    for (int i = 0; i < 2; i++) {
+      shapes[i]->ref();
+      SoGetBoundingBoxAction bba(SbViewportRegion(100, 100));
+      bba.apply(shapes[i]);
+      BOOST_CHECK_MESSAGE(bba.getBoundingBox().getMin() == refbox.getMin() &&
+                          bba.getBoundingBox().getMax() == refbox.getMax(),
+                          "wrong box for " << num << " coordinates in a " <<
+                          shapes[i]->getTypeId().getName().getString());
+      BOOST_CHECK_MESSAGE((bba.getCenter() - refcenter).length() < 1e-3f,
+                          "wrong center for " << num << " coordinates in a " <<
+                          shapes[i]->getTypeId().getName().getString());
+      shapes[i]->unref();
+    }
+    vp->unref();
+  }
+}
+
+// NaN coordinates must be skipped, and not reset the box, in both
+// the SSE blocks and the tail.
+BOOST_AUTO_TEST_CASE(computeCoordBBoxNaN)
+{
+  const int num = 4097;
+  SoVertexProperty * vp = new SoVertexProperty;
+  SbBox3f refbox;
+  SbVec3f refcenter;
+  nonindexedshape_fill(vp, 0, num, refbox, refcenter);
+  vp->vertex.setNum(num);
+
+  const float nan = float(std::sqrt(-1.0));
+  const int nanidx[] = { 1, 2, 3, 4, 2050, num - 1 };
+  for (int i = 0; i < int(sizeof(nanidx) / sizeof(nanidx[0])); i++) {
+    vp->vertex.set1Value(nanidx[i], SbVec3f(nan, nan, nan));
+  }
+  refbox.makeEmpty();
+  for (int i = 0; i < num; i++) {
+    const SbVec3f & c = vp->vertex[i];
+    if (c[0] == c[0]) refbox.extendBy(c);
+  }
+
+  SoPointSet * ps = new SoPointSet;
+  ps->ref();
+  ps->vertexProperty = vp;
+  SoGetBoundingBoxAction bba(SbViewportRegion(100, 100));
+  bba.apply(ps);
+  BOOST_CHECK(bba.getBoundingBox().getMin() == refbox.getMin());
+  BOOST_CHECK(bba.getBoundingBox().getMax() == refbox.getMax());
+  ps->unref();
+}
+
+// Vertex shapes get a bounding box cache when they have at least 100
+// vertices. A cached box doesn't see coordinates changed without
+// notification.
+BOOST_AUTO_TEST_CASE(bboxCacheVertexLimit)
+{
+  const int sizes[] = { 99, 100 };
+  for (int s = 0; s < 2; s++) {
+    SoVertexProperty * vp = new SoVertexProperty;
+    SbBox3f refbox;
+    SbVec3f refcenter;
+    nonindexedshape_fill(vp, 0, sizes[s], refbox, refcenter);
+    vp->vertex.setNum(sizes[s]);
+    SoPointSet * ps = new SoPointSet;
+    ps->ref();
+    ps->vertexProperty = vp;
+
+    SoGetBoundingBoxAction bba(SbViewportRegion(100, 100));
+    bba.apply(ps);
+    vp->vertex.enableNotify(FALSE);
+    vp->vertex.set1Value(0, SbVec3f(1000.0f, 0.0f, 0.0f));
+    vp->vertex.enableNotify(TRUE);
+    bba.apply(ps);
+    const SbBool cached = bba.getBoundingBox().getMax()[0] < 1000.0f;
+    BOOST_CHECK_MESSAGE(cached == (sizes[s] >= 100),
+                        sizes[s] << " vertices should " <<
+                        (sizes[s] >= 100 ? "" : "not ") << "be cached");
+    ps->unref();
+  }
+}
+
+#endif // COIN_TEST_SUITE
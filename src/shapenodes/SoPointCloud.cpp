@@ -0,0 +1,1373 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+/*!
+  \class SoPointCloud SoPointCloud.h Inventor/nodes/SoPointCloud.h
+  \brief The SoPointCloud class renders large point clouds from an octree file.
+
+  \ingroup coin_nodes
+
+  Point clouds from laser scanners often hold far more points than
+  can be kept in memory, or rendered at interactive rates. This node
+  reads its points from an octree file on disk, and only loads and
+  renders the octree nodes needed for the current view.
+
+  Each node of the octree holds a subsample of the points inside its
+  cube, with roughly even spacing, while its children hold the rest
+  at increasing density. A node is refined, i.e. its children are
+  rendered as well, when the spacing between its points would be
+  more than SoPointCloud::pointSpacing pixels on the screen. Nodes
+  closest to the camera are thus rendered at full density, while far
+  away nodes are only represented by a few of their points.
+
+  Octree nodes are read from the file by a separate thread, and the
+  node is touched to trigger a redraw when new data is available.
+  Nodes which have not been used for a while are thrown out of memory
+  when the memory used exceeds SoPointCloud::memoryBudget.
+
+  The octree file is created from a text file with SoPointCloud::convert(),
+  or from points in memory. The conversion streams the points through
+  temporary files next to the output file, so the input may be
+  larger than the available memory.
+
+  If the points in the file have colors, these are used instead of
+  the current material. Otherwise the points are rendered with the
+  current diffuse color. Lighting is never applied, as points have
+  no normals. Use SoDrawStyle::pointSize to set the size of the
+  points.
+
+  Ray picking walks the octree nodes along the ray, at the same
+  level of detail as rendering, and loads the nodes it needs. The
+  SoPointDetail of a picked point holds the index of the point in
+  the octree file. As the index is an \c int, points after the first
+  2^31-1 points of the file get index -1.
+
+  Here's a simple usage example:
+
+  \code
+  SoPointCloud::convert("scan.xyz", "scan.pco");
+
+  SoPointCloud * cloud = new SoPointCloud;
+  cloud->filename = "scan.pco";
+  root->addChild(cloud);
+  \endcode
+
+  <b>FILE FORMAT/DEFAULTS:</b>
+  \code
+    PointCloud {
+        filename ""
+        pointSpacing 2
+        memoryBudget 512
+    }
+  \endcode
+
+  \since Coin 4.1
+*/
+
+#include <Inventor/nodes/SoPointCloud.h>
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif // HAVE_CONFIG_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <climits>
+
+#include <Inventor/SoInput.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/SbHeap.h>
+#include <Inventor/SbViewVolume.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/actions/SoGetPrimitiveCountAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/bundles/SoMaterialBundle.h>
+#include <Inventor/details/SoPointDetail.h>
+#include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/elements/SoCullElement.h>
+#include <Inventor/elements/SoGLLazyElement.h>
+#include <Inventor/elements/SoModelMatrixElement.h>
+#include <Inventor/elements/SoViewVolumeElement.h>
+#include <Inventor/elements/SoViewportRegionElement.h>
+#include <Inventor/errors/SoDebugError.h>
+#include <Inventor/lists/SbStringList.h>
+#include <Inventor/misc/SoGLDriverDatabase.h>
+#include <Inventor/misc/SoState.h>
+#include <Inventor/sensors/SoFieldSensor.h>
+#include <Inventor/sensors/SoTimerSensor.h>
+#include <Inventor/system/gl.h>
+#include <Inventor/C/glue/gl.h>
+#include <Inventor/C/tidbits.h>
+#include <Inventor/C/threads/common.h>
+#include <Inventor/C/threads/sched.h>
+#ifdef HAVE_THREADS
+#include <Inventor/threads/SbCondVar.h>
+#include <Inventor/threads/SbMutex.h>
+#endif // HAVE_THREADS
+
+#include "tidbitsp.h"
+#include "threads/threadsutilp.h"
+#include "nodes/SoSubNodeP.h"
+#include "rendering/SoGL.h"
+#include "rendering/SoVBO.h"
+#include "shapenodes/sopointcloud_octree.h"
+
+/*!
+  \var SoSFString SoPointCloud::filename
+
+  Name of the octree file, as written by SoPointCloud::convert().
+  Relative names are searched for in the SoInput directories.
+*/
+
+/*!
+  \var SoSFFloat SoPointCloud::pointSpacing
+
+  The largest spacing between rendered points, in pixels, before an
+  octree node is refined. Lower values give denser point clouds, at
+  the cost of rendering more points. Default value is 2.
+*/
+
+/*!
+  \var SoSFInt32 SoPointCloud::memoryBudget
+
+  The amount of memory, in megabytes, which may be used for points
+  loaded from the octree file. When the points needed for a view
+  don't fit, the view is rendered with fewer octree nodes. Default
+  value is 512.
+*/
+
+// *************************************************************************
+
+enum {
+  SOPOINTCLOUD_UNLOADED,
+  SOPOINTCLOUD_QUEUED,
+  SOPOINTCLOUD_LOADED,
+  SOPOINTCLOUD_FAILED
+};
+
+struct sopointcloud_job;
+
+typedef struct {
+  unsigned char * data;
+  SoVBO * vbo;
+  int state;
+  uint32_t lastused;
+  uint32_t schedid;
+  sopointcloud_job * job;
+  // used while selecting nodes
+  float priority;
+  int heapidx;
+} sopointcloud_nodedata;
+
+struct sopointcloud_job {
+  SoPointCloudP * owner;
+  int node;
+  unsigned char * data;
+};
+
+class SoPointCloudP {
+public:
+  SoPointCloudP(SoPointCloud * master);
+  ~SoPointCloudP();
+
+  void openFile(void);
+  void closeFile(void);
+  void installCompleted(void);
+  void install(const int idx, unsigned char * data);
+  void unload(const int idx);
+  SbBool loadNow(const int idx);
+  void requestLoad(const int idx);
+  void waitForLoads(void);
+  void enforceBudget(void);
+  void selectNodes(SoState * state, SoRayPickAction * pickaction,
+                   SbList <int> & selected);
+  uint64_t getBudget(void) const;
+  uint64_t getNodeSize(const int idx) const;
+
+  static void filename_cb(void * data, SoSensor * sensor);
+  static void timer_cb(void * data, SoSensor * sensor);
+  static void load_cb(void * closure);
+  static void cleanup(void);
+  static void loadAll(SoPointCloud * cloud);
+
+  static cc_sched * scheduler;
+
+  SoPointCloud * master;
+  sopointcloud_octree octree;
+  SbList <sopointcloud_nodedata> nodedata;
+  SoFieldSensor * filenamesensor;
+  SoTimerSensor * timersensor;
+  uint64_t residentbytes;
+  uint32_t frame;
+  int numpending;
+  int numrendered;
+
+  // jobs finished by the loader thread, waiting to be installed
+  SbList <sopointcloud_job *> completed;
+#ifdef HAVE_THREADS
+  SbMutex mutex;
+  SbCondVar jobdone; // signalled when a job is appended to completed
+#endif // HAVE_THREADS
+};
+
+cc_sched * SoPointCloudP::scheduler = NULL;
+
+#ifdef HAVE_THREADS
+#define LOCK_COMPLETED(p) (p)->mutex.lock()
+#define UNLOCK_COMPLETED(p) (p)->mutex.unlock()
+#else // HAVE_THREADS
+#define LOCK_COMPLETED(p)
+#define UNLOCK_COMPLETED(p)
+#endif // !HAVE_THREADS
+
+#define PRIVATE(obj) ((obj)->pimpl)
+
+// SoPointDetail holds an int index, so points which can't be
+// represented get index -1
+extern "C" int
+sopointcloud_coordinate_index(const uint64_t idx)
+{
+  return (idx > static_cast<uint64_t>(INT_MAX)) ? -1 : static_cast<int>(idx);
+}
+
+// *************************************************************************
+
+SO_NODE_SOURCE(SoPointCloud);
+
+/*!
+  Constructor.
+*/
+SoPointCloud::SoPointCloud(void)
+{
+  SO_NODE_INTERNAL_CONSTRUCTOR(SoPointCloud);
+
+  SO_NODE_ADD_FIELD(filename, (""));
+  SO_NODE_ADD_FIELD(pointSpacing, (2.0f));
+  SO_NODE_ADD_FIELD(memoryBudget, (512));
+
+  PRIVATE(this) = new SoPointCloudP(this);
+}
+
+/*!
+  Destructor.
+*/
+SoPointCloud::~SoPointCloud()
+{
+  delete PRIVATE(this);
+}
+
+/*!
+  \copydetails SoNode::initClass(void)
+*/
+void
+SoPointCloud::initClass(void)
+{
+  SO_NODE_INTERNAL_INIT_CLASS(SoPointCloud, SO_FROM_COIN_4_1);
+  coin_atexit(static_cast<coin_atexit_f *>(SoPointCloudP::cleanup), CC_ATEXIT_NORMAL);
+}
+
+/*!
+  Converts the points in the text file \a infile to an octree file
+  which can be used with this node. Each line of the text file holds
+  one point, as three coordinates, optionally followed by a red, a
+  green and a blue color component in the range [0, 255]. The values
+  can be separated by spaces, tabs or commas. Empty lines, and lines
+  starting with \c #, are ignored.
+
+  Returns \c FALSE if the files could not be read or written.
+*/
+SbBool
+SoPointCloud::convert(const char * infile, const char * outfile)
+{
+  FILE * in = fopen(infile, "r");
+  if (in == NULL) {
+    SoDebugError::postWarning("SoPointCloud::convert",
+                              "Could not open '%s'.", infile);
+    return FALSE;
+  }
+
+  sopointcloud_converter converter;
+  SbBool started = FALSE;
+  char line[1024];
+  int linenr = 0;
+  while (fgets(line, sizeof(line), in)) {
+    linenr++;
+    for (char * c = line; *c; c++) { if (*c == ',') *c = ' '; }
+    const char * start = line;
+    while (*start == ' ' || *start == '\t') start++;
+    if (*start == '#' || *start == '\n' || *start == '\r' || *start == '\0') continue;
+
+    float x, y, z;
+    int r, g, b;
+    const int num = sscanf(start, "%f %f %f %d %d %d", &x, &y, &z, &r, &g, &b);
+    if (num < 3) {
+      SoDebugError::postWarning("SoPointCloud::convert",
+                                "Could not parse line %d of '%s'.", linenr, infile);
+      continue;
+    }
+    // the first point decides if the file has colors
+    if (!started) {
+      if (!converter.begin(outfile, num == 6)) break;
+      started = TRUE;
+    }
+    uint32_t rgba = 0xffffffff;
+    if (num == 6) {
+      rgba =
+        (static_cast<uint32_t>(SbClamp(r, 0, 255)) << 24) |
+        (static_cast<uint32_t>(SbClamp(g, 0, 255)) << 16) |
+        (static_cast<uint32_t>(SbClamp(b, 0, 255)) << 8) | 0xff;
+    }
+    converter.addPoint(SbVec3f(x, y, z), rgba);
+  }
+  fclose(in);
+
+  if (!started) {
+    // no points, but still write a valid (empty) file
+    if (!converter.begin(outfile, FALSE)) return FALSE;
+  }
+  return converter.end();
+}
+
+/*!
+  \overload
+
+  Converts \a numpoints points to an octree file. \a colors is either
+  \c NULL, or holds one packed RGBA color (see SbColor::getPackedValue())
+  for each point.
+*/
+SbBool
+SoPointCloud::convert(const int numpoints, const SbVec3f * points,
+                      const uint32_t * colors, const char * outfile)
+{
+  sopointcloud_converter converter;
+  if (!converter.begin(outfile, colors != NULL)) return FALSE;
+  for (int i = 0; i < numpoints; i++) {
+    converter.addPoint(points[i], colors ? colors[i] : 0xffffffff);
+  }
+  return converter.end();
+}
+
+// Documented in superclass.
+SbBool
+SoPointCloud::readInstance(SoInput * in, unsigned short flags)
+{
+  PRIVATE(this)->filenamesensor->detach();
+  SbBool ret = inherited::readInstance(in, flags);
+  // open the file while the SoInput directories are set up, so that
+  // files relative to the Inventor file are found
+  if (ret) PRIVATE(this)->openFile();
+  PRIVATE(this)->filenamesensor->attach(&this->filename);
+  return ret;
+}
+
+// Documented in superclass.
+void
+SoPointCloud::computeBBox(SoAction * COIN_UNUSED_ARG(action), SbBox3f & box, SbVec3f & center)
+{
+  box = PRIVATE(this)->octree.getBoundingBox();
+  if (box.isEmpty()) center.setValue(0.0f, 0.0f, 0.0f);
+  else center = box.getCenter();
+}
+
+// Documented in superclass.
+void
+SoPointCloud::GLRender(SoGLRenderAction * action)
+{
+  if (!PRIVATE(this)->octree.isOpen()) return;
+  if (!this->shouldGLRender(action)) return;
+
+  SoState * state = action->getState();
+  // the rendered points depend on the view and on which nodes have
+  // been loaded, so this node can't be cached
+  SoCacheElement::invalidate(state);
+
+  PRIVATE(this)->installCompleted();
+  PRIVATE(this)->frame++;
+
+  SbList <int> selected;
+  PRIVATE(this)->selectNodes(state, NULL, selected);
+
+  state->push();
+  SoLazyElement::setLightModel(state, SoLazyElement::BASE_COLOR);
+  SoMaterialBundle mb(action);
+  mb.sendFirst();
+
+  const cc_glglue * glue = sogl_glue_instance(state);
+  const uint32_t contextid = action->getCacheContext();
+  const SbBool colors = PRIVATE(this)->octree.hasColors();
+  const int stride = PRIVATE(this)->octree.getPointSize();
+  const SbBool dova = SoGLDriverDatabase::isSupported(glue, SO_GL_VERTEX_ARRAY);
+  const SbBool dovbo = dova &&
+    SoGLDriverDatabase::isSupported(glue, SO_GL_VERTEX_BUFFER_OBJECT) &&
+    !SoCacheElement::anyOpen(state);
+
+  if (dova) {
+    cc_glglue_glEnableClientState(glue, GL_VERTEX_ARRAY);
+    if (colors) cc_glglue_glEnableClientState(glue, GL_COLOR_ARRAY);
+  }
+
+  PRIVATE(this)->numrendered = 0;
+  for (int i = 0; i < selected.getLength(); i++) {
+    const int idx = selected[i];
+    sopointcloud_nodedata & nd = PRIVATE(this)->nodedata[idx];
+    if (nd.state != SOPOINTCLOUD_LOADED) {
+      PRIVATE(this)->requestLoad(idx);
+      continue;
+    }
+    nd.lastused = PRIVATE(this)->frame;
+    const int numpoints = PRIVATE(this)->octree.getNode(idx).numpoints;
+    PRIVATE(this)->numrendered += numpoints;
+
+    if (dova) {
+      const unsigned char * ptr = nd.data;
+      if (dovbo) {
+        if (nd.vbo == NULL) {
+          nd.vbo = new SoVBO(GL_ARRAY_BUFFER, GL_STATIC_DRAW);
+          nd.vbo->setBufferData(nd.data, PRIVATE(this)->getNodeSize(idx),
+                                SoNode::getNextNodeId());
+        }
+        nd.vbo->bindBuffer(contextid);
+        ptr = NULL;
+      }
+      cc_glglue_glVertexPointer(glue, 3, GL_FLOAT, stride, ptr);
+      if (colors) {
+        cc_glglue_glColorPointer(glue, 4, GL_UNSIGNED_BYTE, stride,
+                                 ptr + 3 * sizeof(float));
+      }
+      cc_glglue_glDrawArrays(glue, GL_POINTS, 0, numpoints);
+    }
+    else {
+      glBegin(GL_POINTS);
+      for (int j = 0; j < numpoints; j++) {
+        const unsigned char * record = nd.data + j * stride;
+        if (colors) glColor4ubv(record + 3 * sizeof(float));
+        glVertex3fv(reinterpret_cast<const GLfloat *>(record));
+      }
+      glEnd();
+    }
+  }
+
+  if (dovbo) cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, 0);
+  if (dova) {
+    if (colors) cc_glglue_glDisableClientState(glue, GL_COLOR_ARRAY);
+    cc_glglue_glDisableClientState(glue, GL_VERTEX_ARRAY);
+  }
+  if (colors) {
+    SoGLLazyElement::getInstance(state)->reset(state, SoLazyElement::DIFFUSE_MASK);
+  }
+  state->pop();
+
+  PRIVATE(this)->enforceBudget();
+}
+
+/*!
+  Picks the points of the octree nodes along the pick ray. Only the
+  nodes which would have been rendered in the view of the pick action
+  are tested, and nodes which are not in memory are loaded first.
+*/
+void
+SoPointCloud::rayPick(SoRayPickAction * action)
+{
+  if (!PRIVATE(this)->octree.isOpen()) return;
+  if (!this->shouldRayPick(action)) return;
+
+  action->setObjectSpace();
+  PRIVATE(this)->installCompleted();
+  // a pick uses nodes like a frame does, so that the memory budget
+  // also holds when the node is only picked
+  PRIVATE(this)->frame++;
+
+  SbList <int> selected;
+  PRIVATE(this)->selectNodes(action->getState(), action, selected);
+
+  const int stride = PRIVATE(this)->octree.getPointSize();
+  for (int i = 0; i < selected.getLength(); i++) {
+    const int idx = selected[i];
+    if (!PRIVATE(this)->loadNow(idx)) continue;
+    sopointcloud_nodedata & nd = PRIVATE(this)->nodedata[idx];
+    nd.lastused = PRIVATE(this)->frame;
+    const sopointcloud_noderecord & node = PRIVATE(this)->octree.getNode(idx);
+    for (uint32_t j = 0; j < node.numpoints; j++) {
+      const SbVec3f point(reinterpret_cast<const float *>(nd.data + j * stride));
+      if (action->intersect(point) && action->isBetweenPlanes(point)) {
+        SoPickedPoint * pp = action->addIntersection(point);
+        if (pp) {
+          SoPointDetail * detail = new SoPointDetail;
+          detail->setCoordinateIndex(sopointcloud_coordinate_index(node.firstpoint + j));
+          pp->setDetail(detail, this);
+        }
+      }
+    }
+  }
+  PRIVATE(this)->enforceBudget();
+}
+
+// Documented in superclass.
+void
+SoPointCloud::getPrimitiveCount(SoGetPrimitiveCountAction * action)
+{
+  if (!this->shouldPrimitiveCount(action)) return;
+  action->addNumPoints(PRIVATE(this)->numrendered);
+}
+
+// Documented in superclass. Generates the points of the octree nodes
+// which are currently in memory.
+void
+SoPointCloud::generatePrimitives(SoAction * action)
+{
+  const int stride = PRIVATE(this)->octree.getPointSize();
+  const SbBool colors = PRIVATE(this)->octree.hasColors();
+  SoPrimitiveVertex vertex;
+  SoPointDetail detail;
+  vertex.setDetail(&detail);
+
+  PRIVATE(this)->installCompleted();
+  for (int i = 0; i < PRIVATE(this)->nodedata.getLength(); i++) {
+    const sopointcloud_nodedata & nd = PRIVATE(this)->nodedata[i];
+    if (nd.state != SOPOINTCLOUD_LOADED) continue;
+    const sopointcloud_noderecord & node = PRIVATE(this)->octree.getNode(i);
+    for (uint32_t j = 0; j < node.numpoints; j++) {
+      const unsigned char * record = nd.data + j * stride;
+      vertex.setPoint(SbVec3f(reinterpret_cast<const float *>(record)));
+      if (colors) {
+        vertex.setPackedColor((static_cast<uint32_t>(record[12]) << 24) |
+                              (static_cast<uint32_t>(record[13]) << 16) |
+                              (static_cast<uint32_t>(record[14]) << 8) |
+                              static_cast<uint32_t>(record[15]));
+      }
+      detail.setCoordinateIndex(sopointcloud_coordinate_index(node.firstpoint + j));
+      this->invokePointCallbacks(action, &vertex);
+    }
+  }
+}
+
+// *************************************************************************
+
+SoPointCloudP::SoPointCloudP(SoPointCloud * masterptr)
+{
+  this->master = masterptr;
+  this->residentbytes = 0;
+  this->frame = 0;
+  this->numpending = 0;
+  this->numrendered = 0;
+  this->filenamesensor = new SoFieldSensor(SoPointCloudP::filename_cb, this);
+  this->filenamesensor->setPriority(0);
+  this->filenamesensor->attach(&masterptr->filename);
+  this->timersensor = new SoTimerSensor(SoPointCloudP::timer_cb, this);
+  this->timersensor->setInterval(SbTime(0.05));
+}
+
+SoPointCloudP::~SoPointCloudP()
+{
+  this->closeFile();
+  delete this->timersensor;
+  delete this->filenamesensor;
+}
+
+void
+SoPointCloudP::cleanup(void)
+{
+  if (SoPointCloudP::scheduler) {
+    cc_sched_destruct(SoPointCloudP::scheduler);
+    SoPointCloudP::scheduler = NULL;
+  }
+}
+
+void
+SoPointCloudP::filename_cb(void * data, SoSensor * COIN_UNUSED_ARG(sensor))
+{
+  static_cast<SoPointCloudP *>(data)->openFile();
+}
+
+void
+SoPointCloudP::openFile(void)
+{
+  this->closeFile();
+  const SbString & name = this->master->filename.getValue();
+  if (name.getLength() == 0) return;
+
+  SbString fullname = SoInput::searchForFile(name, SoInput::getDirectories(),
+                                             SbStringList());
+  if (fullname.getLength() == 0) fullname = name;
+  if (!this->octree.open(fullname.getString())) return;
+
+  sopointcloud_nodedata nd;
+  memset(&nd, 0, sizeof(nd));
+  nd.state = SOPOINTCLOUD_UNLOADED;
+  for (int i = 0; i < this->octree.getNumNodes(); i++) this->nodedata.append(nd);
+
+#ifdef HAVE_THREADS
+  CC_GLOBAL_LOCK;
+  if (SoPointCloudP::scheduler == NULL &&
+      cc_thread_implementation() != CC_NO_THREADS) {
+    SoPointCloudP::scheduler = cc_sched_construct(1);
+  }
+  CC_GLOBAL_UNLOCK;
+#endif // HAVE_THREADS
+}
+
+void
+SoPointCloudP::closeFile(void)
+{
+  // get rid of all loads for this node before the file is closed
+  if (this->numpending > 0 && SoPointCloudP::scheduler) {
+    for (int i = 0; i < this->nodedata.getLength(); i++) {
+      sopointcloud_nodedata & nd = this->nodedata[i];
+      if (nd.state == SOPOINTCLOUD_QUEUED &&
+          cc_sched_unschedule(SoPointCloudP::scheduler, nd.schedid)) {
+        delete nd.job;
+        nd.job = NULL;
+        nd.state = SOPOINTCLOUD_UNLOADED;
+        this->numpending--;
+      }
+    }
+    this->waitForLoads();
+  }
+  this->installCompleted();
+  for (int i = 0; i < this->nodedata.getLength(); i++) this->unload(i);
+  this->nodedata.truncate(0);
+  this->octree.close();
+  this->timersensor->unschedule();
+  this->numrendered = 0;
+}
+
+// Waits until all jobs of this node have been finished by the loader
+// thread. They are installed by the next installCompleted().
+void
+SoPointCloudP::waitForLoads(void)
+{
+#ifdef HAVE_THREADS
+  // the scheduler is shared by all point clouds, so wait for the
+  // jobs of this node only
+  this->mutex.lock();
+  while (this->completed.getLength() < this->numpending) {
+    this->jobdone.wait(this->mutex);
+  }
+  this->mutex.unlock();
+#endif // HAVE_THREADS
+}
+
+uint64_t
+SoPointCloudP::getBudget(void) const
+{
+  return static_cast<uint64_t>(SbMax(this->master->memoryBudget.getValue(), 1)) << 20;
+}
+
+uint64_t
+SoPointCloudP::getNodeSize(const int idx) const
+{
+  return static_cast<uint64_t>(this->octree.getNode(idx).numpoints) *
+    this->octree.getPointSize();
+}
+
+void
+SoPointCloudP::install(const int idx, unsigned char * data)
+{
+  sopointcloud_nodedata & nd = this->nodedata[idx];
+  if (nd.state == SOPOINTCLOUD_LOADED) {
+    // loaded by a pick while the job was running
+    delete[] data;
+    return;
+  }
+  if (data == NULL) {
+    nd.state = SOPOINTCLOUD_FAILED;
+    return;
+  }
+  nd.data = data;
+  nd.state = SOPOINTCLOUD_LOADED;
+  nd.lastused = this->frame;
+  this->residentbytes += this->getNodeSize(idx);
+}
+
+void
+SoPointCloudP::unload(const int idx)
+{
+  sopointcloud_nodedata & nd = this->nodedata[idx];
+  if (nd.state != SOPOINTCLOUD_LOADED) return;
+  delete nd.vbo;
+  delete[] nd.data;
+  nd.vbo = NULL;
+  nd.data = NULL;
+  nd.state = SOPOINTCLOUD_UNLOADED;
+  this->residentbytes -= this->getNodeSize(idx);
+}
+
+// Called from the loader thread.
+void
+SoPointCloudP::load_cb(void * closure)
+{
+  sopointcloud_job * job = static_cast<sopointcloud_job *>(closure);
+  SoPointCloudP * thisp = job->owner;
+  job->data = new unsigned char[thisp->getNodeSize(job->node)];
+  if (!thisp->octree.readPoints(job->node, job->data)) {
+    delete[] job->data;
+    job->data = NULL;
+  }
+  LOCK_COMPLETED(thisp);
+  thisp->completed.append(job);
+#ifdef HAVE_THREADS
+  thisp->jobdone.wakeAll();
+#endif // HAVE_THREADS
+  UNLOCK_COMPLETED(thisp);
+}
+
+void
+SoPointCloudP::installCompleted(void)
+{
+  LOCK_COMPLETED(this);
+  SbList <sopointcloud_job *> jobs(this->completed);
+  this->completed.truncate(0);
+  UNLOCK_COMPLETED(this);
+
+  for (int i = 0; i < jobs.getLength(); i++) {
+    sopointcloud_job * job = jobs[i];
+    sopointcloud_nodedata & nd = this->nodedata[job->node];
+    nd.job = NULL;
+    if (nd.state == SOPOINTCLOUD_QUEUED) nd.state = SOPOINTCLOUD_UNLOADED;
+    this->install(job->node, job->data);
+    this->numpending--;
+    delete job;
+  }
+}
+
+void
+SoPointCloudP::timer_cb(void * data, SoSensor * COIN_UNUSED_ARG(sensor))
+{
+  SoPointCloudP * thisp = static_cast<SoPointCloudP *>(data);
+  LOCK_COMPLETED(thisp);
+  const SbBool done = thisp->completed.getLength() > 0;
+  UNLOCK_COMPLETED(thisp);
+  if (done) thisp->master->touch(); // trigger redraw
+  else if (thisp->numpending == 0) thisp->timersensor->unschedule();
+}
+
+SbBool
+SoPointCloudP::loadNow(const int idx)
+{
+  sopointcloud_nodedata & nd = this->nodedata[idx];
+  if (nd.state == SOPOINTCLOUD_LOADED) return TRUE;
+  if (nd.state == SOPOINTCLOUD_FAILED) return FALSE;
+  // a queued job is left alone, and its data thrown away when it
+  // finishes
+  unsigned char * data = new unsigned char[this->getNodeSize(idx)];
+  if (!this->octree.readPoints(idx, data)) {
+    delete[] data;
+    data = NULL;
+  }
+  const int oldstate = nd.state;
+  nd.state = SOPOINTCLOUD_UNLOADED;
+  this->install(idx, data);
+  if (oldstate == SOPOINTCLOUD_QUEUED && nd.state != SOPOINTCLOUD_LOADED) {
+    nd.state = SOPOINTCLOUD_QUEUED;
+  }
+  return nd.state == SOPOINTCLOUD_LOADED;
+}
+
+void
+SoPointCloudP::requestLoad(const int idx)
+{
+  sopointcloud_nodedata & nd = this->nodedata[idx];
+  if (nd.state == SOPOINTCLOUD_QUEUED) {
+    cc_sched_change_priority(SoPointCloudP::scheduler, nd.schedid, nd.priority);
+    return;
+  }
+  if (nd.state != SOPOINTCLOUD_UNLOADED) return;
+
+  if (SoPointCloudP::scheduler == NULL) {
+    (void) this->loadNow(idx);
+    return;
+  }
+  sopointcloud_job * job = new sopointcloud_job;
+  job->owner = this;
+  job->node = idx;
+  job->data = NULL;
+  nd.job = job;
+  nd.state = SOPOINTCLOUD_QUEUED;
+  nd.schedid = cc_sched_schedule(SoPointCloudP::scheduler,
+                                 SoPointCloudP::load_cb, job, nd.priority);
+  this->numpending++;
+  if (!this->timersensor->isScheduled()) this->timersensor->schedule();
+}
+
+typedef struct {
+  uint32_t lastused;
+  int idx;
+} sopointcloud_lru;
+
+extern "C" {
+static int
+sopointcloud_compare_lru(const void * v0, const void * v1)
+{
+  const sopointcloud_lru * l0 = static_cast<const sopointcloud_lru *>(v0);
+  const sopointcloud_lru * l1 = static_cast<const sopointcloud_lru *>(v1);
+  if (l0->lastused < l1->lastused) return -1;
+  if (l0->lastused > l1->lastused) return 1;
+  return 0;
+}
+}
+
+// Throws out the least recently used nodes until the loaded points
+// fit in the memory budget. Nodes used in the last frame are kept.
+void
+SoPointCloudP::enforceBudget(void)
+{
+  const uint64_t budget = this->getBudget();
+  if (this->residentbytes <= budget) return;
+
+  SbList <sopointcloud_lru> lru;
+  for (int i = 0; i < this->nodedata.getLength(); i++) {
+    const sopointcloud_nodedata & nd = this->nodedata[i];
+    if (nd.state != SOPOINTCLOUD_LOADED || nd.lastused == this->frame) continue;
+    sopointcloud_lru item;
+    item.lastused = nd.lastused;
+    item.idx = i;
+    lru.append(item);
+  }
+  if (lru.getLength() == 0) return;
+  qsort(&lru[0], lru.getLength(), sizeof(sopointcloud_lru),
+        sopointcloud_compare_lru);
+  for (int i = 0; i < lru.getLength() && this->residentbytes > budget; i++) {
+    this->unload(lru[i].idx);
+  }
+}
+
+// callbacks for SbHeap, which extracts the node with the largest
+// projected point spacing first
+static float
+sopointcloud_heap_eval(void * obj)
+{
+  return -static_cast<sopointcloud_nodedata *>(obj)->priority;
+}
+
+static int
+sopointcloud_heap_get_index(void * obj)
+{
+  return static_cast<sopointcloud_nodedata *>(obj)->heapidx;
+}
+
+static void
+sopointcloud_heap_set_index(void * obj, int idx)
+{
+  static_cast<sopointcloud_nodedata *>(obj)->heapidx = idx;
+}
+
+// Finds the octree nodes needed for the current view. The nodes are
+// visited in order of decreasing point spacing on the screen, and
+// refined until the spacing is below pointSpacing, or the memory
+// budget is used up.
+void
+SoPointCloudP::selectNodes(SoState * state, SoRayPickAction * pickaction,
+                           SbList <int> & selected)
+{
+  const int numnodes = this->nodedata.getLength();
+  if (numnodes == 0) return;
+
+  const SbViewVolume & vv = SoViewVolumeElement::get(state);
+  const SbViewportRegion & vp = SoViewportRegionElement::get(state);
+  const SbMatrix & mm = SoModelMatrixElement::get(state);
+  const SbBool ortho = vv.getProjectionType() == SbViewVolume::ORTHOGRAPHIC;
+  const SbVec3f eye = vv.getProjectionPoint();
+  const float neardist = SbMax(vv.getNearDist(), FLT_EPSILON);
+  const float vvheight = SbMax(vv.getHeight(), FLT_EPSILON);
+  const float vpheight = static_cast<float>(vp.getViewportSizePixels()[1]);
+  // points per pixel are only estimated, so the average scale factor
+  // is good enough
+  const float scale = static_cast<float>(pow(fabs(mm.det3()), 1.0 / 3.0));
+  const float threshold = this->master->pointSpacing.getValue();
+  const uint64_t budget = this->getBudget();
+
+  SbHeapFuncs funcs;
+  funcs.eval_func = sopointcloud_heap_eval;
+  funcs.get_index_func = sopointcloud_heap_get_index;
+  funcs.set_index_func = sopointcloud_heap_set_index;
+  SbHeap heap(funcs, 256);
+
+  sopointcloud_nodedata * nodes = &this->nodedata[0];
+  int idx = 0;
+  uint64_t bytes = 0;
+  for (;;) {
+    const sopointcloud_noderecord & node = this->octree.getNode(idx);
+    const SbBox3f & box = this->octree.getNodeBox(idx);
+
+    // projected point spacing at the point of the node's bounding
+    // sphere closest to the camera
+    SbVec3f center;
+    mm.multVecMatrix(box.getCenter(), center);
+    const float radius = (box.getMax() - box.getMin()).length() * 0.5f * scale;
+    float pixelsperunit = vpheight / vvheight;
+    if (!ortho) {
+      const float dist = SbMax((center - eye).length() - radius, neardist);
+      pixelsperunit *= neardist / dist;
+    }
+    nodes[idx].priority = node.spacing * scale * pixelsperunit;
+
+    const SbBool culled = pickaction ?
+      !pickaction->intersect(box, TRUE) : SoCullElement::cullTest(state, box, TRUE);
+    if (!culled) {
+      bytes += this->getNodeSize(idx);
+      if (bytes > budget && selected.getLength() > 0) break;
+      selected.append(idx);
+      if (node.firstchild >= 0 && nodes[idx].priority > threshold) {
+        int child = node.firstchild;
+        for (int octant = 0; octant < 8; octant++) {
+          if (!(node.childmask & (1 << octant))) continue;
+          // the children inherit the priority until they are visited
+          nodes[child].priority = nodes[idx].priority * 0.5f;
+          heap.add(&nodes[child++]);
+        }
+      }
+    }
+    if (heap.size() == 0) break;
+    idx = static_cast<int>(static_cast<sopointcloud_nodedata *>(heap.extractMin()) - nodes);
+  }
+}
+
+// Loads all octree nodes through the loader thread, and waits for the
+// loads to finish. The nodes are installed by the next traversal. Only
+// used by the test suite, as the loader thread is otherwise only
+// reachable from GLRender().
+void
+SoPointCloudP::loadAll(SoPointCloud * cloud)
+{
+  SoPointCloudP * thisp = PRIVATE(cloud);
+  for (int i = 0; i < thisp->nodedata.getLength(); i++) thisp->requestLoad(i);
+  thisp->waitForLoads();
+}
+
+extern "C" void
+sopointcloud_load_all(SoPointCloud * cloud)
+{
+  SoPointCloudP::loadAll(cloud);
+}
+
+#undef LOCK_COMPLETED
+#undef UNLOCK_COMPLETED
+#undef PRIVATE
+
+#ifdef COIN_TEST_SUITE
+
+#include <cstdio>
+#include <cstring>
+#include <Inventor/SbTime.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoPickedPoint.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/actions/SoRayPickAction.h>
+#include <Inventor/details/SoPointDetail.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+
+// sopointcloud_coordinate_index() and sopointcloud_load_all() are
+// internal, so they are declared here.
+extern "C" {
+int sopointcloud_coordinate_index(const uint64_t idx);
+void sopointcloud_load_all(SoPointCloud * cloud);
+}
+
+namespace {
+// removes the octree file when the test case ends, also on failure
+struct sopointcloud_tmpfile {
+  sopointcloud_tmpfile(void) {
+    const char * dir = coin_getenv("TMPDIR");
+    if (dir == NULL) dir = coin_getenv("TEMP");
+    if (dir == NULL) dir = "/tmp";
+    // unique, as test runs may happen in parallel
+    static int counter = 0;
+    this->name.sprintf("%s/sopointcloud_test_%p_%.0f_%d.pco", dir,
+                       static_cast<void *>(this),
+                       SbTime::getTimeOfDay().getValue() * 1e6, counter++);
+  }
+  ~sopointcloud_tmpfile() { (void) remove(this->name.getString()); }
+  SbString name;
+};
+
+// the file layout of sopointcloud_header and sopointcloud_noderecord
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteorder;
+  uint32_t flags;
+  uint32_t numnodes;
+  uint64_t numpoints;
+  uint64_t nodetableoffset;
+  float bboxmin[3];
+  float bboxmax[3];
+  float cubemin[3];
+  float cubesize;
+} sopointcloud_test_header;
+
+typedef struct {
+  uint64_t offset;
+  uint64_t firstpoint;
+  uint32_t numpoints;
+  int32_t firstchild;
+  uint32_t childmask;
+  float spacing;
+} sopointcloud_test_node;
+
+typedef struct {
+  int numpoints;
+  SbList <int> * indices;
+} sopointcloud_test_count;
+}
+
+// a slab of nx * ny * nz points, with a spacing of 1 in x and y, and
+// 0.1 in z
+static SbBool
+sopointcloud_test_slab(const char * filename, const int nx, const int ny,
+                       const int nz)
+{
+  SbList <SbVec3f> points;
+  for (int i = 0; i < nx; i++) {
+    for (int j = 0; j < ny; j++) {
+      for (int k = 0; k < nz; k++) {
+        points.append(SbVec3f(float(i), float(j), float(k) * 0.1f));
+      }
+    }
+  }
+  return SoPointCloud::convert(points.getLength(), points.getArrayPtr(),
+                               NULL, filename);
+}
+
+static void
+sopointcloud_test_point_cb(void * closure, SoCallbackAction *,
+                           const SoPrimitiveVertex * v)
+{
+  sopointcloud_test_count * count = static_cast<sopointcloud_test_count *>(closure);
+  count->numpoints++;
+  if (count->indices) {
+    const SoPointDetail * detail = static_cast<const SoPointDetail *>(v->getDetail());
+    count->indices->append(detail->getCoordinateIndex());
+  }
+}
+
+// the number of points of the octree nodes in memory
+static int
+sopointcloud_test_loaded(SoNode * root, SbList <int> * indices = NULL)
+{
+  sopointcloud_test_count count;
+  count.numpoints = 0;
+  count.indices = indices;
+  SoCallbackAction cba;
+  cba.addPointCallback(SoPointCloud::getClassTypeId(),
+                       sopointcloud_test_point_cb, &count);
+  cba.apply(root);
+  return count.numpoints;
+}
+
+// picks a point off the center of a 400x400 viewport, with the camera zoomed in
+// by zoom from the view of the whole cloud, and returns the number of
+// points loaded by the pick
+static int
+sopointcloud_test_pick(const char * filename, const float spacing,
+                       const float zoom)
+{
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  root->addChild(camera);
+  SoPointCloud * cloud = new SoPointCloud;
+  cloud->filename = filename;
+  cloud->pointSpacing = spacing;
+  root->addChild(cloud);
+
+  SbViewportRegion vp(400, 400);
+  camera->viewAll(root, vp);
+  camera->height = camera->height.getValue() / zoom;
+  SoRayPickAction rpa(vp);
+  rpa.setPoint(SbVec2s(120, 140));
+  rpa.setRadius(4.0f);
+  rpa.apply(root);
+  const int loaded = sopointcloud_test_loaded(root);
+  root->unref();
+  return loaded;
+}
+
+BOOST_AUTO_TEST_CASE(convertAndPick)
+{
+  sopointcloud_tmpfile tmpfile;
+  const char * filename = tmpfile.name.getString();
+  const int n = 100;
+  BOOST_REQUIRE(sopointcloud_test_slab(filename, n, n, 10));
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  root->addChild(camera);
+  SoPointCloud * cloud = new SoPointCloud;
+  cloud->filename = filename;
+  root->addChild(cloud);
+
+  SbViewportRegion vp(400, 400);
+  SoGetBoundingBoxAction bba(vp);
+  bba.apply(root);
+  const SbBox3f & box = bba.getBoundingBox();
+  BOOST_CHECK(box.getMin() == SbVec3f(0.0f, 0.0f, 0.0f));
+  BOOST_CHECK(box.getMax() == SbVec3f(99.0f, 99.0f, 9.0f * 0.1f));
+
+  camera->viewAll(root, vp);
+  SoRayPickAction rpa(vp);
+  rpa.setPoint(SbVec2s(200, 200));
+  rpa.setRadius(4.0f);
+  rpa.apply(root);
+  SoPickedPoint * pp = rpa.getPickedPoint();
+  BOOST_REQUIRE(pp != NULL);
+  const SoPointDetail * detail =
+    static_cast<const SoPointDetail *>(pp->getDetail(cloud));
+  BOOST_REQUIRE(detail != NULL);
+  // the closest point is on top of the slab, near the center
+  BOOST_CHECK_CLOSE(pp->getPoint()[2], 0.9f, 0.01f);
+  BOOST_CHECK(detail->getCoordinateIndex() >= 0 &&
+              detail->getCoordinateIndex() < n * n * 10);
+
+  root->unref();
+}
+
+// Nodes are refined while their point spacing on the screen is larger
+// than pointSpacing, so a lower pointSpacing, or zooming in, loads
+// more of the octree.
+BOOST_AUTO_TEST_CASE(screenDensitySelection)
+{
+  sopointcloud_tmpfile tmpfile;
+  const char * filename = tmpfile.name.getString();
+  BOOST_REQUIRE(sopointcloud_test_slab(filename, 100, 100, 10));
+
+  const int coarse = sopointcloud_test_pick(filename, 1000.0f, 1.0f);
+  const int fine = sopointcloud_test_pick(filename, 0.01f, 1.0f);
+  BOOST_CHECK(coarse > 0);
+  BOOST_CHECK(fine > coarse);
+  BOOST_CHECK(fine < 100 * 100 * 10);
+
+  // the root spacing is about 2 pixels in the full view
+  const int far = sopointcloud_test_pick(filename, 10.0f, 1.0f);
+  const int near = sopointcloud_test_pick(filename, 10.0f, 100.0f);
+  BOOST_CHECK_EQUAL(far, coarse);
+  BOOST_CHECK(near > far);
+}
+
+// Picking all over the cloud loads most of it, unless the least
+// recently used nodes are thrown out to stay within memoryBudget.
+BOOST_AUTO_TEST_CASE(memoryBudgetEviction)
+{
+  sopointcloud_tmpfile tmpfile;
+  const char * filename = tmpfile.name.getString();
+  // 4.3 MB of points
+  BOOST_REQUIRE(sopointcloud_test_slab(filename, 300, 300, 4));
+
+  const int budgets[] = { 1, 512 };
+  int loaded[2];
+  for (int b = 0; b < 2; b++) {
+    SoSeparator * root = new SoSeparator;
+    root->ref();
+    SoOrthographicCamera * camera = new SoOrthographicCamera;
+    root->addChild(camera);
+    SoPointCloud * cloud = new SoPointCloud;
+    cloud->filename = filename;
+    cloud->pointSpacing = 0.01f;
+    cloud->memoryBudget = budgets[b];
+    root->addChild(cloud);
+
+    SbViewportRegion vp(400, 400);
+    camera->viewAll(root, vp);
+    SoRayPickAction rpa(vp);
+    rpa.setRadius(4.0f);
+    for (int x = 0; x < 8; x++) {
+      for (int y = 0; y < 8; y++) {
+        rpa.setPoint(SbVec2s(short(25 + x * 50), short(25 + y * 50)));
+        rpa.apply(root);
+      }
+    }
+    loaded[b] = sopointcloud_test_loaded(root);
+    root->unref();
+  }
+  const int pointsize = 3 * sizeof(float);
+  BOOST_CHECK(loaded[0] * pointsize <= (1 << 20));
+  BOOST_CHECK(loaded[1] * pointsize > (1 << 20));
+}
+
+// Nodes loaded by the loader thread are installed by the next
+// traversal, and hold every point of the file exactly once.
+BOOST_AUTO_TEST_CASE(asyncLoad)
+{
+  sopointcloud_tmpfile tmpfile;
+  const char * filename = tmpfile.name.getString();
+  const int num = 100 * 100 * 10;
+  BOOST_REQUIRE(sopointcloud_test_slab(filename, 100, 100, 10));
+
+  SoPointCloud * cloud = new SoPointCloud;
+  cloud->ref();
+  cloud->filename = filename;
+  sopointcloud_load_all(cloud);
+
+  SbList <int> indices;
+  BOOST_CHECK_EQUAL(sopointcloud_test_loaded(cloud, &indices), num);
+  SbList <unsigned char> seen(num);
+  for (int i = 0; i < num; i++) seen.append(0);
+  int numseen = 0;
+  for (int i = 0; i < indices.getLength(); i++) {
+    const int idx = indices[i];
+    if (idx >= 0 && idx < num && !seen[idx]) { seen[idx] = 1; numseen++; }
+  }
+  BOOST_CHECK_EQUAL(numseen, num);
+
+  // loading nodes which are already in memory does nothing
+  sopointcloud_load_all(cloud);
+  BOOST_CHECK_EQUAL(sopointcloud_test_loaded(cloud), num);
+  cloud->unref();
+}
+
+BOOST_AUTO_TEST_CASE(coordinateIndexLimit)
+{
+  BOOST_CHECK_EQUAL(sopointcloud_coordinate_index(0), 0);
+  BOOST_CHECK_EQUAL(sopointcloud_coordinate_index(uint64_t(INT_MAX)), INT_MAX);
+  BOOST_CHECK_EQUAL(sopointcloud_coordinate_index(uint64_t(INT_MAX) + 1), -1);
+  BOOST_CHECK_EQUAL(sopointcloud_coordinate_index(~uint64_t(0)), -1);
+}
+
+// writes a file with four nodes of one point each, where node 0 has
+// the children 1 and 2, and node 1 has the child 3
+static SbBool
+sopointcloud_test_write(const char * filename, sopointcloud_test_header & header,
+                        sopointcloud_test_node * nodes)
+{
+  FILE * fp = fopen(filename, "wb");
+  if (fp == NULL) return FALSE;
+  SbBool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+  for (int i = 0; i < 4; i++) {
+    const float point[3] = { float(i), float(i), float(i) };
+    ok = ok && fwrite(point, sizeof(point), 1, fp) == 1;
+  }
+  ok = ok && fwrite(nodes, sizeof(sopointcloud_test_node), 4, fp) == 4;
+  return (fclose(fp) == 0) && ok;
+}
+
+static void
+sopointcloud_test_valid(sopointcloud_test_header & header,
+                        sopointcloud_test_node * nodes)
+{
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "COINPCOT", 8);
+  header.version = 1;
+  header.byteorder = 0x01020304;
+  header.numnodes = 4;
+  header.numpoints = 4;
+  header.nodetableoffset = sizeof(header) + 4 * 3 * sizeof(float);
+  for (int i = 0; i < 3; i++) {
+    header.bboxmax[i] = 3.0f;
+    header.cubesize = 4.0f;
+  }
+  memset(nodes, 0, 4 * sizeof(sopointcloud_test_node));
+  for (int i = 0; i < 4; i++) {
+    nodes[i].offset = sizeof(header) + i * 3 * sizeof(float);
+    nodes[i].firstpoint = i;
+    nodes[i].numpoints = 1;
+    nodes[i].firstchild = -1;
+  }
+  nodes[0].firstchild = 1;
+  nodes[0].childmask = 0x3;
+  nodes[1].firstchild = 3;
+  nodes[1].childmask = 0x1;
+}
+
+// returns TRUE if the file was opened, i.e. the cloud has a bounding box
+static SbBool
+sopointcloud_test_opens(const char * filename)
+{
+  SoPointCloud * cloud = new SoPointCloud;
+  cloud->ref();
+  cloud->filename = filename;
+  SoGetBoundingBoxAction bba(SbViewportRegion(100, 100));
+  bba.apply(cloud);
+  cloud->unref();
+  return !bba.getBoundingBox().isEmpty();
+}
+
+// Files with node tables which would make the node allocate too much
+// memory, or corrupt the node selection, are rejected.
+BOOST_AUTO_TEST_CASE(corruptNodeTable)
+{
+  sopointcloud_tmpfile tmpfile;
+  const char * filename = tmpfile.name.getString();
+  sopointcloud_test_header header;
+  sopointcloud_test_node nodes[4];
+
+  sopointcloud_test_valid(header, nodes);
+  BOOST_REQUIRE(sopointcloud_test_write(filename, header, nodes));
+  BOOST_CHECK(sopointcloud_test_opens(filename));
+
+  sopointcloud_test_valid(header, nodes);
+  header.numnodes = 0x80000000;
+  BOOST_REQUIRE(sopointcloud_test_write(filename, header, nodes));
+  BOOST_CHECK(!sopointcloud_test_opens(filename));
+
+  sopointcloud_test_valid(header, nodes);
+  header.numnodes = 5;
+  BOOST_REQUIRE(sopointcloud_test_write(filename, header, nodes));
+  BOOST_CHECK(!sopointcloud_test_opens(filename));
+
+  sopointcloud_test_valid(header, nodes);
+  nodes[2].numpoints = 0xffffffff;
+  BOOST_REQUIRE(sopointcloud_test_write(filename, header, nodes));
+  BOOST_CHECK(!sopointcloud_test_opens(filename));
+
+  sopointcloud_test_valid(header, nodes);
+  nodes[3].numpoints = 2;
+  BOOST_REQUIRE(sopointcloud_test_write(filename, header, nodes));
+  BOOST_CHECK(!sopointcloud_test_opens(filename));
+
+  sopointcloud_test_valid(header, nodes);
+  nodes[1].offset = 0;
+  BOOST_REQUIRE(sopointcloud_test_write(filename, header, nodes));
+  BOOST_CHECK(!sopointcloud_test_opens(filename));
+
+  // node 3 as the child of both node 1 and node 2
+  sopointcloud_test_valid(header, nodes);
+  nodes[2].firstchild = 3;
+  nodes[2].childmask = 0x1;
+  BOOST_REQUIRE(sopointcloud_test_write(filename, header, nodes));
+  BOOST_CHECK(!sopointcloud_test_opens(filename));
+}
+
+BOOST_AUTO_TEST_CASE(compatibilityTypes)
+{
+  BOOST_CHECK_EQUAL(SoNode::getCompatibilityTypes(SoPointCloud::getClassTypeId()),
+                    uint32_t(SoNode::COIN_4_1));
+}
+
+#endif // COIN_TEST_SUITE
@@ -98,10 +98,13 @@
 #include <Inventor/elements/SoViewingMatrixElement.h>
 #include <Inventor/elements/SoViewportRegionElement.h>
 #include <Inventor/errors/SoDebugError.h>
+#include <Inventor/lists/SbList.h>
 #include <Inventor/misc/SoGLBigImage.h>
 #include <Inventor/misc/SoGLDriverDatabase.h>
 #include <Inventor/misc/SoState.h>
+#include <Inventor/nodes/SoIndexedShape.h>
 #include <Inventor/nodes/SoLight.h>
+#include <Inventor/nodes/SoNonIndexedShape.h>
 #include <Inventor/nodes/SoVertexProperty.h>
 #include <Inventor/nodes/SoVertexShape.h>
 #include <Inventor/system/gl.h>
@@ -170,12 +173,31 @@
 
 // *************************************************************************
 
+// default texture coordinates for a texture unit, kept in a VBO for
+// as long as the shape, its vertices and the dimension of the
+// coordinates (2D or 3D) are unchanged
+class soshape_functexcoordvbo {
+public:
+  soshape_functexcoordvbo(void)
+    : vbo(new SoVBO(GL_ARRAY_BUFFER, GL_STATIC_DRAW)),
+      shapeid(0),
+      vertexid(0),
+      texture3d(FALSE) { }
+  ~soshape_functexcoordvbo() { delete this->vbo; }
+
+  SoVBO * vbo;
+  SbUniqueId shapeid;
+  SbUniqueId vertexid;
+  SbBool texture3d;
+};
+
 class SoShapeP {
 public:
   SoShapeP() {
     this->bboxcache = NULL;
     this->pvcache = NULL;
     this->bumprender = NULL;
+    this->functexcoordvbos = NULL;
     this->rendercnt = 0;
     this->flags = 0;
   }
@@ -183,6 +205,12 @@ public:
     if (this->bboxcache) { this->bboxcache->unref(); }
     if (this->pvcache) { this->pvcache->unref(); }
     delete this->bumprender;
+    if (this->functexcoordvbos) {
+      for (int i = 0; i < this->functexcoordvbos->getLength(); i++) {
+        delete (*this->functexcoordvbos)[i];
+      }
+      delete this->functexcoordvbos;
+    }
   }
   enum {
     RENDERCNT_BITS = 4,     // bits needed to store rendercnt
@@ -195,10 +223,13 @@ public:
   };
 
   static void calibrateBBoxCache(void);
+  static int getNumBBoxVertices(SoShape * shape, SoState * state);
   static double bboxcachetimelimit;
+  static const int bboxcachevertexlimit = 100;
   SoBoundingBoxCache * bboxcache;
   SoPrimitiveVertexCache * pvcache;
   soshape_bumprender * bumprender;
+  SbList<soshape_functexcoordvbo *> * functexcoordvbos;
   uint32_t flags : FLAG_BITS;
   // stores the number of frames rendered with no node changes
   uint32_t rendercnt : RENDERCNT_BITS;
@@ -248,6 +279,35 @@ public:
 #endif // ! COIN_THREADSAFE
 
   static void cleanup(void);
+
+  SoVBO * getFuncTexCoordVBO(const SoMultiTextureCoordinateElement * mtelem,
+                             const int unit, const SbUniqueId shapeid,
+                             const SbUniqueId vertexid,
+                             const SbBool texture3d,
+                             const int num, const SbVec3f * points,
+                             const SbVec3f * normals) {
+    if (this->functexcoordvbos == NULL) {
+      this->functexcoordvbos = new SbList<soshape_functexcoordvbo *>;
+    }
+    while (this->functexcoordvbos->getLength() <= unit) {
+      this->functexcoordvbos->append(NULL);
+    }
+    soshape_functexcoordvbo * funcvbo = (*this->functexcoordvbos)[unit];
+    if (funcvbo == NULL) {
+      funcvbo = new soshape_functexcoordvbo;
+      (*this->functexcoordvbos)[unit] = funcvbo;
+    }
+    if (funcvbo->shapeid != shapeid || funcvbo->vertexid != vertexid ||
+        funcvbo->texture3d != texture3d) {
+      SbVec4f * tc = static_cast<SbVec4f *>
+        (funcvbo->vbo->allocBufferData(num * sizeof(SbVec4f), shapeid));
+      mtelem->get(unit, num, points, normals, tc);
+      funcvbo->shapeid = shapeid;
+      funcvbo->vertexid = vertexid;
+      funcvbo->texture3d = texture3d;
+    }
+    return funcvbo->vbo;
+  }
 };
 
 double SoShapeP::bboxcachetimelimit;
@@ -278,6 +338,11 @@ typedef struct {
   SoMaterialBundle * currentbundle;
 
   int rendermode;
+
+  // texture coordinates generated from texture coordinate functions
+  // for vertex array rendering
+  SbVec4f * functexcoords;
+  int functexcoordssize;
 } soshape_staticdata;
 
 static soshape_bigtexture *
@@ -304,6 +369,8 @@ soshape_construct_staticdata(void * closure)
   data->primdata = new soshape_primdata();
   data->trianglesort = new soshape_trianglesort();
   data->rendermode = NORMAL;
+  data->functexcoords = NULL;
+  data->functexcoordssize = 0;
 }
 
 static void
@@ -317,6 +384,7 @@ soshape_destruct_staticdata(void * closure)
   delete data->bigtexturecontext;
   delete data->primdata;
   delete data->trianglesort;
+  delete[] data->functexcoords;
 }
 
 static SbStorage * soshape_staticstorage;
@@ -435,6 +503,8 @@ SoShape::callback(SoCallbackAction * action)
     shapedata->primdata->faceCounter = 0;
     this->generatePrimitives(action);
   }
+  // also needed when the shape has sent its batch arrays itself
+  action->invokeTriangleBatchCallbacks(this);
 }
 
 // test bbox intersection
@@ -681,79 +751,87 @@ SoShape::shouldGLRender(SoGLRenderAction * action)
         PRIVATE(this)->unlock();
         return TRUE;
       }
+      PRIVATE(this)->bumprender->updateTangentSpace(PRIVATE(this)->pvcache);
       SoGLLazyElement::getInstance(state)->send(state, SoLazyElement::ALL_MASK);
 
       glPushAttrib(GL_DEPTH_BUFFER_BIT);
       glDepthFunc(GL_LEQUAL);
       glDisable(GL_LIGHTING);
 
-      glColor3f(1.0f, 1.0f, 1.0f);
-      PRIVATE(this)->setupShapeHints(this, state);
-      const int numlights = lights.getLength();
-      for (int i = 0; i < numlights; i++) {
-        // fetch matrix that convert the light from its object space
-        // to the OpenGL world space
-        SbMatrix lm = SoLightElement::getMatrix(state, i);
-
-        // convert light back to this objects' object space
-        SbMatrix m = SoModelMatrixElement::get(state) *
-          SoViewingMatrixElement::get(state);
-        m = m.inverse();
-        m.multLeft(lm);
-
-
-        // bumprender is shared among all threads, so we need to lock
-        // when we get here since some internal arrays are used while
-        // rendering
-        //
-        // FIXME: about the above comment; i don't see any locking...?
-        // -mortene.
-        PRIVATE(this)->bumprender->renderBump(state, PRIVATE(this)->pvcache,
-                                              (SoLight*) lights[i], m);
-
-        if (i == 0) glEnable(GL_BLEND);
-        if (i == numlights-1) {
-          glBlendFunc(GL_DST_COLOR, GL_ZERO);
-        }
-        else if (i == 0) {
-          glBlendFunc(GL_ONE, GL_ONE);
-        }
+      if (PRIVATE(this)->bumprender->canRenderSinglePass(state, lights.getLength())) {
+        SoMaterialBundle mb(action);
+        mb.sendFirst();
+        PRIVATE(this)->setupShapeHints(this, state);
+        PRIVATE(this)->bumprender->renderBumpSinglePass(state, PRIVATE(this)->pvcache, lights);
       }
+      else {
+        glColor3f(1.0f, 1.0f, 1.0f);
+        PRIVATE(this)->setupShapeHints(this, state);
+        const int numlights = lights.getLength();
+        for (int i = 0; i < numlights; i++) {
+          // fetch matrix that convert the light from its object space
+          // to the OpenGL world space
+          SbMatrix lm = SoLightElement::getMatrix(state, i);
+
+          // convert light back to this objects' object space
+          SbMatrix m = SoModelMatrixElement::get(state) *
+            SoViewingMatrixElement::get(state);
+          m = m.inverse();
+          m.multLeft(lm);
+
+
+          // bumprender is shared among all threads, so we need to lock
+          // when we get here since some internal arrays are used while
+          // rendering
+          //
+          // FIXME: about the above comment; i don't see any locking...?
+          // -mortene.
+          PRIVATE(this)->bumprender->renderBump(state, PRIVATE(this)->pvcache,
+                                                (SoLight*) lights[i], m);
+
+          if (i == 0) glEnable(GL_BLEND);
+          if (i == numlights-1) {
+            glBlendFunc(GL_DST_COLOR, GL_ZERO);
+          }
+          else if (i == 0) {
+            glBlendFunc(GL_ONE, GL_ONE);
+          }
+        }
 
 
-      SoGLLazyElement::getInstance(state)->reset(state,
-                                                 SoLazyElement::DIFFUSE_MASK);
-      SoMaterialBundle mb(action);
-      mb.sendFirst();
-      PRIVATE(this)->setupShapeHints(this, state);
-      PRIVATE(this)->bumprender->renderNormal(state, PRIVATE(this)->pvcache);
-
-      const SbColor spec = SoLazyElement::getSpecular(state);
-      if (spec[0] != 0 || spec[1] != 0 || spec[2] != 0) { // Is the spec. color black?
-
-        // Can the hardware do specular bump maps?
-        if (glue->has_arb_fragment_program &&
-            glue->has_arb_vertex_program) {
-
-          SoGLLazyElement::getInstance(state)->reset(state,
-                                                     SoLazyElement::DIFFUSE_MASK);
-          glEnable(GL_BLEND);
-          glBlendFunc(GL_ONE, GL_ONE);
-
-          for (int i = 0; i < numlights; i++) {
-            SbMatrix lm = SoLightElement::getMatrix(state, i);
-            SbMatrix m = SoModelMatrixElement::get(state) *
-              SoViewingMatrixElement::get(state);
-            m = m.inverse();
-            m.multLeft(lm);
-            PRIVATE(this)->bumprender->renderBumpSpecular(state, PRIVATE(this)->pvcache,
-                                                          (SoLight*) lights[i], m);
+        SoGLLazyElement::getInstance(state)->reset(state,
+                                                   SoLazyElement::DIFFUSE_MASK);
+        SoMaterialBundle mb(action);
+        mb.sendFirst();
+        PRIVATE(this)->setupShapeHints(this, state);
+        PRIVATE(this)->bumprender->renderNormal(state, PRIVATE(this)->pvcache);
+
+        const SbColor spec = SoLazyElement::getSpecular(state);
+        if (spec[0] != 0 || spec[1] != 0 || spec[2] != 0) { // Is the spec. color black?
+
+          // Can the hardware do specular bump maps?
+          if (glue->has_arb_fragment_program &&
+              glue->has_arb_vertex_program) {
+
+            SoGLLazyElement::getInstance(state)->reset(state,
+                                                       SoLazyElement::DIFFUSE_MASK);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+
+            for (int i = 0; i < numlights; i++) {
+              SbMatrix lm = SoLightElement::getMatrix(state, i);
+              SbMatrix m = SoModelMatrixElement::get(state) *
+                SoViewingMatrixElement::get(state);
+              m = m.inverse();
+              m.multLeft(lm);
+              PRIVATE(this)->bumprender->renderBumpSpecular(state, PRIVATE(this)->pvcache,
+                                                            (SoLight*) lights[i], m);
+            }
           }
-        }
 
+        }
       }
 
-
       PRIVATE(this)->unlock();
 
       glPopAttrib();
@@ -1487,9 +1565,12 @@ SoShape::getBBox(SoAction * action, SbBox3f & box, SbVec3f & center)
     PRIVATE(this)->unlock();
     SoCacheElement::set(state, PRIVATE(this)->bboxcache);
   }
-  SbTime begin = SbTime::getTimeOfDay();
+  // the cost of vertex shapes follows from their number of vertices,
+  // other shapes are timed
+  const int numvertices = shouldcache ? 0 : SoShapeP::getNumBBoxVertices(this, state);
+  SbTime begin;
+  if (numvertices < 0) begin = SbTime::getTimeOfDay();
   this->computeBBox(action, box, center);
-  SbTime end = SbTime::getTimeOfDay();
   if (shouldcache) {
     PRIVATE(this)->bboxcache->set(box, TRUE, center);
     // pop state since we pushed it
@@ -1497,7 +1578,9 @@ SoShape::getBBox(SoAction * action, SbBox3f & box, SbVec3f & center)
     SoCacheElement::setInvalid(storedinvalid);
   }
   // only create cache if calculating it took longer than the limit
-  else if ((end.getValue() - begin.getValue()) >= SoShapeP::bboxcachetimelimit) {
+  else if ((numvertices >= 0) ?
+           (numvertices >= SoShapeP::bboxcachevertexlimit) :
+           ((SbTime::getTimeOfDay() - begin).getValue() >= SoShapeP::bboxcachetimelimit)) {
     PRIVATE(this)->flags |= SoShapeP::SHOULD_BBOX_CACHE;
     if (action->isOfType(SoGetBoundingBoxAction::getClassTypeId())) {
       // just recalculate the bbox so that the cache is created at
@@ -1520,6 +1603,29 @@ SoShape::getBBox(SoAction * action, SbBox3f & box, SbVec3f & center)
   }
 }
 
+// Returns the number of vertices computeBBox() can visit for vertex
+// shapes, or -1 for other shapes. For shapes without indices this is
+// the number of coordinates from startIndex and on, which is an upper
+// bound for any subclass.
+int
+SoShapeP::getNumBBoxVertices(SoShape * shape, SoState * state)
+{
+  if (!shape->isOfType(SoVertexShape::getClassTypeId())) return -1;
+  if (shape->isOfType(SoIndexedShape::getClassTypeId())) {
+    return static_cast<SoIndexedShape *>(shape)->coordIndex.getNum();
+  }
+  int numcoords = SoCoordinateElement::getInstance(state)->getNum();
+  SoNode * vpnode = static_cast<SoVertexShape *>(shape)->vertexProperty.getValue();
+  if (vpnode && vpnode->isOfType(SoVertexProperty::getClassTypeId())) {
+    const int num = static_cast<SoVertexProperty *>(vpnode)->vertex.getNum();
+    if (num > 0) numcoords = num;
+  }
+  if (shape->isOfType(SoNonIndexedShape::getClassTypeId())) {
+    numcoords -= static_cast<SoNonIndexedShape *>(shape)->startIndex.getValue();
+  }
+  return SbMax(numcoords, 0);
+}
+
 void
 SoShapeP::calibrateBBoxCache(void)
 {
@@ -1551,6 +1657,12 @@ SoShapeP::calibrateBBoxCache(void)
   Convenience method that enables vertex arrays and/or VBOs
   Returns \e TRUE if VBO is used.
 
+  Texture units using a texture coordinate function get their
+  coordinates generated for all vertices in \a coords, using
+  \a pervertexnormals if not NULL. Default texture coordinates are
+  kept in a VBO when the vertices are, other functions are evaluated
+  every frame and sent as a client side array.
+
   \sa finishVertexArray()
   \since Coin 3.0
 */
@@ -1623,8 +1735,59 @@ SoShape::startVertexArray(SoGLRenderAction * action,
       lastenabled = 0;
     }
 
+    SbVec4f * functexcoords = NULL;
     for (int i = 0; i <= lastenabled; i++) {
-      if (enabledunits[i] && mtelem->getNum(i)) {
+      if (enabledunits[i] && !mtelem->getNum(i) &&
+          mtelem->getType(i) == SoMultiTextureCoordinateElement::FUNCTION &&
+          coords->is3D()) {
+        // generate the texture coordinates for the whole vertex array
+        // in one go
+        const int num = coords->getNum();
+	if (SoGLDriverDatabase::isSupported(glue, SO_GL_MULTITEXTURE)) {
+	  cc_glglue_glClientActiveTexture(glue, GL_TEXTURE0 + i);
+	}
+        const GLvoid * tptr = NULL;
+        if (dovbo && mtelem->getNodeId(i) == this->getNodeId()) {
+          // default texture coordinates only depend on the shape, its
+          // vertices and whether unit 0 has a 3D texture (see
+          // SoTextureCoordinateBundle), so they are kept in a VBO
+          // until any of these changes. Other functions may depend on
+          // the rest of the state, and are regenerated every frame.
+          const SbBool texture3d = SoMultiTextureEnabledElement::getMode(state, 0) ==
+            SoMultiTextureEnabledElement::TEXTURE3D;
+          PRIVATE(this)->lock();
+          vbo = PRIVATE(this)->getFuncTexCoordVBO(mtelem, i, this->getNodeId(),
+                                                  vertexvbo->getBufferDataId(),
+                                                  texture3d,
+                                                  num, coords->getArrayPtr3(),
+                                                  pervertexnormals);
+          vbo->bindBuffer(contextid);
+          PRIVATE(this)->unlock();
+          didbind = TRUE;
+        }
+        else {
+          if (functexcoords == NULL) {
+            soshape_staticdata * shapedata = soshape_get_staticdata();
+            const int reqsize = num * (lastenabled + 1);
+            if (reqsize > shapedata->functexcoordssize) {
+              delete[] shapedata->functexcoords;
+              shapedata->functexcoords = new SbVec4f[reqsize];
+              shapedata->functexcoordssize = reqsize;
+            }
+            functexcoords = shapedata->functexcoords;
+          }
+          SbVec4f * tc = functexcoords + i * num;
+          mtelem->get(i, num, coords->getArrayPtr3(), pervertexnormals, tc);
+          if (didbind) {
+            cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, 0);
+            didbind = FALSE;
+          }
+          tptr = (const GLvoid*) tc;
+        }
+        cc_glglue_glTexCoordPointer(glue, 4, GL_FLOAT, 0, tptr);
+        cc_glglue_glEnableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+      }
+      else if (enabledunits[i] && mtelem->getNum(i)) {
         int dim = mtelem->getDimension(i);
         const GLvoid * tptr;
         switch (dim) {
@@ -1732,7 +1895,9 @@ SoShape::finishVertexArray(SoGLRenderAction * action,
       SoMultiTextureCoordinateElement::getInstance(state);
     
     for (int i = 0; i <= lastenabled; i++) {
-      if (enabledunits[i] && mtelem->getNum(i)) {
+      if (enabledunits[i] &&
+          (mtelem->getNum(i) ||
+           mtelem->getType(i) == SoMultiTextureCoordinateElement::FUNCTION)) {
 	if (SoGLDriverDatabase::isSupported(glue, SO_GL_MULTITEXTURE)) {
 	  cc_glglue_glClientActiveTexture(glue, GL_TEXTURE0 + i);
 	}
@@ -1773,9 +1938,6 @@ SoShape::validatePVCache(SoGLRenderAction * action)
     shapedata->rendermode = PVCACHE;
     this->generatePrimitives(action);
     shapedata->rendermode = NORMAL;
-    // needed for out old bumpmap handling
-    if (PRIVATE(this)->bumprender) PRIVATE(this)->bumprender->calcTangentSpace(PRIVATE(this)->pvcache);
-    // this _must_ be called after creating the pvcache
 
     // FIXME: consider if we should call a virtual function here to
     // enable subclasses to modify the primitive vertex cache. Must be
@@ -120,6 +120,7 @@
 #include <Inventor/misc/SoState.h>
 #include <Inventor/SoPrimitiveVertex.h>
 #include <Inventor/bundles/SoTextureCoordinateBundle.h>
+#include <Inventor/actions/SoCallbackAction.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/system/gl.h>
 #include <Inventor/actions/SoGetPrimitiveCountAction.h>
@@ -138,6 +139,7 @@
 
 #include "nodes/SoSubNodeP.h"
 #include "rendering/SoGL.h"
+#include "shapenodes/soshape_batch.h"
 
 /*!
   \var SoMFInt32 SoTriangleStripSet::numVertices
@@ -802,3 +804,99 @@ SoTriangleStripSet::generatePrimitives(SoAction *action)
   if (this->vertexProperty.getValue())
     state->pop();
 }
+
+// Doc in parent. Triangle batch callbacks get arrays built directly
+// from the numVertices field, with no SoPrimitiveVertex or per
+// triangle callback involved.
+void
+SoTriangleStripSet::callback(SoCallbackAction * action)
+{
+  if (!(this->numVertices.getNum() == 1 && this->numVertices[0] == 0) &&
+      action->shouldGenerateTriangleBatch(this)) {
+    SoState * state = action->getState();
+
+    if (this->vertexProperty.getValue()) {
+      state->push();
+      this->vertexProperty.getValue()->doAction(action);
+    }
+
+    const SoCoordinateElement * coords;
+    const SbVec3f * normals;
+    SoVertexShape::getVertexData(state, coords, normals, TRUE);
+
+    SoTextureCoordinateBundle tb(action, FALSE, FALSE);
+    const SbBool texindices = tb.needCoordinates() && !tb.isFunction();
+
+    Binding mbind = this->findMaterialBinding(state);
+    Binding nbind = this->findNormalBinding(state);
+
+    SoNormalCache * nc = NULL;
+    if (normals == NULL) {
+      nc = this->generateAndReadLockNormalCache(state);
+      normals = nc->getNormals();
+    }
+
+    int32_t idx = this->startIndex.getValue();
+    int32_t dummyarray[1];
+    const int32_t * ptr = this->numVertices.getValues(0);
+    const int32_t * end = ptr + this->numVertices.getNum();
+    this->fixNumVerticesPointers(state, ptr, end, dummyarray);
+
+    int numhint = 0;
+    for (const int32_t * p = ptr; p < end; p++) numhint += *p;
+    soshape_batch batch(coords, normals, numhint);
+    // normal, texture coordinate and material index for each vertex
+    // in the strip
+    SbList <int32_t> strip(256);
+    int32_t mat = 0;
+    int32_t normal = normals ? 0 : -1;
+    int matnr = 0;
+    int normnr = 0;
+    int texnr = 0;
+
+    const SbBool ok = !(tb.needCoordinates() && tb.isFunction() && tb.needIndices());
+    while (ok && ptr < end) {
+      const int n = *ptr++;
+      if (n < 3) continue; // as in generatePrimitives()
+
+      strip.truncate(0);
+      for (int k = 0; k < n; k++) {
+        if (k == 0 ? nbind != OVERALL : (k < 3 ? nbind == PER_VERTEX : nbind >= PER_FACE)) {
+          normal = normnr++;
+        }
+        if (k == 0 ? mbind != OVERALL : (k < 3 ? mbind == PER_VERTEX : mbind >= PER_FACE)) {
+          mat = matnr++;
+        }
+        strip.append(normal);
+        strip.append(texindices ? texnr++ : -1);
+        strip.append(mat);
+
+        if (k >= 2) {
+          // every other triangle has its first two vertices swapped,
+          // and per strip and per face values are used for all three
+          // vertices
+          const int t = k - 2;
+          const int order[3] = { (t & 1) ? t + 1 : t, (t & 1) ? t : t + 1, t + 2 };
+          int32_t tri[3];
+          for (int j = 0; j < 3; j++) {
+            const int32_t * c = strip.getArrayPtr() + order[j] * 3;
+            tri[j] = batch.vertex(idx - k + order[j],
+                                  nbind != PER_VERTEX ? normal : c[0], c[1],
+                                  mbind != PER_VERTEX ? mat : c[2]);
+          }
+          batch.triangle(tri[0], tri[1], tri[2]);
+        }
+        idx++;
+      }
+    }
+    if (ok) batch.send(action, this, tb);
+
+    if (nc) {
+      this->readUnlockNormalCache();
+    }
+    if (this->vertexProperty.getValue()) {
+      state->pop();
+    }
+  }
+  inherited::callback(action);
+}
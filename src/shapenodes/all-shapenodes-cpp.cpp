@@ -49,6 +49,7 @@
 #include "SoNonIndexedShape.cpp"
 #include "SoNurbsCurve.cpp"
 #include "SoNurbsSurface.cpp"
+#include "SoPointCloud.cpp"
 #include "SoPointSet.cpp"
 #include "SoQuadMesh.cpp"
 #include "SoShape.cpp"
@@ -57,7 +58,10 @@
 #include "SoText3.cpp"
 #include "SoTriangleStripSet.cpp"
 #include "SoVertexShape.cpp"
+#include "soshape_batch.cpp"
+#include "soshape_bbox.cpp"
 #include "soshape_bigtexture.cpp"
 #include "soshape_primdata.cpp"
 #include "soshape_trianglesort.cpp"
 #include "soshape_bumprender.cpp"
+#include "sopointcloud_octree.cpp"
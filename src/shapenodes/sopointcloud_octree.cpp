@@ -0,0 +1,584 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include "shapenodes/sopointcloud_octree.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <sys/types.h>
+
+#ifdef HAVE_THREADS
+#include <Inventor/threads/SbMutex.h>
+#endif // HAVE_THREADS
+#include <Inventor/errors/SoDebugError.h>
+
+// Inner nodes keep at most one point per cell of a
+// SOPOINTCLOUD_GRID^3 grid covering their cube.
+#define SOPOINTCLOUD_GRID 128
+// Nodes with fewer points than this are not split.
+#define SOPOINTCLOUD_MAXLEAFPOINTS 20000
+// Guards against infinite splitting of coincident points.
+#define SOPOINTCLOUD_MAXDEPTH 24
+// Number of points streamed through memory at a time.
+#define SOPOINTCLOUD_CHUNK 65536
+
+static const char sopointcloud_magic[8] = { 'C', 'O', 'I', 'N', 'P', 'C', 'O', 'T' };
+static const uint32_t sopointcloud_version = 1;
+static const uint32_t sopointcloud_byteorder = 0x01020304;
+
+// fseek() and ftell() use a long, which is 32 bits on some
+// platforms, and the files are often larger than 2 GB
+static int
+sopointcloud_seek(FILE * fp, const uint64_t offset)
+{
+#ifdef _WIN32
+  return _fseeki64(fp, static_cast<__int64>(offset), SEEK_SET);
+#else // !_WIN32
+  return fseeko(fp, static_cast<off_t>(offset), SEEK_SET);
+#endif // !_WIN32
+}
+
+static uint64_t
+sopointcloud_tell(FILE * fp)
+{
+#ifdef _WIN32
+  return static_cast<uint64_t>(_ftelli64(fp));
+#else // !_WIN32
+  return static_cast<uint64_t>(ftello(fp));
+#endif // !_WIN32
+}
+
+static uint64_t
+sopointcloud_filesize(FILE * fp)
+{
+#ifdef _WIN32
+  if (_fseeki64(fp, 0, SEEK_END) != 0) return 0;
+#else // !_WIN32
+  if (fseeko(fp, 0, SEEK_END) != 0) return 0;
+#endif // !_WIN32
+  return sopointcloud_tell(fp);
+}
+
+// *************************************************************************
+
+sopointcloud_octree::sopointcloud_octree(void)
+{
+  this->fp = NULL;
+#ifdef HAVE_THREADS
+  this->mutex = new SbMutex;
+#else // !HAVE_THREADS
+  this->mutex = NULL;
+#endif // !HAVE_THREADS
+  memset(&this->header, 0, sizeof(this->header));
+}
+
+sopointcloud_octree::~sopointcloud_octree()
+{
+  this->close();
+#ifdef HAVE_THREADS
+  delete this->mutex;
+#endif // HAVE_THREADS
+}
+
+int
+sopointcloud_octree::getPointSize(const SbBool colors)
+{
+  return colors ? 3 * sizeof(float) + 4 : 3 * sizeof(float);
+}
+
+SbBool
+sopointcloud_octree::open(const char * filename)
+{
+  this->close();
+  this->fp = fopen(filename, "rb");
+  if (this->fp == NULL) {
+    SoDebugError::postWarning("sopointcloud_octree::open",
+                              "Could not open '%s'.", filename);
+    return FALSE;
+  }
+  if (fread(&this->header, sizeof(this->header), 1, this->fp) != 1 ||
+      memcmp(this->header.magic, sopointcloud_magic, sizeof(sopointcloud_magic)) != 0) {
+    SoDebugError::postWarning("sopointcloud_octree::open",
+                              "'%s' is not a point cloud octree file.", filename);
+    this->close();
+    return FALSE;
+  }
+  if (this->header.version != sopointcloud_version ||
+      this->header.byteorder != sopointcloud_byteorder ||
+      this->header.numnodes == 0) {
+    SoDebugError::postWarning("sopointcloud_octree::open",
+                              "'%s' has an unsupported version or byte order.",
+                              filename);
+    this->close();
+    return FALSE;
+  }
+
+  // the node table is checked against the file size before anything
+  // is allocated from it, and the points of all nodes must be stored
+  // between the header and the node table
+  const uint64_t filesize = sopointcloud_filesize(this->fp);
+  const uint64_t tablesize =
+    static_cast<uint64_t>(this->header.numnodes) * sizeof(sopointcloud_noderecord);
+  if (this->header.numnodes > static_cast<uint32_t>(INT_MAX) ||
+      this->header.nodetableoffset < sizeof(sopointcloud_header) ||
+      this->header.nodetableoffset > filesize ||
+      tablesize > filesize - this->header.nodetableoffset) {
+    SoDebugError::postWarning("sopointcloud_octree::open",
+                              "The node table of '%s' is corrupt.", filename);
+    this->close();
+    return FALSE;
+  }
+
+  const int numnodes = static_cast<int>(this->header.numnodes);
+  this->nodes.truncate(0);
+  for (int i = 0; i < numnodes; i++) this->nodes.append(sopointcloud_noderecord());
+  if (sopointcloud_seek(this->fp, this->header.nodetableoffset) != 0 ||
+      fread(&this->nodes[0], sizeof(sopointcloud_noderecord),
+            numnodes, this->fp) != static_cast<size_t>(numnodes)) {
+    SoDebugError::postWarning("sopointcloud_octree::open",
+                              "Could not read the node table of '%s'.", filename);
+    this->close();
+    return FALSE;
+  }
+
+  const uint64_t pointsize = this->getPointSize();
+  for (int i = 0; i < numnodes; i++) {
+    const sopointcloud_noderecord & node = this->nodes[i];
+    if (node.offset < sizeof(sopointcloud_header) ||
+        node.offset > this->header.nodetableoffset ||
+        node.numpoints * pointsize > this->header.nodetableoffset - node.offset) {
+      SoDebugError::postWarning("sopointcloud_octree::open",
+                                "The node table of '%s' is corrupt.", filename);
+      this->close();
+      return FALSE;
+    }
+  }
+
+  // the node cubes are not stored, but follow from the root cube
+  this->boxes.truncate(0);
+  const float size = this->header.cubesize;
+  const SbVec3f cubemin(this->header.cubemin[0], this->header.cubemin[1],
+                        this->header.cubemin[2]);
+  for (int i = 0; i < numnodes; i++) this->boxes.append(SbBox3f());
+  this->boxes[0].setBounds(cubemin, cubemin + SbVec3f(size, size, size));
+  // each node must have one parent, or it would be added to the heap
+  // twice while selecting nodes
+  SbList <unsigned char> hasparent(numnodes);
+  for (int i = 0; i < numnodes; i++) hasparent.append(0);
+  for (int i = 0; i < numnodes; i++) {
+    const sopointcloud_noderecord & node = this->nodes[i];
+    if (node.firstchild < 0) continue;
+    const SbVec3f & min = this->boxes[i].getMin();
+    const float half = (this->boxes[i].getMax()[0] - min[0]) * 0.5f;
+    int child = node.firstchild;
+    for (int octant = 0; octant < 8; octant++) {
+      if (!(node.childmask & (1 << octant))) continue;
+      if (child <= i || child >= numnodes || hasparent[child]) {
+        SoDebugError::postWarning("sopointcloud_octree::open",
+                                  "The node table of '%s' is corrupt.", filename);
+        this->close();
+        return FALSE;
+      }
+      const SbVec3f cmin(min[0] + ((octant & 1) ? half : 0.0f),
+                         min[1] + ((octant & 2) ? half : 0.0f),
+                         min[2] + ((octant & 4) ? half : 0.0f));
+      this->boxes[child].setBounds(cmin, cmin + SbVec3f(half, half, half));
+      hasparent[child] = 1;
+      child++;
+    }
+  }
+  this->bbox.setBounds(this->header.bboxmin[0], this->header.bboxmin[1],
+                       this->header.bboxmin[2], this->header.bboxmax[0],
+                       this->header.bboxmax[1], this->header.bboxmax[2]);
+  return TRUE;
+}
+
+void
+sopointcloud_octree::close(void)
+{
+  if (this->fp) fclose(this->fp);
+  this->fp = NULL;
+  this->nodes.truncate(0, TRUE);
+  this->boxes.truncate(0, TRUE);
+  this->bbox.makeEmpty();
+  memset(&this->header, 0, sizeof(this->header));
+}
+
+SbBool
+sopointcloud_octree::isOpen(void) const
+{
+  return this->fp != NULL;
+}
+
+SbBool
+sopointcloud_octree::hasColors(void) const
+{
+  return (this->header.flags & HAS_COLORS) != 0;
+}
+
+int
+sopointcloud_octree::getPointSize(void) const
+{
+  return sopointcloud_octree::getPointSize(this->hasColors());
+}
+
+uint64_t
+sopointcloud_octree::getNumPoints(void) const
+{
+  return this->header.numpoints;
+}
+
+const SbBox3f &
+sopointcloud_octree::getBoundingBox(void) const
+{
+  return this->bbox;
+}
+
+int
+sopointcloud_octree::getNumNodes(void) const
+{
+  return this->nodes.getLength();
+}
+
+const sopointcloud_noderecord &
+sopointcloud_octree::getNode(const int idx) const
+{
+  return this->nodes.getArrayPtr()[idx];
+}
+
+const SbBox3f &
+sopointcloud_octree::getNodeBox(const int idx) const
+{
+  return this->boxes.getArrayPtr()[idx];
+}
+
+SbBool
+sopointcloud_octree::readPoints(const int idx, unsigned char * buffer) const
+{
+  const sopointcloud_noderecord & node = this->nodes[idx];
+#ifdef HAVE_THREADS
+  this->mutex->lock();
+#endif // HAVE_THREADS
+  SbBool ok =
+    sopointcloud_seek(this->fp, node.offset) == 0 &&
+    fread(buffer, this->getPointSize(), node.numpoints, this->fp) == node.numpoints;
+#ifdef HAVE_THREADS
+  this->mutex->unlock();
+#endif // HAVE_THREADS
+  return ok;
+}
+
+// *************************************************************************
+
+sopointcloud_converter::sopointcloud_converter(void)
+{
+  this->out = NULL;
+  this->root = NULL;
+  this->colors = FALSE;
+  this->pointsize = 0;
+  this->tempcounter = 0;
+  this->failed = FALSE;
+  this->numpoints = 0;
+  this->written = 0;
+}
+
+sopointcloud_converter::~sopointcloud_converter()
+{
+  if (this->root) fclose(this->root);
+  if (this->out) fclose(this->out);
+  this->removeTempFiles();
+}
+
+SbString
+sopointcloud_converter::newTempFile(void)
+{
+  SbString name;
+  name.sprintf("%s.%d.tmp", this->filename.getString(), this->tempcounter++);
+  this->tempfiles.append(name);
+  return name;
+}
+
+void
+sopointcloud_converter::removeTempFiles(void)
+{
+  for (int i = 0; i < this->tempfiles.getLength(); i++) {
+    (void) remove(this->tempfiles[i].getString());
+  }
+  this->tempfiles.truncate(0);
+}
+
+SbBool
+sopointcloud_converter::begin(const char * filename, const SbBool colors)
+{
+  this->filename = filename;
+  this->colors = colors;
+  this->pointsize = sopointcloud_octree::getPointSize(colors);
+  this->numpoints = 0;
+  this->written = 0;
+  this->failed = FALSE;
+  this->bbox.makeEmpty();
+  this->nodes.truncate(0);
+
+  this->out = fopen(filename, "wb");
+  if (this->out == NULL) {
+    SoDebugError::postWarning("sopointcloud_converter::begin",
+                              "Could not create '%s'.", filename);
+    return FALSE;
+  }
+  this->rootname = this->newTempFile();
+  this->root = fopen(this->rootname.getString(), "wb");
+  if (this->root == NULL) {
+    SoDebugError::postWarning("sopointcloud_converter::begin",
+                              "Could not create '%s'.", this->rootname.getString());
+    return FALSE;
+  }
+  return TRUE;
+}
+
+void
+sopointcloud_converter::addPoint(const SbVec3f & point, const uint32_t rgba)
+{
+  if (this->root == NULL) return;
+  unsigned char record[16];
+  memcpy(record, point.getValue(), 3 * sizeof(float));
+  if (this->colors) {
+    record[12] = static_cast<unsigned char>(rgba >> 24);
+    record[13] = static_cast<unsigned char>((rgba >> 16) & 0xff);
+    record[14] = static_cast<unsigned char>((rgba >> 8) & 0xff);
+    record[15] = static_cast<unsigned char>(rgba & 0xff);
+  }
+  if (fwrite(record, this->pointsize, 1, this->root) != 1) this->failed = TRUE;
+  this->bbox.extendBy(point);
+  this->numpoints++;
+}
+
+SbBool
+sopointcloud_converter::writePoints(const unsigned char * data, const uint64_t num)
+{
+  if (num && fwrite(data, this->pointsize, static_cast<size_t>(num), this->out) != num) {
+    this->failed = TRUE;
+    return FALSE;
+  }
+  this->written += num;
+  return TRUE;
+}
+
+// Writes the subsample of node idx to the output file, and splits
+// the remaining points into the child octants.
+SbBool
+sopointcloud_converter::buildNode(const int idx, const SbString & tempfile,
+                                  const uint64_t num, const SbVec3f & cubemin,
+                                  const float cubesize, const int depth)
+{
+  FILE * in = fopen(tempfile.getString(), "rb");
+  if (in == NULL) return FALSE;
+
+  sopointcloud_noderecord & node = this->nodes[idx];
+  node.offset = sopointcloud_tell(this->out);
+  node.firstpoint = this->written;
+  node.firstchild = -1;
+  node.childmask = 0;
+  node.spacing = cubesize / SOPOINTCLOUD_GRID;
+
+  unsigned char * chunk = new unsigned char[SOPOINTCLOUD_CHUNK * this->pointsize];
+
+  if (num <= SOPOINTCLOUD_MAXLEAFPOINTS || depth >= SOPOINTCLOUD_MAXDEPTH) {
+    // keep all points in this node
+    uint64_t left = num;
+    while (left > 0 && !this->failed) {
+      const size_t n = static_cast<size_t>(SbMin(left, static_cast<uint64_t>(SOPOINTCLOUD_CHUNK)));
+      if (fread(chunk, this->pointsize, n, in) != n) { this->failed = TRUE; break; }
+      this->writePoints(chunk, n);
+      left -= n;
+    }
+    node.numpoints = static_cast<uint32_t>(num);
+    delete[] chunk;
+    fclose(in);
+    (void) remove(tempfile.getString());
+    return !this->failed;
+  }
+
+  const int grid = SOPOINTCLOUD_GRID;
+  const int numcells = grid * grid * grid;
+  unsigned char * occupied = new unsigned char[numcells / 8];
+  memset(occupied, 0, numcells / 8);
+  uint64_t numkept = 0;
+
+  SbString childname[8];
+  FILE * childfp[8];
+  uint64_t childcount[8];
+  for (int i = 0; i < 8; i++) { childfp[i] = NULL; childcount[i] = 0; }
+
+  const float half = cubesize * 0.5f;
+  const float tocell = grid / cubesize;
+  uint64_t left = num;
+  while (left > 0 && !this->failed) {
+    const size_t n = static_cast<size_t>(SbMin(left, static_cast<uint64_t>(SOPOINTCLOUD_CHUNK)));
+    if (fread(chunk, this->pointsize, n, in) != n) { this->failed = TRUE; break; }
+    for (size_t i = 0; i < n; i++) {
+      const unsigned char * record = chunk + i * this->pointsize;
+      float p[3];
+      memcpy(p, record, sizeof(p));
+      int cell[3];
+      for (int j = 0; j < 3; j++) {
+        cell[j] = SbClamp(static_cast<int>((p[j] - cubemin[j]) * tocell), 0, grid - 1);
+      }
+      const int c = (cell[2] * grid + cell[1]) * grid + cell[0];
+      if (!(occupied[c >> 3] & (1 << (c & 7)))) {
+        // the first point in each cell is kept in this node, and
+        // written to the output file right away
+        occupied[c >> 3] |= static_cast<unsigned char>(1 << (c & 7));
+        this->writePoints(record, 1);
+        numkept++;
+        continue;
+      }
+      const int octant =
+        ((p[0] - cubemin[0] >= half) ? 1 : 0) |
+        ((p[1] - cubemin[1] >= half) ? 2 : 0) |
+        ((p[2] - cubemin[2] >= half) ? 4 : 0);
+      if (childfp[octant] == NULL) {
+        childname[octant] = this->newTempFile();
+        childfp[octant] = fopen(childname[octant].getString(), "wb");
+        if (childfp[octant] == NULL) { this->failed = TRUE; break; }
+      }
+      if (fwrite(record, this->pointsize, 1, childfp[octant]) != 1) this->failed = TRUE;
+      childcount[octant]++;
+    }
+    left -= n;
+  }
+  delete[] occupied;
+  delete[] chunk;
+  fclose(in);
+  (void) remove(tempfile.getString());
+  for (int i = 0; i < 8; i++) {
+    if (childfp[i]) fclose(childfp[i]);
+  }
+  if (this->failed) return FALSE;
+
+  // the children are allocated next to each other in the table
+  const int firstchild = this->nodes.getLength();
+  uint32_t childmask = 0;
+  for (int i = 0; i < 8; i++) {
+    if (childcount[i] == 0) continue;
+    childmask |= 1 << i;
+    this->nodes.append(sopointcloud_noderecord());
+  }
+  // don't use the node reference after the list has grown
+  this->nodes[idx].numpoints = static_cast<uint32_t>(numkept);
+  this->nodes[idx].childmask = childmask;
+  this->nodes[idx].firstchild = childmask ? firstchild : -1;
+
+  int child = firstchild;
+  for (int i = 0; i < 8; i++) {
+    if (childcount[i] == 0) continue;
+    const SbVec3f childmin(cubemin[0] + ((i & 1) ? half : 0.0f),
+                           cubemin[1] + ((i & 2) ? half : 0.0f),
+                           cubemin[2] + ((i & 4) ? half : 0.0f));
+    if (!this->buildNode(child++, childname[i], childcount[i],
+                         childmin, half, depth + 1)) return FALSE;
+  }
+  return TRUE;
+}
+
+SbBool
+sopointcloud_converter::end(void)
+{
+  if (this->out == NULL || this->root == NULL) return FALSE;
+  fclose(this->root);
+  this->root = NULL;
+
+  sopointcloud_header header;
+  memset(&header, 0, sizeof(header));
+  if (fwrite(&header, sizeof(header), 1, this->out) != 1) this->failed = TRUE;
+
+  SbVec3f cubemin(0.0f, 0.0f, 0.0f);
+  float cubesize = 1.0f;
+  if (!this->bbox.isEmpty()) {
+    float dx, dy, dz;
+    this->bbox.getSize(dx, dy, dz);
+    cubesize = SbMax(SbMax(dx, dy), dz);
+    // make sure points on the max sides end up inside the cube
+    cubesize = (cubesize > 0.0f) ? cubesize * 1.0001f : 1.0f;
+    cubemin = this->bbox.getCenter() - SbVec3f(cubesize, cubesize, cubesize) * 0.5f;
+  }
+
+  this->nodes.append(sopointcloud_noderecord());
+  if (!this->failed) {
+    (void) this->buildNode(0, this->rootname, this->numpoints, cubemin, cubesize, 0);
+  }
+
+  if (!this->failed) {
+    memcpy(header.magic, sopointcloud_magic, sizeof(sopointcloud_magic));
+    header.version = sopointcloud_version;
+    header.byteorder = sopointcloud_byteorder;
+    header.flags = this->colors ? sopointcloud_octree::HAS_COLORS : 0;
+    header.numnodes = this->nodes.getLength();
+    header.numpoints = this->written;
+    header.nodetableoffset = sopointcloud_tell(this->out);
+    if (!this->bbox.isEmpty()) {
+      for (int i = 0; i < 3; i++) {
+        header.bboxmin[i] = this->bbox.getMin()[i];
+        header.bboxmax[i] = this->bbox.getMax()[i];
+      }
+    }
+    for (int i = 0; i < 3; i++) header.cubemin[i] = cubemin[i];
+    header.cubesize = cubesize;
+
+    if (fwrite(this->nodes.getArrayPtr(), sizeof(sopointcloud_noderecord),
+               this->nodes.getLength(), this->out) !=
+        static_cast<size_t>(this->nodes.getLength()) ||
+        sopointcloud_seek(this->out, 0) != 0 ||
+        fwrite(&header, sizeof(header), 1, this->out) != 1) {
+      this->failed = TRUE;
+    }
+  }
+  if (fclose(this->out) != 0) this->failed = TRUE;
+  this->out = NULL;
+  this->removeTempFiles();
+
+  if (this->failed) {
+    SoDebugError::postWarning("sopointcloud_converter::end",
+                              "Could not write '%s'.", this->filename.getString());
+    (void) remove(this->filename.getString());
+  }
+  return !this->failed;
+}
+
+#undef SOPOINTCLOUD_GRID
+#undef SOPOINTCLOUD_MAXLEAFPOINTS
+#undef SOPOINTCLOUD_MAXDEPTH
+#undef SOPOINTCLOUD_CHUNK
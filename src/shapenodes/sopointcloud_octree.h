@@ -0,0 +1,164 @@
+#ifndef COIN_SOPOINTCLOUD_OCTREE_H
+#define COIN_SOPOINTCLOUD_OCTREE_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <cstdio>
+
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SbString.h>
+#include <Inventor/lists/SbList.h>
+
+class SbMutex;
+
+// The octree file format read by SoPointCloud. The file starts with
+// a sopointcloud_header, followed by the point data of all nodes. The
+// node table, with one sopointcloud_noderecord per octree node, is
+// stored at the end of the file, since it is not complete until all
+// points have been written.
+//
+// Each point record is three floats, optionally followed by four
+// bytes of RGBA color. The nodes are additive, the points of an
+// inner node are a subsample of the points in its cube, and its
+// children hold the rest. The root is node 0, and the children of a
+// node are stored after each other in the table, in the order of
+// the octant bits set in childmask (bit 0 is +x, bit 1 is +y and bit
+// 2 is +z). Children come after their parent in the table, and every
+// node except the root has exactly one parent.
+//
+// All values are stored in the byte order of the machine that wrote
+// the file. Files from a machine with a different byte order are
+// rejected.
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteorder;
+  uint32_t flags;
+  uint32_t numnodes;
+  uint64_t numpoints;
+  uint64_t nodetableoffset;
+  float bboxmin[3];
+  float bboxmax[3];
+  float cubemin[3];
+  float cubesize;
+} sopointcloud_header;
+
+typedef struct {
+  uint64_t offset;
+  uint64_t firstpoint;
+  uint32_t numpoints;
+  int32_t firstchild;
+  uint32_t childmask;
+  float spacing;
+} sopointcloud_noderecord;
+
+class sopointcloud_octree {
+public:
+  enum Flags {
+    HAS_COLORS = 0x1
+  };
+
+  sopointcloud_octree(void);
+  ~sopointcloud_octree();
+
+  SbBool open(const char * filename);
+  void close(void);
+  SbBool isOpen(void) const;
+
+  SbBool hasColors(void) const;
+  int getPointSize(void) const;
+  uint64_t getNumPoints(void) const;
+  const SbBox3f & getBoundingBox(void) const;
+
+  int getNumNodes(void) const;
+  const sopointcloud_noderecord & getNode(const int idx) const;
+  const SbBox3f & getNodeBox(const int idx) const;
+
+  // reads the point records of a node into buffer, which must hold
+  // getNode(idx).numpoints * getPointSize() bytes. Can be called
+  // from any thread.
+  SbBool readPoints(const int idx, unsigned char * buffer) const;
+
+  static int getPointSize(const SbBool colors);
+
+private:
+  FILE * fp;
+  SbMutex * mutex;
+  sopointcloud_header header;
+  SbBox3f bbox;
+  SbList <sopointcloud_noderecord> nodes;
+  SbList <SbBox3f> boxes;
+};
+
+// Builds an octree file from a stream of points, without keeping all
+// points in memory. The points are first written to a temporary
+// file, which is split into one temporary file per octant while
+// the subsample of each inner node is picked.
+class sopointcloud_converter {
+public:
+  sopointcloud_converter(void);
+  ~sopointcloud_converter();
+
+  SbBool begin(const char * filename, const SbBool colors);
+  void addPoint(const SbVec3f & point, const uint32_t rgba);
+  SbBool end(void);
+
+private:
+  SbString newTempFile(void);
+  SbBool buildNode(const int idx, const SbString & tempfile,
+                   const uint64_t numpoints, const SbVec3f & cubemin,
+                   const float cubesize, const int depth);
+  SbBool writePoints(const unsigned char * data, const uint64_t numpoints);
+  void removeTempFiles(void);
+
+  SbString filename;
+  FILE * out;
+  FILE * root;
+  SbString rootname;
+  SbBool colors;
+  int pointsize;
+  int tempcounter;
+  SbBool failed;
+  uint64_t numpoints;
+  uint64_t written;
+  SbBox3f bbox;
+  SbList <sopointcloud_noderecord> nodes;
+  SbList <SbString> tempfiles;
+};
+
+#endif // !COIN_SOPOINTCLOUD_OCTREE_H
@@ -0,0 +1,143 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include "shapenodes/soshape_batch.h"
+
+#include <Inventor/actions/SoCallbackAction.h>
+#include <Inventor/bundles/SoTextureCoordinateBundle.h>
+#include <Inventor/elements/SoCoordinateElement.h>
+
+// FNV-1a on the four indices, with a final mix since the indices
+// usually differ only in the low bits
+static inline uint32_t
+soshape_batch_hash(const int32_t * key)
+{
+  uint32_t h = 2166136261u;
+  for (int i = 0; i < 4; i++) h = (h ^ static_cast<uint32_t>(key[i])) * 16777619u;
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  return h;
+}
+
+soshape_batch::soshape_batch(const SoCoordinateElement * coordsarg,
+                             const SbVec3f * normalsarg,
+                             const int numvertexhint)
+  : coords(coordsarg),
+    normals(normalsarg),
+    numvertices(0)
+{
+  int size = 256;
+  while (size < numvertexhint * 2) size <<= 1;
+  this->rehash(size);
+}
+
+void
+soshape_batch::rehash(const int size)
+{
+  this->table.truncate(0);
+  for (int i = 0; i < size; i++) this->table.append(-1);
+  int32_t * t = const_cast<int32_t *>(this->table.getArrayPtr());
+
+  const int mask = size - 1;
+  const int32_t * k = this->keys.getArrayPtr();
+  for (int i = 0; i < this->numvertices; i++) {
+    int slot = static_cast<int>(soshape_batch_hash(k + i * 4)) & mask;
+    while (t[slot] >= 0) slot = (slot + 1) & mask;
+    t[slot] = i;
+  }
+}
+
+int32_t
+soshape_batch::vertex(const int32_t coordidx, const int32_t normalidx,
+                      const int32_t texidx, const int32_t matidx)
+{
+  if ((this->numvertices + 1) * 2 > this->table.getLength()) {
+    this->rehash(this->table.getLength() * 2);
+  }
+  const int32_t key[4] = {
+    coordidx,
+    normalidx < 0 ? -1 : normalidx,
+    texidx < 0 ? -1 : texidx,
+    matidx
+  };
+  int32_t * t = const_cast<int32_t *>(this->table.getArrayPtr());
+  const int mask = this->table.getLength() - 1;
+  int slot = static_cast<int>(soshape_batch_hash(key)) & mask;
+  for (;;) {
+    const int32_t idx = t[slot];
+    if (idx < 0) break;
+    const int32_t * k = this->keys.getArrayPtr() + idx * 4;
+    if (k[0] == key[0] && k[1] == key[1] && k[2] == key[2] && k[3] == key[3]) {
+      return idx;
+    }
+    slot = (slot + 1) & mask;
+  }
+  t[slot] = this->numvertices;
+  for (int i = 0; i < 4; i++) this->keys.append(key[i]);
+  return this->numvertices++;
+}
+
+void
+soshape_batch::send(SoCallbackAction * action, const SoShape * shape,
+                    SoTextureCoordinateBundle & tb)
+{
+  const int n = this->numvertices;
+  SbVec3f * points = new SbVec3f[n];
+  SbVec3f * norms = new SbVec3f[n];
+  SbVec4f * texcoords = new SbVec4f[n];
+  int32_t * materials = new int32_t[n];
+
+  const SbVec3f defaultnormal(0.0f, 0.0f, 1.0f);
+  const SbVec4f defaulttexcoord(0.0f, 0.0f, 0.0f, 1.0f);
+  const SbBool texfunc = tb.needCoordinates() && tb.isFunction();
+
+  const int32_t * k = this->keys.getArrayPtr();
+  for (int i = 0; i < n; i++, k += 4) {
+    points[i] = this->coords->get3(k[0]);
+    norms[i] = k[1] >= 0 ? this->normals[k[1]] : defaultnormal;
+    if (!texfunc) texcoords[i] = k[2] >= 0 ? tb.get(k[2]) : defaulttexcoord;
+    materials[i] = k[3];
+  }
+  // texture coordinate functions only depend on the point and
+  // normal, so they can be evaluated for the merged vertices
+  if (texfunc) tb.get(n, points, norms, texcoords);
+
+  action->invokeTriangleBatchCallbacks(shape, n, points, norms,
+                                       texcoords, materials,
+                                       this->indices.getLength() / 3,
+                                       this->indices.getArrayPtr());
+  delete[] materials;
+  delete[] texcoords;
+  delete[] norms;
+  delete[] points;
+}
@@ -0,0 +1,86 @@
+#ifndef COIN_SOSHAPE_BATCH_H
+#define COIN_SOSHAPE_BATCH_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/lists/SbList.h>
+#include <Inventor/SbVec3f.h>
+#include <Inventor/SbVec4f.h>
+
+// Private class used by the vertex shapes to build the arrays for the
+// SoCallbackAction triangle batch callbacks directly from their
+// coordinate and index fields. Vertices are merged on their
+// coordinate, normal, texture coordinate and material indices.
+
+class SoCallbackAction;
+class SoCoordinateElement;
+class SoShape;
+class SoTextureCoordinateBundle;
+
+class soshape_batch {
+public:
+  soshape_batch(const SoCoordinateElement * coords,
+                const SbVec3f * normals,
+                const int numvertexhint);
+
+  // a negative normalidx gives the default normal, and a negative
+  // texidx the default texture coordinate
+  int32_t vertex(const int32_t coordidx, const int32_t normalidx,
+                 const int32_t texidx, const int32_t matidx);
+  void triangle(const int32_t v0, const int32_t v1, const int32_t v2) {
+    this->indices.append(v0);
+    this->indices.append(v1);
+    this->indices.append(v2);
+  }
+  void send(SoCallbackAction * action, const SoShape * shape,
+            SoTextureCoordinateBundle & tb);
+
+private:
+  void rehash(const int size);
+
+  const SoCoordinateElement * coords;
+  const SbVec3f * normals;
+
+  // open addressing table with vertex indices, at most half full
+  SbList <int32_t> table;
+  // the four indices each vertex was created from
+  SbList <int32_t> keys;
+  SbList <int32_t> indices;
+  int numvertices;
+};
+
+#endif // !COIN_SOSHAPE_BATCH_H
@@ -0,0 +1,393 @@
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#include "shapenodes/soshape_bbox.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <cfloat>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define SOSHAPE_BBOX_SSE 1
+#include <xmmintrin.h>
+#endif
+
+#ifdef HAVE_THREADS
+#include <thread>
+#include <Inventor/C/threads/condvar.h>
+#include <Inventor/C/threads/mutex.h>
+#include <Inventor/C/threads/sched.h>
+#include "threads/threadsutilp.h"
+#include "tidbitsp.h"
+#endif // HAVE_THREADS
+
+#include <Inventor/SbBox3f.h>
+#include <Inventor/SbVec3f.h>
+
+// arrays with more elements than this are split over several threads
+#define SOSHAPE_BBOX_PARALLEL_LIMIT (1 << 20)
+#define SOSHAPE_BBOX_MAXTHREADS 8
+// the sums are accumulated in float for this many elements at a
+// time, and then added to double sums
+#define SOSHAPE_BBOX_SUMBLOCK 4096
+
+// NaN coordinates are skipped, like in SbBox3f::extendBy(). The
+// operand order matters: _mm_min_ps(), _mm_max_ps() and SbMin()
+// return their second operand when either one is NaN, so the new
+// value goes first, while SbMax() returns its first operand, so the
+// new value goes last.
+typedef struct {
+  const SbVec3f * coords;
+  int numcoords;
+  const int32_t * indices; // NULL for contiguous coordinates
+  int start;
+  int end;
+
+  float min[3];
+  float max[3];
+  double sum[3];
+  int num;
+  SbBool outofbounds;
+} soshape_bbox_range;
+
+#ifdef SOSHAPE_BBOX_SSE
+
+// Contiguous coordinates. Four points are read as three vectors
+// (x0 y0 z0 x1) (y1 z1 x2 y2) (z2 x3 y3 z3), which are reduced
+// separately and sorted out at the end.
+static void
+soshape_bbox_reduce_array(soshape_bbox_range * r)
+{
+  const float * ptr = r->coords[r->start].getValue();
+  int num = r->end - r->start;
+
+  __m128 min0 = _mm_set1_ps(FLT_MAX), min1 = min0, min2 = min0;
+  __m128 max0 = _mm_set1_ps(-FLT_MAX), max1 = max0, max2 = max0;
+  float mins[12], maxs[12], sums[12];
+
+  while (num >= 4) {
+    __m128 sum0 = _mm_setzero_ps(), sum1 = sum0, sum2 = sum0;
+    const int blocknum = SbMin(num, SOSHAPE_BBOX_SUMBLOCK) & ~3;
+    const float * blockend = ptr + blocknum * 3;
+    for (; ptr < blockend; ptr += 12) {
+      const __m128 v0 = _mm_loadu_ps(ptr);
+      const __m128 v1 = _mm_loadu_ps(ptr + 4);
+      const __m128 v2 = _mm_loadu_ps(ptr + 8);
+      min0 = _mm_min_ps(v0, min0); max0 = _mm_max_ps(v0, max0); sum0 = _mm_add_ps(sum0, v0);
+      min1 = _mm_min_ps(v1, min1); max1 = _mm_max_ps(v1, max1); sum1 = _mm_add_ps(sum1, v1);
+      min2 = _mm_min_ps(v2, min2); max2 = _mm_max_ps(v2, max2); sum2 = _mm_add_ps(sum2, v2);
+    }
+    _mm_storeu_ps(sums, sum0);
+    _mm_storeu_ps(sums + 4, sum1);
+    _mm_storeu_ps(sums + 8, sum2);
+    for (int i = 0; i < 12; i++) r->sum[i % 3] += sums[i];
+    num -= blocknum;
+  }
+  _mm_storeu_ps(mins, min0); _mm_storeu_ps(mins + 4, min1); _mm_storeu_ps(mins + 8, min2);
+  _mm_storeu_ps(maxs, max0); _mm_storeu_ps(maxs + 4, max1); _mm_storeu_ps(maxs + 8, max2);
+  for (int i = 0; i < 12; i++) {
+    r->min[i % 3] = SbMin(mins[i], r->min[i % 3]);
+    r->max[i % 3] = SbMax(r->max[i % 3], maxs[i]);
+  }
+
+  for (; num > 0; num--, ptr += 3) {
+    for (int j = 0; j < 3; j++) {
+      r->min[j] = SbMin(ptr[j], r->min[j]);
+      r->max[j] = SbMax(r->max[j], ptr[j]);
+      r->sum[j] += ptr[j];
+    }
+  }
+  r->num = r->end - r->start;
+}
+
+static void
+soshape_bbox_reduce_indexed(soshape_bbox_range * r)
+{
+  __m128 minv = _mm_set1_ps(FLT_MAX);
+  __m128 maxv = _mm_set1_ps(-FLT_MAX);
+  float tmp[4];
+
+  const int32_t * ptr = r->indices + r->start;
+  const int32_t * endptr = r->indices + r->end;
+  while (ptr < endptr) {
+    __m128 sumv = _mm_setzero_ps();
+    const int32_t * blockend = ptr + SbMin(static_cast<int>(endptr - ptr), SOSHAPE_BBOX_SUMBLOCK);
+    for (; ptr < blockend; ptr++) {
+      const int idx = *ptr;
+      if (idx < 0) continue;
+      if (idx >= r->numcoords) { r->outofbounds = TRUE; continue; }
+      const float * c = r->coords[idx].getValue();
+      const __m128 v = _mm_setr_ps(c[0], c[1], c[2], 0.0f);
+      minv = _mm_min_ps(v, minv);
+      maxv = _mm_max_ps(v, maxv);
+      sumv = _mm_add_ps(sumv, v);
+      r->num++;
+    }
+    _mm_storeu_ps(tmp, sumv);
+    for (int j = 0; j < 3; j++) r->sum[j] += tmp[j];
+  }
+  _mm_storeu_ps(tmp, minv);
+  for (int j = 0; j < 3; j++) r->min[j] = SbMin(tmp[j], r->min[j]);
+  _mm_storeu_ps(tmp, maxv);
+  for (int j = 0; j < 3; j++) r->max[j] = SbMax(r->max[j], tmp[j]);
+}
+
+#else // !SOSHAPE_BBOX_SSE
+
+static void
+soshape_bbox_reduce_array(soshape_bbox_range * r)
+{
+  float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+  float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+  for (int i = r->start; i < r->end; ) {
+    float sum[3] = { 0.0f, 0.0f, 0.0f };
+    const int blockend = SbMin(r->end, i + SOSHAPE_BBOX_SUMBLOCK);
+    for (; i < blockend; i++) {
+      const float * c = r->coords[i].getValue();
+      for (int j = 0; j < 3; j++) {
+        min[j] = SbMin(c[j], min[j]);
+        max[j] = SbMax(max[j], c[j]);
+        sum[j] += c[j];
+      }
+    }
+    for (int j = 0; j < 3; j++) r->sum[j] += sum[j];
+  }
+  for (int j = 0; j < 3; j++) {
+    r->min[j] = SbMin(min[j], r->min[j]);
+    r->max[j] = SbMax(r->max[j], max[j]);
+  }
+  r->num = r->end - r->start;
+}
+
+static void
+soshape_bbox_reduce_indexed(soshape_bbox_range * r)
+{
+  float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+  float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+  for (int i = r->start; i < r->end; ) {
+    float sum[3] = { 0.0f, 0.0f, 0.0f };
+    const int blockend = SbMin(r->end, i + SOSHAPE_BBOX_SUMBLOCK);
+    for (; i < blockend; i++) {
+      const int idx = r->indices[i];
+      if (idx < 0) continue;
+      if (idx >= r->numcoords) { r->outofbounds = TRUE; continue; }
+      const float * c = r->coords[idx].getValue();
+      for (int j = 0; j < 3; j++) {
+        min[j] = SbMin(c[j], min[j]);
+        max[j] = SbMax(max[j], c[j]);
+        sum[j] += c[j];
+      }
+      r->num++;
+    }
+    for (int j = 0; j < 3; j++) r->sum[j] += sum[j];
+  }
+  for (int j = 0; j < 3; j++) {
+    r->min[j] = SbMin(min[j], r->min[j]);
+    r->max[j] = SbMax(r->max[j], max[j]);
+  }
+}
+
+#endif // !SOSHAPE_BBOX_SSE
+
+static void
+soshape_bbox_reduce(soshape_bbox_range * r)
+{
+  if (r->indices) soshape_bbox_reduce_indexed(r);
+  else soshape_bbox_reduce_array(r);
+}
+
+#ifdef HAVE_THREADS
+
+// Worker threads shared by all bbox reductions. Created on first use
+// and kept until exit.
+static cc_sched * soshape_bbox_sched = NULL;
+
+static void
+soshape_bbox_cleanup(void)
+{
+  if (soshape_bbox_sched) {
+    cc_sched_destruct(soshape_bbox_sched);
+    soshape_bbox_sched = NULL;
+  }
+}
+
+static cc_sched *
+soshape_bbox_get_sched(const int numthreads)
+{
+  CC_GLOBAL_LOCK;
+  if (soshape_bbox_sched == NULL) {
+    soshape_bbox_sched = cc_sched_construct(numthreads);
+    coin_atexit(soshape_bbox_cleanup, CC_ATEXIT_NORMAL);
+  }
+  CC_GLOBAL_UNLOCK;
+  return soshape_bbox_sched;
+}
+
+// The ranges of one soshape_bbox_run() call. The scheduler is
+// shared, so the caller waits for its own jobs only.
+typedef struct {
+  cc_mutex * mutex;
+  cc_condvar * done;
+  int remaining;
+} soshape_bbox_batch;
+
+typedef struct {
+  soshape_bbox_range * range;
+  soshape_bbox_batch * batch;
+} soshape_bbox_job;
+
+static void
+soshape_bbox_job_cb(void * closure)
+{
+  soshape_bbox_job * job = static_cast<soshape_bbox_job *>(closure);
+  soshape_bbox_reduce(job->range);
+
+  soshape_bbox_batch * batch = job->batch;
+  cc_mutex_lock(batch->mutex);
+  if (--batch->remaining == 0) cc_condvar_wake_all(batch->done);
+  cc_mutex_unlock(batch->mutex);
+}
+
+#endif // HAVE_THREADS
+
+// Reduces elements [0, num> of coords or indices, and extends box
+// by the result.
+static SbBool
+soshape_bbox_run(const SbVec3f * coords, const int numcoords,
+                 const int32_t * indices, const int num,
+                 SbBox3f & box, SbVec3f & center)
+{
+  int numthreads = 1;
+#ifdef HAVE_THREADS
+  static const int numcpus = static_cast<int>(std::thread::hardware_concurrency());
+  if (num >= SOSHAPE_BBOX_PARALLEL_LIMIT) {
+    numthreads = SbClamp(SbMin(numcpus, num / (SOSHAPE_BBOX_PARALLEL_LIMIT / 2)),
+                         1, SOSHAPE_BBOX_MAXTHREADS);
+  }
+#endif // HAVE_THREADS
+
+  soshape_bbox_range ranges[SOSHAPE_BBOX_MAXTHREADS];
+  for (int i = 0; i < numthreads; i++) {
+    soshape_bbox_range & r = ranges[i];
+    r.coords = coords;
+    r.numcoords = numcoords;
+    r.indices = indices;
+    r.start = static_cast<int>((static_cast<int64_t>(num) * i) / numthreads);
+    r.end = static_cast<int>((static_cast<int64_t>(num) * (i + 1)) / numthreads);
+    for (int j = 0; j < 3; j++) {
+      r.min[j] = FLT_MAX;
+      r.max[j] = -FLT_MAX;
+      r.sum[j] = 0.0;
+    }
+    r.num = 0;
+    r.outofbounds = FALSE;
+  }
+
+#ifdef HAVE_THREADS
+  cc_sched * sched = NULL;
+  if (numthreads > 1) {
+    sched = soshape_bbox_get_sched(SbClamp(numcpus - 1, 1, SOSHAPE_BBOX_MAXTHREADS - 1));
+  }
+  if (sched) {
+    // the calling thread takes the first range
+    soshape_bbox_batch batch;
+    batch.mutex = cc_mutex_construct();
+    batch.done = cc_condvar_construct();
+    batch.remaining = numthreads - 1;
+    soshape_bbox_job jobs[SOSHAPE_BBOX_MAXTHREADS];
+    for (int i = 1; i < numthreads; i++) {
+      jobs[i].range = &ranges[i];
+      jobs[i].batch = &batch;
+      (void) cc_sched_schedule(sched, soshape_bbox_job_cb, &jobs[i], 0);
+    }
+    soshape_bbox_reduce(&ranges[0]);
+    cc_mutex_lock(batch.mutex);
+    while (batch.remaining > 0) cc_condvar_wait(batch.done, batch.mutex);
+    cc_mutex_unlock(batch.mutex);
+    cc_condvar_destruct(batch.done);
+    cc_mutex_destruct(batch.mutex);
+  }
+  else {
+    for (int i = 0; i < numthreads; i++) soshape_bbox_reduce(&ranges[i]);
+  }
+#else // !HAVE_THREADS
+  soshape_bbox_reduce(&ranges[0]);
+#endif // !HAVE_THREADS
+
+  SbVec3f min, max;
+  double sum[3] = { 0.0, 0.0, 0.0 };
+  int total = 0;
+  SbBool ok = TRUE;
+  for (int i = 0; i < numthreads; i++) {
+    const soshape_bbox_range & r = ranges[i];
+    for (int j = 0; j < 3; j++) {
+      min[j] = i ? SbMin(min[j], r.min[j]) : r.min[j];
+      max[j] = i ? SbMax(max[j], r.max[j]) : r.max[j];
+      sum[j] += r.sum[j];
+    }
+    total += r.num;
+    if (r.outofbounds) ok = FALSE;
+  }
+
+  center.setValue(0.0f, 0.0f, 0.0f);
+  if (total > 0) {
+    box.extendBy(SbBox3f(min, max));
+    center.setValue(static_cast<float>(sum[0] / total),
+                    static_cast<float>(sum[1] / total),
+                    static_cast<float>(sum[2] / total));
+  }
+  return ok;
+}
+
+void
+soshape_bbox::compute(const SbVec3f * coords, const int num,
+                      SbBox3f & box, SbVec3f & center)
+{
+  (void) soshape_bbox_run(coords, num, NULL, num, box, center);
+}
+
+SbBool
+soshape_bbox::computeIndexed(const SbVec3f * coords, const int numcoords,
+                             const int32_t * indices, const int numindices,
+                             SbBox3f & box, SbVec3f & center)
+{
+  return soshape_bbox_run(coords, numcoords, indices, numindices, box, center);
+}
+
+#undef SOSHAPE_BBOX_SUMBLOCK
+#undef SOSHAPE_BBOX_MAXTHREADS
+#undef SOSHAPE_BBOX_PARALLEL_LIMIT
+#ifdef SOSHAPE_BBOX_SSE
+#undef SOSHAPE_BBOX_SSE
+#endif // SOSHAPE_BBOX_SSE
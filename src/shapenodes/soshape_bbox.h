@@ -0,0 +1,65 @@
+#ifndef COIN_SOSHAPE_BBOX_H
+#define COIN_SOSHAPE_BBOX_H
+
+/**************************************************************************\
+ * Copyright (c) Kongsberg Oil & Gas Technologies AS
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ * 
+ * Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 
+ * Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+\**************************************************************************/
+
+#ifndef COIN_INTERNAL
+#error this is a private header file
+#endif /* !COIN_INTERNAL */
+
+#include <Inventor/SbBasic.h>
+
+class SbBox3f;
+class SbVec3f;
+
+// Bounding box and center of coordinate arrays, for the computeBBox()
+// methods of the vertex shapes. The arrays are reduced with SSE when
+// available, and split over the worker threads of a shared scheduler
+// when very large.
+
+class soshape_bbox {
+public:
+  // Extends the (empty) box by coords[0] to coords[num - 1], and sets
+  // center to the average of the coordinates.
+  static void compute(const SbVec3f * coords, const int num,
+                      SbBox3f & box, SbVec3f & center);
+
+  // As above, for the coordinates referenced by indices. Negative
+  // indices are skipped, and so are indices >= numcoords, which make
+  // the function return FALSE.
+  static SbBool computeIndexed(const SbVec3f * coords, const int numcoords,
+                               const int32_t * indices, const int numindices,
+                               SbBox3f & box, SbVec3f & center);
+};
+
+#endif // !COIN_SOSHAPE_BBOX_H
@@ -38,17 +38,25 @@
 #include "config.h"
 #endif // HAVE_CONFIG_H
 
+#include <cstdlib>
+#include <cmath>
+
 #include <Inventor/C/glue/gl.h>
+#include <Inventor/C/tidbits.h>
 #include <Inventor/SbMatrix.h>
 #include <Inventor/details/SoPointDetail.h>
 #include <Inventor/elements/SoBumpMapElement.h>
 #include <Inventor/elements/SoBumpMapMatrixElement.h>
 #include <Inventor/elements/SoCacheElement.h>
+#include <Inventor/elements/SoEnvironmentElement.h>
 #include <Inventor/elements/SoGLCacheContextElement.h>
 #include <Inventor/elements/SoGLDisplayList.h>
+#include <Inventor/elements/SoGLLazyElement.h>
+#include <Inventor/elements/SoGLShaderProgramElement.h>
 #include <Inventor/elements/SoGLMultiTextureImageElement.h>
 #include <Inventor/elements/SoGLMultiTextureEnabledElement.h>
 #include <Inventor/elements/SoLazyElement.h>
+#include <Inventor/elements/SoLightElement.h>
 #include <Inventor/elements/SoModelMatrixElement.h>
 #include <Inventor/elements/SoMultiTextureCoordinateElement.h>
 #include <Inventor/elements/SoMultiTextureEnabledElement.h>
@@ -58,6 +66,7 @@
 #include <Inventor/elements/SoViewVolumeElement.h>
 #include <Inventor/elements/SoViewingMatrixElement.h>
 #include <Inventor/errors/SoDebugError.h>
+#include <Inventor/misc/SoContextHandler.h>
 #include <Inventor/misc/SoGLImage.h>
 #include <Inventor/misc/SoState.h>
 #include <Inventor/misc/SoGLDriverDatabase.h>
@@ -66,9 +75,16 @@
 #include <Inventor/nodes/SoSpotLight.h>
 #include <Inventor/caches/SoPrimitiveVertexCache.h>
 
+#ifdef HAVE_VRML97
+#include <Inventor/VRMLnodes/SoVRMLLight.h>
+#endif // HAVE_VRML97
+
 // For coin_apply_normalization_cube_map().
 #include "glue/glp.h"
 #include "rendering/SoGL.h"
+#include "shaders/SoGLShaderProgram.h"
+#include "threads/threadsutilp.h"
+#include "tidbitsp.h"
 
 // *************************************************************************
 
@@ -223,6 +239,98 @@ static const char * normalrenderingvpprogram =
 " MOV result.color, v19;\n"
 "END\n";
 
+// GLSL vertex shader for single pass bump mapping. The tangent frame
+// is passed in texture units 2 and 3, and the light vectors are
+// calculated per fragment.
+static const char * bumpglslvertexshader =
+"varying vec3 objpos;\n"
+"varying vec3 ecpos;\n"
+"varying vec3 stangent;\n"
+"varying vec3 ttangent;\n"
+"varying vec3 normal;\n"
+"void main(void)\n"
+"{\n"
+"  objpos = gl_Vertex.xyz;\n"
+"  vec4 ec = gl_ModelViewMatrix * gl_Vertex;\n"
+"  ecpos = ec.xyz / ec.w;\n"
+"  stangent = gl_MultiTexCoord2.xyz;\n"
+"  ttangent = gl_MultiTexCoord3.xyz;\n"
+"  normal = gl_Normal;\n"
+"  gl_TexCoord[0] = gl_TextureMatrix[0] * gl_MultiTexCoord0;\n"
+"  gl_TexCoord[1] = gl_TextureMatrix[1] * gl_MultiTexCoord1;\n"
+"  gl_FrontColor = gl_Color;\n"
+"  gl_Position = ftransform();\n"
+"}\n";
+
+// GLSL fragment shader for single pass bump mapping. Diffuse and
+// specular contributions from all lights are accumulated in one
+// pass. Lights are specified in object space, with w == 0 for
+// directional lights. Attenuation and spot light cones are
+// calculated in eye space, like fixed function lighting does, with
+// the attenuation as (constant, linear, quadratic), and the spot
+// light direction and cosine of the cutoff angle in lightspot. The
+// cosine is -1 for lights which are not spot lights. The ambient
+// contribution of all lights and the environment is precalculated
+// into one color.
+static const char * bumpglslfragmentshader =
+"#define MAXLIGHTS 8\n"
+"uniform sampler2D bumpmap;\n"
+"uniform sampler2D texturemap;\n"
+"uniform int hastexture;\n"
+"uniform vec4 lightpos[MAXLIGHTS];\n"
+"uniform vec3 lightdiffuse[MAXLIGHTS];\n"
+"uniform vec3 lighteyepos[MAXLIGHTS];\n"
+"uniform vec3 lightattenuation[MAXLIGHTS];\n"
+"uniform vec4 lightspot[MAXLIGHTS];\n"
+"uniform float lightspotexponent[MAXLIGHTS];\n"
+"uniform int numlights;\n"
+"uniform vec3 ambient;\n"
+"uniform vec3 eyepos;\n"
+"uniform vec3 specular;\n"
+"uniform float shininess;\n"
+"varying vec3 objpos;\n"
+"varying vec3 ecpos;\n"
+"varying vec3 stangent;\n"
+"varying vec3 ttangent;\n"
+"varying vec3 normal;\n"
+"void main(void)\n"
+"{\n"
+"  vec3 bump = texture2D(bumpmap, gl_TexCoord[1].xy).xyz * 2.0 - 1.0;\n"
+"  vec3 s = normalize(stangent);\n"
+"  vec3 t = normalize(ttangent);\n"
+"  vec3 n = normalize(normal);\n"
+"  vec3 eye = normalize(eyepos - objpos);\n"
+"  eye = vec3(dot(s, eye), dot(t, eye), dot(n, eye));\n"
+"  vec3 diffuse = vec3(0.0);\n"
+"  vec3 spec = vec3(0.0);\n"
+"  for (int i = 0; i < MAXLIGHTS; i++) {\n"
+"    if (i < numlights) {\n"
+"      vec3 l = lightpos[i].xyz;\n"
+"      float att = 1.0;\n"
+"      if (lightpos[i].w != 0.0) {\n"
+"        l = normalize(l - objpos);\n"
+"        vec3 el = lighteyepos[i] - ecpos;\n"
+"        float d = length(el);\n"
+"        att = 1.0 / (lightattenuation[i].x + lightattenuation[i].y * d +\n"
+"                     lightattenuation[i].z * d * d);\n"
+"        if (lightspot[i].w > -1.0) {\n"
+"          float c = dot(-el / d, lightspot[i].xyz);\n"
+"          att = (c < lightspot[i].w) ? 0.0 : att * pow(max(c, 0.0001), lightspotexponent[i]);\n"
+"        }\n"
+"      }\n"
+"      l = normalize(vec3(dot(s, l), dot(t, l), dot(n, l)));\n"
+"      float ndotl = dot(bump, l);\n"
+"      if (ndotl > 0.0) {\n"
+"        diffuse += att * lightdiffuse[i] * ndotl;\n"
+"        spec += att * lightdiffuse[i] * pow(max(dot(bump, normalize(l + eye)), 0.0001), shininess);\n"
+"      }\n"
+"    }\n"
+"  }\n"
+"  vec4 color = vec4(min(ambient + gl_Color.rgb * diffuse, 1.0), gl_Color.a);\n"
+"  if (hastexture != 0) color *= texture2D(texturemap, gl_TexCoord[0].xy);\n"
+"  gl_FragColor = vec4(color.rgb + specular * spec, color.a);\n"
+"}\n";
+
 // *************************************************************************
 
 SbBool bumphack = TRUE;
@@ -259,10 +367,12 @@ soshape_bumprender::soshape_bumprender(void)
 {
   this->diffuseprogramsinitialized = FALSE;
   this->programsinitialized = FALSE;
+  this->tangentcache = NULL;
 }
 
 soshape_bumprender::~soshape_bumprender()
 {
+  if (this->tangentcache) this->tangentcache->unref();
 
   // FIXME: Cannot delete programs just yet, as we dont know if the
   // context was valid or not. We must wait for new functionality to be
@@ -406,6 +516,403 @@ soshape_bumprender::initPrograms(const cc_glglue * glue, SoState * state)
   this->programsinitialized = TRUE;
 }
 
+// The GLSL program is shared by all bump mapped shapes. The
+// cc_glglue instance of each context points to the program for that
+// context, which is only used while rendering in that context, so it
+// needs no lock. The programs are also kept in this table, which is
+// protected by the global lock, to free them when the context is
+// destructed, or at exit.
+static SbHash<uint32_t, void *> * soshape_bumprender_glslprograms = NULL;
+
+void
+soshape_bumprender::glslprogramdeletion(uint32_t contextid, void * COIN_UNUSED_ARG(closure))
+{
+  void * ptr = NULL;
+  CC_GLOBAL_LOCK;
+  if (soshape_bumprender_glslprograms &&
+      soshape_bumprender_glslprograms->get(contextid, ptr)) {
+    (void) soshape_bumprender_glslprograms->erase(contextid);
+  }
+  CC_GLOBAL_UNLOCK;
+  if (ptr) {
+    // the context is current, and the cc_glglue instance is
+    // destructed after the callbacks
+    glsl_programidx * pidx = (glsl_programidx *) ptr;
+    if (pidx->program) pidx->glue->glDeleteObjectARB(pidx->program);
+    ((cc_glglue *) pidx->glue)->bumpprogram = NULL;
+    delete pidx;
+  }
+}
+
+void
+soshape_bumprender::glslprogramcleanup(void)
+{
+  SoContextHandler::removeContextDestructionCallback(soshape_bumprender::glslprogramdeletion, NULL);
+  // no context is current, so the GL programs can't be deleted
+  for (SbHash<uint32_t, void *>::const_iterator iter =
+         soshape_bumprender_glslprograms->const_begin();
+       iter != soshape_bumprender_glslprograms->const_end();
+       ++iter) {
+    delete (glsl_programidx *) iter->obj;
+  }
+  delete soshape_bumprender_glslprograms;
+  soshape_bumprender_glslprograms = NULL;
+}
+
+soshape_bumprender::glsl_programidx *
+soshape_bumprender::getGLSLProgram(const cc_glglue * glue)
+{
+  glsl_programidx * pidx = (glsl_programidx *) glue->bumpprogram;
+  if (pidx) return pidx;
+
+  pidx = new glsl_programidx;
+  pidx->glue = glue;
+  pidx->program = 0;
+
+  COIN_GLhandle vs = glue->glCreateShaderObjectARB(GL_VERTEX_SHADER_ARB);
+  COIN_GLhandle fs = glue->glCreateShaderObjectARB(GL_FRAGMENT_SHADER_ARB);
+  glue->glShaderSourceARB(vs, 1, (const COIN_GLchar **) &bumpglslvertexshader, NULL);
+  glue->glShaderSourceARB(fs, 1, (const COIN_GLchar **) &bumpglslfragmentshader, NULL);
+  glue->glCompileShaderARB(vs);
+  glue->glCompileShaderARB(fs);
+
+  GLint vsok = 0, fsok = 0, linkok = 0;
+  glue->glGetObjectParameterivARB(vs, GL_OBJECT_COMPILE_STATUS_ARB, &vsok);
+  glue->glGetObjectParameterivARB(fs, GL_OBJECT_COMPILE_STATUS_ARB, &fsok);
+  if (vsok && fsok) {
+    COIN_GLhandle program = glue->glCreateProgramObjectARB();
+    glue->glAttachObjectARB(program, vs);
+    glue->glAttachObjectARB(program, fs);
+    glue->glLinkProgramARB(program);
+    glue->glGetObjectParameterivARB(program, GL_OBJECT_LINK_STATUS_ARB, &linkok);
+    if (linkok) pidx->program = program;
+    else glue->glDeleteObjectARB(program);
+  }
+  // the shader objects are freed when the program is deleted
+  glue->glDeleteObjectARB(vs);
+  glue->glDeleteObjectARB(fs);
+
+  if (pidx->program) {
+    const COIN_GLhandle p = pidx->program;
+    pidx->lightpos = glue->glGetUniformLocationARB(p, "lightpos");
+    pidx->lightdiffuse = glue->glGetUniformLocationARB(p, "lightdiffuse");
+    pidx->lighteyepos = glue->glGetUniformLocationARB(p, "lighteyepos");
+    pidx->lightattenuation = glue->glGetUniformLocationARB(p, "lightattenuation");
+    pidx->lightspot = glue->glGetUniformLocationARB(p, "lightspot");
+    pidx->lightspotexponent = glue->glGetUniformLocationARB(p, "lightspotexponent");
+    pidx->numlights = glue->glGetUniformLocationARB(p, "numlights");
+    pidx->ambient = glue->glGetUniformLocationARB(p, "ambient");
+    pidx->eyepos = glue->glGetUniformLocationARB(p, "eyepos");
+    pidx->specular = glue->glGetUniformLocationARB(p, "specular");
+    pidx->shininess = glue->glGetUniformLocationARB(p, "shininess");
+    pidx->bumpmap = glue->glGetUniformLocationARB(p, "bumpmap");
+    pidx->texturemap = glue->glGetUniformLocationARB(p, "texturemap");
+    pidx->hastexture = glue->glGetUniformLocationARB(p, "hastexture");
+  }
+  else {
+    SoDebugError::postWarning("soshape_bumprender::getGLSLProgram",
+                              "Unable to compile bump mapping shaders. "
+                              "Falling back to multipass rendering.");
+  }
+
+  CC_GLOBAL_LOCK;
+  if (soshape_bumprender_glslprograms == NULL) {
+    soshape_bumprender_glslprograms = new SbHash<uint32_t, void *>;
+    SoContextHandler::addContextDestructionCallback(soshape_bumprender::glslprogramdeletion, NULL);
+    coin_atexit((coin_atexit_f *) soshape_bumprender::glslprogramcleanup, CC_ATEXIT_NORMAL);
+  }
+  (void) soshape_bumprender_glslprograms->put(glue->contextid, pidx);
+  CC_GLOBAL_UNLOCK;
+  ((cc_glglue *) glue)->bumpprogram = pidx;
+  return pidx;
+}
+
+//
+// Returns TRUE if the shape can be bump mapped in a single pass with
+// the GLSL program. The program only supports a 2D modulated texture
+// in unit 0, and is not used if the application has enabled its own
+// shader program.
+//
+SbBool
+soshape_bumprender::canRenderSinglePass(SoState * state, const int numlights)
+{
+  static int multipass = -1;
+  if (multipass < 0) {
+    const char * env = coin_getenv("COIN_BUMPMAP_MULTIPASS");
+    multipass = env ? atoi(env) : 0;
+  }
+  if (multipass || numlights > MAXLIGHTS) return FALSE;
+
+  const cc_glglue * glue = sogl_glue_instance(state);
+  if (!SoGLDriverDatabase::isSupported(glue, SO_GL_ARB_SHADER_OBJECT)) return FALSE;
+  // the tangent frames are sent in texture units 2 and 3
+  if (cc_glglue_max_texture_units(glue) < 4) return FALSE;
+
+  SoGLShaderProgram * prog = SoGLShaderProgramElement::get(state);
+  if (prog && prog->isEnabled()) return FALSE;
+
+  int lastenabled;
+  (void) SoMultiTextureEnabledElement::getEnabledUnits(state, lastenabled);
+  if (lastenabled > 0) return FALSE;
+  if (lastenabled == 0) {
+    if (SoMultiTextureEnabledElement::getMode(state, 0) !=
+        SoMultiTextureEnabledElement::TEXTURE2D) return FALSE;
+    SoMultiTextureImageElement::Model model;
+    SbColor blendcolor;
+    (void) SoGLMultiTextureImageElement::get(state, 0, model, blendcolor);
+    if (model != SoMultiTextureImageElement::MODULATE) return FALSE;
+  }
+  return soshape_bumprender::getGLSLProgram(glue)->program != 0;
+}
+
+//
+// Returns the diffuse and ambient color of a light, as sent to GL by
+// the light node. Only VRML97 lights have an ambient contribution.
+//
+static void
+soshape_bumprender_getlightcolors(SoNode * light, SbColor & diffuse, SbColor & ambient)
+{
+  diffuse.setValue(1.0f, 1.0f, 1.0f);
+  ambient.setValue(0.0f, 0.0f, 0.0f);
+  if (light->isOfType(SoLight::getClassTypeId())) {
+    SoLight * l = (SoLight*) light;
+    diffuse = l->color.getValue() * l->intensity.getValue();
+  }
+#ifdef HAVE_VRML97
+  else if (light->isOfType(SoVRMLLight::getClassTypeId())) {
+    SoVRMLLight * l = (SoVRMLLight*) light;
+    diffuse = l->color.getValue() * l->intensity.getValue();
+    ambient = l->color.getValue() * l->ambientIntensity.getValue();
+  }
+#endif // HAVE_VRML97
+}
+
+//
+// Returns the eye space position, attenuation (constant, linear,
+// quadratic), and spot direction and cosine of the cutoff angle of a
+// light, like the light node sends them to GL. lighttoeye is the
+// matrix from SoLightElement::getMatrix(), and envattenuation the
+// (quadratic, linear, constant) attenuation of SoEnvironmentElement.
+//
+static void
+soshape_bumprender_getlighteyeparams(SoNode * light,
+                                     const SbMatrix & lighttoeye,
+                                     const SbVec3f & envattenuation,
+                                     float * eyepos, float * attenuation,
+                                     float * spot, float & spotexponent)
+{
+  SbVec3f pos(0.0f, 0.0f, 0.0f);
+  attenuation[0] = 1.0f;
+  attenuation[1] = 0.0f;
+  attenuation[2] = 0.0f;
+  spot[0] = 0.0f;
+  spot[1] = 0.0f;
+  spot[2] = -1.0f;
+  spot[3] = -1.0f;
+  spotexponent = 0.0f;
+
+  SoSpotLight * spotlight = NULL;
+  if (light->isOfType(SoPointLight::getClassTypeId())) {
+    pos = ((SoPointLight*) light)->location.getValue();
+  }
+  else if (light->isOfType(SoSpotLight::getClassTypeId())) {
+    spotlight = (SoSpotLight*) light;
+    pos = spotlight->location.getValue();
+  }
+  else {
+    // no attenuation for directional lights
+    eyepos[0] = eyepos[1] = eyepos[2] = 0.0f;
+    return;
+  }
+  lighttoeye.multVecMatrix(pos, pos);
+  eyepos[0] = pos[0];
+  eyepos[1] = pos[1];
+  eyepos[2] = pos[2];
+  attenuation[0] = envattenuation[2];
+  attenuation[1] = envattenuation[1];
+  attenuation[2] = envattenuation[0];
+
+  if (spotlight) {
+    SbVec3f dir;
+    lighttoeye.multDirMatrix(spotlight->direction.getValue(), dir);
+    (void) dir.normalize();
+    const float cutoff = SbClamp(spotlight->cutOffAngle.getValue(),
+                                 0.0f, float(M_PI) / 2.0f);
+    spot[0] = dir[0];
+    spot[1] = dir[1];
+    spot[2] = dir[2];
+    spot[3] = float(cos(cutoff));
+    spotexponent = SbClamp(spotlight->dropOffRate.getValue(), 0.0f, 1.0f) * 128.0f;
+  }
+}
+
+//
+// Renders diffuse and specular bump mapping for all lights in one
+// pass. Light vectors are calculated on the GPU, using the tangent
+// frames calculated in updateTangentSpace().
+//
+void
+soshape_bumprender::renderBumpSinglePass(SoState * state,
+                                         const SoPrimitiveVertexCache * cache,
+                                         const SoNodeList & lights)
+{
+  const int n = cache->getNumTriangleIndices();
+  if (n == 0) return;
+
+  const cc_glglue * glue = sogl_glue_instance(state);
+  const glsl_programidx * pidx = soshape_bumprender::getGLSLProgram(glue);
+  assert(pidx->program);
+
+  // convert lights and eye position to this objects' object space
+  const SbMatrix toobject = (SoModelMatrixElement::get(state) *
+                             SoViewingMatrixElement::get(state)).inverse();
+  const int numlights = SbMin(lights.getLength(), (int) MAXLIGHTS);
+  float lightpos[MAXLIGHTS * 4];
+  float lightdiffuse[MAXLIGHTS * 3];
+  float lighteyepos[MAXLIGHTS * 3];
+  float lightattenuation[MAXLIGHTS * 3];
+  float lightspot[MAXLIGHTS * 4];
+  float lightspotexponent[MAXLIGHTS];
+  const SbVec3f & envattenuation = SoEnvironmentElement::getLightAttenuation(state);
+  SbColor lightambient(0.0f, 0.0f, 0.0f);
+  for (int i = 0; i < numlights; i++) {
+    const SbMatrix & lighttoeye = SoLightElement::getMatrix(state, i);
+    soshape_bumprender_getlighteyeparams(lights[i], lighttoeye, envattenuation,
+                                         &lighteyepos[i*3], &lightattenuation[i*3],
+                                         &lightspot[i*4], lightspotexponent[i]);
+    SbMatrix m = toobject;
+    m.multLeft(lighttoeye);
+    this->initLight((SoLight*) lights[i], m);
+    lightpos[i*4] = this->lightvec[0];
+    lightpos[i*4+1] = this->lightvec[1];
+    lightpos[i*4+2] = this->lightvec[2];
+    lightpos[i*4+3] = this->ispointlight ? 1.0f : 0.0f;
+
+    SbColor diffuse, ambient;
+    soshape_bumprender_getlightcolors(lights[i], diffuse, ambient);
+    lightdiffuse[i*3] = diffuse[0];
+    lightdiffuse[i*3+1] = diffuse[1];
+    lightdiffuse[i*3+2] = diffuse[2];
+    lightambient += ambient;
+  }
+  // same ambient term as fixed function lighting: the material
+  // ambient color lit by the environment and all the lights
+  SbColor ambient = SoEnvironmentElement::getAmbientColor(state);
+  ambient *= SoEnvironmentElement::getAmbientIntensity(state);
+  ambient += lightambient;
+  const SbColor & matambient = SoLazyElement::getAmbient(state);
+  for (int c = 0; c < 3; c++) ambient[c] *= matambient[c];
+  SbVec3f eyepos = SoViewVolumeElement::get(state).getProjectionPoint();
+  SoModelMatrixElement::get(state).inverse().multVecMatrix(eyepos, eyepos);
+
+  const SbColor spec = SoLazyElement::getSpecular(state);
+  const float shininess = SoLazyElement::getShininess(state);
+
+  const SbBool hastexture =
+    SoMultiTextureEnabledElement::getMode(state, 0) == SoMultiTextureEnabledElement::TEXTURE2D &&
+    cache->getTexCoordArray() != NULL;
+  const SbBool colorpervertex = cache->colorPerVertex();
+
+  // the bump map is bound to unit 1, which is disabled since
+  // canRenderSinglePass() only accepts a texture in unit 0. Its
+  // texture matrix and image are restored after rendering.
+  const SbMatrix & oldtexture1matrix = SoMultiTextureMatrixElement::get(state, 1);
+  SoGLImage * bumpimage = SoBumpMapElement::get(state);
+  assert(bumpimage);
+  cc_glglue_glActiveTexture(glue, GL_TEXTURE1);
+  glMatrixMode(GL_TEXTURE);
+  glLoadMatrixf(SoBumpMapMatrixElement::get(state)[0]);
+  glMatrixMode(GL_MODELVIEW);
+  bumpimage->getGLDisplayList(state)->call(state);
+  cc_glglue_glActiveTexture(glue, GL_TEXTURE0);
+
+  glue->glUseProgramObjectARB(pidx->program);
+  glue->glUniform1iARB(pidx->bumpmap, 1);
+  glue->glUniform1iARB(pidx->texturemap, 0);
+  glue->glUniform1iARB(pidx->hastexture, hastexture ? 1 : 0);
+  glue->glUniform1iARB(pidx->numlights, numlights);
+  if (numlights) {
+    glue->glUniform4fvARB(pidx->lightpos, numlights, lightpos);
+    glue->glUniform3fvARB(pidx->lightdiffuse, numlights, lightdiffuse);
+    glue->glUniform3fvARB(pidx->lighteyepos, numlights, lighteyepos);
+    glue->glUniform3fvARB(pidx->lightattenuation, numlights, lightattenuation);
+    glue->glUniform4fvARB(pidx->lightspot, numlights, lightspot);
+    glue->glUniform1fvARB(pidx->lightspotexponent, numlights, lightspotexponent);
+  }
+  glue->glUniform3fvARB(pidx->ambient, 1, ambient.getValue());
+  glue->glUniform3fvARB(pidx->eyepos, 1, eyepos.getValue());
+  glue->glUniform3fvARB(pidx->specular, 1, spec.getValue());
+  glue->glUniform1fARB(pidx->shininess, shininess * 64.0f);
+
+  if (!SoGLDriverDatabase::isSupported(glue, SO_GL_VBO_IN_DISPLAYLIST)) {
+    SoCacheElement::invalidate(state);
+    SoGLCacheContextElement::shouldAutoCache(state,
+                                             SoGLCacheContextElement::DONT_AUTO_CACHE);
+  }
+
+  const SbVec3f * tptr = this->tangentlist.getArrayPtr();
+
+  cc_glglue_glVertexPointer(glue, 3, GL_FLOAT, 0,
+                            (GLvoid*) cache->getVertexArray());
+  cc_glglue_glEnableClientState(glue, GL_VERTEX_ARRAY);
+  cc_glglue_glNormalPointer(glue, GL_FLOAT, 0,
+                            (GLvoid*) cache->getNormalArray());
+  cc_glglue_glEnableClientState(glue, GL_NORMAL_ARRAY);
+  if (colorpervertex) {
+    cc_glglue_glColorPointer(glue, 4, GL_UNSIGNED_BYTE, 0,
+                             (GLvoid*) cache->getColorArray());
+    cc_glglue_glEnableClientState(glue, GL_COLOR_ARRAY);
+  }
+  if (hastexture) {
+    cc_glglue_glTexCoordPointer(glue, 4, GL_FLOAT, 0,
+                                (GLvoid*) cache->getTexCoordArray());
+    cc_glglue_glEnableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  }
+  cc_glglue_glClientActiveTexture(glue, GL_TEXTURE1);
+  cc_glglue_glTexCoordPointer(glue, 2, GL_FLOAT, 0,
+                              (GLvoid*) cache->getBumpCoordArray());
+  cc_glglue_glEnableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  cc_glglue_glClientActiveTexture(glue, GL_TEXTURE2);
+  cc_glglue_glTexCoordPointer(glue, 3, GL_FLOAT, 6*sizeof(float), (GLvoid*) tptr);
+  cc_glglue_glEnableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  cc_glglue_glClientActiveTexture(glue, GL_TEXTURE3);
+  cc_glglue_glTexCoordPointer(glue, 3, GL_FLOAT, 6*sizeof(float), (GLvoid*) (tptr + 1));
+  cc_glglue_glEnableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+
+  cc_glglue_glDrawElements(glue, GL_TRIANGLES, n, GL_UNSIGNED_INT,
+                           (const GLvoid*) cache->getTriangleIndices());
+
+  cc_glglue_glDisableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  cc_glglue_glClientActiveTexture(glue, GL_TEXTURE2);
+  cc_glglue_glDisableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  cc_glglue_glClientActiveTexture(glue, GL_TEXTURE1);
+  cc_glglue_glDisableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  cc_glglue_glClientActiveTexture(glue, GL_TEXTURE0);
+  if (hastexture) cc_glglue_glDisableClientState(glue, GL_TEXTURE_COORD_ARRAY);
+  if (colorpervertex) {
+    cc_glglue_glDisableClientState(glue, GL_COLOR_ARRAY);
+    SoGLLazyElement::getInstance(state)->reset(state, SoLazyElement::DIFFUSE_MASK);
+  }
+  cc_glglue_glDisableClientState(glue, GL_NORMAL_ARRAY);
+  cc_glglue_glDisableClientState(glue, GL_VERTEX_ARRAY);
+
+  glue->glUseProgramObjectARB(0);
+
+  cc_glglue_glActiveTexture(glue, GL_TEXTURE1);
+  glMatrixMode(GL_TEXTURE);
+  glLoadMatrixf(oldtexture1matrix[0]);
+  glMatrixMode(GL_MODELVIEW);
+  SoGLMultiTextureImageElement::Model model;
+  SbColor blendcolor;
+  if (SoGLMultiTextureImageElement::get(state, 1, model, blendcolor)) {
+    SoGLMultiTextureImageElement::restore(state, 1);
+  }
+  else {
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+  cc_glglue_glActiveTexture(glue, GL_TEXTURE0);
+}
+
 void
 soshape_bumprender::renderBumpSpecular(SoState * state,
                                        const SoPrimitiveVertexCache * cache,
@@ -758,6 +1265,21 @@ soshape_bumprender::renderNormal(SoState * state, const SoPrimitiveVertexCache *
   }
 }
 
+//
+// Recalculates the tangent frames if the primitive vertex cache has
+// been regenerated since the last call. The cache is referenced to
+// make sure a new cache can't be allocated at the same address.
+//
+void
+soshape_bumprender::updateTangentSpace(SoPrimitiveVertexCache * cache)
+{
+  if (cache == this->tangentcache) return;
+  cache->ref();
+  if (this->tangentcache) this->tangentcache->unref();
+  this->tangentcache = cache;
+  this->calcTangentSpace(cache);
+}
+
 void
 soshape_bumprender::calcTangentSpace(const SoPrimitiveVertexCache * cache)
 {
@@ -883,3 +1405,70 @@ soshape_bumprender::getLightVec(const SbVec3f & v) const
   }
   else return this->lightvec;
 }
+
+#ifdef COIN_TEST_SUITE
+
+#include <Inventor/C/tidbits.h>
+#include <Inventor/SbViewportRegion.h>
+#include <Inventor/SoOffscreenRenderer.h>
+#include <Inventor/errors/SoDebugError.h>
+#include <Inventor/nodes/SoBumpMap.h>
+#include <Inventor/nodes/SoCube.h>
+#include <Inventor/nodes/SoDirectionalLight.h>
+#include <Inventor/nodes/SoOrthographicCamera.h>
+#include <Inventor/nodes/SoSeparator.h>
+#include <cstring>
+
+static void
+bumpshadererrorCB(const SoError * error, void * data)
+{
+  if (strstr(error->getDebugString().getString(), "bump mapping shaders")) {
+    *((SbBool *) data) = TRUE;
+  }
+}
+
+// The single pass shaders must compile and link. This needs a GL
+// context, so the test is reported as skipped if the offscreen
+// renderer cannot create one.
+BOOST_AUTO_TEST_CASE(singlePassShadersLink)
+{
+#if !defined(_WIN32) && !defined(__APPLE__)
+  // offscreen contexts need an X display with GLX
+  if (coin_getenv("DISPLAY") == NULL) {
+    BOOST_WARN_MESSAGE(FALSE, "singlePassShadersLink skipped: no X display");
+    return;
+  }
+#endif // !_WIN32 && !__APPLE__
+
+  SoSeparator * root = new SoSeparator;
+  root->ref();
+  SoOrthographicCamera * camera = new SoOrthographicCamera;
+  root->addChild(camera);
+  root->addChild(new SoDirectionalLight);
+  SoBumpMap * bumpmap = new SoBumpMap;
+  const unsigned char flat[] = { 128, 128, 255 };
+  bumpmap->image.setValue(SbVec2s(1, 1), 3, flat);
+  root->addChild(bumpmap);
+  root->addChild(new SoCube);
+
+  const SbViewportRegion vp(32, 32);
+  camera->viewAll(root, vp);
+
+  SbBool failed = FALSE;
+  SoErrorCB * prevcb = SoDebugError::getHandlerCallback();
+  void * prevdata = SoDebugError::getHandlerData();
+  SoDebugError::setHandlerCallback(bumpshadererrorCB, &failed);
+  SoOffscreenRenderer renderer(vp);
+  const SbBool rendered = renderer.render(root);
+  SoDebugError::setHandlerCallback(prevcb, prevdata);
+
+  if (rendered) {
+    BOOST_CHECK_MESSAGE(!failed, "unable to compile bump mapping shaders");
+  }
+  else {
+    BOOST_WARN_MESSAGE(FALSE, "singlePassShadersLink skipped: no GL context");
+  }
+  root->unref();
+}
+
+#endif // COIN_TEST_SUITE
@@ -41,6 +41,7 @@
 #include <Inventor/C/glue/gl.h>
 
 #include "misc/SbHash.h"
+#include "glue/glp.h"
 
 // *************************************************************************
 
@@ -49,17 +50,20 @@ class SoLight;
 class SoGLImage;
 class SbMatrix;
 class SoPrimitiveVertexCache;
+class SoNodeList;
 
 // *************************************************************************
 
-// FIXME: inherit from SoCache to avoid regenerating everything every frame
-
 class soshape_bumprender {
 public:
   soshape_bumprender(void);
   ~soshape_bumprender();
 
-  void calcTangentSpace(const SoPrimitiveVertexCache * cache);
+  void updateTangentSpace(SoPrimitiveVertexCache * cache);
+  SbBool canRenderSinglePass(SoState * state, const int numlights);
+  void renderBumpSinglePass(SoState * state,
+                            const SoPrimitiveVertexCache * cache,
+                            const SoNodeList & lights);
   void renderBump(SoState * state,
                   const SoPrimitiveVertexCache * cache,
                   SoLight * light, const SbMatrix & toobjectspace);
@@ -68,13 +72,38 @@ public:
                           SoLight * light, const SbMatrix & toobjectspace);
   void renderNormal(SoState * state, const SoPrimitiveVertexCache * cache);
 
+  enum { MAXLIGHTS = 8 };
+
 private:
 
+  struct glsl_programidx {
+    const cc_glglue * glue;
+    COIN_GLhandle program;
+    GLint lightpos;
+    GLint lightdiffuse;
+    GLint lighteyepos;
+    GLint lightattenuation;
+    GLint lightspot;
+    GLint lightspotexponent;
+    GLint numlights;
+    GLint ambient;
+    GLint eyepos;
+    GLint specular;
+    GLint shininess;
+    GLint bumpmap;
+    GLint texturemap;
+    GLint hastexture;
+  };
+
+  void calcTangentSpace(const SoPrimitiveVertexCache * cache);
   void initLight(SoLight * light, const SbMatrix & m);
   void calcTSBCoords(const SoPrimitiveVertexCache * cache, SoLight * light);
   SbVec3f getLightVec(const SbVec3f & v) const;
   void initPrograms(const cc_glglue * glue, SoState * state);
   void initDiffusePrograms(const cc_glglue * glue, SoState * state);
+  static glsl_programidx * getGLSLProgram(const cc_glglue * glue);
+  static void glslprogramdeletion(uint32_t contextid, void * closure);
+  static void glslprogramcleanup(void);
 
   void soshape_diffuseprogramdeletion(unsigned long key, void * value);
   void soshape_specularprogramdeletion(unsigned long key, void * value);
@@ -95,6 +124,8 @@ private:
 
   SbList <SbVec3f> cubemaplist;
   SbList <SbVec3f> tangentlist;
+  // the primitive vertex cache tangentlist was calculated from
+  SoPrimitiveVertexCache * tangentcache;
 
   SbVec3f lightvec;
   SbBool ispointlight;
@@ -1746,6 +1746,95 @@ coin_geq_prime_number(unsigned long num)
 
 /**************************************************************************/
 
+/*
+  Maps the values linearly onto integer keys between 0 and
+  2^keybits-1, where the smallest value gets key 0 and the largest
+  value gets the largest key. Used for sorting floating point values
+  with coin_radix_sort().
+
+  Only finite values decide the range. Infinite values get the key at
+  their end of the range, and NaN values get key 0.
+*/
+void
+coin_quantize_floats(const float * values, uint32_t * keys,
+                     const int num, const int keybits)
+{
+  int i;
+  float minval, maxval, scale;
+  const uint32_t maxkey = (keybits >= 32) ? 0xffffffffU : ((1U << keybits) - 1);
+
+  if (num <= 0) return;
+  minval = FLT_MAX;
+  maxval = -FLT_MAX;
+  for (i = 0; i < num; i++) {
+    const float v = values[i];
+    if (!coin_finite(v)) continue;
+    if (v < minval) minval = v;
+    if (v > maxval) maxval = v;
+  }
+  if (minval > maxval) minval = maxval = 0.0f; /* no finite values */
+  scale = (maxval > minval) ? ((float) maxkey) / (maxval - minval) : 0.0f;
+  for (i = 0; i < num; i++) {
+    const float v = values[i];
+    /* the float to integer conversion is undefined for NaN, and for
+       values outside the key range */
+    if (coin_isnan(v)) keys[i] = 0;
+    else if (!coin_finite(v)) keys[i] = (v > 0.0f) ? maxkey : 0;
+    else {
+      const float k = (v - minval) * scale;
+      keys[i] = (k >= (float) maxkey) ? maxkey : ((k > 0.0f) ? (uint32_t) k : 0);
+    }
+  }
+}
+
+/*
+  Stable LSD radix sort of the num indices in order, using
+  keys[order[i]] as the sort key. Only the lowest keybits bits of the
+  keys are used, and each pass sorts on 8 bits. scratch must have room
+  for num indices.
+
+  The function returns FALSE without doing anything if order is
+  already sorted, and since the sort is stable equal keys keep their
+  relative order. Passing in the order from a previous sort of the
+  same elements is therefore cheap when the keys change little.
+*/
+SbBool
+coin_radix_sort(const uint32_t * keys, int * order, int * scratch,
+                const int num, const int keybits)
+{
+  int i, shift;
+  int * src = order;
+  int * dst = scratch;
+
+  for (i = 1; i < num; i++) {
+    if (keys[order[i]] < keys[order[i-1]]) break;
+  }
+  if (i >= num) return FALSE;
+
+  for (shift = 0; shift < keybits; shift += 8) {
+    int count[256];
+    int sum = 0;
+    for (i = 0; i < 256; i++) count[i] = 0;
+    for (i = 0; i < num; i++) count[(keys[src[i]] >> shift) & 0xff]++;
+    for (i = 0; i < 256; i++) {
+      const int c = count[i];
+      count[i] = sum;
+      sum += c;
+    }
+    for (i = 0; i < num; i++) {
+      const int idx = src[i];
+      dst[count[(keys[idx] >> shift) & 0xff]++] = idx;
+    }
+    int * tmp = src; src = dst; dst = tmp;
+  }
+  if (src != order) {
+    (void) memcpy(order, src, num * sizeof(int));
+  }
+  return TRUE;
+}
+
+/**************************************************************************/
+
 int
 coin_runtime_os(void)
 {
@@ -1824,3 +1913,58 @@ coin_debug_caching_level(void)
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
+
+#ifdef COIN_TEST_SUITE
+
+#include <cmath>
+#include <limits>
+
+// coin_quantize_floats() is internal, so it is declared here instead
+// of including tidbitsp.h.
+extern "C" {
+void coin_quantize_floats(const float * values, uint32_t * keys,
+                          const int num, const int keybits);
+}
+
+// The keys keep the order of the values, and span the whole key range.
+BOOST_AUTO_TEST_CASE(quantizeFloats)
+{
+  const float values[] = { 2.0f, -1.0f, 0.5f, 3.0f, 0.5f };
+  uint32_t keys[5];
+  coin_quantize_floats(values, keys, 5, 16);
+  BOOST_CHECK_EQUAL(keys[1], 0u);
+  BOOST_CHECK_EQUAL(keys[3], 0xffffu);
+  BOOST_CHECK(keys[1] < keys[2] && keys[2] < keys[0] && keys[0] < keys[3]);
+  BOOST_CHECK_EQUAL(keys[2], keys[4]);
+
+  // all keys are equal when the values are
+  const float same[] = { 7.0f, 7.0f };
+  coin_quantize_floats(same, keys, 2, 16);
+  BOOST_CHECK_EQUAL(keys[0], 0u);
+  BOOST_CHECK_EQUAL(keys[1], 0u);
+}
+
+// NaN and infinite values must not reach the float to integer
+// conversion, or spoil the range of the finite values.
+BOOST_AUTO_TEST_CASE(quantizeFloatsNotFinite)
+{
+  const float nan = float(std::sqrt(-1.0));
+  const float inf = std::numeric_limits<float>::infinity();
+  const float values[] = { nan, 1.0f, inf, -inf, 3.0f, nan, 2.0f };
+  uint32_t keys[7];
+  coin_quantize_floats(values, keys, 7, 16);
+  BOOST_CHECK_EQUAL(keys[0], 0u);
+  BOOST_CHECK_EQUAL(keys[5], 0u);
+  BOOST_CHECK_EQUAL(keys[2], 0xffffu);
+  BOOST_CHECK_EQUAL(keys[3], 0u);
+  BOOST_CHECK_EQUAL(keys[1], 0u);
+  BOOST_CHECK_EQUAL(keys[4], 0xffffu);
+  BOOST_CHECK(keys[6] > 0u && keys[6] < 0xffffu);
+
+  const float nans[] = { nan, nan };
+  coin_quantize_floats(nans, keys, 2, 16);
+  BOOST_CHECK_EQUAL(keys[0], 0u);
+  BOOST_CHECK_EQUAL(keys[1], 0u);
+}
+
+#endif // COIN_TEST_SUITE
@@ -90,6 +90,11 @@ enum coin_atexit_priorities {
 
   /* Relative priorities */
 
+  /* Objects waiting for deferred destruction must be destroyed
+     before any other Coin cleanup code runs, and deferral must be
+     turned off so objects released by that code die immediately. */
+  CC_ATEXIT_DEFERRED_DESTRUCTION = CC_ATEXIT_NORMAL + 20,
+
   /* The realTime field should be cleaned up before normal cleanups
      are called, since the global field list will be cleaned up there.
   */
@@ -249,6 +254,13 @@ unsigned long coin_geq_prime_number(unsigned long num);
 
 /* ********************************************************************** */
 
+void coin_quantize_floats(const float * values, uint32_t * keys,
+                          const int num, const int keybits);
+SbBool coin_radix_sort(const uint32_t * keys, int * order, int * scratch,
+                       const int num, const int keybits);
+
+/* ********************************************************************** */
+
 enum CoinOSType {
   COIN_UNIX,
   COIN_OS_X,
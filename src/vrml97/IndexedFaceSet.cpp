@@ -542,6 +542,9 @@ SoVRMLIndexedFaceSet::GLRender(SoGLRenderAction * action)
     !convexcacheused && !normalCacheUsed &&
     ((nbind == OVERALL) || ((nbind == PER_VERTEX_INDEXED) && ((nindices == cindices) || (nindices == NULL)))) &&
     ((tbind == NONE && !tb.needCoordinates()) || 
+     // function coordinates are generated for the vertex array
+     (tbind == NONE && tb.isFunction() && coords->is3D() &&
+      (nbind == PER_VERTEX_INDEXED)) ||
      ((tbind == PER_VERTEX_INDEXED) && ((tindices == cindices) || (tindices == NULL)))) &&
     ((mbind == NONE) || ((mbind == PER_VERTEX_INDEXED) && ((mindices == cindices) || (mindices == NULL)))) &&
     SoGLDriverDatabase::isSupported(sogl_glue_instance(state), SO_GL_VERTEX_ARRAY);
@@ -226,6 +226,7 @@
 #include <Inventor/SoDB.h>
 
 #include "engines/SoSubNodeEngineP.h"
+#include "misc/SoDBP.h"
 
 #ifndef DOXYGEN_SKIP_THIS
 
@@ -245,6 +246,19 @@ public:
 
 SO_NODEENGINE_SOURCE(SoVRMLTimeSensor);
 
+// Called from SoDBP::updateRealTimeFieldCB() together with all other
+// realtime animators. Notification on timeIn is disabled while the
+// sensor is not active, so there is nothing to pass on then.
+static void
+vrmltimesensor_realtime_animator(SoBase * animator, SoNotList * list)
+{
+  SoVRMLTimeSensor * sensor = static_cast<SoVRMLTimeSensor *>(animator);
+  SoField * timein = sensor->getField(SbName("timeIn"));
+  if (timein->isNotifyEnabled()) {
+    SoDBP::notifyRealTimeInput(timein, list);
+  }
+}
+
 /*!
   \copydetails SoNode::initClass(void)
 */
@@ -291,6 +305,7 @@ SoVRMLTimeSensor::SoVRMLTimeSensor(void)
   this->timeIn.enableNotify(FALSE);
   SoField * realtime = SoDB::getGlobalField("realTime");
   this->timeIn.connectFrom(realtime);
+  SoDBP::addRealTimeAnimator(vrmltimesensor_realtime_animator, this);
 
   // we always connect and just disable notification when timer
   // is not active, since it is currently not possible to disconnect
@@ -309,14 +324,18 @@ SoVRMLTimeSensor::SoVRMLTimeSensor(void)
 */
 SoVRMLTimeSensor::~SoVRMLTimeSensor()
 {
+    SoDBP::removeRealTimeAnimator(this);
     delete PRIVATE(this);
     PRIVATE(this) = 0;
 }
 
-// Doc in parent
+// Doc in parent. Overridden to ignore the realTime field's own
+// notification of timeIn during a realTime update, as the tick is
+// passed on from vrmltimesensor_realtime_animator().
 void
 SoVRMLTimeSensor::notify(SoNotList * list)
 {
+  if (SoDBP::isRealTimeTick(list, &this->timeIn)) return;
   inherited::notify(list);
 }
 